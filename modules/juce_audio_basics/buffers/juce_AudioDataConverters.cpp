@@ -472,6 +472,314 @@ void AudioDataConverters::deinterleaveSamples (const float* const source,
 }
 
 
+//==============================================================================
+#if JUCE_USE_SSE_INTRINSICS && JUCE_LITTLE_ENDIAN
+
+namespace AudioDataConversionHelpers
+{
+    static inline __m128i loadInt16s (const char* src, const int stride) noexcept
+    {
+        return _mm_set_epi32 (*(const int16*) (src + 3 * stride), *(const int16*) (src + 2 * stride),
+                              *(const int16*) (src + stride), *(const int16*) src);
+    }
+
+    // NB: this reads a 4th byte after each sample, so the caller must make sure that there's
+    // some more data following the last of the samples that it asks for.
+    static inline __m128i loadInt24s (const char* src, const int stride) noexcept
+    {
+        const __m128i v = _mm_set_epi32 ((int) ByteOrder::littleEndianInt (src + 3 * stride), (int) ByteOrder::littleEndianInt (src + 2 * stride),
+                                         (int) ByteOrder::littleEndianInt (src + stride), (int) ByteOrder::littleEndianInt (src));
+        return _mm_srai_epi32 (_mm_slli_epi32 (v, 8), 8);
+    }
+
+    static inline __m128i loadInt32s (const char* src, const int stride) noexcept
+    {
+        return _mm_set_epi32 (*(const int32*) (src + 3 * stride), *(const int32*) (src + 2 * stride),
+                              *(const int32*) (src + stride), *(const int32*) src);
+    }
+
+    // When the integer formats copy from a Float32, they take the top bits of Float32::getAsInt32(),
+    // which clips to +/-1 and then rounds to the nearest 32-bit int. To produce exactly the same
+    // results as the generic code, this does the same thing in doubles, two samples at a time.
+    static inline int32 floatToInt32 (const float f) noexcept
+    {
+        return (int32) roundToInt (jlimit (-1.0, 1.0, (double) f) * (double) 0x7fffffff);
+    }
+
+    static inline __m128i floatToInt32 (const __m128 v) noexcept
+    {
+        const __m128d minusOne = _mm_set1_pd (-1.0), one = _mm_set1_pd (1.0), scale = _mm_set1_pd ((double) 0x7fffffff);
+        const __m128d lo = _mm_mul_pd (scale, _mm_min_pd (one, _mm_max_pd (minusOne, _mm_cvtps_pd (v))));
+        const __m128d hi = _mm_mul_pd (scale, _mm_min_pd (one, _mm_max_pd (minusOne, _mm_cvtps_pd (_mm_movehl_ps (v, v)))));
+        return _mm_unpacklo_epi64 (_mm_cvtpd_epi32 (lo), _mm_cvtpd_epi32 (hi));
+    }
+
+    template <int bitsToDiscard>
+    static inline void storeInts (char* dest, const int stride, const __m128i v) noexcept;
+
+    template <>
+    inline void storeInts<16> (char* dest, const int stride, const __m128i v) noexcept
+    {
+        *(int16*) dest                = (int16) _mm_extract_epi16 (v, 1);
+        *(int16*) (dest + stride)     = (int16) _mm_extract_epi16 (v, 3);
+        *(int16*) (dest + 2 * stride) = (int16) _mm_extract_epi16 (v, 5);
+        *(int16*) (dest + 3 * stride) = (int16) _mm_extract_epi16 (v, 7);
+    }
+
+    template <>
+    inline void storeInts<8> (char* dest, const int stride, const __m128i v) noexcept
+    {
+        int32 values[4];
+        _mm_storeu_si128 ((__m128i*) values, _mm_srai_epi32 (v, 8));
+
+        if (stride == 3)
+        {
+            // packed 24-bit samples can be written as overlapping 32-bit words, as long as
+            // they're written in order and the last one is trimmed back to 3 bytes
+            *(int32*) dest       = values[0];
+            *(int32*) (dest + 3) = values[1];
+            *(int32*) (dest + 6) = values[2];
+            ByteOrder::littleEndian24BitToChars (values[3], dest + 9);
+        }
+        else
+        {
+            for (int i = 0; i < 4; ++i)
+                ByteOrder::littleEndian24BitToChars (values[i], dest + i * stride);
+        }
+    }
+
+    template <>
+    inline void storeInts<0> (char* dest, const int stride, const __m128i v) noexcept
+    {
+        int32 values[4];
+        _mm_storeu_si128 ((__m128i*) values, v);
+
+        for (int i = 0; i < 4; ++i)
+            *(int32*) (dest + i * stride) = values[i];
+    }
+}
+
+template <>
+bool AudioData::FastConverters::convert<AudioData::Float32, AudioData::Int16> (void* dest, int destStride, const void* source, int sourceStride, int numSamples) noexcept
+{
+    using namespace AudioDataConversionHelpers;
+
+    if (destStride != sizeof (float))
+        return false;
+
+    const float scale = 1.0f / 0x8000;
+    const __m128 scale4 = _mm_set1_ps (scale);
+    const char* src = static_cast <const char*> (source);
+    float* dst = static_cast <float*> (dest);
+
+    if (sourceStride == sizeof (int16))
+    {
+        for (; numSamples >= 8; numSamples -= 8)
+        {
+            const __m128i v = _mm_loadu_si128 ((const __m128i*) src);
+            _mm_storeu_ps (dst,     _mm_mul_ps (scale4, _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16))));
+            _mm_storeu_ps (dst + 4, _mm_mul_ps (scale4, _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16))));
+            src += 16;
+            dst += 8;
+        }
+    }
+    else
+    {
+        for (; numSamples >= 4; numSamples -= 4)
+        {
+            _mm_storeu_ps (dst, _mm_mul_ps (scale4, _mm_cvtepi32_ps (loadInt16s (src, sourceStride))));
+            src += 4 * sourceStride;
+            dst += 4;
+        }
+    }
+
+    for (; --numSamples >= 0; src += sourceStride)
+        *dst++ = scale * *(const int16*) src;
+
+    return true;
+}
+
+template <>
+bool AudioData::FastConverters::convert<AudioData::Float32, AudioData::Int24> (void* dest, int destStride, const void* source, int sourceStride, int numSamples) noexcept
+{
+    using namespace AudioDataConversionHelpers;
+
+    if (destStride != sizeof (float))
+        return false;
+
+    const float scale = 1.0f / 0x800000;
+    const __m128 scale4 = _mm_set1_ps (scale);
+    const char* src = static_cast <const char*> (source);
+    float* dst = static_cast <float*> (dest);
+
+    for (; numSamples > 4; numSamples -= 4) // (stops short so that loadInt24s never reads past the end)
+    {
+        _mm_storeu_ps (dst, _mm_mul_ps (scale4, _mm_cvtepi32_ps (loadInt24s (src, sourceStride))));
+        src += 4 * sourceStride;
+        dst += 4;
+    }
+
+    for (; --numSamples >= 0; src += sourceStride)
+        *dst++ = scale * ByteOrder::littleEndian24Bit (src);
+
+    return true;
+}
+
+template <>
+bool AudioData::FastConverters::convert<AudioData::Float32, AudioData::Int32> (void* dest, int destStride, const void* source, int sourceStride, int numSamples) noexcept
+{
+    using namespace AudioDataConversionHelpers;
+
+    if (destStride != sizeof (float))
+        return false;
+
+    const float scale = 1.0f / 0x80000000;
+    const __m128 scale4 = _mm_set1_ps (scale);
+    const char* src = static_cast <const char*> (source);
+    float* dst = static_cast <float*> (dest);
+
+    if (sourceStride == sizeof (int32))
+    {
+        for (; numSamples >= 4; numSamples -= 4)
+        {
+            _mm_storeu_ps (dst, _mm_mul_ps (scale4, _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i*) src))));
+            src += 16;
+            dst += 4;
+        }
+    }
+    else
+    {
+        for (; numSamples >= 4; numSamples -= 4)
+        {
+            _mm_storeu_ps (dst, _mm_mul_ps (scale4, _mm_cvtepi32_ps (loadInt32s (src, sourceStride))));
+            src += 4 * sourceStride;
+            dst += 4;
+        }
+    }
+
+    for (; --numSamples >= 0; src += sourceStride)
+        *dst++ = scale * (float) *(const int32*) src;
+
+    return true;
+}
+
+template <>
+bool AudioData::FastConverters::convert<AudioData::Int16, AudioData::Float32> (void* dest, int destStride, const void* source, int sourceStride, int numSamples) noexcept
+{
+    using namespace AudioDataConversionHelpers;
+
+    if (sourceStride != sizeof (float))
+        return false;
+
+    const float* src = static_cast <const float*> (source);
+    char* dst = static_cast <char*> (dest);
+
+    if (destStride == sizeof (int16))
+    {
+        for (; numSamples >= 8; numSamples -= 8)
+        {
+            const __m128i lo = _mm_srai_epi32 (floatToInt32 (_mm_loadu_ps (src)), 16);
+            const __m128i hi = _mm_srai_epi32 (floatToInt32 (_mm_loadu_ps (src + 4)), 16);
+            _mm_storeu_si128 ((__m128i*) dst, _mm_packs_epi32 (lo, hi));
+            src += 8;
+            dst += 16;
+        }
+    }
+    else
+    {
+        for (; numSamples >= 4; numSamples -= 4)
+        {
+            storeInts<16> (dst, destStride, floatToInt32 (_mm_loadu_ps (src)));
+            src += 4;
+            dst += 4 * destStride;
+        }
+    }
+
+    for (; --numSamples >= 0; dst += destStride)
+        *(int16*) dst = (int16) (floatToInt32 (*src++) >> 16);
+
+    return true;
+}
+
+template <>
+bool AudioData::FastConverters::convert<AudioData::Int24, AudioData::Float32> (void* dest, int destStride, const void* source, int sourceStride, int numSamples) noexcept
+{
+    using namespace AudioDataConversionHelpers;
+
+    if (sourceStride != sizeof (float))
+        return false;
+
+    const float* src = static_cast <const float*> (source);
+    char* dst = static_cast <char*> (dest);
+
+    for (; numSamples >= 4; numSamples -= 4)
+    {
+        storeInts<8> (dst, destStride, floatToInt32 (_mm_loadu_ps (src)));
+        src += 4;
+        dst += 4 * destStride;
+    }
+
+    for (; --numSamples >= 0; dst += destStride)
+        ByteOrder::littleEndian24BitToChars (floatToInt32 (*src++) >> 8, dst);
+
+    return true;
+}
+
+template <>
+bool AudioData::FastConverters::convert<AudioData::Int32, AudioData::Float32> (void* dest, int destStride, const void* source, int sourceStride, int numSamples) noexcept
+{
+    using namespace AudioDataConversionHelpers;
+
+    if (sourceStride != sizeof (float))
+        return false;
+
+    const float* src = static_cast <const float*> (source);
+    char* dst = static_cast <char*> (dest);
+
+    if (destStride == sizeof (int32))
+    {
+        for (; numSamples >= 4; numSamples -= 4)
+        {
+            _mm_storeu_si128 ((__m128i*) dst, floatToInt32 (_mm_loadu_ps (src)));
+            src += 4;
+            dst += 16;
+        }
+    }
+    else
+    {
+        for (; numSamples >= 4; numSamples -= 4)
+        {
+            storeInts<0> (dst, destStride, floatToInt32 (_mm_loadu_ps (src)));
+            src += 4;
+            dst += 4 * destStride;
+        }
+    }
+
+    for (; --numSamples >= 0; dst += destStride)
+        *(int32*) dst = floatToInt32 (*src++);
+
+    return true;
+}
+
+#else
+
+// Without SSE, the generic templated loops in AudioData::Pointer are as good as anything we could do here.
+#define JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION(DestFormat, SourceFormat) \
+    template <> \
+    bool AudioData::FastConverters::convert<AudioData::DestFormat, AudioData::SourceFormat> (void*, int, const void*, int, int) noexcept  { return false; }
+
+JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION (Float32, Int16)
+JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION (Float32, Int24)
+JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION (Float32, Int32)
+JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION (Int16, Float32)
+JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION (Int24, Float32)
+JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION (Int32, Float32)
+
+#undef JUCE_DECLARE_UNAVAILABLE_FAST_CONVERSION
+
+#endif
+
+
 //==============================================================================
 #if JUCE_UNIT_TESTS
 
@@ -581,6 +889,153 @@ public:
         }
     };
 
+    //==============================================================================
+    // Checks the optimised conversions between interleaved integers and non-interleaved floats
+    // against a plain sample-by-sample loop, which they should match exactly.
+    template <class IntFormat>
+    struct FastPathTest
+    {
+        typedef AudioData::Pointer<AudioData::Float32, AudioData::NativeEndian, AudioData::NonInterleaved, AudioData::NonConst> FloatDest;
+        typedef AudioData::Pointer<AudioData::Float32, AudioData::NativeEndian, AudioData::NonInterleaved, AudioData::Const>    FloatSource;
+        typedef AudioData::Pointer<IntFormat, AudioData::LittleEndian, AudioData::Interleaved, AudioData::NonConst>             IntDest;
+        typedef AudioData::Pointer<IntFormat, AudioData::LittleEndian, AudioData::Interleaved, AudioData::Const>                IntSource;
+
+        static void test (UnitTest& unitTest, Random& r)
+        {
+            for (int numChannels = 1; numChannels <= 3; ++numChannels)
+            {
+                for (int numSamples = 0; numSamples < 20; ++numSamples)
+                    for (int channel = 0; channel < numChannels; ++channel)
+                        test (unitTest, r, numChannels, channel, numSamples);
+
+                test (unitTest, r, numChannels, numChannels - 1, 1001);
+            }
+        }
+
+        static void test (UnitTest& unitTest, Random& r, const int numChannels, const int channel, const int numSamples)
+        {
+            const int bytesPerSample = IntSource::getBytesPerSample();
+            const int intBufferSize = numSamples * numChannels * bytesPerSample;
+
+            // (these are allocated at exactly the right size so that a memory checker will catch any overruns)
+            HeapBlock<char> ints ((size_t) intBufferSize), intsConverted ((size_t) intBufferSize), intsExpected ((size_t) intBufferSize);
+            HeapBlock<float> floats ((size_t) numSamples), floatsConverted ((size_t) numSamples), floatsExpected ((size_t) numSamples);
+
+            for (int i = 0; i < intBufferSize; ++i)
+                ints[i] = (char) r.nextInt (256);
+
+            for (int i = 0; i < numSamples; ++i)
+                floats[i] = r.nextFloat() * 2.4f - 1.2f;
+
+            {
+                AudioData::ConverterInstance<IntSource, FloatDest> conv (numChannels, 1);
+                conv.convertSamples (floatsConverted, 0, ints, channel, numSamples);
+
+                IntSource s (addBytesToPointer (ints.getData(), channel * bytesPerSample), numChannels);
+                FloatDest d (floatsExpected);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    d.setAsFloat (s.getAsFloat());
+                    ++s;
+                    ++d;
+                }
+
+                unitTest.expect (memcmp (floatsConverted, floatsExpected, sizeof (float) * (size_t) numSamples) == 0);
+            }
+
+            {
+                memcpy (intsConverted, ints, (size_t) intBufferSize);
+                memcpy (intsExpected, ints, (size_t) intBufferSize);
+
+                AudioData::ConverterInstance<FloatSource, IntDest> conv (1, numChannels);
+                conv.convertSamples (intsConverted, channel, floats, 0, numSamples);
+
+                FloatSource s (floats);
+                IntDest d (addBytesToPointer (intsExpected.getData(), channel * bytesPerSample), numChannels);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    d.setAsInt32 (s.getAsInt32());
+                    ++s;
+                    ++d;
+                }
+
+                // (this also checks that the other channels haven't been touched)
+                unitTest.expect (memcmp (intsConverted, intsExpected, (size_t) intBufferSize) == 0);
+            }
+        }
+
+        static void comparePerformance (UnitTest& unitTest, const String& formatName, const int numChannels)
+        {
+            const int numSamples = 4096, numRepeats = 500;
+            HeapBlock<char> ints ((size_t) (numSamples * numChannels * IntSource::getBytesPerSample()), true);
+            HeapBlock<float> floats ((size_t) numSamples, true);
+            double toFloat[2], fromFloat[2];
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                int64 start = Time::getHighResolutionTicks();
+
+                for (int i = 0; i < numRepeats; ++i)
+                {
+                    if (pass == 0)
+                    {
+                        IntSource s (ints, numChannels);
+                        FloatDest d (floats);
+
+                        for (int j = numSamples; --j >= 0;)
+                        {
+                            d.setAsFloat (s.getAsFloat());
+                            ++s;
+                            ++d;
+                        }
+                    }
+                    else
+                    {
+                        FloatDest (floats).convertSamples (IntSource (ints, numChannels), numSamples);
+                    }
+                }
+
+                toFloat[pass] = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+                start = Time::getHighResolutionTicks();
+
+                for (int i = 0; i < numRepeats; ++i)
+                {
+                    if (pass == 0)
+                    {
+                        FloatSource s (floats);
+                        IntDest d (ints, numChannels);
+
+                        for (int j = numSamples; --j >= 0;)
+                        {
+                            d.setAsInt32 (s.getAsInt32());
+                            ++s;
+                            ++d;
+                        }
+                    }
+                    else
+                    {
+                        IntDest (ints, numChannels).convertSamples (FloatSource (floats), numSamples);
+                    }
+                }
+
+                fromFloat[pass] = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            }
+
+            const double numConverted = (double) numSamples * numRepeats * 1.0e-6;
+            const String name (formatName + " (" + String (numChannels) + "ch)");
+
+            unitTest.logMessage ((name + " -> Float32").paddedRight (' ', 24)
+                                   + String (numConverted / jmax (1.0e-9, toFloat[1]), 1) + " Msamples/sec, generic loop: "
+                                   + String (numConverted / jmax (1.0e-9, toFloat[0]), 1) + " Msamples/sec");
+
+            unitTest.logMessage (("Float32 -> " + name).paddedRight (' ', 24)
+                                   + String (numConverted / jmax (1.0e-9, fromFloat[1]), 1) + " Msamples/sec, generic loop: "
+                                   + String (numConverted / jmax (1.0e-9, fromFloat[0]), 1) + " Msamples/sec");
+        }
+    };
+
     void runTest()
     {
         beginTest ("Round-trip conversion: Int8");
@@ -593,6 +1048,21 @@ public:
         Test1 <AudioData::Int32>::test (*this);
         beginTest ("Round-trip conversion: Float32");
         Test1 <AudioData::Float32>::test (*this);
+
+        beginTest ("Optimised conversions");
+        Random r;
+        FastPathTest <AudioData::Int16>::test (*this, r);
+        FastPathTest <AudioData::Int24>::test (*this, r);
+        FastPathTest <AudioData::Int32>::test (*this, r);
+
+        beginTest ("Performance");
+
+        for (int numChannels = 1; numChannels <= 2; ++numChannels)
+        {
+            FastPathTest <AudioData::Int16>::comparePerformance (*this, "Int16", numChannels);
+            FastPathTest <AudioData::Int24>::comparePerformance (*this, "Int24", numChannels);
+            FastPathTest <AudioData::Int32>::comparePerformance (*this, "Int32", numChannels);
+        }
     }
 };
 
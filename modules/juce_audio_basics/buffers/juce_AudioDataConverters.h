@@ -301,6 +301,20 @@ public:
         static inline void* toVoidPtr (VoidType* v) noexcept { return const_cast <void*> (v); }
         enum { isConst = 1 };
     };
+
+    //==============================================================================
+    /*  Optimised versions of the most common conversions, i.e. between little-endian packed
+        integers (which may be interleaved) and contiguous native floats. The specialised versions
+        of convert() are declared at the bottom of this file, and each of them returns false if it
+        can't handle the layout it's given, in which case Pointer::convertSamples() will fall back
+        to its generic sample-by-sample loop.
+    */
+    class FastConverters
+    {
+    public:
+        template <class DestFormat, class SourceFormat>
+        static bool convert (void*, int /*destStride*/, const void*, int /*sourceStride*/, int /*numSamples*/) noexcept    { return false; }
+    };
   #endif
 
     //==============================================================================
@@ -433,8 +447,8 @@ public:
         /** Writes a stream of samples into this pointer from another pointer.
             This will copy the specified number of samples, converting between formats appropriately.
         */
-        template <class OtherPointerType>
-        void convertSamples (OtherPointerType source, int numSamples) const noexcept
+        template <class OtherFormat, class OtherEndianness, class OtherInterleavingType, class OtherConstness>
+        void convertSamples (Pointer<OtherFormat, OtherEndianness, OtherInterleavingType, OtherConstness> source, int numSamples) const noexcept
         {
             static_jassert (Constness::isConst == 0); // trying to write to a const pointer! For a writeable one, use AudioData::NonConst instead!
 
@@ -442,6 +456,11 @@ public:
 
             if (source.getRawData() != getRawData() || source.getNumBytesBetweenSamples() >= getNumBytesBetweenSamples())
             {
+                if (Endianness::isBigEndian == 0 && OtherEndianness::isBigEndian == 0
+                     && FastConverters::convert<SampleFormat, OtherFormat> (dest.data.data, getNumBytesBetweenSamples(),
+                                                                           source.getRawData(), source.getNumBytesBetweenSamples(), numSamples))
+                    return;
+
                 while (--numSamples >= 0)
                 {
                     Endianness::copyFrom (dest.data, source);
@@ -618,6 +637,15 @@ public:
     };
 };
 
+#ifndef DOXYGEN
+template <> bool AudioData::FastConverters::convert<AudioData::Float32, AudioData::Int16>   (void*, int, const void*, int, int) noexcept;
+template <> bool AudioData::FastConverters::convert<AudioData::Float32, AudioData::Int24>   (void*, int, const void*, int, int) noexcept;
+template <> bool AudioData::FastConverters::convert<AudioData::Float32, AudioData::Int32>   (void*, int, const void*, int, int) noexcept;
+template <> bool AudioData::FastConverters::convert<AudioData::Int16,   AudioData::Float32> (void*, int, const void*, int, int) noexcept;
+template <> bool AudioData::FastConverters::convert<AudioData::Int24,   AudioData::Float32> (void*, int, const void*, int, int) noexcept;
+template <> bool AudioData::FastConverters::convert<AudioData::Int32,   AudioData::Float32> (void*, int, const void*, int, int) noexcept;
+#endif
+
 
 
 //==============================================================================
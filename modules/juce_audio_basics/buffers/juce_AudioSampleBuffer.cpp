@@ -268,13 +268,7 @@ void AudioSampleBuffer::applyGainRamp (const int channel,
         jassert (startSample >= 0 && startSample + numSamples <= size);
 
         const float increment = (endGain - startGain) / numSamples;
-        float* d = channels [channel] + startSample;
-
-        while (--numSamples >= 0)
-        {
-            *d++ *= startGain;
-            startGain += increment;
-        }
+        FloatVectorOperations::multiplyWithRamp (channels [channel] + startSample, startGain, increment, numSamples);
     }
 }
 
@@ -367,13 +361,8 @@ void AudioSampleBuffer::addFromWithRamp (const int destChannel,
         if (numSamples > 0 && (startGain != 0.0f || endGain != 0.0f))
         {
             const float increment = (endGain - startGain) / numSamples;
-            float* d = channels [destChannel] + destStartSample;
-
-            while (--numSamples >= 0)
-            {
-                *d++ += startGain * *source++;
-                startGain += increment;
-            }
+            FloatVectorOperations::addWithMultiplyRamp (channels [destChannel] + destStartSample,
+                                                        source, startGain, increment, numSamples);
         }
     }
 }
@@ -464,13 +453,8 @@ void AudioSampleBuffer::copyFromWithRamp (const int destChannel,
         if (numSamples > 0 && (startGain != 0.0f || endGain != 0.0f))
         {
             const float increment = (endGain - startGain) / numSamples;
-            float* d = channels [destChannel] + destStartSample;
-
-            while (--numSamples >= 0)
-            {
-                *d++ = startGain * *source++;
-                startGain += increment;
-            }
+            FloatVectorOperations::copyWithMultiplyRamp (channels [destChannel] + destStartSample,
+                                                         source, startGain, increment, numSamples);
         }
     }
 }
@@ -522,14 +506,7 @@ float AudioSampleBuffer::getRMSLevel (const int channel,
     if (numSamples <= 0 || channel < 0 || channel >= numChannels)
         return 0.0f;
 
-    const float* const data = channels [channel] + startSample;
-    double sum = 0.0;
-
-    for (int i = 0; i < numSamples; ++i)
-    {
-        const float sample = data [i];
-        sum += sample * sample;
-    }
+    const double sum = FloatVectorOperations::sumOfSquares (channels [channel] + startSample, numSamples);
 
     return (float) std::sqrt (sum / numSamples);
 }
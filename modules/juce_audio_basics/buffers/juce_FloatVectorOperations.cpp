@@ -50,48 +50,100 @@ namespace FloatVectorHelpers
        #endif
     }
 
-    static inline float findMinimumOrMaximum (const float* src, int num, const bool isMinimum) noexcept
+    //==============================================================================
+    /* These wrap up the SSE instructions for each type, so that the same loops can be
+       used for both floats and doubles.
+    */
+    struct BasicOps32
     {
-       #if JUCE_USE_SSE_INTRINSICS
-        const int numLongOps = num / 4;
+        typedef float Type;
+        typedef __m128 ParallelType;
+        enum { numParallel = 4 };
+
+        static forcedinline ParallelType load1 (Type v) noexcept                                { return _mm_load1_ps (&v); }
+        static forcedinline ParallelType loadA (const Type* v) noexcept                         { return _mm_load_ps (v); }
+        static forcedinline ParallelType loadU (const Type* v) noexcept                         { return _mm_loadu_ps (v); }
+        static forcedinline void storeA (Type* dest, ParallelType a) noexcept                   { _mm_store_ps (dest, a); }
+        static forcedinline void storeU (Type* dest, ParallelType a) noexcept                   { _mm_storeu_ps (dest, a); }
+        static forcedinline ParallelType ramp (Type start, Type increment) noexcept             { return _mm_setr_ps (start, start + increment, start + increment * 2, start + increment * 3); }
+
+        static forcedinline ParallelType add (ParallelType a, ParallelType b) noexcept          { return _mm_add_ps (a, b); }
+        static forcedinline ParallelType mul (ParallelType a, ParallelType b) noexcept          { return _mm_mul_ps (a, b); }
+        static forcedinline ParallelType max (ParallelType a, ParallelType b) noexcept          { return _mm_max_ps (a, b); }
+        static forcedinline ParallelType min (ParallelType a, ParallelType b) noexcept          { return _mm_min_ps (a, b); }
+        static forcedinline ParallelType negate (ParallelType a) noexcept                       { return _mm_xor_ps (a, _mm_set1_ps (-0.0f)); }
+        static forcedinline ParallelType abs (ParallelType a) noexcept                          { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a); }
+
+        static forcedinline Type max (ParallelType a) noexcept   { Type v[numParallel]; storeU (v, a); return jmax (v[0], v[1], v[2], v[3]); }
+        static forcedinline Type min (ParallelType a) noexcept   { Type v[numParallel]; storeU (v, a); return jmin (v[0], v[1], v[2], v[3]); }
+    };
+
+    struct BasicOps64
+    {
+        typedef double Type;
+        typedef __m128d ParallelType;
+        enum { numParallel = 2 };
+
+        static forcedinline ParallelType load1 (Type v) noexcept                                { return _mm_load1_pd (&v); }
+        static forcedinline ParallelType loadA (const Type* v) noexcept                         { return _mm_load_pd (v); }
+        static forcedinline ParallelType loadU (const Type* v) noexcept                         { return _mm_loadu_pd (v); }
+        static forcedinline void storeA (Type* dest, ParallelType a) noexcept                   { _mm_store_pd (dest, a); }
+        static forcedinline void storeU (Type* dest, ParallelType a) noexcept                   { _mm_storeu_pd (dest, a); }
+        static forcedinline ParallelType ramp (Type start, Type increment) noexcept             { return _mm_setr_pd (start, start + increment); }
+
+        static forcedinline ParallelType add (ParallelType a, ParallelType b) noexcept          { return _mm_add_pd (a, b); }
+        static forcedinline ParallelType mul (ParallelType a, ParallelType b) noexcept          { return _mm_mul_pd (a, b); }
+        static forcedinline ParallelType max (ParallelType a, ParallelType b) noexcept          { return _mm_max_pd (a, b); }
+        static forcedinline ParallelType min (ParallelType a, ParallelType b) noexcept          { return _mm_min_pd (a, b); }
+        static forcedinline ParallelType negate (ParallelType a) noexcept                       { return _mm_xor_pd (a, _mm_set1_pd (-0.0)); }
+        static forcedinline ParallelType abs (ParallelType a) noexcept                          { return _mm_andnot_pd (_mm_set1_pd (-0.0), a); }
+
+        static forcedinline Type max (ParallelType a) noexcept   { Type v[numParallel]; storeU (v, a); return jmax (v[0], v[1]); }
+        static forcedinline Type min (ParallelType a) noexcept   { Type v[numParallel]; storeU (v, a); return jmin (v[0], v[1]); }
+    };
+
+    template <int typeSize> struct ModeType;
+    template <> struct ModeType<4>  { typedef BasicOps32 Mode; };
+    template <> struct ModeType<8>  { typedef BasicOps64 Mode; };
+
+    //==============================================================================
+    template <class Mode>
+    static typename Mode::Type findMinimumOrMaximum (const typename Mode::Type* src, int num, const bool isMinimum) noexcept
+    {
+        typedef typename Mode::Type Type;
+        typedef typename Mode::ParallelType ParallelType;
+
+        const int numLongOps = num / Mode::numParallel;
 
         if (numLongOps > 1 && FloatVectorHelpers::isSSE2Available())
         {
-            __m128 val;
+            ParallelType val;
 
             #define JUCE_MINIMUMMAXIMUM_SSE_LOOP(loadOp, minMaxOp) \
                 val = loadOp (src); \
-                src += 4; \
+                src += Mode::numParallel; \
                 for (int i = 1; i < numLongOps; ++i) \
                 { \
-                    const __m128 s = loadOp (src); \
+                    const ParallelType s = loadOp (src); \
                     val = minMaxOp (val, s); \
-                    src += 4; \
+                    src += Mode::numParallel; \
                 }
 
             if (isMinimum)
             {
-                if (FloatVectorHelpers::isAligned (src)) { JUCE_MINIMUMMAXIMUM_SSE_LOOP (_mm_load_ps,  _mm_min_ps) }
-                else                                     { JUCE_MINIMUMMAXIMUM_SSE_LOOP (_mm_loadu_ps, _mm_min_ps) }
+                if (FloatVectorHelpers::isAligned (src)) { JUCE_MINIMUMMAXIMUM_SSE_LOOP (Mode::loadA, Mode::min) }
+                else                                     { JUCE_MINIMUMMAXIMUM_SSE_LOOP (Mode::loadU, Mode::min) }
             }
             else
             {
-                if (FloatVectorHelpers::isAligned (src)) { JUCE_MINIMUMMAXIMUM_SSE_LOOP (_mm_load_ps, _mm_max_ps) }
-                else                                     { JUCE_MINIMUMMAXIMUM_SSE_LOOP (_mm_loadu_ps,_mm_max_ps) }
+                if (FloatVectorHelpers::isAligned (src)) { JUCE_MINIMUMMAXIMUM_SSE_LOOP (Mode::loadA, Mode::max) }
+                else                                     { JUCE_MINIMUMMAXIMUM_SSE_LOOP (Mode::loadU, Mode::max) }
             }
 
-            float localVal;
-
-            {
-                float vals[4];
-                _mm_storeu_ps (vals, val);
-                FloatVectorHelpers::mmEmpty();
-
-                localVal = isMinimum ? jmin (vals[0], vals[1], vals[2], vals[3])
-                                     : jmax (vals[0], vals[1], vals[2], vals[3]);
-            }
+            Type localVal = isMinimum ? Mode::min (val) : Mode::max (val);
+            FloatVectorHelpers::mmEmpty();
 
-            num &= 3;
+            num &= (Mode::numParallel - 1);
 
             for (int i = 0; i < num; ++i)
                 localVal = isMinimum ? jmin (localVal, src[i])
@@ -99,67 +151,290 @@ namespace FloatVectorHelpers
 
             return localVal;
         }
-       #endif
 
         return isMinimum ? juce::findMinimum (src, num)
                          : juce::findMaximum (src, num);
     }
+
+    template <class Mode>
+    static void findMinAndMax (const typename Mode::Type* src, int num,
+                               typename Mode::Type& minResult, typename Mode::Type& maxResult) noexcept
+    {
+        typedef typename Mode::Type Type;
+        typedef typename Mode::ParallelType ParallelType;
+
+        const int numLongOps = num / Mode::numParallel;
+
+        if (numLongOps > 1 && FloatVectorHelpers::isSSE2Available())
+        {
+            ParallelType mn, mx;
+
+            #define JUCE_MINMAX_SSE_LOOP(loadOp) \
+                mn = loadOp (src); \
+                mx = mn; \
+                src += Mode::numParallel; \
+                for (int i = 1; i < numLongOps; ++i) \
+                { \
+                    const ParallelType s = loadOp (src); \
+                    mn = Mode::min (mn, s); \
+                    mx = Mode::max (mx, s); \
+                    src += Mode::numParallel; \
+                }
+
+            if (FloatVectorHelpers::isAligned (src)) { JUCE_MINMAX_SSE_LOOP (Mode::loadA) }
+            else                                     { JUCE_MINMAX_SSE_LOOP (Mode::loadU) }
+
+            Type localMin = Mode::min (mn);
+            Type localMax = Mode::max (mx);
+            FloatVectorHelpers::mmEmpty();
+
+            num &= (Mode::numParallel - 1);
+
+            for (int i = 0; i < num; ++i)
+            {
+                const Type s = src[i];
+                localMin = jmin (localMin, s);
+                localMax = jmax (localMax, s);
+            }
+
+            minResult = localMin;
+            maxResult = localMax;
+            return;
+        }
+
+        juce::findMinAndMax (src, num, minResult, maxResult);
+    }
 }
 
-#define JUCE_BEGIN_SSE_OP \
+#define JUCE_BEGIN_VEC_OP \
+    typedef FloatVectorHelpers::ModeType<sizeof (*dest)>::Mode Mode; \
     if (FloatVectorHelpers::isSSE2Available()) \
     { \
-        const int numLongOps = num / 4;
+        const int numLongOps = num / Mode::numParallel;
 
-#define JUCE_FINISH_SSE_OP(normalOp) \
+#define JUCE_FINISH_VEC_OP(normalOp) \
         FloatVectorHelpers::mmEmpty(); \
-        num &= 3; \
+        num &= (Mode::numParallel - 1); \
         if (num == 0) return; \
     } \
     for (int i = 0; i < num; ++i) normalOp;
 
-#define JUCE_SSE_LOOP(sseOp, srcLoad, dstLoad, dstStore, locals, increment) \
+#define JUCE_VEC_LOOP(vecOp, srcLoad, dstLoad, dstStore, locals, increment) \
     for (int i = 0; i < numLongOps; ++i) \
     { \
         locals (srcLoad, dstLoad); \
-        dstStore (dest, sseOp); \
+        dstStore (dest, vecOp); \
         increment; \
     }
 
-#define JUCE_INCREMENT_SRC_DEST    dest += 4; src += 4;
-#define JUCE_INCREMENT_DEST        dest += 4;
+#define JUCE_INCREMENT_SRC_DEST    dest += Mode::numParallel; src += Mode::numParallel;
+#define JUCE_INCREMENT_DEST        dest += Mode::numParallel;
 
 #define JUCE_LOAD_NONE(srcLoad, dstLoad)
-#define JUCE_LOAD_DEST(srcLoad, dstLoad)     const __m128 d = dstLoad (dest);
-#define JUCE_LOAD_SRC(srcLoad, dstLoad)      const __m128 s = srcLoad (src);
-#define JUCE_LOAD_SRC_DEST(srcLoad, dstLoad) const __m128 d = dstLoad (dest); const __m128 s = srcLoad (src);
-
-#define JUCE_PERFORM_SSE_OP_DEST(normalOp, sseOp, locals) \
-    JUCE_BEGIN_SSE_OP \
-    if (FloatVectorHelpers::isAligned (dest))   JUCE_SSE_LOOP (sseOp, dummy, _mm_load_ps,  _mm_store_ps,  locals, JUCE_INCREMENT_DEST) \
-    else                                        JUCE_SSE_LOOP (sseOp, dummy, _mm_loadu_ps, _mm_storeu_ps, locals, JUCE_INCREMENT_DEST) \
-    JUCE_FINISH_SSE_OP (normalOp)
-
-#define JUCE_PERFORM_SSE_OP_SRC_DEST(normalOp, sseOp, locals, increment) \
-    JUCE_BEGIN_SSE_OP \
+#define JUCE_LOAD_DEST(srcLoad, dstLoad)     const Mode::ParallelType d = dstLoad (dest);
+#define JUCE_LOAD_SRC(srcLoad, dstLoad)      const Mode::ParallelType s = srcLoad (src);
+#define JUCE_LOAD_SRC_DEST(srcLoad, dstLoad) const Mode::ParallelType d = dstLoad (dest); const Mode::ParallelType s = srcLoad (src);
+
+#define JUCE_PERFORM_VEC_OP_DEST(normalOp, vecOp, locals, setupOp) \
+    JUCE_BEGIN_VEC_OP \
+    setupOp \
+    if (FloatVectorHelpers::isAligned (dest))   JUCE_VEC_LOOP (vecOp, dummy, Mode::loadA, Mode::storeA, locals, JUCE_INCREMENT_DEST) \
+    else                                        JUCE_VEC_LOOP (vecOp, dummy, Mode::loadU, Mode::storeU, locals, JUCE_INCREMENT_DEST) \
+    JUCE_FINISH_VEC_OP (normalOp)
+
+#define JUCE_PERFORM_VEC_OP_SRC_DEST(normalOp, vecOp, locals, increment, setupOp) \
+    JUCE_BEGIN_VEC_OP \
+    setupOp \
     if (FloatVectorHelpers::isAligned (dest)) \
     { \
-        if (FloatVectorHelpers::isAligned (src)) JUCE_SSE_LOOP (sseOp, _mm_load_ps,  _mm_load_ps, _mm_store_ps, locals, increment) \
-        else                                     JUCE_SSE_LOOP (sseOp, _mm_loadu_ps, _mm_load_ps, _mm_store_ps, locals, increment) \
+        if (FloatVectorHelpers::isAligned (src)) JUCE_VEC_LOOP (vecOp, Mode::loadA, Mode::loadA, Mode::storeA, locals, increment) \
+        else                                     JUCE_VEC_LOOP (vecOp, Mode::loadU, Mode::loadA, Mode::storeA, locals, increment) \
     }\
     else \
     { \
-        if (FloatVectorHelpers::isAligned (src)) JUCE_SSE_LOOP (sseOp, _mm_load_ps,  _mm_loadu_ps, _mm_storeu_ps, locals, increment) \
-        else                                     JUCE_SSE_LOOP (sseOp, _mm_loadu_ps, _mm_loadu_ps, _mm_storeu_ps, locals, increment) \
+        if (FloatVectorHelpers::isAligned (src)) JUCE_VEC_LOOP (vecOp, Mode::loadA, Mode::loadU, Mode::storeU, locals, increment) \
+        else                                     JUCE_VEC_LOOP (vecOp, Mode::loadU, Mode::loadU, Mode::storeU, locals, increment) \
     } \
-    JUCE_FINISH_SSE_OP (normalOp)
+    JUCE_FINISH_VEC_OP (normalOp)
+
+// (for the gain ramps, the scalar gain is kept in step with the vector one, ready for any leftover values)
+#define JUCE_SETUP_RAMP \
+    Mode::ParallelType gains = Mode::ramp (startGain, gainIncrement); \
+    const Mode::ParallelType gainStep = Mode::load1 (gainIncrement * Mode::numParallel);
+
+#define JUCE_INCREMENT_DEST_RAMP        JUCE_INCREMENT_DEST     gains = Mode::add (gains, gainStep); startGain += gainIncrement * Mode::numParallel;
+#define JUCE_INCREMENT_SRC_DEST_RAMP    JUCE_INCREMENT_SRC_DEST gains = Mode::add (gains, gainStep); startGain += gainIncrement * Mode::numParallel;
+
+#define JUCE_PERFORM_VEC_OP_DEST_RAMP(normalOp, vecOp, locals) \
+    JUCE_BEGIN_VEC_OP \
+    JUCE_SETUP_RAMP \
+    if (FloatVectorHelpers::isAligned (dest))   JUCE_VEC_LOOP (vecOp, dummy, Mode::loadA, Mode::storeA, locals, JUCE_INCREMENT_DEST_RAMP) \
+    else                                        JUCE_VEC_LOOP (vecOp, dummy, Mode::loadU, Mode::storeU, locals, JUCE_INCREMENT_DEST_RAMP) \
+    JUCE_FINISH_VEC_OP (normalOp)
+
+#else
+ #define JUCE_PERFORM_VEC_OP_DEST(normalOp, vecOp, locals, setupOp)                 for (int i = 0; i < num; ++i) normalOp;
+ #define JUCE_PERFORM_VEC_OP_SRC_DEST(normalOp, vecOp, locals, increment, setupOp)  for (int i = 0; i < num; ++i) normalOp;
+ #define JUCE_PERFORM_VEC_OP_DEST_RAMP(normalOp, vecOp, locals)                     for (int i = 0; i < num; ++i) normalOp;
+#endif
+
+//==============================================================================
+#if JUCE_USE_AVX_INTRINSICS
+
+#if JUCE_GCC
+ #define JUCE_AVX_FUNCTION      __attribute__ ((target ("avx")))
+ #define JUCE_AVX_FMA_FUNCTION  __attribute__ ((target ("avx,fma")))
+#else
+ #define JUCE_AVX_FUNCTION
+ #define JUCE_AVX_FMA_FUNCTION
+#endif
+
+/*  These are compiled for AVX regardless of the project's compiler settings, and only get
+    called if the CPU supports it. Unaligned loads and stores are no slower than aligned
+    ones on AVX hardware when the data happens to be aligned, so there's only one loop.
+*/
+namespace FloatVectorHelpers
+{
+    static int avxLevel = -1;
+
+    enum { noAVX = 0, avxOnly = 1, avxWithFMA = 2 };
+
+    static int getAVXLevel() noexcept
+    {
+        if (avxLevel < 0)
+            avxLevel = SystemStats::hasAVX() ? (SystemStats::hasFMA() ? avxWithFMA : avxOnly) : noAVX;
+
+        return avxLevel;
+    }
+
+    #define JUCE_AVX_LOOP(avxOp, normalOp, increment) \
+        for (int n = num / 8; --n >= 0;) \
+        { \
+            avxOp; \
+            increment; \
+        } \
+        num &= 7; \
+        for (int i = 0; i < num; ++i) normalOp; \
+        _mm256_zeroupper();
+
+    #define JUCE_AVX_INCREMENT_SRC_DEST    dest += 8; src += 8;
+    #define JUCE_AVX_INCREMENT_DEST        dest += 8;
+
+    JUCE_AVX_FUNCTION static void fillAVX (float* dest, const float valueToFill, int num) noexcept
+    {
+        const __m256 val = _mm256_set1_ps (valueToFill);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, val),
+                       dest[i] = valueToFill, JUCE_AVX_INCREMENT_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void copyWithMultiplyAVX (float* dest, const float* src, const float multiplier, int num) noexcept
+    {
+        const __m256 mult = _mm256_set1_ps (multiplier);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_mul_ps (mult, _mm256_loadu_ps (src))),
+                       dest[i] = src[i] * multiplier, JUCE_AVX_INCREMENT_SRC_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void addAVX (float* dest, const float* src, int num) noexcept
+    {
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_add_ps (_mm256_loadu_ps (dest), _mm256_loadu_ps (src))),
+                       dest[i] += src[i], JUCE_AVX_INCREMENT_SRC_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void addAVX (float* dest, const float amount, int num) noexcept
+    {
+        const __m256 amountToAdd = _mm256_set1_ps (amount);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_add_ps (_mm256_loadu_ps (dest), amountToAdd)),
+                       dest[i] += amount, JUCE_AVX_INCREMENT_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void addWithMultiplyAVX (float* dest, const float* src, const float multiplier, int num) noexcept
+    {
+        const __m256 mult = _mm256_set1_ps (multiplier);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_add_ps (_mm256_loadu_ps (dest), _mm256_mul_ps (mult, _mm256_loadu_ps (src)))),
+                       dest[i] += src[i] * multiplier, JUCE_AVX_INCREMENT_SRC_DEST)
+    }
+
+    JUCE_AVX_FMA_FUNCTION static void addWithMultiplyFMA (float* dest, const float* src, const float multiplier, int num) noexcept
+    {
+        const __m256 mult = _mm256_set1_ps (multiplier);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_fmadd_ps (mult, _mm256_loadu_ps (src), _mm256_loadu_ps (dest))),
+                       dest[i] += src[i] * multiplier, JUCE_AVX_INCREMENT_SRC_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void multiplyAVX (float* dest, const float* src, int num) noexcept
+    {
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_mul_ps (_mm256_loadu_ps (dest), _mm256_loadu_ps (src))),
+                       dest[i] *= src[i], JUCE_AVX_INCREMENT_SRC_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void multiplyAVX (float* dest, const float multiplier, int num) noexcept
+    {
+        const __m256 mult = _mm256_set1_ps (multiplier);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_mul_ps (_mm256_loadu_ps (dest), mult)),
+                       dest[i] *= multiplier, JUCE_AVX_INCREMENT_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void convertFixedToFloatAVX (float* dest, const int* src, const float multiplier, int num) noexcept
+    {
+        const __m256 mult = _mm256_set1_ps (multiplier);
+        JUCE_AVX_LOOP (_mm256_storeu_ps (dest, _mm256_mul_ps (mult, _mm256_cvtepi32_ps (_mm256_loadu_si256 ((const __m256i*) src)))),
+                       dest[i] = src[i] * multiplier, JUCE_AVX_INCREMENT_SRC_DEST)
+    }
+
+    JUCE_AVX_FUNCTION static void findMinAndMaxAVX (const float* src, int num, float& minResult, float& maxResult) noexcept
+    {
+        jassert (num >= 8);
+
+        __m256 mn = _mm256_loadu_ps (src);
+        __m256 mx = mn;
+        src += 8;
+
+        for (int n = num / 8; --n > 0;)
+        {
+            const __m256 s = _mm256_loadu_ps (src);
+            mn = _mm256_min_ps (mn, s);
+            mx = _mm256_max_ps (mx, s);
+            src += 8;
+        }
+
+        float mns[8], mxs[8];
+        _mm256_storeu_ps (mns, mn);
+        _mm256_storeu_ps (mxs, mx);
+        _mm256_zeroupper();
+
+        float localMin = mns[0], localMax = mxs[0];
 
+        for (int i = 1; i < 8; ++i)
+        {
+            localMin = jmin (localMin, mns[i]);
+            localMax = jmax (localMax, mxs[i]);
+        }
+
+        num &= 7;
+
+        for (int i = 0; i < num; ++i)
+        {
+            localMin = jmin (localMin, src[i]);
+            localMax = jmax (localMax, src[i]);
+        }
+
+        minResult = localMin;
+        maxResult = localMax;
+    }
+}
+
+#define JUCE_PERFORM_AVX_OP(avxFunction, args) \
+    if (num >= 8 && FloatVectorHelpers::getAVXLevel() != FloatVectorHelpers::noAVX) \
+    { \
+        FloatVectorHelpers::avxFunction args; \
+        return; \
+    }
 
 #else
- #define JUCE_PERFORM_SSE_OP_DEST(normalOp, unused1, unused2)              for (int i = 0; i < num; ++i) normalOp;
- #define JUCE_PERFORM_SSE_OP_SRC_DEST(normalOp, sseOp, locals, increment)  for (int i = 0; i < num; ++i) normalOp;
+ #define JUCE_PERFORM_AVX_OP(avxFunction, args)
 #endif
 
+//==============================================================================
 void JUCE_CALLTYPE FloatVectorOperations::clear (float* dest, int num) noexcept
 {
    #if JUCE_USE_VDSP_FRAMEWORK
@@ -169,16 +444,34 @@ void JUCE_CALLTYPE FloatVectorOperations::clear (float* dest, int num) noexcept
    #endif
 }
 
+void JUCE_CALLTYPE FloatVectorOperations::clear (double* dest, int num) noexcept
+{
+   #if JUCE_USE_VDSP_FRAMEWORK
+    vDSP_vclrD (dest, 1, num);
+   #else
+    zeromem (dest, num * sizeof (double));
+   #endif
+}
+
 void JUCE_CALLTYPE FloatVectorOperations::fill (float* dest, float valueToFill, int num) noexcept
 {
    #if JUCE_USE_VDSP_FRAMEWORK
     vDSP_vfill (&valueToFill, dest, 1, num);
    #else
-    #if JUCE_USE_SSE_INTRINSICS
-     const __m128 val = _mm_load1_ps (&valueToFill);
-    #endif
+    JUCE_PERFORM_AVX_OP (fillAVX, (dest, valueToFill, num))
 
-    JUCE_PERFORM_SSE_OP_DEST (dest[i] = valueToFill, val, JUCE_LOAD_NONE)
+    JUCE_PERFORM_VEC_OP_DEST (dest[i] = valueToFill, val, JUCE_LOAD_NONE,
+                              const Mode::ParallelType val = Mode::load1 (valueToFill);)
+   #endif
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::fill (double* dest, double valueToFill, int num) noexcept
+{
+   #if JUCE_USE_VDSP_FRAMEWORK
+    vDSP_vfillD (&valueToFill, dest, 1, num);
+   #else
+    JUCE_PERFORM_VEC_OP_DEST (dest[i] = valueToFill, val, JUCE_LOAD_NONE,
+                              const Mode::ParallelType val = Mode::load1 (valueToFill);)
    #endif
 }
 
@@ -187,18 +480,34 @@ void JUCE_CALLTYPE FloatVectorOperations::copy (float* dest, const float* src, i
     memcpy (dest, src, num * sizeof (float));
 }
 
+void JUCE_CALLTYPE FloatVectorOperations::copy (double* dest, const double* src, int num) noexcept
+{
+    memcpy (dest, src, num * sizeof (double));
+}
+
 void JUCE_CALLTYPE FloatVectorOperations::copyWithMultiply (float* dest, const float* src, float multiplier, int num) noexcept
 {
    #if JUCE_USE_VDSP_FRAMEWORK
     vDSP_vsmul (src, 1, &multiplier, dest, 1, num);
    #else
-    #if JUCE_USE_SSE_INTRINSICS
-     const __m128 mult = _mm_load1_ps (&multiplier);
-    #endif
+    JUCE_PERFORM_AVX_OP (copyWithMultiplyAVX, (dest, src, multiplier, num))
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = src[i] * multiplier,
+                                  Mode::mul (mult, s),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType mult = Mode::load1 (multiplier);)
+   #endif
+}
 
-    JUCE_PERFORM_SSE_OP_SRC_DEST (dest[i] = src[i] * multiplier,
-                                  _mm_mul_ps (mult, s),
-                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST)
+void JUCE_CALLTYPE FloatVectorOperations::copyWithMultiply (double* dest, const double* src, double multiplier, int num) noexcept
+{
+   #if JUCE_USE_VDSP_FRAMEWORK
+    vDSP_vsmulD (src, 1, &multiplier, dest, 1, num);
+   #else
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = src[i] * multiplier,
+                                  Mode::mul (mult, s),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType mult = Mode::load1 (multiplier);)
    #endif
 }
 
@@ -207,32 +516,67 @@ void JUCE_CALLTYPE FloatVectorOperations::add (float* dest, const float* src, in
    #if JUCE_USE_VDSP_FRAMEWORK
     vDSP_vadd (src, 1, dest, 1, dest, 1, num);
    #else
-    JUCE_PERFORM_SSE_OP_SRC_DEST (dest[i] += src[i],
-                                  _mm_add_ps (d, s),
-                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST)
+    JUCE_PERFORM_AVX_OP (addAVX, (dest, src, num))
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] += src[i],
+                                  Mode::add (d, s),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST, )
+   #endif
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::add (double* dest, const double* src, int num) noexcept
+{
+   #if JUCE_USE_VDSP_FRAMEWORK
+    vDSP_vaddD (src, 1, dest, 1, dest, 1, num);
+   #else
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] += src[i],
+                                  Mode::add (d, s),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST, )
    #endif
 }
 
 void JUCE_CALLTYPE FloatVectorOperations::add (float* dest, float amount, int num) noexcept
 {
-   #if JUCE_USE_SSE_INTRINSICS
-    const __m128 amountToAdd = _mm_load1_ps (&amount);
-   #endif
+    JUCE_PERFORM_AVX_OP (addAVX, (dest, amount, num))
+
+    JUCE_PERFORM_VEC_OP_DEST (dest[i] += amount,
+                              Mode::add (d, amountToAdd),
+                              JUCE_LOAD_DEST,
+                              const Mode::ParallelType amountToAdd = Mode::load1 (amount);)
+}
 
-    JUCE_PERFORM_SSE_OP_DEST (dest[i] += amount,
-                              _mm_add_ps (d, amountToAdd),
-                              JUCE_LOAD_DEST)
+void JUCE_CALLTYPE FloatVectorOperations::add (double* dest, double amount, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_DEST (dest[i] += amount,
+                              Mode::add (d, amountToAdd),
+                              JUCE_LOAD_DEST,
+                              const Mode::ParallelType amountToAdd = Mode::load1 (amount);)
 }
 
 void JUCE_CALLTYPE FloatVectorOperations::addWithMultiply (float* dest, const float* src, float multiplier, int num) noexcept
 {
-   #if JUCE_USE_SSE_INTRINSICS
-    const __m128 mult = _mm_load1_ps (&multiplier);
+   #if JUCE_USE_AVX_INTRINSICS
+    if (num >= 8 && FloatVectorHelpers::getAVXLevel() == FloatVectorHelpers::avxWithFMA)
+    {
+        FloatVectorHelpers::addWithMultiplyFMA (dest, src, multiplier, num);
+        return;
+    }
    #endif
 
-    JUCE_PERFORM_SSE_OP_SRC_DEST (dest[i] += src[i] * multiplier,
-                                  _mm_add_ps (d, _mm_mul_ps (mult, s)),
-                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST)
+    JUCE_PERFORM_AVX_OP (addWithMultiplyAVX, (dest, src, multiplier, num))
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] += src[i] * multiplier,
+                                  Mode::add (d, Mode::mul (mult, s)),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType mult = Mode::load1 (multiplier);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::addWithMultiply (double* dest, const double* src, double multiplier, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] += src[i] * multiplier,
+                                  Mode::add (d, Mode::mul (mult, s)),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType mult = Mode::load1 (multiplier);)
 }
 
 void JUCE_CALLTYPE FloatVectorOperations::multiply (float* dest, const float* src, int num) noexcept
@@ -240,9 +584,22 @@ void JUCE_CALLTYPE FloatVectorOperations::multiply (float* dest, const float* sr
    #if JUCE_USE_VDSP_FRAMEWORK
     vDSP_vmul (src, 1, dest, 1, dest, 1, num);
    #else
-    JUCE_PERFORM_SSE_OP_SRC_DEST (dest[i] *= src[i],
-                                  _mm_mul_ps (d, s),
-                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST)
+    JUCE_PERFORM_AVX_OP (multiplyAVX, (dest, src, num))
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] *= src[i],
+                                  Mode::mul (d, s),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST, )
+   #endif
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::multiply (double* dest, const double* src, int num) noexcept
+{
+   #if JUCE_USE_VDSP_FRAMEWORK
+    vDSP_vmulD (src, 1, dest, 1, dest, 1, num);
+   #else
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] *= src[i],
+                                  Mode::mul (d, s),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST, )
    #endif
 }
 
@@ -251,85 +608,284 @@ void JUCE_CALLTYPE FloatVectorOperations::multiply (float* dest, float multiplie
    #if JUCE_USE_VDSP_FRAMEWORK
     vDSP_vsmul (dest, 1, &multiplier, dest, 1, num);
    #else
-    #if JUCE_USE_SSE_INTRINSICS
-     const __m128 mult = _mm_load1_ps (&multiplier);
-    #endif
+    JUCE_PERFORM_AVX_OP (multiplyAVX, (dest, multiplier, num))
 
-    JUCE_PERFORM_SSE_OP_DEST (dest[i] *= multiplier,
-                              _mm_mul_ps (d, mult),
-                              JUCE_LOAD_DEST)
+    JUCE_PERFORM_VEC_OP_DEST (dest[i] *= multiplier,
+                              Mode::mul (d, mult),
+                              JUCE_LOAD_DEST,
+                              const Mode::ParallelType mult = Mode::load1 (multiplier);)
    #endif
 }
 
-void JUCE_CALLTYPE FloatVectorOperations::convertFixedToFloat (float* dest, const int* src, float multiplier, int num) noexcept
+void JUCE_CALLTYPE FloatVectorOperations::multiply (double* dest, double multiplier, int num) noexcept
 {
-   #if JUCE_USE_SSE_INTRINSICS
-    const __m128 mult = _mm_load1_ps (&multiplier);
+   #if JUCE_USE_VDSP_FRAMEWORK
+    vDSP_vsmulD (dest, 1, &multiplier, dest, 1, num);
+   #else
+    JUCE_PERFORM_VEC_OP_DEST (dest[i] *= multiplier,
+                              Mode::mul (d, mult),
+                              JUCE_LOAD_DEST,
+                              const Mode::ParallelType mult = Mode::load1 (multiplier);)
    #endif
+}
 
-    JUCE_PERFORM_SSE_OP_SRC_DEST (dest[i] = src[i] * multiplier,
-                                  _mm_mul_ps (mult, _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i*) src))),
-                                  JUCE_LOAD_NONE, JUCE_INCREMENT_SRC_DEST)
+//==============================================================================
+void JUCE_CALLTYPE FloatVectorOperations::negate (float* dest, const float* src, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = -src[i],
+                                  Mode::negate (s),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST, )
 }
 
-void JUCE_CALLTYPE FloatVectorOperations::findMinAndMax (const float* src, int num, float& minResult, float& maxResult) noexcept
+void JUCE_CALLTYPE FloatVectorOperations::negate (double* dest, const double* src, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = -src[i],
+                                  Mode::negate (s),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST, )
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::abs (float* dest, const float* src, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = std::abs (src[i]),
+                                  Mode::abs (s),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST, )
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::abs (double* dest, const double* src, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = std::abs (src[i]),
+                                  Mode::abs (s),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST, )
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::min (float* dest, const float* src, float comp, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = jmin (src[i], comp),
+                                  Mode::min (s, cmp),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType cmp = Mode::load1 (comp);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::min (double* dest, const double* src, double comp, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = jmin (src[i], comp),
+                                  Mode::min (s, cmp),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType cmp = Mode::load1 (comp);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::max (float* dest, const float* src, float comp, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = jmax (src[i], comp),
+                                  Mode::max (s, cmp),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType cmp = Mode::load1 (comp);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::max (double* dest, const double* src, double comp, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = jmax (src[i], comp),
+                                  Mode::max (s, cmp),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType cmp = Mode::load1 (comp);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::clip (float* dest, const float* src, float low, float high, int num) noexcept
+{
+    jassert (high >= low);
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = jmax (jmin (src[i], high), low),
+                                  Mode::max (Mode::min (s, hi), lo),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType lo = Mode::load1 (low); const Mode::ParallelType hi = Mode::load1 (high);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::clip (double* dest, const double* src, double low, double high, int num) noexcept
+{
+    jassert (high >= low);
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = jmax (jmin (src[i], high), low),
+                                  Mode::max (Mode::min (s, hi), lo),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType lo = Mode::load1 (low); const Mode::ParallelType hi = Mode::load1 (high);)
+}
+
+//==============================================================================
+void JUCE_CALLTYPE FloatVectorOperations::multiplyWithRamp (float* dest, float startGain, float gainIncrement, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_DEST_RAMP ({ dest[i] *= startGain; startGain += gainIncrement; },
+                                   Mode::mul (d, gains),
+                                   JUCE_LOAD_DEST)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::multiplyWithRamp (double* dest, double startGain, double gainIncrement, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_DEST_RAMP ({ dest[i] *= startGain; startGain += gainIncrement; },
+                                   Mode::mul (d, gains),
+                                   JUCE_LOAD_DEST)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::copyWithMultiplyRamp (float* dest, const float* src, float startGain, float gainIncrement, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST ({ dest[i] = src[i] * startGain; startGain += gainIncrement; },
+                                  Mode::mul (s, gains),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST_RAMP, JUCE_SETUP_RAMP)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::copyWithMultiplyRamp (double* dest, const double* src, double startGain, double gainIncrement, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST ({ dest[i] = src[i] * startGain; startGain += gainIncrement; },
+                                  Mode::mul (s, gains),
+                                  JUCE_LOAD_SRC, JUCE_INCREMENT_SRC_DEST_RAMP, JUCE_SETUP_RAMP)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::addWithMultiplyRamp (float* dest, const float* src, float startGain, float gainIncrement, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST ({ dest[i] += src[i] * startGain; startGain += gainIncrement; },
+                                  Mode::add (d, Mode::mul (s, gains)),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST_RAMP, JUCE_SETUP_RAMP)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::addWithMultiplyRamp (double* dest, const double* src, double startGain, double gainIncrement, int num) noexcept
+{
+    JUCE_PERFORM_VEC_OP_SRC_DEST ({ dest[i] += src[i] * startGain; startGain += gainIncrement; },
+                                  Mode::add (d, Mode::mul (s, gains)),
+                                  JUCE_LOAD_SRC_DEST, JUCE_INCREMENT_SRC_DEST_RAMP, JUCE_SETUP_RAMP)
+}
+
+//==============================================================================
+void JUCE_CALLTYPE FloatVectorOperations::convertFixedToFloat (float* dest, const int* src, float multiplier, int num) noexcept
+{
+    JUCE_PERFORM_AVX_OP (convertFixedToFloatAVX, (dest, src, multiplier, num))
+
+    JUCE_PERFORM_VEC_OP_SRC_DEST (dest[i] = src[i] * multiplier,
+                                  Mode::mul (mult, _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i*) src))),
+                                  JUCE_LOAD_NONE, JUCE_INCREMENT_SRC_DEST,
+                                  const Mode::ParallelType mult = Mode::load1 (multiplier);)
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::interleave (float* dest, const float* const* sources, int numChannels, int num) noexcept
 {
    #if JUCE_USE_SSE_INTRINSICS
-    const int numLongOps = num / 4;
-
-    if (numLongOps > 1 && FloatVectorHelpers::isSSE2Available())
-    {
-        __m128 mn, mx;
-
-        #define JUCE_MINMAX_SSE_LOOP(loadOp) \
-            mn = loadOp (src); \
-            mx = mn; \
-            src += 4; \
-            for (int i = 1; i < numLongOps; ++i) \
-            { \
-                const __m128 s = loadOp (src); \
-                mn = _mm_min_ps (mn, s); \
-                mx = _mm_max_ps (mx, s); \
-                src += 4; \
-            }
+    if (numChannels == 2 && FloatVectorHelpers::isSSE2Available())
+    {
+        const float* left  = sources[0];
+        const float* right = sources[1];
 
-        if (FloatVectorHelpers::isAligned (src)) { JUCE_MINMAX_SSE_LOOP (_mm_load_ps) }
-        else                                     { JUCE_MINMAX_SSE_LOOP (_mm_loadu_ps) }
+        for (int i = num / 4; --i >= 0;)
+        {
+            const __m128 l = _mm_loadu_ps (left);
+            const __m128 r = _mm_loadu_ps (right);
+            _mm_storeu_ps (dest,     _mm_unpacklo_ps (l, r));
+            _mm_storeu_ps (dest + 4, _mm_unpackhi_ps (l, r));
+            left += 4;
+            right += 4;
+            dest += 8;
+        }
 
-        float localMin, localMax;
+        FloatVectorHelpers::mmEmpty();
 
+        for (int i = 0; i < (num & 3); ++i)
         {
-            float mns[4], mxs[4];
-            _mm_storeu_ps (mns, mn);
-            _mm_storeu_ps (mxs, mx);
-            FloatVectorHelpers::mmEmpty();
+            *dest++ = left[i];
+            *dest++ = right[i];
+        }
+
+        return;
+    }
+   #endif
 
-            localMin = jmin (mns[0], mns[1], mns[2], mns[3]);
-            localMax = jmax (mxs[0], mxs[1], mxs[2], mxs[3]);
+    for (int chan = 0; chan < numChannels; ++chan)
+    {
+        const float* src = sources [chan];
+        float* d = dest + chan;
+
+        for (int i = num; --i >= 0;)
+        {
+            *d = *src++;
+            d += numChannels;
         }
+    }
+}
 
-        num &= 3;
+void JUCE_CALLTYPE FloatVectorOperations::deinterleave (float* const* dests, const float* src, int numChannels, int num) noexcept
+{
+   #if JUCE_USE_SSE_INTRINSICS
+    if (numChannels == 2 && FloatVectorHelpers::isSSE2Available())
+    {
+        float* left  = dests[0];
+        float* right = dests[1];
 
-        for (int i = 0; i < num; ++i)
+        for (int i = num / 4; --i >= 0;)
         {
-            const float s = src[i];
-            localMin = jmin (localMin, s);
-            localMax = jmax (localMax, s);
+            const __m128 a = _mm_loadu_ps (src);
+            const __m128 b = _mm_loadu_ps (src + 4);
+            _mm_storeu_ps (left,  _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0)));
+            _mm_storeu_ps (right, _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1)));
+            left += 4;
+            right += 4;
+            src += 8;
+        }
+
+        FloatVectorHelpers::mmEmpty();
+
+        for (int i = 0; i < (num & 3); ++i)
+        {
+            left[i]  = *src++;
+            right[i] = *src++;
         }
 
-        minResult = localMin;
-        maxResult = localMax;
         return;
     }
    #endif
 
+    for (int chan = 0; chan < numChannels; ++chan)
+    {
+        const float* s = src + chan;
+        float* d = dests [chan];
+
+        for (int i = num; --i >= 0;)
+        {
+            *d++ = *s;
+            s += numChannels;
+        }
+    }
+}
+
+//==============================================================================
+void JUCE_CALLTYPE FloatVectorOperations::findMinAndMax (const float* src, int num, float& minResult, float& maxResult) noexcept
+{
+    JUCE_PERFORM_AVX_OP (findMinAndMaxAVX, (src, num, minResult, maxResult))
+
+   #if JUCE_USE_SSE_INTRINSICS
+    FloatVectorHelpers::findMinAndMax<FloatVectorHelpers::BasicOps32> (src, num, minResult, maxResult);
+   #else
     juce::findMinAndMax (src, num, minResult, maxResult);
+   #endif
+}
+
+void JUCE_CALLTYPE FloatVectorOperations::findMinAndMax (const double* src, int num, double& minResult, double& maxResult) noexcept
+{
+   #if JUCE_USE_SSE_INTRINSICS
+    FloatVectorHelpers::findMinAndMax<FloatVectorHelpers::BasicOps64> (src, num, minResult, maxResult);
+   #else
+    juce::findMinAndMax (src, num, minResult, maxResult);
+   #endif
 }
 
 float JUCE_CALLTYPE FloatVectorOperations::findMinimum (const float* src, int num) noexcept
 {
    #if JUCE_USE_SSE_INTRINSICS
-    return FloatVectorHelpers::findMinimumOrMaximum (src, num, true);
+    return FloatVectorHelpers::findMinimumOrMaximum<FloatVectorHelpers::BasicOps32> (src, num, true);
+   #else
+    return juce::findMinimum (src, num);
+   #endif
+}
+
+double JUCE_CALLTYPE FloatVectorOperations::findMinimum (const double* src, int num) noexcept
+{
+   #if JUCE_USE_SSE_INTRINSICS
+    return FloatVectorHelpers::findMinimumOrMaximum<FloatVectorHelpers::BasicOps64> (src, num, true);
    #else
     return juce::findMinimum (src, num);
    #endif
@@ -338,8 +894,337 @@ float JUCE_CALLTYPE FloatVectorOperations::findMinimum (const float* src, int nu
 float JUCE_CALLTYPE FloatVectorOperations::findMaximum (const float* src, int num) noexcept
 {
    #if JUCE_USE_SSE_INTRINSICS
-    return FloatVectorHelpers::findMinimumOrMaximum (src, num, false);
+    return FloatVectorHelpers::findMinimumOrMaximum<FloatVectorHelpers::BasicOps32> (src, num, false);
+   #else
+    return juce::findMaximum (src, num);
+   #endif
+}
+
+double JUCE_CALLTYPE FloatVectorOperations::findMaximum (const double* src, int num) noexcept
+{
+   #if JUCE_USE_SSE_INTRINSICS
+    return FloatVectorHelpers::findMinimumOrMaximum<FloatVectorHelpers::BasicOps64> (src, num, false);
    #else
     return juce::findMaximum (src, num);
    #endif
 }
+
+double JUCE_CALLTYPE FloatVectorOperations::sumOfSquares (const float* src, int num) noexcept
+{
+    double sum = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    if (num >= 4 && FloatVectorHelpers::isSSE2Available())
+    {
+        // (the squares are summed as doubles, so that long blocks don't lose precision)
+        __m128d sumLo = _mm_setzero_pd(), sumHi = _mm_setzero_pd();
+
+        for (int i = num / 4; --i >= 0;)
+        {
+            const __m128 s = _mm_loadu_ps (src);
+            const __m128d lo = _mm_cvtps_pd (s);
+            const __m128d hi = _mm_cvtps_pd (_mm_movehl_ps (s, s));
+            sumLo = _mm_add_pd (sumLo, _mm_mul_pd (lo, lo));
+            sumHi = _mm_add_pd (sumHi, _mm_mul_pd (hi, hi));
+            src += 4;
+        }
+
+        double sums[2];
+        _mm_storeu_pd (sums, _mm_add_pd (sumLo, sumHi));
+        FloatVectorHelpers::mmEmpty();
+
+        sum = sums[0] + sums[1];
+        num &= 3;
+    }
+   #endif
+
+    for (int i = 0; i < num; ++i)
+    {
+        const double sample = src[i];
+        sum += sample * sample;
+    }
+
+    return sum;
+}
+
+double JUCE_CALLTYPE FloatVectorOperations::sumOfSquares (const double* src, int num) noexcept
+{
+    double sum = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    if (num >= 4 && FloatVectorHelpers::isSSE2Available())
+    {
+        __m128d sum1 = _mm_setzero_pd(), sum2 = _mm_setzero_pd();
+
+        for (int i = num / 4; --i >= 0;)
+        {
+            const __m128d s1 = _mm_loadu_pd (src);
+            const __m128d s2 = _mm_loadu_pd (src + 2);
+            sum1 = _mm_add_pd (sum1, _mm_mul_pd (s1, s1));
+            sum2 = _mm_add_pd (sum2, _mm_mul_pd (s2, s2));
+            src += 4;
+        }
+
+        double sums[2];
+        _mm_storeu_pd (sums, _mm_add_pd (sum1, sum2));
+        FloatVectorHelpers::mmEmpty();
+
+        sum = sums[0] + sums[1];
+        num &= 3;
+    }
+   #endif
+
+    for (int i = 0; i < num; ++i)
+        sum += src[i] * src[i];
+
+    return sum;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class FloatVectorOperationsTests  : public UnitTest
+{
+public:
+    FloatVectorOperationsTests() : UnitTest ("FloatVectorOperations") {}
+
+    template <typename Type>
+    static void fillRandomly (Random& random, Type* d, int num)
+    {
+        while (--num >= 0)
+            *d++ = (Type) (random.nextDouble() * 2.0 - 1.0);
+    }
+
+    template <typename Type>
+    static bool areAllValuesEqual (const Type* d1, const Type* d2, int num, const Type tolerance = 0)
+    {
+        while (--num >= 0)
+            if (std::abs (*d1++ - *d2++) > tolerance)
+                return false;
+
+        return true;
+    }
+
+    template <typename Type>
+    void testOperations (Random& r)
+    {
+        HeapBlock<Type> buffer1 (80), buffer2 (80), buffer3 (80);
+        const Type tolerance = (Type) 1.0e-6;
+
+        for (int i = 0; i < 200; ++i)
+        {
+            // (odd sizes and offsets, so that every combination of alignment and leftover values gets used)
+            const int num = r.nextInt (64);
+            Type* const src = buffer1 + r.nextInt (8);
+            Type* const dst = buffer2 + r.nextInt (8);
+            Type* const expected = buffer3;
+            const Type multiplier = (Type) (r.nextDouble() * 2.0 - 1.0);
+
+            fillRandomly (r, src, num);
+            fillRandomly (r, dst, num);
+
+            FloatVectorOperations::fill (dst, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] = multiplier;
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::copyWithMultiply (dst, src, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] = src[j] * multiplier;
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::add (dst, src, num);
+            for (int j = 0; j < num; ++j) expected[j] += src[j];
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::add (dst, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] += multiplier;
+            expect (areAllValuesEqual (dst, expected, num));
+
+            // (a fused multiply-add is allowed to round differently)
+            FloatVectorOperations::addWithMultiply (dst, src, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] += src[j] * multiplier;
+            expect (areAllValuesEqual (dst, expected, num, tolerance));
+            FloatVectorOperations::copy (dst, expected, num);
+
+            FloatVectorOperations::multiply (dst, src, num);
+            for (int j = 0; j < num; ++j) expected[j] *= src[j];
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::multiply (dst, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] *= multiplier;
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::negate (dst, src, num);
+            for (int j = 0; j < num; ++j) expected[j] = -src[j];
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::abs (dst, src, num);
+            for (int j = 0; j < num; ++j) expected[j] = std::abs (src[j]);
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::min (dst, src, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] = jmin (src[j], multiplier);
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::max (dst, src, multiplier, num);
+            for (int j = 0; j < num; ++j) expected[j] = jmax (src[j], multiplier);
+            expect (areAllValuesEqual (dst, expected, num));
+
+            FloatVectorOperations::clip (dst, src, -std::abs (multiplier), std::abs (multiplier), num);
+            for (int j = 0; j < num; ++j) expected[j] = jlimit (-std::abs (multiplier), std::abs (multiplier), src[j]);
+            expect (areAllValuesEqual (dst, expected, num));
+
+            // (the vectorised ramps work out their gains in a different order, so may round differently)
+            const Type increment = multiplier / 64;
+            const Type rampTolerance = tolerance * 10;
+
+            FloatVectorOperations::copy (dst, src, num);
+            FloatVectorOperations::multiplyWithRamp (dst, multiplier, increment, num);
+            for (int j = 0; j < num; ++j) expected[j] = src[j] * (multiplier + j * increment);
+            expect (areAllValuesEqual (dst, expected, num, rampTolerance));
+
+            FloatVectorOperations::copyWithMultiplyRamp (dst, src, multiplier, increment, num);
+            expect (areAllValuesEqual (dst, expected, num, rampTolerance));
+
+            FloatVectorOperations::addWithMultiplyRamp (dst, src, multiplier, increment, num);
+            for (int j = 0; j < num; ++j) expected[j] *= 2;
+            expect (areAllValuesEqual (dst, expected, num, rampTolerance));
+
+            if (num > 0)
+            {
+                Type mn, mx;
+                FloatVectorOperations::findMinAndMax (src, num, mn, mx);
+                expectEquals (mn, juce::findMinimum (src, num));
+                expectEquals (mx, juce::findMaximum (src, num));
+                expectEquals (FloatVectorOperations::findMinimum (src, num), mn);
+                expectEquals (FloatVectorOperations::findMaximum (src, num), mx);
+            }
+
+            double sumOfSquares = 0;
+            for (int j = 0; j < num; ++j) sumOfSquares += (double) src[j] * (double) src[j];
+            expect (std::abs (FloatVectorOperations::sumOfSquares (src, num) - sumOfSquares) < 1.0e-9);
+        }
+    }
+
+    void testFloatOnlyOperations (Random& r)
+    {
+        HeapBlock<float> buffer1 (80), buffer2 (80), buffer3 (160);
+        HeapBlock<int> intBuffer (80);
+
+        for (int i = 0; i < 200; ++i)
+        {
+            const int num = r.nextInt (64);
+            float* const left  = buffer1 + r.nextInt (8);
+            float* const right = buffer2 + r.nextInt (8);
+            float* const interleaved = buffer3 + r.nextInt (8);
+
+            fillRandomly (r, left, num);
+            fillRandomly (r, right, num);
+
+            for (int j = 0; j < num; ++j)
+                intBuffer[j] = r.nextInt();
+
+            FloatVectorOperations::convertFixedToFloat (left, intBuffer, 1.0f / 0x7fffffff, num);
+            for (int j = 0; j < num; ++j) expect (left[j] == intBuffer[j] * (1.0f / 0x7fffffff));
+
+            const float* sources[] = { left, right };
+            FloatVectorOperations::interleave (interleaved, sources, 2, num);
+
+            for (int j = 0; j < num; ++j)
+                expect (interleaved [j * 2] == left[j] && interleaved [j * 2 + 1] == right[j]);
+
+            HeapBlock<float> newLeft (num + 1), newRight (num + 1);
+            float* dests[] = { newLeft, newRight };
+            FloatVectorOperations::deinterleave (dests, interleaved, 2, num);
+
+            expect (areAllValuesEqual (newLeft.getData(), left, num));
+            expect (areAllValuesEqual (newRight.getData(), right, num));
+
+            // ..and the same again for a channel count that doesn't have a special case
+            const float* threeSources[] = { left, right, left };
+            FloatVectorOperations::interleave (interleaved, threeSources, 3, jmin (num, 50));
+
+            for (int j = 0; j < jmin (num, 50); ++j)
+                expect (interleaved [j * 3] == left[j] && interleaved [j * 3 + 1] == right[j] && interleaved [j * 3 + 2] == left[j]);
+        }
+    }
+
+    //==============================================================================
+    // Times an operation against the same thing done with a plain loop, and logs the results
+    template <class VectorOp, class ScalarOp>
+    void comparePerformance (const String& name, VectorOp vectorOp, ScalarOp scalarOp)
+    {
+        const int numValues = 1024, numRepeats = 2000;
+        HeapBlock<float> dest (numValues), src (numValues);
+        Random r (1);
+        fillRandomly (r, src.getData(), numValues);
+        fillRandomly (r, dest.getData(), numValues);
+
+        double times[2];
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const int64 start = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numRepeats; ++i)
+            {
+                if (pass == 0)
+                    scalarOp (dest.getData(), src.getData(), numValues);
+                else
+                    vectorOp (dest.getData(), src.getData(), numValues);
+
+                dest[0] = 0; // (keeps the results from growing too large or being optimised away)
+            }
+
+            times [pass] = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        }
+
+        logMessage (name.paddedRight (' ', 22) + " scalar: " + String (times[0] * 1000.0, 2) + "ms,  vectorised: "
+                      + String (times[1] * 1000.0, 2) + "ms,  speedup: " + String (times[0] / jmax (1.0e-9, times[1]), 1));
+    }
+
+    struct ScalarOps
+    {
+        static void add (float* d, const float* s, int num)                 { for (int i = 0; i < num; ++i) d[i] += s[i]; }
+        static void addWithMultiply (float* d, const float* s, int num)     { for (int i = 0; i < num; ++i) d[i] += s[i] * 0.5f; }
+        static void copyWithMultiplyRamp (float* d, const float* s, int num) { float g = 0.5f; for (int i = 0; i < num; ++i) { d[i] = s[i] * g; g += 0.0001f; } }
+        static void addWithMultiplyRamp (float* d, const float* s, int num) { float g = 0.5f; for (int i = 0; i < num; ++i) { d[i] += s[i] * g; g += 0.0001f; } }
+        static void clip (float* d, const float* s, int num)                { for (int i = 0; i < num; ++i) d[i] = jlimit (-0.5f, 0.5f, s[i]); }
+        static void sumOfSquares (float* d, const float* s, int num)        { double sum = 0; for (int i = 0; i < num; ++i) sum += s[i] * (double) s[i]; d[1] = (float) sum; }
+        static void findMinAndMax (float* d, const float* s, int num)       { juce::findMinAndMax (s, num, d[1], d[2]); }
+    };
+
+    struct VectorOps
+    {
+        static void add (float* d, const float* s, int num)                 { FloatVectorOperations::add (d, s, num); }
+        static void addWithMultiply (float* d, const float* s, int num)     { FloatVectorOperations::addWithMultiply (d, s, 0.5f, num); }
+        static void copyWithMultiplyRamp (float* d, const float* s, int num) { FloatVectorOperations::copyWithMultiplyRamp (d, s, 0.5f, 0.0001f, num); }
+        static void addWithMultiplyRamp (float* d, const float* s, int num) { FloatVectorOperations::addWithMultiplyRamp (d, s, 0.5f, 0.0001f, num); }
+        static void clip (float* d, const float* s, int num)                { FloatVectorOperations::clip (d, s, -0.5f, 0.5f, num); }
+        static void sumOfSquares (float* d, const float* s, int num)        { d[1] = (float) FloatVectorOperations::sumOfSquares (s, num); }
+        static void findMinAndMax (float* d, const float* s, int num)       { FloatVectorOperations::findMinAndMax (s, num, d[1], d[2]); }
+    };
+
+    void runTest()
+    {
+        beginTest ("Vector operations");
+
+        Random r (1234);
+        testOperations<float> (r);
+        testOperations<double> (r);
+        testFloatOnlyOperations (r);
+
+        beginTest ("Performance");
+
+        comparePerformance ("add",                  VectorOps::add,                 ScalarOps::add);
+        comparePerformance ("addWithMultiply",      VectorOps::addWithMultiply,     ScalarOps::addWithMultiply);
+        comparePerformance ("copyWithMultiplyRamp", VectorOps::copyWithMultiplyRamp, ScalarOps::copyWithMultiplyRamp);
+        comparePerformance ("addWithMultiplyRamp",  VectorOps::addWithMultiplyRamp, ScalarOps::addWithMultiplyRamp);
+        comparePerformance ("clip",                 VectorOps::clip,                ScalarOps::clip);
+        comparePerformance ("sumOfSquares",         VectorOps::sumOfSquares,        ScalarOps::sumOfSquares);
+        comparePerformance ("findMinAndMax",        VectorOps::findMinAndMax,       ScalarOps::findMinAndMax);
+    }
+};
+
+static FloatVectorOperationsTests floatVectorOperationsTests;
+
+#endif
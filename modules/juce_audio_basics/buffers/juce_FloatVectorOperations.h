@@ -39,41 +39,157 @@ public:
     /** Clears a vector of floats. */
     static void JUCE_CALLTYPE clear (float* dest, int numValues) noexcept;
 
+    /** Clears a vector of doubles. */
+    static void JUCE_CALLTYPE clear (double* dest, int numValues) noexcept;
+
     /** Copies a repeated value into a vector of floats. */
     static void JUCE_CALLTYPE fill (float* dest, float valueToFill, int numValues) noexcept;
 
+    /** Copies a repeated value into a vector of doubles. */
+    static void JUCE_CALLTYPE fill (double* dest, double valueToFill, int numValues) noexcept;
+
     /** Copies a vector of floats. */
     static void JUCE_CALLTYPE copy (float* dest, const float* src, int numValues) noexcept;
 
+    /** Copies a vector of doubles. */
+    static void JUCE_CALLTYPE copy (double* dest, const double* src, int numValues) noexcept;
+
     /** Copies a vector of floats, multiplying each value by a given multiplier */
     static void JUCE_CALLTYPE copyWithMultiply (float* dest, const float* src, float multiplier, int numValues) noexcept;
 
+    /** Copies a vector of doubles, multiplying each value by a given multiplier */
+    static void JUCE_CALLTYPE copyWithMultiply (double* dest, const double* src, double multiplier, int numValues) noexcept;
+
     /** Adds the source values to the destination values. */
     static void JUCE_CALLTYPE add (float* dest, const float* src, int numValues) noexcept;
 
+    /** Adds the source values to the destination values. */
+    static void JUCE_CALLTYPE add (double* dest, const double* src, int numValues) noexcept;
+
     /** Adds a fixed value to the destination values. */
     static void JUCE_CALLTYPE add (float* dest, float amount, int numValues) noexcept;
 
+    /** Adds a fixed value to the destination values. */
+    static void JUCE_CALLTYPE add (double* dest, double amount, int numValues) noexcept;
+
     /** Multiplies each source value by the given multiplier, then adds it to the destination value. */
     static void JUCE_CALLTYPE addWithMultiply (float* dest, const float* src, float multiplier, int numValues) noexcept;
 
+    /** Multiplies each source value by the given multiplier, then adds it to the destination value. */
+    static void JUCE_CALLTYPE addWithMultiply (double* dest, const double* src, double multiplier, int numValues) noexcept;
+
     /** Multiplies the destination values by the source values. */
     static void JUCE_CALLTYPE multiply (float* dest, const float* src, int numValues) noexcept;
 
+    /** Multiplies the destination values by the source values. */
+    static void JUCE_CALLTYPE multiply (double* dest, const double* src, int numValues) noexcept;
+
     /** Multiplies each of the destination values by a fixed multiplier. */
     static void JUCE_CALLTYPE multiply (float* dest, float multiplier, int numValues) noexcept;
 
+    /** Multiplies each of the destination values by a fixed multiplier. */
+    static void JUCE_CALLTYPE multiply (double* dest, double multiplier, int numValues) noexcept;
+
+    //==============================================================================
+    /** Copies a vector of floats, negating each value. */
+    static void JUCE_CALLTYPE negate (float* dest, const float* src, int numValues) noexcept;
+
+    /** Copies a vector of doubles, negating each value. */
+    static void JUCE_CALLTYPE negate (double* dest, const double* src, int numValues) noexcept;
+
+    /** Copies a vector of floats, replacing each value with its absolute value. */
+    static void JUCE_CALLTYPE abs (float* dest, const float* src, int numValues) noexcept;
+
+    /** Copies a vector of doubles, replacing each value with its absolute value. */
+    static void JUCE_CALLTYPE abs (double* dest, const double* src, int numValues) noexcept;
+
+    /** Copies each source value to the destination, or the given comparison value if that's lower. */
+    static void JUCE_CALLTYPE min (float* dest, const float* src, float comp, int numValues) noexcept;
+
+    /** Copies each source value to the destination, or the given comparison value if that's lower. */
+    static void JUCE_CALLTYPE min (double* dest, const double* src, double comp, int numValues) noexcept;
+
+    /** Copies each source value to the destination, or the given comparison value if that's higher. */
+    static void JUCE_CALLTYPE max (float* dest, const float* src, float comp, int numValues) noexcept;
+
+    /** Copies each source value to the destination, or the given comparison value if that's higher. */
+    static void JUCE_CALLTYPE max (double* dest, const double* src, double comp, int numValues) noexcept;
+
+    /** Copies each source value to the destination, limiting it to the range low to high. */
+    static void JUCE_CALLTYPE clip (float* dest, const float* src, float low, float high, int numValues) noexcept;
+
+    /** Copies each source value to the destination, limiting it to the range low to high. */
+    static void JUCE_CALLTYPE clip (double* dest, const double* src, double low, double high, int numValues) noexcept;
+
+    //==============================================================================
+    /** Multiplies the destination values by a gain that starts at startGain, and goes up
+        by gainIncrement for each value.
+    */
+    static void JUCE_CALLTYPE multiplyWithRamp (float* dest, float startGain, float gainIncrement, int numValues) noexcept;
+
+    /** Multiplies the destination values by a gain that starts at startGain, and goes up
+        by gainIncrement for each value.
+    */
+    static void JUCE_CALLTYPE multiplyWithRamp (double* dest, double startGain, double gainIncrement, int numValues) noexcept;
+
+    /** Copies a vector of floats, multiplying them by a gain that starts at startGain, and
+        goes up by gainIncrement for each value.
+    */
+    static void JUCE_CALLTYPE copyWithMultiplyRamp (float* dest, const float* src, float startGain, float gainIncrement, int numValues) noexcept;
+
+    /** Copies a vector of doubles, multiplying them by a gain that starts at startGain, and
+        goes up by gainIncrement for each value.
+    */
+    static void JUCE_CALLTYPE copyWithMultiplyRamp (double* dest, const double* src, double startGain, double gainIncrement, int numValues) noexcept;
+
+    /** Multiplies the source values by a gain that starts at startGain and goes up by
+        gainIncrement for each value, and adds them to the destination values.
+    */
+    static void JUCE_CALLTYPE addWithMultiplyRamp (float* dest, const float* src, float startGain, float gainIncrement, int numValues) noexcept;
+
+    /** Multiplies the source values by a gain that starts at startGain and goes up by
+        gainIncrement for each value, and adds them to the destination values.
+    */
+    static void JUCE_CALLTYPE addWithMultiplyRamp (double* dest, const double* src, double startGain, double gainIncrement, int numValues) noexcept;
+
+    //==============================================================================
     /** Converts a stream of integers to floats, multiplying each one by the given multiplier. */
     static void JUCE_CALLTYPE convertFixedToFloat (float* dest, const int* src, float multiplier, int numValues) noexcept;
 
+    /** Interleaves a set of separate channels into a single buffer.
+        The destination must have space for (numChannels * numSamples) values.
+    */
+    static void JUCE_CALLTYPE interleave (float* dest, const float* const* sources, int numChannels, int numSamples) noexcept;
+
+    /** Splits an interleaved buffer into a set of separate channels. */
+    static void JUCE_CALLTYPE deinterleave (float* const* dests, const float* src, int numChannels, int numSamples) noexcept;
+
+    //==============================================================================
     /** Finds the miniumum and maximum values in the given array. */
     static void JUCE_CALLTYPE findMinAndMax (const float* src, int numValues, float& minResult, float& maxResult) noexcept;
 
+    /** Finds the miniumum and maximum values in the given array. */
+    static void JUCE_CALLTYPE findMinAndMax (const double* src, int numValues, double& minResult, double& maxResult) noexcept;
+
     /** Finds the miniumum value in the given array. */
     static float JUCE_CALLTYPE findMinimum (const float* src, int numValues) noexcept;
 
+    /** Finds the miniumum value in the given array. */
+    static double JUCE_CALLTYPE findMinimum (const double* src, int numValues) noexcept;
+
     /** Finds the maximum value in the given array. */
     static float JUCE_CALLTYPE findMaximum (const float* src, int numValues) noexcept;
+
+    /** Finds the maximum value in the given array. */
+    static double JUCE_CALLTYPE findMaximum (const double* src, int numValues) noexcept;
+
+    /** Returns the sum of the squares of the values in the given array.
+        The sum is always accumulated as a double, to avoid losing precision over long arrays.
+    */
+    static double JUCE_CALLTYPE sumOfSquares (const float* src, int numValues) noexcept;
+
+    /** Returns the sum of the squares of the values in the given array. */
+    static double JUCE_CALLTYPE sumOfSquares (const double* src, int numValues) noexcept;
 };
 
 
@@ -199,3 +199,12 @@ int LagrangeInterpolator::processAdding (const double actualRatio, const float*
     subSamplePos = pos;
     return (int) (in - originalIn);
 }
+
+void JUCE_CALLTYPE LagrangeInterpolator::calculateWeights (const float offset, float* const weights) noexcept
+{
+    weights[0] = LagrangeHelpers::calcCoefficient<0> (1.0f, offset);
+    weights[1] = LagrangeHelpers::calcCoefficient<1> (1.0f, offset);
+    weights[2] = LagrangeHelpers::calcCoefficient<2> (1.0f, offset);
+    weights[3] = LagrangeHelpers::calcCoefficient<3> (1.0f, offset);
+    weights[4] = LagrangeHelpers::calcCoefficient<4> (1.0f, offset);
+}
@@ -83,6 +83,19 @@ public:
                        int numOutputSamplesToProduce,
                        float gain) noexcept;
 
+    /** Calculates the weights that the interpolator's kernel applies to five consecutive
+        input samples to find the value at a position between the third and fourth of them.
+
+        This lets other classes which need to interpolate use the same kernel as the
+        resampler, e.g. to build tables of coefficients.
+
+        @param offset   the position to evaluate, as a proportion of the distance from the
+                        third sample to the fourth, i.e. 0 to 1
+        @param weights  an array of five values, which will be set to the weights to apply
+                        to each of the samples, in the same order as the samples
+    */
+    static void JUCE_CALLTYPE calculateWeights (float offset, float* weights) noexcept;
+
 private:
     float lastInputSamples[5];
     double subSamplePos;
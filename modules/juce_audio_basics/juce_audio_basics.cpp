@@ -49,6 +49,19 @@
  #include <emmintrin.h>
 #endif
 
+// The AVX code is only called after checking the CPU, so it just needs a compiler that can build
+// it without the whole project being compiled for AVX.
+#ifndef JUCE_USE_AVX_INTRINSICS
+ #if JUCE_USE_SSE_INTRINSICS && ((JUCE_GCC && (defined (__clang__) || (__GNUC__ * 100 + __GNUC_MINOR__) >= 409)) \
+                                  || (JUCE_MSVC && _MSC_VER >= 1700))
+  #define JUCE_USE_AVX_INTRINSICS 1
+ #endif
+#endif
+
+#if JUCE_USE_AVX_INTRINSICS
+ #include <immintrin.h>
+#endif
+
 #if JUCE_MAC || JUCE_IOS
  #define JUCE_USE_VDSP_FRAMEWORK 1
  #include <Accelerate/Accelerate.h>
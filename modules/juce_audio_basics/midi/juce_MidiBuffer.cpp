@@ -35,11 +35,6 @@ namespace MidiBufferHelpers
         return *reinterpret_cast <const uint16*> (static_cast <const char*> (d) + sizeof (int));
     }
 
-    inline uint16 getEventTotalSize (const void* const d) noexcept
-    {
-        return getEventDataSize (d) + sizeof (int) + sizeof (uint16);
-    }
-
     static int findActualEventLength (const uint8* const data, const int maxBytes) noexcept
     {
         unsigned int byte = (unsigned int) *data;
@@ -72,26 +67,46 @@ namespace MidiBufferHelpers
 
 //==============================================================================
 MidiBuffer::MidiBuffer() noexcept
-    : bytesUsed (0)
+    : bytesUsed (0), numEvents (0), numEventsAllocated (0)
 {
 }
 
 MidiBuffer::MidiBuffer (const MidiMessage& message) noexcept
-    : bytesUsed (0)
+    : bytesUsed (0), numEvents (0), numEventsAllocated (0)
 {
     addEvent (message, 0);
 }
 
 MidiBuffer::MidiBuffer (const MidiBuffer& other) noexcept
     : data (other.data),
-      bytesUsed (other.bytesUsed)
+      bytesUsed (other.bytesUsed),
+      numEvents (other.numEvents),
+      numEventsAllocated (other.numEvents)
 {
+    if (numEvents > 0)
+    {
+        eventOffsets.malloc ((size_t) numEvents);
+        memcpy (eventOffsets, other.eventOffsets, sizeof (int) * (size_t) numEvents);
+    }
 }
 
 MidiBuffer& MidiBuffer::operator= (const MidiBuffer& other) noexcept
 {
-    bytesUsed = other.bytesUsed;
-    data = other.data;
+    if (this != &other)
+    {
+        // This re-uses the existing storage when there's enough of it, so that copying
+        // one buffer to another on the audio thread won't need to allocate anything.
+        ensureSpaceFor (other.bytesUsed - bytesUsed, other.numEvents - numEvents);
+
+        bytesUsed = other.bytesUsed;
+        numEvents = other.numEvents;
+
+        if (bytesUsed > 0)
+        {
+            memcpy (getData(), other.getData(), (size_t) bytesUsed);
+            memcpy (eventOffsets, other.eventOffsets, sizeof (int) * (size_t) numEvents);
+        }
+    }
 
     return *this;
 }
@@ -99,7 +114,10 @@ MidiBuffer& MidiBuffer::operator= (const MidiBuffer& other) noexcept
 void MidiBuffer::swapWith (MidiBuffer& other) noexcept
 {
     data.swapWith (other.data);
+    eventOffsets.swapWith (other.eventOffsets);
     std::swap (bytesUsed, other.bytesUsed);
+    std::swap (numEvents, other.numEvents);
+    std::swap (numEventsAllocated, other.numEventsAllocated);
 }
 
 MidiBuffer::~MidiBuffer()
@@ -111,24 +129,37 @@ inline uint8* MidiBuffer::getData() const noexcept
     return static_cast <uint8*> (data.getData());
 }
 
+inline int MidiBuffer::getEventOffset (const int index) const noexcept
+{
+    return index < numEvents ? eventOffsets [index] : bytesUsed;
+}
+
 void MidiBuffer::clear() noexcept
 {
     bytesUsed = 0;
+    numEvents = 0;
 }
 
 void MidiBuffer::clear (const int startSample, const int numSamples)
 {
-    uint8* const start = findEventAfter (getData(), startSample - 1);
-    uint8* const end   = findEventAfter (start, startSample + numSamples - 1);
+    const int startIndex = findIndexOfFirstEventAfter (startSample - 1);
+    const int endIndex   = findIndexOfFirstEventAfter (startSample + numSamples - 1);
 
-    if (end > start)
+    if (endIndex > startIndex)
     {
-        const int bytesToMove = bytesUsed - (int) (end - getData());
+        const int startOffset = getEventOffset (startIndex);
+        const int bytesRemoved = getEventOffset (endIndex) - startOffset;
+        const int bytesToMove = bytesUsed - (startOffset + bytesRemoved);
 
         if (bytesToMove > 0)
-            memmove (start, end, (size_t) bytesToMove);
+            memmove (getData() + startOffset, getData() + startOffset + bytesRemoved, (size_t) bytesToMove);
+
+        bytesUsed -= bytesRemoved;
 
-        bytesUsed -= (int) (end - start);
+        for (int i = endIndex; i < numEvents; ++i)
+            eventOffsets [i - (endIndex - startIndex)] = eventOffsets [i] - bytesRemoved;
+
+        numEvents -= (endIndex - startIndex);
     }
 }
 
@@ -143,14 +174,16 @@ void MidiBuffer::addEvent (const void* const newData, const int maxBytes, const
 
     if (numBytes > 0)
     {
-        size_t spaceNeeded = (size_t) bytesUsed + (size_t) numBytes + sizeof (int) + sizeof (uint16);
-        data.ensureSize ((spaceNeeded + spaceNeeded / 2 + 8) & ~(size_t) 7);
+        const int eventSize = numBytes + (int) (sizeof (int) + sizeof (uint16));
+        ensureSpaceFor (eventSize, 1);
 
-        uint8* d = findEventAfter (getData(), sampleNumber);
-        const int bytesToMove = bytesUsed - (int) (d - getData());
+        const int index = findIndexOfFirstEventAfter (sampleNumber);
+        const int offset = getEventOffset (index);
+        const int bytesToMove = bytesUsed - offset;
+        uint8* d = getData() + offset;
 
         if (bytesToMove > 0)
-            memmove (d + numBytes + sizeof (int) + sizeof (uint16), d, (size_t) bytesToMove);
+            memmove (d + eventSize, d, (size_t) bytesToMove);
 
         *reinterpret_cast <int*> (d) = sampleNumber;
         d += sizeof (int);
@@ -159,7 +192,13 @@ void MidiBuffer::addEvent (const void* const newData, const int maxBytes, const
 
         memcpy (d, newData, (size_t) numBytes);
 
-        bytesUsed += sizeof (int) + sizeof (uint16) + (size_t) numBytes;
+        bytesUsed += eventSize;
+
+        for (int i = numEvents; i > index; --i)
+            eventOffsets [i] = eventOffsets [i - 1] + eventSize;
+
+        eventOffsets [index] = offset;
+        ++numEvents;
     }
 }
 
@@ -168,76 +207,126 @@ void MidiBuffer::addEvents (const MidiBuffer& otherBuffer,
                             const int numSamples,
                             const int sampleDeltaToAdd)
 {
-    Iterator i (otherBuffer);
-    i.setNextSamplePosition (startSample);
+    jassert (&otherBuffer != this); // adding a buffer to itself isn't supported!
 
-    const uint8* eventData;
-    int eventSize, position;
+    const int firstIndex = otherBuffer.findIndexOfFirstEventAfter (startSample - 1);
+    const int endIndex = numSamples < 0 ? otherBuffer.numEvents
+                                        : otherBuffer.findIndexOfFirstEventAfter (startSample + numSamples - 1);
 
-    while (i.getNextEvent (eventData, eventSize, position)
-            && (position < startSample + numSamples || numSamples < 0))
+    if (endIndex <= firstIndex)
+        return;
+
+    const int sourceOffset = otherBuffer.getEventOffset (firstIndex);
+    const int numBytes = otherBuffer.getEventOffset (endIndex) - sourceOffset;
+    ensureSpaceFor (numBytes, endIndex - firstIndex);
+
+    const uint8* const source = otherBuffer.getData();
+
+    if (numEvents == 0 || getLastEventTime() <= MidiBufferHelpers::getEventTime (source + sourceOffset) + sampleDeltaToAdd)
     {
-        addEvent (eventData, eventSize, position + sampleDeltaToAdd);
+        // All the new events go after the existing ones (which is the usual case when merging
+        // buffers), so they can be copied across as a single block..
+        uint8* const dest = getData() + bytesUsed;
+        memcpy (dest, source + sourceOffset, (size_t) numBytes);
+
+        for (int i = firstIndex; i < endIndex; ++i)
+        {
+            const int offset = otherBuffer.eventOffsets [i] - sourceOffset;
+            *reinterpret_cast <int*> (dest + offset) += sampleDeltaToAdd;
+            eventOffsets [numEvents++] = bytesUsed + offset;
+        }
+
+        bytesUsed += numBytes;
+    }
+    else
+    {
+        for (int i = firstIndex; i < endIndex; ++i)
+        {
+            const uint8* const d = source + otherBuffer.eventOffsets [i];
+
+            addEvent (d + sizeof (int) + sizeof (uint16),
+                      MidiBufferHelpers::getEventDataSize (d),
+                      MidiBufferHelpers::getEventTime (d) + sampleDeltaToAdd);
+        }
     }
 }
 
 void MidiBuffer::ensureSize (size_t minimumNumBytes)
 {
     data.ensureSize (minimumNumBytes);
+
+    // leave enough room in the index for the largest number of events that could fit in the data
+    const int maxNumEvents = (int) (minimumNumBytes / (sizeof (int) + sizeof (uint16) + 1));
+
+    if (maxNumEvents > numEventsAllocated)
+    {
+        eventOffsets.realloc ((size_t) maxNumEvents);
+        numEventsAllocated = maxNumEvents;
+    }
 }
 
-bool MidiBuffer::isEmpty() const noexcept
+size_t MidiBuffer::getAllocatedSize() const noexcept
 {
-    return bytesUsed == 0;
+    return data.getSize() + sizeof (int) * (size_t) numEventsAllocated;
 }
 
-int MidiBuffer::getNumEvents() const noexcept
+void MidiBuffer::ensureSpaceFor (const int numExtraBytes, const int numExtraEvents)
 {
-    int n = 0;
-    const uint8* d = getData();
-    const uint8* const end = d + bytesUsed;
+    const size_t spaceNeeded = (size_t) (bytesUsed + numExtraBytes);
 
-    while (d < end)
+    if (spaceNeeded > data.getSize())
+        data.ensureSize ((spaceNeeded + spaceNeeded / 2 + 8) & ~(size_t) 7);
+
+    const int eventsNeeded = numEvents + numExtraEvents;
+
+    if (eventsNeeded > numEventsAllocated)
     {
-        d += MidiBufferHelpers::getEventTotalSize (d);
-        ++n;
+        numEventsAllocated = (eventsNeeded + eventsNeeded / 2 + 8) & ~7;
+        eventOffsets.realloc ((size_t) numEventsAllocated);
     }
+}
 
-    return n;
+bool MidiBuffer::isEmpty() const noexcept
+{
+    return numEvents == 0;
+}
+
+int MidiBuffer::getNumEvents() const noexcept
+{
+    return numEvents;
 }
 
 int MidiBuffer::getFirstEventTime() const noexcept
 {
-    return bytesUsed > 0 ? MidiBufferHelpers::getEventTime (data.getData()) : 0;
+    return numEvents > 0 ? MidiBufferHelpers::getEventTime (data.getData()) : 0;
 }
 
 int MidiBuffer::getLastEventTime() const noexcept
 {
-    if (bytesUsed == 0)
-        return 0;
-
-    const uint8* d = getData();
-    const uint8* const endData = d + bytesUsed;
+    return numEvents > 0 ? MidiBufferHelpers::getEventTime (getData() + eventOffsets [numEvents - 1]) : 0;
+}
 
-    for (;;)
-    {
-        const uint8* const nextOne = d + MidiBufferHelpers::getEventTotalSize (d);
+int MidiBuffer::findIndexOfFirstEventAfter (const int samplePosition) const noexcept
+{
+    const uint8* const d = getData();
 
-        if (nextOne >= endData)
-            return MidiBufferHelpers::getEventTime (d);
+    // (events are most often added in order, so it's worth checking the end first)
+    if (numEvents == 0 || MidiBufferHelpers::getEventTime (d + eventOffsets [numEvents - 1]) <= samplePosition)
+        return numEvents;
 
-        d = nextOne;
-    }
-}
+    int start = 0, end = numEvents - 1;
 
-uint8* MidiBuffer::findEventAfter (uint8* d, const int samplePosition) const noexcept
-{
-    const uint8* const endData = getData() + bytesUsed;
+    while (start < end)
+    {
+        const int mid = (start + end) / 2;
 
-    while (d < endData && MidiBufferHelpers::getEventTime (d) <= samplePosition)
-        d += MidiBufferHelpers::getEventTotalSize (d);
+        if (MidiBufferHelpers::getEventTime (d + eventOffsets [mid]) <= samplePosition)
+            start = mid + 1;
+        else
+            end = mid;
+    }
 
-    return d;
+    return start;
 }
 
 //==============================================================================
@@ -254,11 +343,7 @@ MidiBuffer::Iterator::~Iterator() noexcept
 //==============================================================================
 void MidiBuffer::Iterator::setNextSamplePosition (const int samplePosition) noexcept
 {
-    data = buffer.getData();
-    const uint8* dataEnd = data + buffer.bytesUsed;
-
-    while (data < dataEnd && MidiBufferHelpers::getEventTime (data) < samplePosition)
-        data += MidiBufferHelpers::getEventTotalSize (data);
+    data = buffer.getData() + buffer.getEventOffset (buffer.findIndexOfFirstEventAfter (samplePosition - 1));
 }
 
 bool MidiBuffer::Iterator::getNextEvent (const uint8* &midiData, int& numBytes, int& samplePosition) noexcept
@@ -288,3 +373,218 @@ bool MidiBuffer::Iterator::getNextEvent (MidiMessage& result, int& samplePositio
 
     return true;
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class MidiBufferTests  : public UnitTest
+{
+public:
+    MidiBufferTests() : UnitTest ("MidiBuffer") {}
+
+    // Each event is a controller message whose bytes encode a unique id, so that
+    // the buffer's contents can be compared against a simple list of ids and times.
+    struct Event
+    {
+        int time, id;
+    };
+
+    static MidiMessage createMessage (const int id)
+    {
+        return MidiMessage (0xb0 | (id & 15), (id >> 4) & 127, (id >> 11) & 127);
+    }
+
+    static int getId (const uint8* const data)
+    {
+        return (data[0] & 15) | (data[1] << 4) | (data[2] << 11);
+    }
+
+    static void addToReference (Array<Event>& reference, const int time, const int id)
+    {
+        int i = reference.size();
+
+        while (i > 0 && reference.getReference (i - 1).time > time)
+            --i;
+
+        const Event e = { time, id };
+        reference.insert (i, e);
+    }
+
+    bool matches (const MidiBuffer& buffer, const Array<Event>& reference)
+    {
+        if (buffer.getNumEvents() != reference.size())
+            return false;
+
+        MidiBuffer::Iterator iter (buffer);
+        const uint8* data;
+        int size, time;
+
+        for (int i = 0; i < reference.size(); ++i)
+        {
+            if (! (iter.getNextEvent (data, size, time)
+                    && size == 3 && time == reference[i].time && getId (data) == reference[i].id))
+                return false;
+        }
+
+        return ! iter.getNextEvent (data, size, time);
+    }
+
+    /** Counts how many times a set of buffers have had to (re)allocate their storage. */
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter() : numAllocations (0) {}
+
+        void watch (const MidiBuffer& buffer)
+        {
+            buffers.add (&buffer);
+            sizes.add (buffer.getAllocatedSize());
+        }
+
+        int update()
+        {
+            for (int i = 0; i < buffers.size(); ++i)
+            {
+                const size_t newSize = buffers.getUnchecked (i)->getAllocatedSize();
+
+                if (newSize != sizes[i])
+                {
+                    sizes.set (i, newSize);
+                    ++numAllocations;
+                }
+            }
+
+            return numAllocations;
+        }
+
+    private:
+        Array<const MidiBuffer*> buffers;
+        Array<size_t> sizes;
+        int numAllocations;
+    };
+
+    void runTest()
+    {
+        Random r;
+
+        beginTest ("Event ordering");
+        {
+            MidiBuffer buffer;
+            Array<Event> reference;
+
+            for (int i = 0; i < 2000; ++i)
+            {
+                const int time = r.nextInt (500);
+                buffer.addEvent (createMessage (i), time);
+                addToReference (reference, time, i);
+            }
+
+            expect (matches (buffer, reference));
+            expect (buffer.getFirstEventTime() == reference.getFirst().time);
+            expect (buffer.getLastEventTime() == reference.getLast().time);
+
+            buffer.clear (100, 50);
+
+            for (int i = reference.size(); --i >= 0;)
+                if (reference[i].time >= 100 && reference[i].time < 150)
+                    reference.remove (i);
+
+            expect (matches (buffer, reference));
+
+            MidiBuffer::Iterator iter (buffer);
+            iter.setNextSamplePosition (120);
+            MidiMessage m;
+            int time;
+            expect (iter.getNextEvent (m, time) && time == 150);
+
+            MidiBuffer merged;
+            Array<Event> mergedReference;
+
+            for (int i = 0; i < 100; ++i)
+            {
+                const int time = r.nextInt (1000);
+                merged.addEvent (createMessage (5000 + i), time);
+                addToReference (mergedReference, time, 5000 + i);
+            }
+
+            merged.addEvents (buffer, 200, 100, 250);
+
+            for (int i = 0; i < reference.size(); ++i)
+                if (reference[i].time >= 200 && reference[i].time < 300)
+                    addToReference (mergedReference, reference[i].time + 250, reference[i].id);
+
+            expect (matches (merged, mergedReference));
+
+            // adding a buffer whose events all come after the existing ones..
+            MidiBuffer appended (merged);
+            appended.addEvents (buffer, 0, -1, 2000);
+
+            for (int i = 0; i < reference.size(); ++i)
+                addToReference (mergedReference, reference[i].time + 2000, reference[i].id);
+
+            expect (matches (appended, mergedReference));
+
+            appended = buffer;
+            expect (matches (appended, reference));
+
+            appended.clear();
+            expect (appended.isEmpty() && appended.getNumEvents() == 0);
+        }
+
+        beginTest ("No allocation once space is reserved");
+        {
+            // This mimics the kind of things an AudioProcessorGraph does to its midi buffers
+            // while rendering: clearing them, copying between them and merging them.
+            const size_t bytesToReserve = 9 * 1024;
+            MidiBuffer input, a, b, output;
+            input.ensureSize (bytesToReserve);
+            a.ensureSize (bytesToReserve);
+            b.ensureSize (bytesToReserve);
+            output.ensureSize (bytesToReserve);
+
+            AllocationCounter counter;
+            counter.watch (input);
+            counter.watch (a);
+            counter.watch (b);
+            counter.watch (output);
+
+            for (int block = 0; block < 200; ++block)
+            {
+                input.clear();
+
+                for (int i = 0; i < 200; ++i)
+                    input.addEvent (createMessage (i), r.nextInt (256));
+
+                a = input;
+                b.clear();
+                b.addEvents (input, 0, 128, 0);
+                b.addEvent (createMessage (1), 64);
+                b.clear (32, 16);
+                a.addEvents (b, 0, 256, 0);
+
+                output.clear();
+                output.addEvents (a, 0, 256, 0);
+                output.addEvents (b, 0, 256, 0);
+
+                MidiBuffer::Iterator iter (output);
+                MidiMessage m;
+                int time;
+
+                while (iter.getNextEvent (m, time))
+                {}
+            }
+
+            expectEquals (counter.update(), 0);
+
+            // ..and check that the counter would have noticed if they had allocated
+            for (int i = 0; i < 10; ++i)
+                input.addEvents (output, 0, -1, 0);
+
+            expect (counter.update() > 0);
+        }
+    }
+};
+
+static MidiBufferTests midiBufferTests;
+
+#endif
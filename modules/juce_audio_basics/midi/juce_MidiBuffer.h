@@ -79,12 +79,7 @@ public:
     */
     bool isEmpty() const noexcept;
 
-    /** Counts the number of events in the buffer.
-
-        This is actually quite a slow operation, as it has to iterate through all
-        the events, so you might prefer to call isEmpty() if that's all you need
-        to know.
-    */
+    /** Returns the number of events in the buffer. */
     int getNumEvents() const noexcept;
 
     /** Adds an event to the buffer.
@@ -95,6 +90,8 @@ public:
 
         If an event is added whose sample position is the same as one or more events
         already in the buffer, the new event will be placed after the existing ones.
+        Finding the position takes O(log n) time, and appending an event after all the
+        others is a constant-time operation.
 
         To retrieve events, use a MidiBuffer::Iterator object
     */
@@ -133,6 +130,9 @@ public:
                                     startSample will be taken.
         @param sampleDeltaToAdd     a value which will be added to the source timestamps of the events
                                     that are added to this buffer
+
+        If all the new events belong after the ones that are already in this buffer, they'll be
+        copied across in a single block, so merging buffers like this is very cheap.
     */
     void addEvents (const MidiBuffer& otherBuffer,
                     int startSample,
@@ -160,11 +160,26 @@ public:
     void swapWith (MidiBuffer& other) noexcept;
 
     /** Preallocates some memory for the buffer to use.
+
         This helps to avoid needing to reallocate space when the buffer has messages
-        added to it.
+        added to it. Each event takes up 6 bytes plus the size of its midi data, so e.g.
+        a buffer of 3-byte messages will need 9 bytes per event.
+
+        Once this has been called, none of the methods that add, remove or copy events
+        will allocate any memory unless the total size of the events grows beyond this
+        size, which makes it safe to use them on the audio thread. (Note that copying
+        this buffer into another one only avoids allocating if the other buffer
+        has also had enough space reserved).
+
+        @see getAllocatedSize
     */
     void ensureSize (size_t minimumNumBytes);
 
+    /** Returns the number of bytes of memory that the buffer currently has allocated.
+        @see ensureSize
+    */
+    size_t getAllocatedSize() const noexcept;
+
     //==============================================================================
     /**
         Used to iterate through the events in a MidiBuffer.
@@ -229,10 +244,13 @@ private:
     //==============================================================================
     friend class MidiBuffer::Iterator;
     MemoryBlock data;
-    int bytesUsed;
+    HeapBlock<int> eventOffsets; // the position of each event in the data, so that they can be binary-searched
+    int bytesUsed, numEvents, numEventsAllocated;
 
     uint8* getData() const noexcept;
-    uint8* findEventAfter (uint8*, int samplePosition) const noexcept;
+    int getEventOffset (int index) const noexcept;
+    int findIndexOfFirstEventAfter (int samplePosition) const noexcept;
+    void ensureSpaceFor (int numExtraBytes, int numExtraEvents);
 
     JUCE_LEAK_DETECTOR (MidiBuffer)
 };
@@ -37,7 +37,13 @@ SynthesiserVoice::SynthesiserVoice()
       currentlyPlayingNote (-1),
       noteOnTime (0),
       keyIsDown (false),
-      sostenutoPedalDown (false)
+      sostenutoPedalDown (false),
+      ownerSynth (nullptr),
+      previousVoice (nullptr),
+      nextVoice (nullptr),
+      isOnActiveList (false),
+      numRenderCalls (0),
+      numSamplesRendered (0)
 {
 }
 
@@ -59,14 +65,175 @@ void SynthesiserVoice::setCurrentPlaybackSampleRate (const double newRate)
 void SynthesiserVoice::clearCurrentNote()
 {
     currentlyPlayingNote = -1;
-    currentlyPlayingSound = nullptr;
+
+    if (currentlyPlayingSound != nullptr)
+    {
+        currentlyPlayingSound = nullptr;
+
+        if (ownerSynth != nullptr)
+            ownerSynth->voiceFinished (this);
+    }
+}
+
+//==============================================================================
+/*  A fixed-size lock-free queue of short midi messages, which any number of threads can
+    write to, and which the audio thread reads from.
+
+    Each slot has a sequence number which tells the writers and the reader whether it's
+    ready for them, so the writers only ever need to race for the write position, and the
+    reader never has to wait for anything.
+*/
+class Synthesiser::MidiEventQueue
+{
+public:
+    MidiEventQueue() noexcept
+        : readPosition (0)
+    {
+        for (uint32 i = 0; i < queueSize; ++i)
+            slots[i].sequence = i;
+    }
+
+    bool push (const uint32 packedMessage) noexcept
+    {
+        uint32 pos = writePosition.get();
+
+        for (;;)
+        {
+            Slot& slot = slots [pos & (queueSize - 1)];
+            const int32 diff = (int32) (slot.sequence.get() - pos);
+
+            if (diff == 0)
+            {
+                if (writePosition.compareAndSetBool (pos + 1, pos))
+                {
+                    slot.packedMessage = packedMessage;
+                    slot.sequence = pos + 1;
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // the queue's full
+            }
+
+            pos = writePosition.get();
+        }
+    }
+
+    // This must only be called by one thread at a time.
+    bool pop (uint32& packedMessage) noexcept
+    {
+        Slot& slot = slots [readPosition & (queueSize - 1)];
+
+        if (slot.sequence.get() != readPosition + 1)
+            return false;
+
+        packedMessage = slot.packedMessage;
+        slot.sequence = readPosition + queueSize;
+        ++readPosition;
+        return true;
+    }
+
+private:
+    enum { queueSize = 1024 };
+
+    struct Slot
+    {
+        Atomic<uint32> sequence;
+        uint32 packedMessage;
+    };
+
+    Slot slots [queueSize];
+    Atomic<uint32> writePosition;
+    uint32 readPosition;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiEventQueue)
+};
+
+//==============================================================================
+Synthesiser::VoiceList::VoiceList() noexcept
+    : first (nullptr), last (nullptr), size (0)
+{
+}
+
+void Synthesiser::VoiceList::append (SynthesiserVoice* const voice) noexcept
+{
+    voice->previousVoice = last;
+    voice->nextVoice = nullptr;
+
+    if (last != nullptr)
+        last->nextVoice = voice;
+    else
+        first = voice;
+
+    last = voice;
+    ++size;
+}
+
+void Synthesiser::VoiceList::insertInNoteOnOrder (SynthesiserVoice* const voice) noexcept
+{
+    SynthesiserVoice* previous = last;
+
+    while (previous != nullptr && previous->noteOnTime > voice->noteOnTime)
+        previous = previous->previousVoice;
+
+    voice->previousVoice = previous;
+    voice->nextVoice = (previous != nullptr) ? previous->nextVoice : first;
+
+    if (voice->nextVoice != nullptr)
+        voice->nextVoice->previousVoice = voice;
+    else
+        last = voice;
+
+    if (previous != nullptr)
+        previous->nextVoice = voice;
+    else
+        first = voice;
+
+    ++size;
+}
+
+void Synthesiser::VoiceList::remove (SynthesiserVoice* const voice) noexcept
+{
+    if (voice->previousVoice != nullptr)
+        voice->previousVoice->nextVoice = voice->nextVoice;
+    else
+        first = voice->nextVoice;
+
+    if (voice->nextVoice != nullptr)
+        voice->nextVoice->previousVoice = voice->previousVoice;
+    else
+        last = voice->previousVoice;
+
+    voice->previousVoice = nullptr;
+    voice->nextVoice = nullptr;
+    --size;
+}
+
+void Synthesiser::VoiceList::clear() noexcept
+{
+    first = last = nullptr;
+    size = 0;
+}
+
+//==============================================================================
+Synthesiser::RenderingStats::RenderingStats() noexcept
+    : numBlocks (0), numSubBlocks (0), numMidiEvents (0),
+      numVoiceRenderCalls (0), numVoiceSamplesRendered (0), numVoiceRenderCallsSkipped (0)
+{
 }
 
 //==============================================================================
 Synthesiser::Synthesiser()
     : sampleRate (0),
       lastNoteOnCounter (0),
-      shouldStealNotes (true)
+      voicesGeneration (0),
+      voiceListsGeneration (0),
+      shouldStealNotes (true),
+      queuedEvents (new MidiEventQueue()),
+      minimumSubBlockSize (1),
+      subBlockSubdivisionIsStrict (false),
+      skipInactiveVoices (false)
 {
     for (int i = 0; i < numElementsInArray (lastPitchWheelValues); ++i)
         lastPitchWheelValues[i] = 0x2000;
@@ -74,6 +241,8 @@ Synthesiser::Synthesiser()
 
 Synthesiser::~Synthesiser()
 {
+    for (int i = voices.size(); --i >= 0;)
+        voices.getUnchecked (i)->ownerSynth = nullptr;
 }
 
 //==============================================================================
@@ -86,19 +255,36 @@ SynthesiserVoice* Synthesiser::getVoice (const int index) const
 void Synthesiser::clearVoices()
 {
     const ScopedLock sl (lock);
+
+    for (int i = voices.size(); --i >= 0;)
+        voices.getUnchecked (i)->ownerSynth = nullptr;
+
+    activeVoices.clear();
+    freeVoices.clear();
     voices.clear();
+    ++voicesGeneration;
 }
 
 void Synthesiser::addVoice (SynthesiserVoice* const newVoice)
 {
     const ScopedLock sl (lock);
     voices.add (newVoice);
+    ++voicesGeneration;
+    updateVoiceLists();
 }
 
 void Synthesiser::removeVoice (const int index)
 {
     const ScopedLock sl (lock);
-    voices.remove (index);
+
+    if (SynthesiserVoice* const voice = voices [index])
+    {
+        updateVoiceLists();
+        (voice->isOnActiveList ? activeVoices : freeVoices).remove (voice);
+        voice->ownerSynth = nullptr;
+        voices.remove (index);
+        ++voicesGeneration;
+    }
 }
 
 void Synthesiser::clearSounds()
@@ -124,6 +310,124 @@ void Synthesiser::setNoteStealingEnabled (const bool shouldStealNotes_)
     shouldStealNotes = shouldStealNotes_;
 }
 
+void Synthesiser::setMinimumRenderingSubdivisionSize (const int numSamples, const bool shouldBeStrict) noexcept
+{
+    jassert (numSamples > 0); // it wouldn't make much sense for this to be less than 1
+    minimumSubBlockSize = jmax (1, numSamples);
+    subBlockSubdivisionIsStrict = shouldBeStrict;
+}
+
+void Synthesiser::setInactiveVoiceSkippingEnabled (const bool shouldSkipInactiveVoices) noexcept
+{
+    skipInactiveVoices = shouldSkipInactiveVoices;
+}
+
+//==============================================================================
+Synthesiser::RenderingStats Synthesiser::getRenderingStats() const
+{
+    const ScopedLock sl (lock);
+    RenderingStats result (stats);
+
+    for (int i = voices.size(); --i >= 0;)
+    {
+        const SynthesiserVoice* const voice = voices.getUnchecked (i);
+        result.numVoiceRenderCalls += voice->numRenderCalls;
+        result.numVoiceSamplesRendered += voice->numSamplesRendered;
+    }
+
+    return result;
+}
+
+Synthesiser::RenderingStats Synthesiser::getVoiceRenderingStats (const int voiceIndex) const
+{
+    const ScopedLock sl (lock);
+    RenderingStats result;
+
+    if (const SynthesiserVoice* const voice = voices [voiceIndex])
+    {
+        result.numVoiceRenderCalls = voice->numRenderCalls;
+        result.numVoiceSamplesRendered = voice->numSamplesRendered;
+    }
+
+    return result;
+}
+
+void Synthesiser::resetRenderingStats()
+{
+    const ScopedLock sl (lock);
+    stats = RenderingStats();
+
+    for (int i = voices.size(); --i >= 0;)
+    {
+        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        voice->numRenderCalls = 0;
+        voice->numSamplesRendered = 0;
+    }
+}
+
+//==============================================================================
+void Synthesiser::checkForReplacedVoices() noexcept
+{
+    // A subclass may have swapped some of its voices for new ones, which leaves the number of
+    // voices unchanged. A voice is on one of the lists exactly when its owner is set to this
+    // synth, so if any voice isn't, the lists need rebuilding..
+    for (int i = voices.size(); --i >= 0;)
+    {
+        if (voices.getUnchecked (i)->ownerSynth != this)
+        {
+            ++voicesGeneration;
+            break;
+        }
+    }
+}
+
+void Synthesiser::updateVoiceLists()
+{
+    // This only needs to do anything when voices have been added or removed. addVoice(),
+    // removeVoice() and clearVoices() bump the generation count, and a subclass that has added
+    // or removed voices directly will have changed the size of the array..
+    if (voiceListsGeneration == voicesGeneration
+         && activeVoices.size + freeVoices.size == voices.size())
+        return;
+
+    voiceListsGeneration = voicesGeneration;
+
+    activeVoices.clear();
+    freeVoices.clear();
+
+    for (int i = 0; i < voices.size(); ++i)
+    {
+        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        voice->ownerSynth = this;
+        voice->isOnActiveList = (voice->currentlyPlayingSound != nullptr);
+
+        if (voice->isOnActiveList)
+            activeVoices.insertInNoteOnOrder (voice);
+        else
+            freeVoices.append (voice);
+    }
+}
+
+void Synthesiser::voiceStarted (SynthesiserVoice* const voice) noexcept
+{
+    if (voice->ownerSynth == this)
+    {
+        (voice->isOnActiveList ? activeVoices : freeVoices).remove (voice);
+        activeVoices.append (voice);
+        voice->isOnActiveList = true;
+    }
+}
+
+void Synthesiser::voiceFinished (SynthesiserVoice* const voice) noexcept
+{
+    if (voice->isOnActiveList)
+    {
+        activeVoices.remove (voice);
+        freeVoices.append (voice);
+        voice->isOnActiveList = false;
+    }
+}
+
 //==============================================================================
 void Synthesiser::setCurrentPlaybackSampleRate (const double newRate)
 {
@@ -150,35 +454,120 @@ void Synthesiser::renderNextBlock (AudioSampleBuffer& outputBuffer,
 
     const ScopedLock sl (lock);
 
+    ++stats.numBlocks;
+    checkForReplacedVoices();
+    updateVoiceLists();
+    handleQueuedEvents();
+
     MidiBuffer::Iterator midiIterator (midiData);
     midiIterator.setNextSamplePosition (startSample);
     MidiMessage m (0xf4, 0.0);
+    bool isFirstSubBlock = true;
 
     while (numSamples > 0)
     {
         int midiEventPos;
-        const bool useEvent = midiIterator.getNextEvent (m, midiEventPos)
-                                && midiEventPos < startSample + numSamples;
 
-        const int numThisTime = useEvent ? midiEventPos - startSample
-                                         : numSamples;
+        if (! midiIterator.getNextEvent (m, midiEventPos))
+        {
+            renderVoices (outputBuffer, startSample, numSamples);
+            break;
+        }
+
+        const int samplesToNextEvent = midiEventPos - startSample;
 
-        if (numThisTime > 0)
+        if (samplesToNextEvent >= numSamples)
         {
-            for (int i = voices.size(); --i >= 0;)
-                voices.getUnchecked (i)->renderNextBlock (outputBuffer, startSample, numThisTime);
+            // (events beyond the end of the block are ignored)
+            renderVoices (outputBuffer, startSample, numSamples);
+            break;
         }
 
-        if (useEvent)
+        // Events that fall too close to the start of the current sub-block are handled
+        // straight away rather than splitting it into even smaller pieces..
+        if (samplesToNextEvent < ((isFirstSubBlock && ! subBlockSubdivisionIsStrict) ? 1 : minimumSubBlockSize))
+        {
             handleMidiEvent (m);
+            continue;
+        }
+
+        isFirstSubBlock = false;
+        renderVoices (outputBuffer, startSample, samplesToNextEvent);
+        handleMidiEvent (m);
+
+        startSample += samplesToNextEvent;
+        numSamples -= samplesToNextEvent;
+    }
+}
+
+void Synthesiser::renderVoices (AudioSampleBuffer& outputBuffer, const int startSample, const int numSamples)
+{
+    ++stats.numSubBlocks;
+
+    if (skipInactiveVoices)
+    {
+        stats.numVoiceRenderCallsSkipped += freeVoices.size;
+
+        // (a voice may move itself onto the free list while it's rendering, so
+        // we need to find the next one before calling it)
+        for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
+        {
+            SynthesiserVoice* const next = voice->nextVoice;
+
+            ++(voice->numRenderCalls);
+            voice->numSamplesRendered += numSamples;
+            voice->renderNextBlock (outputBuffer, startSample, numSamples);
+
+            voice = next;
+        }
+    }
+    else
+    {
+        for (int i = voices.size(); --i >= 0;)
+        {
+            SynthesiserVoice* const voice = voices.getUnchecked (i);
+
+            ++(voice->numRenderCalls);
+            voice->numSamplesRendered += numSamples;
+            voice->renderNextBlock (outputBuffer, startSample, numSamples);
+        }
+    }
+}
+
+bool Synthesiser::addMidiMessageToQueue (const MidiMessage& message)
+{
+    const int size = message.getRawDataSize();
+
+    // Only short messages can be queued - sysex and meta-events are no use to the synth anyway.
+    jassert (size > 0 && size <= 3);
+
+    if (size <= 0 || size > 3)
+        return false;
+
+    const uint8* const data = message.getRawData();
+    uint32 packedMessage = ((uint32) size) << 24;
+
+    for (int i = 0; i < size; ++i)
+        packedMessage |= ((uint32) data[i]) << (8 * i);
 
-        startSample += numThisTime;
-        numSamples -= numThisTime;
+    return queuedEvents->push (packedMessage);
+}
+
+void Synthesiser::handleQueuedEvents()
+{
+    uint32 packedMessage;
+
+    while (queuedEvents->pop (packedMessage))
+    {
+        const uint8 data[] = { (uint8) packedMessage, (uint8) (packedMessage >> 8), (uint8) (packedMessage >> 16) };
+        handleMidiEvent (MidiMessage (data, (int) (packedMessage >> 24)));
     }
 }
 
 void Synthesiser::handleMidiEvent (const MidiMessage& m)
 {
+    ++stats.numMidiEvents;
+
     if (m.isNoteOn())
     {
         noteOn (m.getChannel(),
@@ -217,6 +606,7 @@ void Synthesiser::noteOn (const int midiChannel,
                           const float velocity)
 {
     const ScopedLock sl (lock);
+    updateVoiceLists();
 
     for (int i = sounds.size(); --i >= 0;)
     {
@@ -227,13 +617,15 @@ void Synthesiser::noteOn (const int midiChannel,
         {
             // If hitting a note that's still ringing, stop it first (it could be
             // still playing because of the sustain or sostenuto pedal).
-            for (int j = voices.size(); --j >= 0;)
+            for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
             {
-                SynthesiserVoice* const voice = voices.getUnchecked (j);
+                SynthesiserVoice* const next = voice->nextVoice;
 
                 if (voice->getCurrentlyPlayingNote() == midiNoteNumber
                      && voice->isPlayingChannel (midiChannel))
                     stopVoice (voice, true);
+
+                voice = next;
             }
 
             startVoice (findFreeVoice (sound, shouldStealNotes),
@@ -261,6 +653,8 @@ void Synthesiser::startVoice (SynthesiserVoice* const voice,
         voice->currentlyPlayingSound = sound;
         voice->keyIsDown = true;
         voice->sostenutoPedalDown = false;
+
+        voiceStarted (voice);
     }
 }
 
@@ -279,10 +673,11 @@ void Synthesiser::noteOff (const int midiChannel,
                            const bool allowTailOff)
 {
     const ScopedLock sl (lock);
+    updateVoiceLists();
 
-    for (int i = voices.size(); --i >= 0;)
+    for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
     {
-        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        SynthesiserVoice* const next = voice->nextVoice;
 
         if (voice->getCurrentlyPlayingNote() == midiNoteNumber)
         {
@@ -298,19 +693,24 @@ void Synthesiser::noteOff (const int midiChannel,
                 }
             }
         }
+
+        voice = next;
     }
 }
 
 void Synthesiser::allNotesOff (const int midiChannel, const bool allowTailOff)
 {
     const ScopedLock sl (lock);
+    updateVoiceLists();
 
-    for (int i = voices.size(); --i >= 0;)
+    for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
     {
-        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        SynthesiserVoice* const next = voice->nextVoice;
 
         if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
             voice->stopNote (allowTailOff);
+
+        voice = next;
     }
 
     sustainPedalsDown.clear();
@@ -320,12 +720,24 @@ void Synthesiser::handlePitchWheel (const int midiChannel, const int wheelValue)
 {
     const ScopedLock sl (lock);
 
-    for (int i = voices.size(); --i >= 0;)
+    if (midiChannel <= 0)
     {
-        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        for (int i = voices.size(); --i >= 0;)
+            voices.getUnchecked (i)->pitchWheelMoved (wheelValue);
+    }
+    else
+    {
+        updateVoiceLists();
 
-        if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
-            voice->pitchWheelMoved (wheelValue);
+        for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
+        {
+            SynthesiserVoice* const next = voice->nextVoice;
+
+            if (voice->isPlayingChannel (midiChannel))
+                voice->pitchWheelMoved (wheelValue);
+
+            voice = next;
+        }
     }
 }
 
@@ -343,12 +755,24 @@ void Synthesiser::handleController (const int midiChannel,
 
     const ScopedLock sl (lock);
 
-    for (int i = voices.size(); --i >= 0;)
+    if (midiChannel <= 0)
     {
-        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        for (int i = voices.size(); --i >= 0;)
+            voices.getUnchecked (i)->controllerMoved (controllerNumber, controllerValue);
+    }
+    else
+    {
+        updateVoiceLists();
 
-        if (midiChannel <= 0 || voice->isPlayingChannel (midiChannel))
-            voice->controllerMoved (controllerNumber, controllerValue);
+        for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
+        {
+            SynthesiserVoice* const next = voice->nextVoice;
+
+            if (voice->isPlayingChannel (midiChannel))
+                voice->controllerMoved (controllerNumber, controllerValue);
+
+            voice = next;
+        }
     }
 }
 
@@ -363,12 +787,16 @@ void Synthesiser::handleSustainPedal (int midiChannel, bool isDown)
     }
     else
     {
-        for (int i = voices.size(); --i >= 0;)
+        updateVoiceLists();
+
+        for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
         {
-            SynthesiserVoice* const voice = voices.getUnchecked (i);
+            SynthesiserVoice* const next = voice->nextVoice;
 
             if (voice->isPlayingChannel (midiChannel) && ! voice->keyIsDown)
                 stopVoice (voice, true);
+
+            voice = next;
         }
 
         sustainPedalsDown.clearBit (midiChannel);
@@ -379,10 +807,11 @@ void Synthesiser::handleSostenutoPedal (int midiChannel, bool isDown)
 {
     jassert (midiChannel > 0 && midiChannel <= 16);
     const ScopedLock sl (lock);
+    updateVoiceLists();
 
-    for (int i = voices.size(); --i >= 0;)
+    for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr;)
     {
-        SynthesiserVoice* const voice = voices.getUnchecked (i);
+        SynthesiserVoice* const next = voice->nextVoice;
 
         if (voice->isPlayingChannel (midiChannel))
         {
@@ -391,6 +820,8 @@ void Synthesiser::handleSostenutoPedal (int midiChannel, bool isDown)
             else if (voice->sostenutoPedalDown)
                 stopVoice (voice, true);
         }
+
+        voice = next;
     }
 }
 
@@ -405,29 +836,352 @@ SynthesiserVoice* Synthesiser::findFreeVoice (SynthesiserSound* soundToPlay,
                                               const bool stealIfNoneAvailable) const
 {
     const ScopedLock sl (lock);
+    const_cast <Synthesiser*> (this)->updateVoiceLists();
 
-    for (int i = voices.size(); --i >= 0;)
-        if (voices.getUnchecked (i)->getCurrentlyPlayingNote() < 0
-             && voices.getUnchecked (i)->canPlaySound (soundToPlay))
-            return voices.getUnchecked (i);
+    for (SynthesiserVoice* voice = freeVoices.last; voice != nullptr; voice = voice->previousVoice)
+        if (voice->canPlaySound (soundToPlay))
+            return voice;
 
     if (stealIfNoneAvailable)
     {
         // currently this just steals the one that's been playing the longest, but could be made a bit smarter..
-        SynthesiserVoice* oldest = nullptr;
+        // (the active list is kept in the order that the notes were started, so the oldest is the first one)
+        for (SynthesiserVoice* voice = activeVoices.first; voice != nullptr; voice = voice->nextVoice)
+            if (voice->canPlaySound (soundToPlay))
+                return voice;
 
-        for (int i = voices.size(); --i >= 0;)
+        jassertfalse;
+    }
+
+    return nullptr;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class SynthesiserTests  : public UnitTest
+{
+public:
+    SynthesiserTests() : UnitTest ("Synthesiser") {}
+
+    struct TestSound  : public SynthesiserSound
+    {
+        bool appliesToNote (const int)          { return true; }
+        bool appliesToChannel (const int)       { return true; }
+    };
+
+    struct TestVoice  : public SynthesiserVoice
+    {
+        TestVoice() : tailOffSamples (0), numNotesStarted (0) {}
+
+        bool canPlaySound (SynthesiserSound*)   { return true; }
+
+        void startNote (const int, const float, SynthesiserSound*, const int)
         {
-            SynthesiserVoice* const voice = voices.getUnchecked (i);
+            tailOffSamples = 0;
+            ++numNotesStarted;
+        }
+
+        void stopNote (const bool allowTailOff)
+        {
+            if (allowTailOff && tailOffSamples == 0)
+                tailOffSamples = 100;
+            else
+                clearCurrentNote();
+        }
 
-            if (voice->canPlaySound (soundToPlay)
-                 && (oldest == nullptr || oldest->noteOnTime > voice->noteOnTime))
-                oldest = voice;
+        void renderNextBlock (AudioSampleBuffer&, int, int numSamples)
+        {
+            if (tailOffSamples > 0 && (tailOffSamples -= numSamples) <= 0)
+            {
+                tailOffSamples = 0;
+                clearCurrentNote();
+            }
+        }
+
+        void pitchWheelMoved (const int) {}
+        void controllerMoved (const int, const int) {}
+
+        int tailOffSamples, numNotesStarted;
+    };
+
+    // Changes its voices array directly, the way a subclass is allowed to.
+    struct VoiceReplacingSynth  : public Synthesiser
+    {
+        void replaceVoice (const int index, SynthesiserVoice* const newVoice)
+        {
+            const ScopedLock sl (lock);
+            voices.set (index, newVoice);
         }
+    };
+
+    static void createVoices (Synthesiser& synth, const int numVoices)
+    {
+        synth.addSound (new TestSound());
+
+        for (int i = 0; i < numVoices; ++i)
+            synth.addVoice (new TestVoice());
 
-        jassert (oldest != nullptr);
-        return oldest;
+        synth.setCurrentPlaybackSampleRate (44100.0);
     }
 
-    return nullptr;
-}
+    static int findVoicePlaying (Synthesiser& synth, const int note)
+    {
+        for (int i = 0; i < synth.getNumVoices(); ++i)
+            if (synth.getVoice (i)->getCurrentlyPlayingNote() == note)
+                return i;
+
+        return -1;
+    }
+
+    static int countNotesStarted (Synthesiser& synth)
+    {
+        int total = 0;
+
+        for (int i = 0; i < synth.getNumVoices(); ++i)
+            total += static_cast <TestVoice*> (synth.getVoice (i))->numNotesStarted;
+
+        return total;
+    }
+
+    //==============================================================================
+    class QueueWriterThread  : public Thread
+    {
+    public:
+        QueueWriterThread (Synthesiser& s, int channel_, int numNotes_)
+            : Thread ("synth test"), synth (s), channel (channel_), numNotes (numNotes_)
+        {}
+
+        void run()
+        {
+            for (int i = 0; i < numNotes; ++i)
+            {
+                post (MidiMessage::noteOn (channel, 36 + i % 64, 0.5f));
+                post (MidiMessage::noteOff (channel, 36 + i % 64));
+            }
+        }
+
+        void post (const MidiMessage& m)
+        {
+            while (! synth.addMidiMessageToQueue (m))
+                Thread::yield();
+        }
+
+    private:
+        Synthesiser& synth;
+        const int channel, numNotes;
+    };
+
+    //==============================================================================
+    void runTest()
+    {
+        AudioSampleBuffer buffer (2, 64);
+        MidiBuffer noMidi;
+
+        beginTest ("Voice allocation");
+        {
+            Synthesiser synth;
+            createVoices (synth, 4);
+
+            for (int note = 60; note < 64; ++note)
+                synth.noteOn (1, note, 1.0f);
+
+            expect (findVoicePlaying (synth, 60) >= 0 && findVoicePlaying (synth, 63) >= 0);
+
+            // all the voices are busy, so this should steal the oldest one..
+            const int oldestVoice = findVoicePlaying (synth, 60);
+            synth.noteOn (1, 64, 1.0f);
+            expect (findVoicePlaying (synth, 60) < 0);
+            expect (findVoicePlaying (synth, 64) == oldestVoice);
+
+            // ..and the next-oldest should be next to go
+            synth.noteOn (1, 65, 1.0f);
+            expect (findVoicePlaying (synth, 61) < 0 && findVoicePlaying (synth, 65) >= 0);
+
+            // a voice which has been stopped should be reused before stealing any more
+            synth.noteOff (1, 63, false);
+            const int freedVoice = findVoicePlaying (synth, 63);
+            expect (freedVoice < 0);
+            synth.noteOn (1, 66, 1.0f);
+            expect (findVoicePlaying (synth, 62) >= 0 && findVoicePlaying (synth, 66) >= 0);
+
+            // voices which are tailing off are still busy until they call clearCurrentNote()
+            synth.noteOff (1, 62, true);
+            expect (findVoicePlaying (synth, 62) >= 0);
+            synth.setNoteStealingEnabled (false);
+            synth.noteOn (1, 67, 1.0f);
+            expect (findVoicePlaying (synth, 67) < 0);
+
+            synth.renderNextBlock (buffer, noMidi, 0, 64);
+            synth.renderNextBlock (buffer, noMidi, 0, 64);
+            expect (findVoicePlaying (synth, 62) < 0);
+            synth.noteOn (1, 67, 1.0f);
+            expect (findVoicePlaying (synth, 67) >= 0);
+
+            synth.allNotesOff (0, false);
+
+            for (int i = 0; i < synth.getNumVoices(); ++i)
+                expect (synth.getVoice (i)->getCurrentlyPlayingNote() < 0);
+
+            // removing voices mustn't leave anything dangling..
+            synth.setNoteStealingEnabled (true);
+            synth.noteOn (1, 60, 1.0f);
+            synth.noteOn (1, 61, 1.0f);
+            synth.removeVoice (findVoicePlaying (synth, 60));
+            synth.noteOn (1, 62, 1.0f);
+            synth.noteOn (1, 63, 1.0f);
+            synth.noteOn (1, 64, 1.0f);
+            expect (synth.getNumVoices() == 3);
+            expect (findVoicePlaying (synth, 61) < 0 && findVoicePlaying (synth, 64) >= 0);
+        }
+
+        beginTest ("Voices replaced by a subclass");
+        {
+            VoiceReplacingSynth synth;
+            createVoices (synth, 4);
+
+            synth.noteOn (1, 60, 1.0f);
+            synth.noteOn (1, 61, 1.0f);
+
+            // swapping an idle voice for a new one keeps the number of voices the same, but the
+            // old one has been deleted, so the next block mustn't leave it on the free list..
+            int idleVoice = 0;
+            while (synth.getVoice (idleVoice)->getCurrentlyPlayingNote() >= 0)
+                ++idleVoice;
+
+            TestVoice* const newVoice = new TestVoice();
+            synth.replaceVoice (idleVoice, newVoice);
+
+            AudioSampleBuffer buffer (1, 64);
+            MidiBuffer midi;
+            midi.addEvent (MidiMessage::noteOff (1, 60), 0);
+            midi.addEvent (MidiMessage::noteOn (1, 62, 1.0f), 1);
+            midi.addEvent (MidiMessage::noteOn (1, 63, 1.0f), 2);
+            midi.addEvent (MidiMessage::noteOn (1, 64, 1.0f), 3);
+            synth.renderNextBlock (buffer, midi, 0, 64);
+
+            expectEquals (newVoice->numNotesStarted, 1);
+            expect (findVoicePlaying (synth, 61) >= 0 && findVoicePlaying (synth, 64) >= 0);
+
+            synth.allNotesOff (0, false);
+
+            for (int i = 0; i < synth.getNumVoices(); ++i)
+                expect (synth.getVoice (i)->getCurrentlyPlayingNote() < 0);
+        }
+
+        beginTest ("Queued events");
+        {
+            Synthesiser synth;
+            createVoices (synth, 16);
+
+            const int numThreads = 4, notesPerThread = 5000;
+            OwnedArray<QueueWriterThread> threads;
+
+            for (int i = 0; i < numThreads; ++i)
+                threads.add (new QueueWriterThread (synth, i + 1, notesPerThread));
+
+            for (int i = 0; i < numThreads; ++i)
+                threads.getUnchecked (i)->startThread();
+
+            bool anyThreadsRunning = true;
+
+            while (anyThreadsRunning)
+            {
+                anyThreadsRunning = false;
+
+                for (int i = 0; i < numThreads; ++i)
+                    anyThreadsRunning = threads.getUnchecked (i)->isThreadRunning() || anyThreadsRunning;
+
+                synth.renderNextBlock (buffer, noMidi, 0, 64);
+            }
+
+            synth.renderNextBlock (buffer, noMidi, 0, 64);
+            expect (countNotesStarted (synth) == numThreads * notesPerThread);
+        }
+
+        beginTest ("Sub-block rendering");
+        {
+            Synthesiser synth;
+            createVoices (synth, 8);
+
+            // a note, followed by a controller change at every sample
+            const int blockSize = 64;
+            MidiBuffer midi;
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.0f), 0);
+
+            for (int i = 1; i < blockSize; ++i)
+                midi.addEvent (MidiMessage::controllerEvent (1, 1, i), i);
+
+            synth.renderNextBlock (buffer, midi, 0, blockSize);
+
+            Synthesiser::RenderingStats stats (synth.getRenderingStats());
+            expect (stats.numBlocks == 1 && stats.numMidiEvents == blockSize);
+            expect (stats.numSubBlocks == blockSize);
+            expect (stats.numVoiceRenderCalls == blockSize * 8);
+            expect (stats.numVoiceSamplesRendered == blockSize * 8);
+
+            synth.resetRenderingStats();
+            synth.setMinimumRenderingSubdivisionSize (16, true);
+            synth.renderNextBlock (buffer, midi, 0, blockSize);
+
+            stats = synth.getRenderingStats();
+            expect (stats.numSubBlocks == blockSize / 16);
+            expect (stats.numMidiEvents == blockSize);
+            expect (synth.getVoiceRenderingStats (0).numVoiceRenderCalls == blockSize / 16);
+            expect (synth.getVoiceRenderingStats (0).numVoiceSamplesRendered == blockSize);
+
+            // when it's not strict, only the first sub-block may be smaller than the limit
+            synth.resetRenderingStats();
+            synth.setMinimumRenderingSubdivisionSize (16, false);
+            synth.renderNextBlock (buffer, midi, 0, blockSize);
+            expect (synth.getRenderingStats().numSubBlocks == blockSize / 16 + 1);
+
+            // only the voice that's playing the note should get called
+            synth.allNotesOff (0, false);
+            synth.resetRenderingStats();
+            synth.setInactiveVoiceSkippingEnabled (true);
+            synth.renderNextBlock (buffer, midi, 0, blockSize);
+
+            stats = synth.getRenderingStats();
+            expect (stats.numVoiceRenderCalls == stats.numSubBlocks);
+            expect (stats.numVoiceRenderCallsSkipped == stats.numSubBlocks * 7);
+            expect (stats.numVoiceSamplesRendered == blockSize);
+        }
+
+        beginTest ("Performance");
+        {
+            Synthesiser synth;
+            createVoices (synth, 256);
+
+            // a dense stream of overlapping notes, with notes being stolen and tailing off
+            const int blockSize = 64, notesPerBlock = 32, numBlocks = 2000;
+            MidiBuffer midi;
+            Random r;
+
+            for (int i = 0; i < notesPerBlock; ++i)
+            {
+                const int note = r.nextInt (128);
+                midi.addEvent (MidiMessage::noteOn (1 + i % 16, note, 0.8f), i * 2);
+                midi.addEvent (MidiMessage::noteOff (1 + (i + 5) % 16, note), i * 2 + 1);
+            }
+
+            const int64 start = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numBlocks; ++i)
+                synth.renderNextBlock (buffer, midi, 0, blockSize);
+
+            const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            const int numNotes = notesPerBlock * numBlocks;
+
+            expect (countNotesStarted (synth) == numNotes);
+
+            logMessage ("256 voices, " + String (numNotes) + " notes: " + String (elapsed * 1000.0, 2) + "ms ("
+                          + String (numNotes / jmax (1.0e-9, elapsed), 0) + " notes/sec, "
+                          + String (elapsed * 1.0e6 / numBlocks, 2) + " microseconds per block)");
+        }
+    }
+};
+
+static SynthesiserTests synthesiserTests;
+
+#endif
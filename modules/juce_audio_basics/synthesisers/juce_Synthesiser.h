@@ -231,6 +231,15 @@ private:
     bool keyIsDown; // the voice may still be playing when the key is not down (i.e. sustain pedal)
     bool sostenutoPedalDown;
 
+    // the synth keeps each of its voices in either its free or its active list
+    class Synthesiser* ownerSynth;
+    SynthesiserVoice* previousVoice;
+    SynthesiserVoice* nextVoice;
+    bool isOnActiveList;
+
+    // rendering statistics, which the synth updates as it calls renderNextBlock()
+    int64 numRenderCalls, numSamplesRendered;
+
     JUCE_LEAK_DETECTOR (SynthesiserVoice)
 };
 
@@ -440,11 +449,109 @@ public:
                           int startSample,
                           int numSamples);
 
+    //==============================================================================
+    /** Adds a midi message to a queue, to be played at the start of the next block that
+        gets rendered.
+
+        Unlike noteOn(), noteOff() and the other methods that trigger events directly, this
+        doesn't need to lock the synth, and it never blocks, so it can safely be called by any
+        number of threads (e.g. a UI keyboard or a midi input callback) while the audio thread
+        is rendering, without risking priority inversion.
+
+        Only short messages (notes, controllers, pitch-wheel, etc) can be queued. If the queue is
+        full because the audio thread isn't keeping up, the message will be discarded and this
+        will return false.
+    */
+    bool addMidiMessageToQueue (const MidiMessage& message);
+
+    //==============================================================================
+    /** Sets a minimum limit on the size to which audio sub-blocks will be divided when rendering.
+
+        When rendering, the audio blocks that are passed into renderNextBlock() will be split up
+        into smaller blocks that lie between all the incoming midi messages, and it is these smaller
+        sub-blocks that are rendered by each voice. If there are very dense midi events (e.g. a
+        controller being moved at every sample), this can mean that the voices get called to render
+        tiny blocks of just a few samples, which is very inefficient.
+
+        This method lets you set a limit on the size of these sub-blocks: any midi events which
+        arrive less than this number of samples after the start of the current sub-block will be
+        handled at the start of that sub-block instead, so effectively the event timing is
+        quantised to this many samples.
+
+        If shouldBeStrict is false, the first sub-block in each buffer is allowed to be smaller
+        than the limit, so that events which don't happen to fall near the start of the buffer
+        won't be moved backwards into the previous buffer. If it's true, then every sub-block
+        will be at least this size (apart from the last one in each buffer).
+
+        The default is 1, which means that every event is rendered sample-accurately.
+    */
+    void setMinimumRenderingSubdivisionSize (int numSamples, bool shouldBeStrict = false) noexcept;
+
+    /** Returns the current minimum rendering sub-block size.
+        @see setMinimumRenderingSubdivisionSize
+    */
+    int getMinimumRenderingSubdivisionSize() const noexcept        { return minimumSubBlockSize; }
+
+    /** If enabled, renderNextBlock() will only call the voices that are currently playing a note.
+
+        By default, every voice is asked to render every sub-block, even if it isn't playing
+        anything. Voices are supposed to produce no output when they're idle, so enabling this
+        can save a lot of pointless virtual calls in synths that have lots of voices. You should
+        only leave it disabled if your voices need to do something in renderNextBlock() even
+        when they're not playing a note.
+    */
+    void setInactiveVoiceSkippingEnabled (bool shouldSkipInactiveVoices) noexcept;
+
+    /** Returns true if inactive voices are skipped when rendering.
+        @see setInactiveVoiceSkippingEnabled
+    */
+    bool isInactiveVoiceSkippingEnabled() const noexcept            { return skipInactiveVoices; }
+
+    //==============================================================================
+    /** Some counters that describe how much work the synth has been doing in its
+        renderNextBlock() method.
+
+        @see getRenderingStats, getVoiceRenderingStats, resetRenderingStats
+    */
+    struct RenderingStats
+    {
+        RenderingStats() noexcept;
+
+        int64 numBlocks;                    /**< The number of calls to Synthesiser::renderNextBlock(). */
+        int64 numSubBlocks;                 /**< The number of sections that those blocks were divided into. */
+        int64 numMidiEvents;                /**< The number of midi events that were handled while rendering. */
+        int64 numVoiceRenderCalls;          /**< The number of calls made to SynthesiserVoice::renderNextBlock(). */
+        int64 numVoiceSamplesRendered;      /**< The total number of samples that the voices were asked to render. */
+        int64 numVoiceRenderCallsSkipped;   /**< The number of voice render calls that were skipped because the voice was idle. */
+    };
+
+    /** Returns the rendering counters for the whole synth.
+
+        The per-voice counters are summed across all the voices that the synth currently has.
+    */
+    RenderingStats getRenderingStats() const;
+
+    /** Returns the rendering counters for one of the voices.
+
+        Only the numVoiceRenderCalls and numVoiceSamplesRendered fields of the result are
+        filled-in; the others are zero.
+    */
+    RenderingStats getVoiceRenderingStats (int voiceIndex) const;
+
+    /** Resets all the rendering counters to zero. */
+    void resetRenderingStats();
+
 protected:
     //==============================================================================
     /** This is used to control access to the rendering callback and the note trigger methods. */
     CriticalSection lock;
 
+    /** The synth's voices.
+        If you change this array directly instead of using addVoice() and removeVoice(), do
+        it while holding the lock, and only replace voices that aren't playing. If you replace
+        a voice with a new one, the synth won't notice until the start of the next
+        renderNextBlock() call, so don't trigger any notes directly in between.
+    */
     OwnedArray <SynthesiserVoice> voices;
     ReferenceCountedArray <SynthesiserSound> sounds;
 
@@ -456,6 +563,13 @@ protected:
 
         Returns nullptr if all voices are busy and stealing isn't enabled.
 
+        The default implementation takes the idle voice that most recently finished playing
+        (so a voice that has just been released will be re-used before one that has been
+        silent for longer, regardless of their positions in the voices array), or if there
+        aren't any, steals the one which started playing the longest time ago. Both of these are
+        constant-time operations (unless the voices are fussy about which sounds they'll play),
+        so this is cheap even when there are hundreds of voices.
+
         This can be overridden to implement custom voice-stealing algorithms.
     */
     virtual SynthesiserVoice* findFreeVoice (SynthesiserSound* soundToPlay,
@@ -474,13 +588,43 @@ protected:
 
 private:
     //==============================================================================
+    class VoiceList
+    {
+    public:
+        VoiceList() noexcept;
+
+        void append (SynthesiserVoice*) noexcept;
+        void insertInNoteOnOrder (SynthesiserVoice*) noexcept;
+        void remove (SynthesiserVoice*) noexcept;
+        void clear() noexcept;
+
+        SynthesiserVoice* first;
+        SynthesiserVoice* last;
+        int size;
+    };
+
+    class MidiEventQueue;
+    friend class SynthesiserVoice;
+
     double sampleRate;
     uint32 lastNoteOnCounter;
+    uint32 voicesGeneration, voiceListsGeneration;
     bool shouldStealNotes;
     BigInteger sustainPedalsDown;
+    VoiceList activeVoices, freeVoices; // (active voices are kept in the order in which they were started)
+    ScopedPointer<MidiEventQueue> queuedEvents;
+    int minimumSubBlockSize;
+    bool subBlockSubdivisionIsStrict, skipInactiveVoices;
+    RenderingStats stats; // (the voice fields are only filled-in when the stats are requested)
 
     void handleMidiEvent (const MidiMessage& m);
+    void handleQueuedEvents();
+    void renderVoices (AudioSampleBuffer& outputAudio, int startSample, int numSamples);
     void stopVoice (SynthesiserVoice* voice, bool allowTailOff);
+    void voiceStarted (SynthesiserVoice*) noexcept;
+    void voiceFinished (SynthesiserVoice*) noexcept;
+    void checkForReplacedVoices() noexcept;
+    void updateVoiceLists();
 
    #if JUCE_CATCH_DEPRECATED_CODE_MISUSE
     // Note the new parameters for this method.
@@ -39,6 +39,18 @@
 #include "../juce_core/native/juce_BasicNativeHeaders.h"
 #include "juce_audio_formats.h"
 
+#ifndef JUCE_USE_SSE_INTRINSICS
+ #define JUCE_USE_SSE_INTRINSICS 1
+#endif
+
+#if ! JUCE_INTEL
+ #undef JUCE_USE_SSE_INTRINSICS
+#endif
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#endif
+
 //==============================================================================
 #if JUCE_MAC
  #define Point CarbonDummyPointName
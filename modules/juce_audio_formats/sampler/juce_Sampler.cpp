@@ -23,6 +23,193 @@
   ==============================================================================
 */
 
+//==============================================================================
+namespace SamplerHelpers
+{
+    static void readSamples (AudioFormatReader& source, AudioSampleBuffer& dest,
+                             int destStart, int numSamples, int64 sourceStart)
+    {
+        // if the whole file couldn't be mapped, we'll have to map each section as it's needed
+        if (MemoryMappedAudioFormatReader* const mapped = dynamic_cast <MemoryMappedAudioFormatReader*> (&source))
+        {
+            const Range<int64> section (sourceStart, jmin (source.lengthInSamples, sourceStart + numSamples));
+
+            if (! (section.isEmpty() || mapped->getMappedSection().contains (section)))
+                mapped->mapSectionOfFile (section.withLength (jmax ((int64) (1 << 20), section.getLength()))
+                                                 .getIntersectionWith (Range<int64> (0, source.lengthInSamples)));
+        }
+
+        source.read (&dest, destStart, numSamples, sourceStart, true, true);
+    }
+}
+
+//==============================================================================
+class SamplerDiskStreamer::Stream
+{
+public:
+    Stream (const int capacity)
+        : buffer (2, capacity), mask (capacity - 1),
+          sound (nullptr), endPosition (0), playbackRate (1.0)
+    {
+        jassert (isPowerOfTwo (capacity));
+    }
+
+    enum
+    {
+        streamFree,
+        streamStarting, // claimed by the audio thread, which is setting it up
+        streamActive,
+        streamFinished  // released by its voice, and waiting for the reader thread to clear it
+    };
+
+    int getCapacity() const noexcept                { return mask + 1; }
+
+    // The number of samples that need to be read before the buffer is full or the sound has ended
+    int getNumSamplesWanted() const noexcept
+    {
+        return jmin (readPosition.get() + getCapacity(), endPosition) - validEnd.get();
+    }
+
+    double getTimeBuffered() const noexcept
+    {
+        return (validEnd.get() - readPosition.get()) / playbackRate;
+    }
+
+    void readNextChunk (const int maxSamples)
+    {
+        const int start = validEnd.get();
+        const int num = jmin (maxSamples, getNumSamplesWanted());
+
+        if (num > 0)
+        {
+            const int ringStart = start & mask;
+            const int numBeforeWrap = jmin (num, getCapacity() - ringStart);
+
+            SamplerHelpers::readSamples (*sound->streamingSource, buffer, ringStart, numBeforeWrap, start);
+
+            if (numBeforeWrap < num)
+                SamplerHelpers::readSamples (*sound->streamingSource, buffer, 0, num - numBeforeWrap, start + numBeforeWrap);
+
+            // (only publish the new data once it's all been written)
+            validEnd = start + num;
+        }
+    }
+
+    AudioSampleBuffer buffer;
+    const int mask;
+
+    SamplerSound* sound;
+    SynthesiserSound::Ptr soundRef; // keeps the sound alive until the reader thread has finished with it
+    int endPosition;
+    double playbackRate;
+
+    Atomic<int> state, readPosition, validEnd;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (Stream)
+};
+
+//==============================================================================
+SamplerDiskStreamer::SamplerDiskStreamer (TimeSliceThread& thread_,
+                                          const int maxNumStreams,
+                                          const int samplesToBufferPerStream)
+    : thread (thread_)
+{
+    jassert (maxNumStreams > 0);
+
+    const int capacity = nextPowerOfTwo (jmax (4096, samplesToBufferPerStream));
+
+    for (int i = 0; i < maxNumStreams; ++i)
+        streams.add (new Stream (capacity));
+
+    thread.addTimeSliceClient (this);
+}
+
+SamplerDiskStreamer::~SamplerDiskStreamer()
+{
+    thread.removeTimeSliceClient (this);
+}
+
+int SamplerDiskStreamer::getNumActiveStreams() const noexcept
+{
+    int num = 0;
+
+    for (int i = streams.size(); --i >= 0;)
+        if (streams.getUnchecked(i)->state.get() == Stream::streamActive)
+            ++num;
+
+    return num;
+}
+
+SamplerDiskStreamer::Stream* SamplerDiskStreamer::startStream (SamplerSound& sound, const int startPosition,
+                                                               const double playbackRate) noexcept
+{
+    for (int i = 0; i < streams.size(); ++i)
+    {
+        Stream* const s = streams.getUnchecked(i);
+
+        if (s->state.compareAndSetBool (Stream::streamStarting, Stream::streamFree))
+        {
+            s->sound = &sound;
+            s->soundRef = &sound;
+            s->endPosition = sound.length + 4;
+            s->playbackRate = jmax (0.001, playbackRate);
+            s->readPosition = startPosition;
+            s->validEnd = startPosition;
+            s->state = Stream::streamActive;
+            return s;
+        }
+    }
+
+    ++numUnderruns;
+    return nullptr;
+}
+
+int SamplerDiskStreamer::useTimeSlice()
+{
+    Stream* mostUrgent = nullptr;
+    double leastTimeBuffered = 0;
+    int numActive = 0;
+
+    for (int i = streams.size(); --i >= 0;)
+    {
+        Stream& s = *streams.getUnchecked(i);
+        const int state = s.state.get();
+
+        if (state == Stream::streamActive)
+        {
+            ++numActive;
+
+            if (s.getNumSamplesWanted() > 0)
+            {
+                const double timeBuffered = s.getTimeBuffered();
+
+                if (mostUrgent == nullptr || timeBuffered < leastTimeBuffered)
+                {
+                    mostUrgent = &s;
+                    leastTimeBuffered = timeBuffered;
+                }
+            }
+        }
+        else if (state == Stream::streamFinished)
+        {
+            s.sound = nullptr;
+            s.soundRef = nullptr;
+            s.state = Stream::streamFree;
+        }
+    }
+
+    if (mostUrgent == nullptr)
+        return numActive > 0 ? 2 : 10;
+
+    // With more voices playing, each one gets a smaller chunk, so they all get topped up more often
+    const int capacity = mostUrgent->getCapacity();
+    mostUrgent->readNextChunk (jmin (capacity / 2, jmax (1024, capacity / numActive)));
+    return 0;
+}
+
+
+//==============================================================================
 SamplerSound::SamplerSound (const String& name_,
                             AudioFormatReader& source,
                             const BigInteger& midiNotes_,
@@ -32,7 +219,8 @@ SamplerSound::SamplerSound (const String& name_,
                             const double maxSampleLengthSeconds)
     : name (name_),
       midiNotes (midiNotes_),
-      midiRootNote (midiNoteForNormalPitch)
+      midiRootNote (midiNoteForNormalPitch),
+      streamer (nullptr)
 {
     sourceSampleRate = source.sampleRate;
 
@@ -54,6 +242,51 @@ SamplerSound::SamplerSound (const String& name_,
         attackSamples = roundToInt (attackTimeSecs * sourceSampleRate);
         releaseSamples = roundToInt (releaseTimeSecs * sourceSampleRate);
     }
+
+    preloadLength = length;
+}
+
+SamplerSound::SamplerSound (const String& name_,
+                            AudioFormatReader* const source,
+                            const BigInteger& midiNotes_,
+                            const int midiNoteForNormalPitch,
+                            const double attackTimeSecs,
+                            const double releaseTimeSecs,
+                            SamplerDiskStreamer& streamer_,
+                            const double preloadTimeSecs)
+    : name (name_),
+      midiNotes (midiNotes_),
+      midiRootNote (midiNoteForNormalPitch),
+      streamingSource (source),
+      streamer (&streamer_)
+{
+    jassert (source != nullptr);
+    sourceSampleRate = source != nullptr ? source->sampleRate : 0.0;
+
+    if (source == nullptr || sourceSampleRate <= 0 || source->lengthInSamples <= 0)
+    {
+        length = 0;
+        attackSamples = 0;
+        releaseSamples = 0;
+        preloadLength = 0;
+        streamer = nullptr;
+    }
+    else
+    {
+        if (MemoryMappedAudioFormatReader* const mapped = dynamic_cast <MemoryMappedAudioFormatReader*> (source))
+            mapped->mapEntireFile();
+
+        // (the stream positions are ints, so this still allows a couple of hours at 192KHz)
+        length = (int) jmin ((int64) 0x7ffff000, source->lengthInSamples);
+        preloadLength = jlimit (0, length, roundToInt (preloadTimeSecs * sourceSampleRate));
+
+        data = new AudioSampleBuffer (jmin (2, (int) source->numChannels), preloadLength + 4);
+
+        SamplerHelpers::readSamples (*source, *data, 0, preloadLength + 4, 0);
+
+        attackSamples = roundToInt (attackTimeSecs * sourceSampleRate);
+        releaseSamples = roundToInt (releaseTimeSecs * sourceSampleRate);
+    }
 }
 
 SamplerSound::~SamplerSound()
@@ -70,19 +303,230 @@ bool SamplerSound::appliesToChannel (const int /*midiChannel*/)
     return true;
 }
 
+//==============================================================================
+namespace SamplerInterpolationHelpers
+{
+    enum
+    {
+        maxOutputBlockSize = 256,
+        maxSourceBlockSize = 1024,   // (must be well under the smallest stream buffer size)
+        sourceBufferSize = maxSourceBlockSize + 64,
+        numPhases = 128,
+        numSincTables = 9            // for speed ratios from 1 up to 4, in quarter-octave steps
+    };
+
+    /* A table of the weights for a kernel at each of a set of phases between two samples. Each
+       row of weights is followed by the differences to the next row, so that the kernel can be
+       interpolated for positions between the phases.
+    */
+    template <int numTaps>
+    class KernelTable
+    {
+    public:
+        KernelTable() : data ((size_t) (numPhases * numTaps * 2), true) {}
+
+        template <class KernelFunction>
+        void build (KernelFunction kernel)
+        {
+            HeapBlock<float> weights ((size_t) ((numPhases + 1) * numTaps), true);
+
+            for (int phase = 0; phase <= numPhases; ++phase)
+                kernel (phase / (float) numPhases, weights + phase * numTaps);
+
+            for (int phase = 0; phase < numPhases; ++phase)
+            {
+                float* const row = data + phase * numTaps * 2;
+                const float* const w = weights + phase * numTaps;
+
+                for (int i = 0; i < numTaps; ++i)
+                {
+                    row[i] = w[i];
+                    row[i + numTaps] = w[i + numTaps] - w[i];
+                }
+            }
+        }
+
+        /* Interpolates a block of samples, returning the source position that follows the last one.
+           The source data has to contain the samples from (numTaps / 2 - 1) before the first
+           position to (numTaps / 2) after the last one.
+        */
+        double process (const float* srcL, const float* srcR, const int firstSourceIndex,
+                        float* destL, float* destR, double pos, const double ratio, int num) const noexcept
+        {
+            const int offset = firstSourceIndex + (numTaps / 2 - 1);
+
+            while (--num >= 0)
+            {
+                const int index = (int) pos;
+                const float phase = (float) (pos - index) * numPhases;
+                const int row = jmin ((int) phase, numPhases - 1);
+                const float* const weights = data + row * numTaps * 2;
+                const float* const l = srcL + (index - offset);
+
+               #if JUCE_USE_SSE_INTRINSICS
+                const __m128 frac = _mm_set1_ps (phase - row);
+                __m128 w[numTaps / 4];
+
+                for (int i = 0; i < numTaps / 4; ++i)
+                    w[i] = _mm_add_ps (_mm_loadu_ps (weights + i * 4),
+                                       _mm_mul_ps (frac, _mm_loadu_ps (weights + numTaps + i * 4)));
+
+                *destL++ = dotProduct (w, l);
+
+                if (srcR != nullptr)
+                    *destR++ = dotProduct (w, srcR + (index - offset));
+               #else
+                const float frac = phase - row;
+                float w[numTaps];
+
+                for (int i = 0; i < numTaps; ++i)
+                    w[i] = weights[i] + frac * weights[i + numTaps];
+
+                *destL++ = dotProduct (w, l);
+
+                if (srcR != nullptr)
+                    *destR++ = dotProduct (w, srcR + (index - offset));
+               #endif
+
+                pos += ratio;
+            }
+
+            return pos;
+        }
+
+    private:
+        HeapBlock<float> data;
+
+       #if JUCE_USE_SSE_INTRINSICS
+        static forcedinline float dotProduct (const __m128* w, const float* src) noexcept
+        {
+            __m128 sum = _mm_mul_ps (w[0], _mm_loadu_ps (src));
+
+            for (int i = 1; i < numTaps / 4; ++i)
+                sum = _mm_add_ps (sum, _mm_mul_ps (w[i], _mm_loadu_ps (src + i * 4)));
+
+            sum = _mm_add_ps (sum, _mm_movehl_ps (sum, sum));
+            return _mm_cvtss_f32 (_mm_add_ss (sum, _mm_shuffle_ps (sum, sum, 1)));
+        }
+       #else
+        static forcedinline float dotProduct (const float* w, const float* src) noexcept
+        {
+            float sum = 0;
+
+            for (int i = 0; i < numTaps; ++i)
+                sum += w[i] * src[i];
+
+            return sum;
+        }
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (KernelTable)
+    };
+
+    // The lagrange kernel only needs 5 taps, but is padded to 8 to keep things aligned
+    struct LagrangeKernel
+    {
+        void operator() (const float offset, float* const weights) const noexcept
+        {
+            LagrangeInterpolator::calculateWeights (offset, weights + 1);
+        }
+    };
+
+    // A 16-point sinc, with a Blackman-Harris window
+    struct SincKernel
+    {
+        SincKernel (const double cutoff_) noexcept : cutoff (cutoff_) {}
+
+        void operator() (const float offset, float* const weights) const noexcept
+        {
+            double total = 0;
+
+            for (int i = 0; i < 16; ++i)
+            {
+                const double x = (i - 7) - offset;
+                const double sinc = x == 0 ? 1.0 : std::sin (double_Pi * cutoff * x) / (double_Pi * cutoff * x);
+                const double w = double_Pi * x / 8.0;
+                const double window = 0.35875 + 0.48829 * std::cos (w) + 0.14128 * std::cos (2.0 * w) + 0.01168 * std::cos (3.0 * w);
+
+                weights[i] = (float) (sinc * window);
+                total += weights[i];
+            }
+
+            // normalise the gain so that every phase has the same DC level
+            for (int i = 0; i < 16; ++i)
+                weights[i] = (float) (weights[i] / total);
+        }
+
+        const double cutoff;
+    };
+
+    class KernelTables
+    {
+    public:
+        KernelTables()
+        {
+            lagrange.build (LagrangeKernel());
+
+            for (int i = 0; i < numSincTables; ++i)
+                sinc[i].build (SincKernel (0.9 / std::pow (2.0, i / 4.0)));
+        }
+
+        static const KernelTables& getInstance()
+        {
+            static KernelTables tables;
+            return tables;
+        }
+
+        // When the pitch goes up, a table with a lower cutoff is needed to avoid aliasing
+        const KernelTable<16>& getSincTableForRatio (const double ratio) const noexcept
+        {
+            return sinc [ratio <= 1.0 ? 0 : jmin ((int) numSincTables - 1, (int) std::ceil (4.0 * std::log (ratio) / std::log (2.0) - 0.001))];
+        }
+
+        KernelTable<8> lagrange;
+        KernelTable<16> sinc [numSincTables];
+    };
+
+    static double interpolateLinear (const float* srcL, const float* srcR, const int firstSourceIndex,
+                                     float* destL, float* destR, double pos, const double ratio, int num) noexcept
+    {
+        while (--num >= 0)
+        {
+            const int index = (int) pos;
+            const float alpha = (float) (pos - index);
+            const float invAlpha = 1.0f - alpha;
+            const int i = index - firstSourceIndex;
+
+            *destL++ = srcL [i] * invAlpha + srcL [i + 1] * alpha;
+
+            if (srcR != nullptr)
+                *destR++ = srcR [i] * invAlpha + srcR [i + 1] * alpha;
+
+            pos += ratio;
+        }
+
+        return pos;
+    }
+}
+
 //==============================================================================
 SamplerVoice::SamplerVoice()
-    : pitchRatio (0.0),
+    : stream (nullptr),
+      pitchRatio (0.0),
       sourceSamplePosition (0.0),
       lgain (0.0f),
       rgain (0.0f),
       isInAttack (false),
-      isInRelease (false)
+      isInRelease (false),
+      quality (linearInterpolation),
+      workspace ((size_t) (2 * (SamplerInterpolationHelpers::sourceBufferSize
+                                 + SamplerInterpolationHelpers::maxOutputBlockSize)))
 {
 }
 
 SamplerVoice::~SamplerVoice()
 {
+    releaseStream();
 }
 
 bool SamplerVoice::canPlaySound (SynthesiserSound* sound)
@@ -90,12 +534,23 @@ bool SamplerVoice::canPlaySound (SynthesiserSound* sound)
     return dynamic_cast <const SamplerSound*> (sound) != nullptr;
 }
 
+void SamplerVoice::setInterpolationQuality (const InterpolationQuality newQuality)
+{
+    // (this makes sure the kernel tables are built here, rather than on the audio thread)
+    if (newQuality != linearInterpolation)
+        SamplerInterpolationHelpers::KernelTables::getInstance();
+
+    quality = newQuality;
+}
+
 void SamplerVoice::startNote (const int midiNoteNumber,
                               const float velocity,
                               SynthesiserSound* s,
                               const int /*currentPitchWheelPosition*/)
 {
-    if (const SamplerSound* const sound = dynamic_cast <const SamplerSound*> (s))
+    releaseStream();
+
+    if (SamplerSound* const sound = dynamic_cast <SamplerSound*> (s))
     {
         pitchRatio = pow (2.0, (midiNoteNumber - sound->midiRootNote) / 12.0)
                         * sound->sourceSampleRate / getSampleRate();
@@ -122,6 +577,9 @@ void SamplerVoice::startNote (const int midiNoteNumber,
             releaseDelta = (float) (-pitchRatio / sound->releaseSamples);
         else
             releaseDelta = 0.0f;
+
+        if (sound->isStreaming() && sound->preloadLength < sound->length)
+            stream = sound->streamer->startStream (*sound, sound->preloadLength, pitchRatio);
     }
     else
     {
@@ -138,10 +596,20 @@ void SamplerVoice::stopNote (const bool allowTailOff)
     }
     else
     {
+        releaseStream();
         clearCurrentNote();
     }
 }
 
+void SamplerVoice::releaseStream() noexcept
+{
+    if (stream != nullptr)
+    {
+        stream->state = SamplerDiskStreamer::Stream::streamFinished;
+        stream = nullptr;
+    }
+}
+
 void SamplerVoice::pitchWheelMoved (const int /*newValue*/)
 {
 }
@@ -152,75 +620,731 @@ void SamplerVoice::controllerMoved (const int /*controllerNumber*/,
 }
 
 //==============================================================================
+bool SamplerVoice::readSourceSamples (const SamplerSound& sound, int startIndex, int numSamples,
+                                      float* destL, float* destR) const noexcept
+{
+    // Copies a run of the sound's samples into a contiguous block, taking them from the
+    // preloaded data or the stream, and padding with silence beyond either end
+    const AudioSampleBuffer& preloaded = *sound.data;
+    bool underran = false;
+
+    if (startIndex < 0)
+    {
+        const int num = jmin (numSamples, -startIndex);
+        FloatVectorOperations::clear (destL, num);
+        if (destR != nullptr) { FloatVectorOperations::clear (destR, num); destR += num; }
+        destL += num;
+        startIndex += num;
+        numSamples -= num;
+    }
+
+    if (numSamples > 0 && startIndex < preloaded.getNumSamples())
+    {
+        const int num = jmin (numSamples, preloaded.getNumSamples() - startIndex);
+        FloatVectorOperations::copy (destL, preloaded.getSampleData (0, startIndex), num);
+        if (destR != nullptr) { FloatVectorOperations::copy (destR, preloaded.getSampleData (1, startIndex), num); destR += num; }
+        destL += num;
+        startIndex += num;
+        numSamples -= num;
+    }
+
+    if (numSamples > 0 && stream != nullptr)
+    {
+        const int num = jmin (numSamples, stream->validEnd.get() - startIndex);
+
+        if (num > 0)
+        {
+            const int ringStart = startIndex & stream->mask;
+            const int numBeforeWrap = jmin (num, stream->getCapacity() - ringStart);
+
+            for (int chan = 0; chan < 2; ++chan)
+            {
+                if (float* const dest = chan == 0 ? destL : destR)
+                {
+                    const float* const ring = stream->buffer.getSampleData (chan, 0);
+                    FloatVectorOperations::copy (dest, ring + ringStart, numBeforeWrap);
+                    FloatVectorOperations::copy (dest + numBeforeWrap, ring, num - numBeforeWrap);
+                }
+            }
+
+            if (destR != nullptr)
+                destR += num;
+
+            destL += num;
+            startIndex += num;
+            numSamples -= num;
+        }
+
+        // if there's still some data missing that the reader should have provided, it's fallen behind
+        underran = numSamples > 0 && startIndex < stream->endPosition;
+    }
+
+    if (numSamples > 0)
+    {
+        FloatVectorOperations::clear (destL, numSamples);
+
+        if (destR != nullptr)
+            FloatVectorOperations::clear (destR, numSamples);
+    }
+
+    return underran;
+}
+
 void SamplerVoice::renderNextBlock (AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
 {
+    using namespace SamplerInterpolationHelpers;
+
     if (const SamplerSound* const playingSound = static_cast <SamplerSound*> (getCurrentlyPlayingSound().get()))
     {
-        const float* const inL = playingSound->data->getSampleData (0, 0);
-        const float* const inR = playingSound->data->getNumChannels() > 1
-                                    ? playingSound->data->getSampleData (1, 0) : nullptr;
+        const bool isStereoSound = playingSound->data->getNumChannels() > 1;
+
+        // a streaming sound which couldn't get a stream can only play the part that's in memory
+        const int playableLength = (playingSound->isStreaming() && stream == nullptr) ? playingSound->preloadLength
+                                                                                        : playingSound->length;
+
+        int numTapsBefore = 0, numTapsAfter = 1;
+        const KernelTable<8>* lagrangeTable = nullptr;
+        const KernelTable<16>* sincTable = nullptr;
+
+        if (quality == lagrangeInterpolation)
+        {
+            lagrangeTable = &(KernelTables::getInstance().lagrange);
+            numTapsBefore = 3;
+            numTapsAfter = 4;
+        }
+        else if (quality == sincInterpolation)
+        {
+            sincTable = &(KernelTables::getInstance().getSincTableForRatio (pitchRatio));
+            numTapsBefore = 7;
+            numTapsAfter = 8;
+        }
+
+        float* const sourceL = workspace;
+        float* const sourceR = isStereoSound ? sourceL + sourceBufferSize : nullptr;
+        float* const dryL = workspace + 2 * sourceBufferSize;
+        float* const dryR = isStereoSound ? dryL + maxOutputBlockSize : dryL;
 
         float* outL = outputBuffer.getSampleData (0, startSample);
         float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getSampleData (1, startSample) : nullptr;
 
-        while (--numSamples >= 0)
+        SamplerDiskStreamer* const streamer = playingSound->streamer;
+        bool underran = false;
+
+        // The sound is rendered in sub-blocks, each of which is resampled in one go, and then
+        // has its envelope applied as a series of linear ramps..
+        while (numSamples > 0)
         {
-            const int pos = (int) sourceSamplePosition;
-            const float alpha = (float) (sourceSamplePosition - pos);
-            const float invAlpha = 1.0f - alpha;
+            if (sourceSamplePosition > playableLength)
+            {
+                stopNote (false);
+                break;
+            }
 
-            // just using a very simple linear interpolation here..
-            float l = (inL [pos] * invAlpha + inL [pos + 1] * alpha);
-            float r = (inR != nullptr) ? (inR [pos] * invAlpha + inR [pos + 1] * alpha)
-                                       : l;
+            int num = jmin (numSamples, (int) maxOutputBlockSize,
+                            (int) (maxSourceBlockSize / pitchRatio) + 1,
+                            (int) ((playableLength - sourceSamplePosition) / pitchRatio) + 1);
 
-            l *= lgain;
-            r *= rgain;
+            bool releaseHasFinished = false;
 
-            if (isInAttack)
+            if (isInRelease && releaseDelta < 0)
             {
-                l *= attackReleaseLevel;
-                r *= attackReleaseLevel;
+                // (the sample at which the level drops to zero isn't played)
+                const int numBeforeSilence = (int) std::ceil (attackReleaseLevel / -releaseDelta) - 1;
 
-                attackReleaseLevel += attackDelta;
+                if (numBeforeSilence <= num)
+                {
+                    num = numBeforeSilence;
+                    releaseHasFinished = true;
+                }
+            }
 
-                if (attackReleaseLevel >= 1.0f)
+            if (num > 0)
+            {
+                const int firstSourceIndex = (int) sourceSamplePosition - numTapsBefore;
+                const int lastSourceIndex = (int) (sourceSamplePosition + (num - 1) * pitchRatio) + numTapsAfter + 1;
+                jassert (lastSourceIndex - firstSourceIndex <= sourceBufferSize);
+
+                if (readSourceSamples (*playingSound, firstSourceIndex, lastSourceIndex - firstSourceIndex, sourceL, sourceR))
+                    underran = true;
+
+                if (sincTable != nullptr)
+                    sourceSamplePosition = sincTable->process (sourceL, sourceR, firstSourceIndex, dryL, dryR, sourceSamplePosition, pitchRatio, num);
+                else if (lagrangeTable != nullptr)
+                    sourceSamplePosition = lagrangeTable->process (sourceL, sourceR, firstSourceIndex, dryL, dryR, sourceSamplePosition, pitchRatio, num);
+                else
+                    sourceSamplePosition = interpolateLinear (sourceL, sourceR, firstSourceIndex, dryL, dryR, sourceSamplePosition, pitchRatio, num);
+
+                for (int done = 0; done < num;)
                 {
-                    attackReleaseLevel = 1.0f;
-                    isInAttack = false;
+                    int numInSegment = num - done;
+                    float levelDelta = 0.0f;
+
+                    if (isInAttack)
+                    {
+                        const int numUntilFullLevel = jmax (1, (int) std::ceil ((1.0f - attackReleaseLevel) / attackDelta));
+                        numInSegment = jmin (numInSegment, numUntilFullLevel);
+                        levelDelta = attackDelta;
+                    }
+                    else if (isInRelease)
+                    {
+                        levelDelta = releaseDelta;
+                    }
+
+                    if (outR != nullptr)
+                    {
+                        FloatVectorOperations::addWithMultiplyRamp (outL + done, dryL + done, lgain * attackReleaseLevel, lgain * levelDelta, numInSegment);
+                        FloatVectorOperations::addWithMultiplyRamp (outR + done, dryR + done, rgain * attackReleaseLevel, rgain * levelDelta, numInSegment);
+                    }
+                    else
+                    {
+                        FloatVectorOperations::addWithMultiplyRamp (outL + done, dryL + done, 0.5f * lgain * attackReleaseLevel, 0.5f * lgain * levelDelta, numInSegment);
+                        FloatVectorOperations::addWithMultiplyRamp (outL + done, dryR + done, 0.5f * rgain * attackReleaseLevel, 0.5f * rgain * levelDelta, numInSegment);
+                    }
+
+                    attackReleaseLevel += levelDelta * numInSegment;
+                    done += numInSegment;
+
+                    if (isInAttack && attackReleaseLevel >= 1.0f)
+                    {
+                        attackReleaseLevel = 1.0f;
+                        isInAttack = false;
+                    }
                 }
+
+                outL += num;
+                if (outR != nullptr) outR += num;
+                numSamples -= num;
             }
-            else if (isInRelease)
+
+            if (releaseHasFinished)
             {
-                l *= attackReleaseLevel;
-                r *= attackReleaseLevel;
+                stopNote (false);
+                break;
+            }
+        }
+
+        // Let the reader know which data we've finished with (the note may have stopped,
+        // in which case the stream will already have been released)
+        if (stream != nullptr)
+            stream->readPosition = (int) sourceSamplePosition - numTapsBefore;
 
-                attackReleaseLevel += releaseDelta;
+        if (underran)
+            ++(streamer->numUnderruns);
+    }
+}
 
-                if (attackReleaseLevel <= 0.0f)
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class SamplerTests  : public UnitTest
+{
+public:
+    SamplerTests() : UnitTest ("Sampler") {}
+
+    enum { sampleRate = 44100, rootNote = 60 };
+
+    // Writes some audio into an in-memory WAV file, and returns a reader for it. The data
+    // block must outlive the reader.
+    static AudioFormatReader* createWavReader (const AudioSampleBuffer& audio, MemoryBlock& wavData)
+    {
+        WavAudioFormat wav;
+
+        {
+            ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (new MemoryOutputStream (wavData, false), sampleRate,
+                                                                          (unsigned int) audio.getNumChannels(), 32,
+                                                                          StringPairArray(), 0));
+            writer->writeFromAudioSampleBuffer (audio, 0, audio.getNumSamples());
+        }
+
+        return wav.createReaderFor (new MemoryInputStream (wavData, false), true);
+    }
+
+    static void fillWithNoise (AudioSampleBuffer& buffer, const int64 seed)
+    {
+        Random r (seed);
+
+        for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.getSampleData (chan)[i] = r.nextFloat() * 2.0f - 1.0f;
+    }
+
+    // (a frequency of zero gives a DC level instead)
+    static void fillWithSine (AudioSampleBuffer& buffer, const double frequency)
+    {
+        for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.getSampleData (chan)[i] = frequency > 0 ? (float) (0.5 * std::sin (2.0 * double_Pi * frequency * i / sampleRate))
+                                                               : 0.5f;
+    }
+
+    static double getPitchRatio (const int note)
+    {
+        return std::pow (2.0, (note - rootNote) / 12.0);
+    }
+
+    // Plays a note in blocks, optionally releasing it at the start of one of the blocks, and
+    // optionally pausing after each block to give a streamer's thread time to keep up.
+    static void renderNote (const SynthesiserSound::Ptr& sound, const SamplerVoice::InterpolationQuality quality,
+                            const int note, AudioSampleBuffer& output, const int blockSize,
+                            const int noteOffSample = -1, const int millisecsToWaitPerBlock = 0)
+    {
+        Synthesiser synth;
+        SamplerVoice* const voice = new SamplerVoice();
+        voice->setInterpolationQuality (quality);
+        synth.addVoice (voice);
+        synth.addSound (sound);
+        synth.setCurrentPlaybackSampleRate (sampleRate);
+
+        synth.noteOn (1, note, 0.8f);
+        output.clear();
+        MidiBuffer noMidi;
+
+        for (int pos = 0; pos < output.getNumSamples(); pos += blockSize)
+        {
+            if (pos == noteOffSample)
+                synth.noteOff (1, note, true);
+
+            synth.renderNextBlock (output, noMidi, pos, jmin (blockSize, output.getNumSamples() - pos));
+
+            if (millisecsToWaitPerBlock > 0)
+                Thread::sleep (millisecsToWaitPerBlock);
+        }
+    }
+
+    static void renderBlocks (Synthesiser& synth, const int numBlocks)
+    {
+        AudioSampleBuffer output (2, 256);
+        MidiBuffer noMidi;
+
+        for (int i = 0; i < numBlocks; ++i)
+            synth.renderNextBlock (output, noMidi, 0, output.getNumSamples());
+    }
+
+    static int countVoicesPlaying (Synthesiser& synth)
+    {
+        int num = 0;
+
+        for (int i = 0; i < synth.getNumVoices(); ++i)
+            if (synth.getVoice (i)->getCurrentlyPlayingSound() != nullptr)
+                ++num;
+
+        return num;
+    }
+
+    static float getPeakLevel (const float* const data, const int num)
+    {
+        float mn, mx;
+        FloatVectorOperations::findMinAndMax (data, num, mn, mx);
+        return jmax (-mn, mx);
+    }
+
+    static int findLastNonZeroSample (const AudioSampleBuffer& buffer)
+    {
+        for (int i = buffer.getNumSamples(); --i >= 0;)
+            if (buffer.getSampleData (0)[i] != 0)
+                return i;
+
+        return -1;
+    }
+
+    //==============================================================================
+    // The per-sample loop that SamplerVoice used before it rendered in blocks, which the
+    // linear mode should still match.
+    class ReferenceVoice
+    {
+    public:
+        ReferenceVoice (const AudioSampleBuffer& data_, const int length_, const double pitchRatio_,
+                        const float gain, const int attackSamples, const int releaseSamples)
+            : data (data_), length (length_), pitchRatio (pitchRatio_), sourceSamplePosition (0),
+              lgain (gain), rgain (gain), isPlaying (true), isInAttack (attackSamples > 0), isInRelease (false)
+        {
+            attackReleaseLevel = isInAttack ? 0.0f : 1.0f;
+            attackDelta = isInAttack ? (float) (pitchRatio / attackSamples) : 0.0f;
+            releaseDelta = releaseSamples > 0 ? (float) (-pitchRatio / releaseSamples) : 0.0f;
+        }
+
+        void render (AudioSampleBuffer& output, const int noteOffSample)
+        {
+            const float* const inL = data.getSampleData (0, 0);
+            const float* const inR = data.getNumChannels() > 1 ? data.getSampleData (1, 0) : nullptr;
+            float* outL = output.getSampleData (0);
+            float* outR = output.getSampleData (1);
+
+            output.clear();
+
+            for (int i = 0; i < output.getNumSamples() && isPlaying; ++i)
+            {
+                if (i == noteOffSample)
                 {
-                    stopNote (false);
-                    break;
+                    isInAttack = false;
+                    isInRelease = true;
+                }
+
+                const int pos = (int) sourceSamplePosition;
+                const float alpha = (float) (sourceSamplePosition - pos);
+                const float invAlpha = 1.0f - alpha;
+
+                float l = (inL [pos] * invAlpha + inL [pos + 1] * alpha);
+                float r = (inR != nullptr) ? (inR [pos] * invAlpha + inR [pos + 1] * alpha) : l;
+
+                l *= lgain;
+                r *= rgain;
+
+                if (isInAttack)
+                {
+                    l *= attackReleaseLevel;
+                    r *= attackReleaseLevel;
+                    attackReleaseLevel += attackDelta;
+
+                    if (attackReleaseLevel >= 1.0f)
+                    {
+                        attackReleaseLevel = 1.0f;
+                        isInAttack = false;
+                    }
                 }
+                else if (isInRelease)
+                {
+                    l *= attackReleaseLevel;
+                    r *= attackReleaseLevel;
+                    attackReleaseLevel += releaseDelta;
+
+                    if (attackReleaseLevel <= 0.0f)
+                    {
+                        isPlaying = false;
+                        break;
+                    }
+                }
+
+                outL[i] = l;
+                outR[i] = r;
+
+                sourceSamplePosition += pitchRatio;
+
+                if (sourceSamplePosition > length)
+                    isPlaying = false;
             }
+        }
+
+    private:
+        const AudioSampleBuffer& data;
+        const int length;
+        const double pitchRatio;
+        double sourceSamplePosition;
+        float lgain, rgain, attackReleaseLevel, attackDelta, releaseDelta;
+        bool isPlaying, isInAttack, isInRelease;
+
+        JUCE_DECLARE_NON_COPYABLE (ReferenceVoice)
+    };
+
+    void checkLinearAgainstReference (const int numChannels, const int note, const int noteOffSample)
+    {
+        const int length = 6000, attackSamples = 441, releaseSamples = 1000, blockSize = 100;
+
+        AudioSampleBuffer source (numChannels, length);
+        fillWithNoise (source, note);
+        MemoryBlock wavData;
+        ScopedPointer<AudioFormatReader> reader (createWavReader (source, wavData));
+
+        BigInteger allNotes;
+        allNotes.setRange (0, 128, true);
+        SynthesiserSound::Ptr sound (new SamplerSound ("test", *reader, allNotes, rootNote,
+                                                       attackSamples / (double) sampleRate,
+                                                       releaseSamples / (double) sampleRate, 10.0));
+
+        AudioSampleBuffer output (2, 2 * length), expected (2, 2 * length);
+        renderNote (sound, SamplerVoice::linearInterpolation, note, output, blockSize, noteOffSample);
+
+        ReferenceVoice reference (*static_cast <SamplerSound*> (sound.getObject())->getAudioData(), length,
+                                  getPitchRatio (note), 0.8f, attackSamples, releaseSamples);
+        reference.render (expected, noteOffSample);
+
+        float maxError = 0;
+
+        for (int chan = 0; chan < 2; ++chan)
+            for (int i = 0; i < output.getNumSamples(); ++i)
+                maxError = jmax (maxError, std::abs (output.getSampleData (chan)[i] - expected.getSampleData (chan)[i]));
+
+        expect (maxError < 1.0e-4f, "error " + String (maxError));
+        expectEquals (findLastNonZeroSample (output), findLastNonZeroSample (expected));
+    }
+
+    void checkReproducesSignal (const SamplerVoice::InterpolationQuality quality, const int note,
+                                const double frequency, const float tolerance)
+    {
+        const int length = 8000;
+        const double ratio = getPitchRatio (note);
+
+        AudioSampleBuffer source (1, length);
+        fillWithSine (source, frequency);
+        MemoryBlock wavData;
+        ScopedPointer<AudioFormatReader> reader (createWavReader (source, wavData));
+
+        BigInteger allNotes;
+        allNotes.setRange (0, 128, true);
+        SynthesiserSound::Ptr sound (new SamplerSound ("test", *reader, allNotes, rootNote, 0, 0, 10.0));
+
+        // (the ends are skipped, where the kernel runs off the edge of the sound)
+        AudioSampleBuffer output (2, (int) ((length - 16) / ratio));
+        renderNote (sound, quality, note, output, 256);
+
+        float maxError = 0;
+
+        for (int i = (int) (16 / ratio) + 1; i < output.getNumSamples(); ++i)
+        {
+            const float expected = 0.8f * (frequency > 0 ? (float) (0.5 * std::sin (2.0 * double_Pi * frequency * i * ratio / sampleRate))
+                                                         : 0.5f);
+
+            for (int chan = 0; chan < 2; ++chan)
+                maxError = jmax (maxError, std::abs (output.getSampleData (chan)[i] - expected));
+        }
+
+        expect (maxError < tolerance, "note " + String (note) + ", error " + String (maxError));
+    }
+
+    template <int numTaps>
+    void checkKernelTable (const SamplerInterpolationHelpers::KernelTable<numTaps>& table, const bool shouldReproduceRamp)
+    {
+        const int firstSourceIndex = 50, numSource = 200, num = 100;
+        const double startPos = 60.3, ratio = 0.73;
+
+        HeapBlock<float> dc ((size_t) numSource), ramp ((size_t) numSource);
+        HeapBlock<float> destL ((size_t) num), destR ((size_t) num);
+
+        for (int i = 0; i < numSource; ++i)
+        {
+            dc[i] = 0.25f;
+            ramp[i] = (float) (firstSourceIndex + i);
+        }
+
+        const double endPos = table.process (ramp, dc, firstSourceIndex, destL, destR, startPos, ratio, num);
+        expect (std::abs (endPos - (startPos + num * ratio)) < 1.0e-9);
+
+        for (int i = 0; i < num; ++i)
+        {
+            expect (std::abs (destR[i] - 0.25f) < 1.0e-5f);
+
+            if (shouldReproduceRamp)
+                expect (std::abs (destL[i] - (float) (startPos + i * ratio)) < 1.0e-3f);
+        }
+    }
+
+    //==============================================================================
+    void runTest()
+    {
+        using namespace SamplerInterpolationHelpers;
+
+        beginTest ("Kernel tables");
+        {
+            const KernelTables& tables = KernelTables::getInstance();
+
+            // (a 5-point lagrange kernel is exact for polynomials, so it should follow a ramp perfectly)
+            checkKernelTable (tables.lagrange, true);
+
+            for (int i = 0; i < numSincTables; ++i)
+                checkKernelTable (tables.sinc[i], false);
+
+            expect (&tables.getSincTableForRatio (0.5) == &tables.sinc[0]);
+            expect (&tables.getSincTableForRatio (1.0) == &tables.sinc[0]);
+            expect (&tables.getSincTableForRatio (1.01) == &tables.sinc[1]);
+            expect (&tables.getSincTableForRatio (std::pow (2.0, 0.25)) == &tables.sinc[1]);
+            expect (&tables.getSincTableForRatio (2.0) == &tables.sinc[4]);
+            expect (&tables.getSincTableForRatio (4.0) == &tables.sinc[8]);
+            expect (&tables.getSincTableForRatio (16.0) == &tables.sinc[8]);
+
+            // the tables for raised pitches should filter out what would otherwise alias
+            HeapBlock<float> nyquist (64), dest (16);
+
+            for (int i = 0; i < 64; ++i)
+                nyquist[i] = (i & 1) != 0 ? 1.0f : -1.0f;
+
+            tables.sinc[0].process (nyquist, nullptr, 0, dest, nullptr, 20.25, 2.0, 16);
+            const float levelAtLowestRatio = getPeakLevel (dest, 16);
+            tables.getSincTableForRatio (2.0).process (nyquist, nullptr, 0, dest, nullptr, 20.25, 2.0, 16);
+            const float levelAtRatio = getPeakLevel (dest, 16);
+            expect (levelAtRatio < 0.01f && levelAtLowestRatio > 0.1f,
+                    String (levelAtLowestRatio) + ", " + String (levelAtRatio));
+        }
 
-            if (outR != nullptr)
+        beginTest ("Linear interpolation");
+        {
+            // the sound running out, releasing after the attack, and releasing during the attack
+            checkLinearAgainstReference (2, 61, -1);
+            checkLinearAgainstReference (2, 67, 2000);
+            checkLinearAgainstReference (1, 53, 2000);
+            checkLinearAgainstReference (2, 64, 200);
+        }
+
+        beginTest ("Lagrange and sinc interpolation");
+        {
+            const int notes[] = { 60, 64, 55, 72 };
+
+            for (int i = 0; i < numElementsInArray (notes); ++i)
             {
-                *outL++ += l;
-                *outR++ += r;
+                checkReproducesSignal (SamplerVoice::lagrangeInterpolation, notes[i], 0, 1.0e-5f);
+                checkReproducesSignal (SamplerVoice::sincInterpolation, notes[i], 0, 1.0e-5f);
+                checkReproducesSignal (SamplerVoice::lagrangeInterpolation, notes[i], 200.0, 1.0e-4f);
+                checkReproducesSignal (SamplerVoice::sincInterpolation, notes[i], 200.0, 1.0e-3f);
             }
-            else
+        }
+
+        beginTest ("Streaming");
+        {
+            // The stream buffers are the smallest allowed, so the sound wraps round them several
+            // times, and only a few blocks are preloaded before the stream has to take over..
+            const int length = 40000, streamBufferSize = 4096;
+            const double preloadSecs = 0.02;
+
+            AudioSampleBuffer source (2, length);
+            fillWithNoise (source, 2);
+            MemoryBlock wavData;
+            ScopedPointer<AudioFormatReader> reader (createWavReader (source, wavData));
+
+            TimeSliceThread thread ("sampler test");
+            thread.startThread();
+
             {
-                *outL++ += (l + r) * 0.5f;
+                SamplerDiskStreamer streamer (thread, 2, streamBufferSize);
+
+                BigInteger allNotes;
+                allNotes.setRange (0, 128, true);
+
+                SynthesiserSound::Ptr inMemory (new SamplerSound ("memory", *reader, allNotes, rootNote, 0.01, 0.05, 10.0));
+                SynthesiserSound::Ptr streamed (new SamplerSound ("streamed", createWavReader (source, wavData), allNotes,
+                                                                  rootNote, 0.01, 0.05, streamer, preloadSecs));
+                expect (static_cast <SamplerSound*> (streamed.getObject())->isStreaming());
+
+                // the streamed sound should play exactly the same as the one in memory, through the
+                // hand-over from the preloaded data to the stream, and for every interpolator
+                for (int quality = SamplerVoice::linearInterpolation; quality <= SamplerVoice::sincInterpolation; ++quality)
+                {
+                    const int notes[] = { 60, 67 };
+
+                    for (int i = 0; i < numElementsInArray (notes); ++i)
+                    {
+                        AudioSampleBuffer expected (2, length + 1000), output (2, length + 1000);
+                        renderNote (inMemory, (SamplerVoice::InterpolationQuality) quality, notes[i], expected, 256);
+
+                        streamer.resetUnderrunCount();
+                        renderNote (streamed, (SamplerVoice::InterpolationQuality) quality, notes[i], output, 256, -1, 5);
+                        expectEquals (streamer.getNumUnderruns(), 0);
+
+                        for (int chan = 0; chan < 2; ++chan)
+                            expect (memcmp (expected.getSampleData (chan), output.getSampleData (chan),
+                                            sizeof (float) * (size_t) output.getNumSamples()) == 0);
+                    }
+                }
+
+                Synthesiser synth;
+
+                for (int i = 0; i < 3; ++i)
+                    synth.addVoice (new SamplerVoice());
+
+                synth.addSound (streamed);
+                synth.setCurrentPlaybackSampleRate (sampleRate);
+
+                // with the reader stopped, the voice will play past the preloaded part and run out of data..
+                thread.stopThread (1000);
+                streamer.resetUnderrunCount();
+
+                synth.noteOn (1, 60, 1.0f);
+                expectEquals (streamer.getNumActiveStreams(), 1);
+                renderBlocks (synth, 2);
+                expectEquals (streamer.getNumUnderruns(), 0);
+                renderBlocks (synth, 6);
+                expect (streamer.getNumUnderruns() > 0);
+
+                // ..and when it stops, its stream is released, but can't be re-used until the reader has cleared it
+                synth.allNotesOff (0, false);
+                expectEquals (streamer.getNumActiveStreams(), 0);
+
+                streamer.resetUnderrunCount();
+                synth.noteOn (1, 60, 1.0f);
+                synth.noteOn (1, 62, 1.0f);
+                expectEquals (streamer.getNumActiveStreams(), 1);
+                expectEquals (streamer.getNumUnderruns(), 1);
+                synth.allNotesOff (0, false);
+
+                thread.startThread();
+                Thread::sleep (100);
+
+                // once the reader has cleared them, both streams are free again, and a third voice
+                // has to make do with the preloaded data..
+                streamer.resetUnderrunCount();
+                synth.noteOn (1, 60, 1.0f);
+                synth.noteOn (1, 62, 1.0f);
+                expectEquals (streamer.getNumActiveStreams(), 2);
+                expectEquals (streamer.getNumUnderruns(), 0);
+
+                synth.noteOn (1, 64, 1.0f);
+                expectEquals (streamer.getNumActiveStreams(), 2);
+                expectEquals (streamer.getNumUnderruns(), 1);
+
+                renderBlocks (synth, 8);
+                expectEquals (countVoicesPlaying (synth), 2);
+
+                synth.allNotesOff (0, false);
+                expectEquals (streamer.getNumActiveStreams(), 0);
             }
 
-            sourceSamplePosition += pitchRatio;
+            thread.stopThread (1000);
+        }
+
+        beginTest ("Voices per core");
+        {
+            const int numVoices = 48, blockSize = 512, numBlocks = 100;
+            const char* const qualityNames[] = { "linear", "Lagrange", "sinc" };
+
+            AudioSampleBuffer source (2, 5 * sampleRate);
+            fillWithNoise (source, 1);
+            MemoryBlock wavData;
+            ScopedPointer<AudioFormatReader> reader (createWavReader (source, wavData));
+
+            BigInteger allNotes;
+            allNotes.setRange (0, 128, true);
+            SynthesiserSound::Ptr sound (new SamplerSound ("test", *reader, allNotes, rootNote, 0.01, 0.1, 10.0));
 
-            if (sourceSamplePosition > playingSound->length)
+            for (int quality = 0; quality < numElementsInArray (qualityNames); ++quality)
             {
-                stopNote (false);
-                break;
+                Synthesiser synth;
+
+                for (int i = 0; i < numVoices; ++i)
+                {
+                    SamplerVoice* const voice = new SamplerVoice();
+                    voice->setInterpolationQuality ((SamplerVoice::InterpolationQuality) quality);
+                    synth.addVoice (voice);
+                }
+
+                synth.addSound (sound);
+                synth.setCurrentPlaybackSampleRate (sampleRate);
+
+                // every voice plays a different note, over four octaves around the root
+                for (int i = 0; i < numVoices; ++i)
+                    synth.noteOn (1, rootNote - numVoices / 2 + i, 0.5f);
+
+                AudioSampleBuffer output (2, blockSize);
+                MidiBuffer noMidi;
+
+                const int64 startTime = Time::getHighResolutionTicks();
+
+                for (int i = 0; i < numBlocks; ++i)
+                {
+                    output.clear();
+                    synth.renderNextBlock (output, noMidi, 0, blockSize);
+                }
+
+                const double secondsTaken = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTime);
+                const double secondsRendered = numBlocks * blockSize / (double) sampleRate;
+
+                logMessage (String (qualityNames [quality]) + ": "
+                              + String (roundToInt (numVoices * secondsRendered / secondsTaken)) + " voices per core");
+
+                for (int i = 0; i < numVoices; ++i)
+                    expect (synth.getVoice (i)->getCurrentlyPlayingSound() != nullptr);
             }
         }
     }
-}
+};
+
+static SamplerTests samplerTests;
+
+#endif
@@ -26,13 +26,99 @@
 #ifndef __JUCE_SAMPLER_JUCEHEADER__
 #define __JUCE_SAMPLER_JUCEHEADER__
 
+class SamplerSound;
+class SamplerVoice;
+
+
+//==============================================================================
+/**
+    Streams sample data from disk for SamplerSounds that are too big to keep in memory.
+
+    A SamplerSound that's created in streaming mode only keeps the first part of its
+    audio in memory, and when a SamplerVoice plays it, the rest of the audio is read
+    by this object on a background thread, into a buffer which belongs to that voice.
+
+    The streamer has a fixed number of these buffers, all of which are allocated when
+    it's created, so starting and stopping voices never needs to allocate memory or
+    block the audio thread. Each time it gets a time-slice, it fills whichever buffer
+    is closest to running out, and it reads in smaller chunks as the number of active
+    voices goes up, so that all of them get serviced often enough.
+
+    If a voice catches up with the data that has been read, it'll play silence until
+    the data arrives, and this is counted as an underrun - see getNumUnderruns(). If
+    that happens, you'll need a longer preload time for your sounds, a larger buffer
+    size, or a faster disk!
+
+    For formats that support it (e.g. WAV and AIFF), it's best to give your sounds a
+    MemoryMappedAudioFormatReader (see AudioFormat::createMemoryMappedReader()), which
+    the sound will map into memory, so the streamer can read it without any copying
+    through file streams.
+
+    @see SamplerSound, SamplerVoice
+*/
+class JUCE_API  SamplerDiskStreamer  : private TimeSliceClient
+{
+public:
+    //==============================================================================
+    /** Creates a streamer.
+
+        @param timeSliceThread      the thread that should be used to do the reading. Make sure
+                                    that this thread is running, and won't be deleted while the
+                                    streamer exists
+        @param maxNumStreams        the number of voices that can be streaming at once. Normally
+                                    this is the number of SamplerVoices in your synth
+        @param samplesToBufferPerStream the number of samples that each voice can have buffered
+                                    ahead of its playback position (this will be rounded up to
+                                    a power of two)
+    */
+    SamplerDiskStreamer (TimeSliceThread& timeSliceThread,
+                         int maxNumStreams,
+                         int samplesToBufferPerStream = 32768);
+
+    /** Destructor.
+        Make sure that no voices are still playing sounds that use this streamer before
+        you delete it.
+    */
+    ~SamplerDiskStreamer();
+
+    //==============================================================================
+    /** Returns the number of voices that are currently streaming data. */
+    int getNumActiveStreams() const noexcept;
+
+    /** Returns the number of times that a voice has had to play silence because its data
+        hadn't been read in time, or because no streams were free when it started.
+
+        Each block that a voice renders counts as at most one underrun.
+        @see resetUnderrunCount
+    */
+    int getNumUnderruns() const noexcept                    { return numUnderruns.get(); }
+
+    /** Resets the counter that is returned by getNumUnderruns(). */
+    void resetUnderrunCount() noexcept                      { numUnderruns = 0; }
+
+private:
+    //==============================================================================
+    friend class SamplerVoice;
+    class Stream;
+
+    TimeSliceThread& thread;
+    OwnedArray<Stream> streams;
+    Atomic<int> numUnderruns;
+
+    Stream* startStream (SamplerSound&, int startPosition, double playbackRate) noexcept;
+    int useTimeSlice();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerDiskStreamer)
+};
+
 
 //==============================================================================
 /**
     A subclass of SynthesiserSound that represents a sampled audio clip.
 
-    This is a pretty basic sampler, and just attempts to load the whole audio stream
-    into memory.
+    This is a pretty basic sampler, which can either load the whole audio stream into
+    memory, or for very large samples, keep just the start of it in memory and stream
+    the rest from disk using a SamplerDiskStreamer.
 
     To use it, create a Synthesiser, add some SamplerVoice objects to it, then
     give it some SampledSound objects to play.
@@ -69,6 +155,36 @@ public:
                   double releaseTimeSecs,
                   double maxSampleLengthSeconds);
 
+    /** Creates a sampled sound which streams its audio from disk.
+
+        Only the first preloadTimeSecs of the audio will be loaded into memory, and
+        when a SamplerVoice plays the sound, it'll use the streamer to read the rest
+        of the audio in the background while it plays the part that's in memory. The
+        preload time needs to be long enough to cover the time it takes to start reading
+        from the disk when there are lots of voices playing.
+
+        @param name         a name for the sample
+        @param source       the audio to stream. The sound takes ownership of this object and
+                            will delete it when no longer needed. If it's a
+                            MemoryMappedAudioFormatReader, the sound will map the whole file
+        @param midiNotes    the set of midi keys that this sound should be played on
+        @param midiNoteForNormalPitch   the midi note at which the sample should be played
+                                        with its natural rate
+        @param attackTimeSecs   the attack (fade-in) time, in seconds
+        @param releaseTimeSecs  the decay (fade-out) time, in seconds
+        @param streamer         the streamer that will read the audio. This must not be deleted
+                                while the sound exists
+        @param preloadTimeSecs  the length of the audio to keep in memory, in seconds
+    */
+    SamplerSound (const String& name,
+                  AudioFormatReader* source,
+                  const BigInteger& midiNotes,
+                  int midiNoteForNormalPitch,
+                  double attackTimeSecs,
+                  double releaseTimeSecs,
+                  SamplerDiskStreamer& streamer,
+                  double preloadTimeSecs);
+
     /** Destructor. */
     ~SamplerSound();
 
@@ -77,10 +193,14 @@ public:
     const String& getName() const                           { return name; }
 
     /** Returns the audio sample data.
-        This could be 0 if there was a problem loading it.
+        This could be 0 if there was a problem loading it. For a streaming sound, this
+        only contains the part of the audio which is preloaded.
     */
     AudioSampleBuffer* getAudioData() const                 { return data; }
 
+    /** Returns true if this sound streams its audio from disk. */
+    bool isStreaming() const noexcept                       { return streamer != nullptr; }
+
 
     //==============================================================================
     bool appliesToNote (const int midiNoteNumber);
@@ -90,6 +210,7 @@ public:
 private:
     //==============================================================================
     friend class SamplerVoice;
+    friend class SamplerDiskStreamer;
 
     String name;
     ScopedPointer <AudioSampleBuffer> data;
@@ -98,6 +219,11 @@ private:
     int length, attackSamples, releaseSamples;
     int midiRootNote;
 
+    // (only used when streaming)
+    ScopedPointer <AudioFormatReader> streamingSource;
+    SamplerDiskStreamer* streamer;
+    int preloadLength;
+
     JUCE_LEAK_DETECTOR (SamplerSound)
 };
 
@@ -122,6 +248,30 @@ public:
     /** Destructor. */
     ~SamplerVoice();
 
+    //==============================================================================
+    /** The methods that a SamplerVoice can use to resample its sound.
+        @see setInterpolationQuality
+    */
+    enum InterpolationQuality
+    {
+        linearInterpolation = 0,    /**< The cheapest method, which has noticeable aliasing and
+                                         high-frequency loss when the pitch is changed. */
+        lagrangeInterpolation,      /**< The same 4th-order polynomial that LagrangeInterpolator
+                                         uses - a good compromise between quality and speed. */
+        sincInterpolation           /**< A 16-point windowed-sinc filter, whose cutoff is lowered
+                                         when the pitch is raised so that it doesn't alias. This
+                                         sounds best, but costs a few times as much as linear. */
+    };
+
+    /** Chooses the method that the voice uses to resample its sound.
+        This shouldn't be called while the voice is playing. The default is linearInterpolation.
+    */
+    void setInterpolationQuality (InterpolationQuality newQuality);
+
+    /** Returns the method that the voice uses to resample its sound.
+        @see setInterpolationQuality
+    */
+    InterpolationQuality getInterpolationQuality() const noexcept       { return quality; }
 
     //==============================================================================
     bool canPlaySound (SynthesiserSound* sound);
@@ -142,10 +292,16 @@ public:
 
 private:
     //==============================================================================
+    SamplerDiskStreamer::Stream* stream;
     double pitchRatio;
     double sourceSamplePosition;
     float lgain, rgain, attackReleaseLevel, attackDelta, releaseDelta;
     bool isInAttack, isInRelease;
+    InterpolationQuality quality;
+    HeapBlock<float> workspace;
+
+    void releaseStream() noexcept;
+    bool readSourceSamples (const SamplerSound&, int startIndex, int numSamples, float* destL, float* destR) const noexcept;
 
     JUCE_LEAK_DETECTOR (SamplerVoice)
 };
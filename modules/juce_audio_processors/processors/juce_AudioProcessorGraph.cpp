@@ -30,213 +30,316 @@ namespace GraphRenderingOps
 {
 
 //==============================================================================
-class AudioGraphRenderingOp
+/** Lists the shared audio channels and midi buffers that a rendering op touches, so
+    that ops which can't interfere with each other can be run on different threads.
+*/
+struct BufferUsage
 {
-public:
-    AudioGraphRenderingOp() {}
-    virtual ~AudioGraphRenderingOp()  {}
+    enum
+    {
+        midiBufferFlag      = 0x40000000,
+        graphAudioOutput    = 0x20000000,
+        graphMidiOutput     = 0x20000001
+    };
 
-    virtual void perform (AudioSampleBuffer& sharedBufferChans,
-                          const OwnedArray <MidiBuffer>& sharedMidiBuffers,
-                          const int numSamples) = 0;
+    void readAudio (const int channel)          { reads.addIfNotAlreadyThere (channel); }
+    void writeAudio (const int channel)         { writes.addIfNotAlreadyThere (channel); }
+    void readMidi (const int bufferNum)         { reads.addIfNotAlreadyThere (bufferNum | midiBufferFlag); }
+    void writeMidi (const int bufferNum)        { writes.addIfNotAlreadyThere (bufferNum | midiBufferFlag); }
 
-    JUCE_LEAK_DETECTOR (AudioGraphRenderingOp)
+    Array<int> reads, writes;
 };
 
 //==============================================================================
-class ClearChannelOp : public AudioGraphRenderingOp
+/** A compiled rendering sequence, held as a flat list of instructions.
+
+    The instructions and their operands are kept in contiguous arrays and run by a single
+    switch, rather than being separate heap objects with a virtual call each. As the program
+    is built, runs of copies and adds into the same channel get merged into a single mix
+    instruction, and all the delay lines share one block of memory.
+*/
+class RenderingProgram
 {
 public:
-    ClearChannelOp (const int channelNum_)
-        : channelNum (channelNum_)
-    {}
-
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    RenderingProgram()
+        : midiBuffers (nullptr), totalDelaySamples (0)
     {
-        sharedBufferChans.clear (channelNum, 0, numSamples);
     }
 
-private:
-    const int channelNum;
-
-    JUCE_DECLARE_NON_COPYABLE (ClearChannelOp)
-};
-
-//==============================================================================
-class CopyChannelOp : public AudioGraphRenderingOp
-{
-public:
-    CopyChannelOp (const int srcChannelNum_, const int dstChannelNum_)
-        : srcChannelNum (srcChannelNum_),
-          dstChannelNum (dstChannelNum_)
-    {}
+    //==============================================================================
+    void addClearChannel (const int channel)
+    {
+        Instruction& i = addInstruction (clearChannelOp);
+        addChannelOperand (i, channel);
+    }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    void addCopyChannel (const int sourceChannel, const int destChannel)
     {
-        sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        Instruction& i = addInstruction (mixChannelsOp);
+        addChannelOperand (i, destChannel);
+        addChannelOperand (i, sourceChannel);
     }
 
-private:
-    const int srcChannelNum, dstChannelNum;
+    void addAddChannel (const int sourceChannel, const int destChannel)
+    {
+        jassert (sourceChannel != destChannel);
 
-    JUCE_DECLARE_NON_COPYABLE (CopyChannelOp)
-};
+        if (instructions.size() > 0)
+        {
+            // (the last instruction's operands are always the last ones in the list)
+            Instruction& last = instructions.getReference (instructions.size() - 1);
 
-//==============================================================================
-class AddChannelOp : public AudioGraphRenderingOp
-{
-public:
-    AddChannelOp (const int srcChannelNum_, const int dstChannelNum_)
-        : srcChannelNum (srcChannelNum_),
-          dstChannelNum (dstChannelNum_)
-    {}
+            if ((last.opcode == mixChannelsOp || last.opcode == clearChannelOp)
+                  && channelIndexes.getUnchecked (last.firstChannel) == destChannel)
+            {
+                last.opcode = mixChannelsOp; // (adding to a cleared channel is just a copy)
+                addChannelOperand (last, sourceChannel);
+                return;
+            }
+        }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
-    {
-        sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
+        Instruction& i = addInstruction (mixChannelsOp);
+        addChannelOperand (i, destChannel);
+        addChannelOperand (i, destChannel);
+        addChannelOperand (i, sourceChannel);
     }
 
-private:
-    const int srcChannelNum, dstChannelNum;
-
-    JUCE_DECLARE_NON_COPYABLE (AddChannelOp)
-};
+    void addDelayChannel (const int channel, const int numSamplesDelay)
+    {
+        jassert (numSamplesDelay > 0);
 
-//==============================================================================
-class ClearMidiBufferOp : public AudioGraphRenderingOp
-{
-public:
-    ClearMidiBufferOp (const int bufferNum_)
-        : bufferNum (bufferNum_)
-    {}
+        Instruction& i = addInstruction (delayChannelOp);
+        addChannelOperand (i, channel);
+        i.delayStart = totalDelaySamples;
+        i.delaySize = numSamplesDelay;
+        totalDelaySamples += numSamplesDelay;
+    }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    void addClearMidiBuffer (const int bufferNum)
     {
-        sharedMidiBuffers.getUnchecked (bufferNum)->clear();
+        addInstruction (clearMidiOp).midiDest = bufferNum;
     }
 
-private:
-    const int bufferNum;
-
-    JUCE_DECLARE_NON_COPYABLE (ClearMidiBufferOp)
-};
-
-//==============================================================================
-class CopyMidiBufferOp : public AudioGraphRenderingOp
-{
-public:
-    CopyMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
-        : srcBufferNum (srcBufferNum_),
-          dstBufferNum (dstBufferNum_)
-    {}
+    void addCopyMidiBuffer (const int sourceBufferNum, const int destBufferNum)
+    {
+        Instruction& i = addInstruction (copyMidiOp);
+        i.midiSource = sourceBufferNum;
+        i.midiDest = destBufferNum;
+    }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    void addAddMidiBuffer (const int sourceBufferNum, const int destBufferNum)
     {
-        *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
+        Instruction& i = addInstruction (addMidiOp);
+        i.midiSource = sourceBufferNum;
+        i.midiDest = destBufferNum;
     }
 
-private:
-    const int srcBufferNum, dstBufferNum;
+    void addProcess (const AudioProcessorGraph::Node::Ptr& node, const Array<int>& audioChannelsToUse,
+                     const int totalChans, const int midiBufferToUse)
+    {
+        Instruction& i = addInstruction (processOp);
+        i.processor = node->getProcessor();
+        i.midiDest = midiBufferToUse;
 
-    JUCE_DECLARE_NON_COPYABLE (CopyMidiBufferOp)
-};
+        // (any channels that weren't assigned get pointed at the read-only empty buffer)
+        for (int chan = 0; chan < jmax (1, totalChans); ++chan)
+            addChannelOperand (i, audioChannelsToUse [chan]);
 
-//==============================================================================
-class AddMidiBufferOp : public AudioGraphRenderingOp
-{
-public:
-    AddMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
-        : srcBufferNum (srcBufferNum_),
-          dstBufferNum (dstBufferNum_)
-    {}
+        nodes.add (node);
+    }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    //==============================================================================
+    /** Resolves all the channel operands into pointers to the buffers that will be rendered into.
+        This must be called before the program is performed, and the buffers mustn't be resized
+        after it.
+    */
+    void prepare (AudioSampleBuffer& audioBuffers, const OwnedArray<MidiBuffer>& midiBuffers_)
     {
-        sharedMidiBuffers.getUnchecked (dstBufferNum)
-            ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
+        channelData.malloc ((size_t) channelIndexes.size() + 1);
+
+        for (int i = 0; i < channelIndexes.size(); ++i)
+            channelData[i] = audioBuffers.getSampleData (channelIndexes.getUnchecked (i), 0);
+
+        delayData.calloc ((size_t) totalDelaySamples + 1);
+        midiBuffers = &midiBuffers_;
     }
 
-private:
-    const int srcBufferNum, dstBufferNum;
+    int getNumInstructions() const noexcept                         { return instructions.size(); }
 
-    JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
-};
+    bool isProcessInstruction (const int index) const noexcept     { return instructions.getReference (index).opcode == processOp; }
 
-//==============================================================================
-class DelayChannelOp : public AudioGraphRenderingOp
-{
-public:
-    DelayChannelOp (const int channel_, const int numSamplesDelay_)
-        : channel (channel_),
-          bufferSize (numSamplesDelay_ + 1),
-          readIndex (0), writeIndex (numSamplesDelay_)
+    void perform (const int firstInstruction, const int numInstructions, const int numSamples)
     {
-        buffer.calloc ((size_t) bufferSize);
+        jassert (midiBuffers != nullptr);
+
+        for (int n = 0; n < numInstructions; ++n)
+        {
+            Instruction& i = instructions.getReference (firstInstruction + n);
+            float** const chans = channelData + i.firstChannel;
+
+            switch (i.opcode)
+            {
+                case clearChannelOp:    FloatVectorOperations::clear (chans[0], numSamples); break;
+                case mixChannelsOp:     mixChannels (chans, i.numChannels, numSamples); break;
+                case delayChannelOp:    delayChannel (i, chans[0], numSamples); break;
+                case clearMidiOp:       getMidiBuffer (i.midiDest).clear(); break;
+                case copyMidiOp:        getMidiBuffer (i.midiDest) = getMidiBuffer (i.midiSource); break;
+                case addMidiOp:         getMidiBuffer (i.midiDest).addEvents (getMidiBuffer (i.midiSource), 0, numSamples, 0); break;
+
+                case processOp:
+                {
+                    AudioSampleBuffer buffer (chans, i.numChannels, numSamples);
+                    i.processor->processBlock (buffer, getMidiBuffer (i.midiDest));
+                    break;
+                }
+
+                default:                jassertfalse; break;
+            }
+        }
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    void getBuffersUsed (const int index, BufferUsage& usage) const
     {
-        float* data = sharedBufferChans.getSampleData (channel, 0);
+        const Instruction& i = instructions.getReference (index);
 
-        for (int i = numSamples; --i >= 0;)
+        switch (i.opcode)
         {
-            buffer [writeIndex] = *data;
-            *data++ = buffer [readIndex];
+            case clearChannelOp:
+            case delayChannelOp:
+                usage.writeAudio (channelIndexes.getUnchecked (i.firstChannel));
+                break;
+
+            case mixChannelsOp:
+                for (int j = 1; j < i.numChannels; ++j)
+                    usage.readAudio (channelIndexes.getUnchecked (i.firstChannel + j));
+
+                usage.writeAudio (channelIndexes.getUnchecked (i.firstChannel));
+                break;
+
+            case clearMidiOp:
+                usage.writeMidi (i.midiDest);
+                break;
+
+            case copyMidiOp:
+            case addMidiOp:
+                usage.readMidi (i.midiSource);
+                usage.writeMidi (i.midiDest);
+                break;
+
+            case processOp:
+            {
+                // channels beyond the processor's outputs are only read, so these may be shared
+                const int numOuts = i.processor->getNumOutputChannels();
 
-            if (++readIndex  >= bufferSize) readIndex = 0;
-            if (++writeIndex >= bufferSize) writeIndex = 0;
+                for (int j = 0; j < i.numChannels; ++j)
+                {
+                    if (j < numOuts)
+                        usage.writeAudio (channelIndexes.getUnchecked (i.firstChannel + j));
+                    else
+                        usage.readAudio (channelIndexes.getUnchecked (i.firstChannel + j));
+                }
+
+                usage.writeMidi (i.midiDest);
+
+                // the graph's i/o nodes all mix into the same output buffers, so must stay in order
+                if (const AudioProcessorGraph::AudioGraphIOProcessor* const ioProc
+                        = dynamic_cast <const AudioProcessorGraph::AudioGraphIOProcessor*> (i.processor))
+                {
+                    if (ioProc->getType() == AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode)
+                        usage.writes.add (BufferUsage::graphAudioOutput);
+                    else if (ioProc->getType() == AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode)
+                        usage.writes.add (BufferUsage::graphMidiOutput);
+                }
+
+                break;
+            }
+
+            default:
+                jassertfalse;
+                break;
         }
     }
 
 private:
-    HeapBlock<float> buffer;
-    const int channel, bufferSize;
-    int readIndex, writeIndex;
+    //==============================================================================
+    enum Opcode
+    {
+        clearChannelOp,     // channels: [dest]
+        mixChannelsOp,      // channels: [dest, source1, source2...], where source1 may also be the dest
+        delayChannelOp,     // channels: [dest]
+        clearMidiOp,
+        copyMidiOp,
+        addMidiOp,
+        processOp           // channels: all of the processor's channels
+    };
 
-    JUCE_DECLARE_NON_COPYABLE (DelayChannelOp)
-};
+    struct Instruction
+    {
+        Opcode opcode;
+        int firstChannel, numChannels;
+        int midiSource, midiDest;
+        int delayStart, delaySize, delayPosition;
+        AudioProcessor* processor;
+    };
 
+    Array<Instruction> instructions;
+    Array<int> channelIndexes;
+    HeapBlock<float*> channelData;
+    HeapBlock<float> delayData;
+    ReferenceCountedArray<AudioProcessorGraph::Node> nodes;
+    const OwnedArray<MidiBuffer>* midiBuffers;
+    int totalDelaySamples;
 
-//==============================================================================
-class ProcessBufferOp : public AudioGraphRenderingOp
-{
-public:
-    ProcessBufferOp (const AudioProcessorGraph::Node::Ptr& node_,
-                     const Array <int>& audioChannelsToUse_,
-                     const int totalChans_,
-                     const int midiBufferToUse_)
-        : node (node_),
-          processor (node_->getProcessor()),
-          audioChannelsToUse (audioChannelsToUse_),
-          totalChans (jmax (1, totalChans_)),
-          midiBufferToUse (midiBufferToUse_)
+    Instruction& addInstruction (const Opcode opcode)
+    {
+        const Instruction i = { opcode, channelIndexes.size(), 0, 0, 0, 0, 0, 0, nullptr };
+        instructions.add (i);
+        return instructions.getReference (instructions.size() - 1);
+    }
+
+    void addChannelOperand (Instruction& i, const int channel)
     {
-        channels.calloc ((size_t) totalChans);
+        jassert (i.firstChannel + i.numChannels == channelIndexes.size());
 
-        while (audioChannelsToUse.size() < totalChans)
-            audioChannelsToUse.add (0);
+        channelIndexes.add (channel);
+        ++i.numChannels;
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    MidiBuffer& getMidiBuffer (const int index) const noexcept
     {
-        for (int i = totalChans; --i >= 0;)
-            channels[i] = sharedBufferChans.getSampleData (audioChannelsToUse.getUnchecked (i), 0);
+        return *midiBuffers->getUnchecked (index);
+    }
+
+    static void mixChannels (float* const* const chans, const int numChans, const int numSamples) noexcept
+    {
+        float* const dest = chans[0];
 
-        AudioSampleBuffer buffer (channels, totalChans, numSamples);
+        if (chans[1] != dest)
+            FloatVectorOperations::copy (dest, chans[1], numSamples);
 
-        processor->processBlock (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+        for (int i = 2; i < numChans; ++i)
+            FloatVectorOperations::add (dest, chans[i], numSamples);
     }
 
-    const AudioProcessorGraph::Node::Ptr node;
-    AudioProcessor* const processor;
+    void delayChannel (Instruction& i, float* const data, const int numSamples) noexcept
+    {
+        float* const line = delayData + i.delayStart;
+        int position = i.delayPosition;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const float delayed = line [position];
+            line [position] = data[n];
+            data[n] = delayed;
 
-private:
-    Array <int> audioChannelsToUse;
-    HeapBlock <float*> channels;
-    int totalChans;
-    int midiBufferToUse;
+            if (++position >= i.delaySize)
+                position = 0;
+        }
 
-    JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
+        i.delayPosition = position;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (RenderingProgram)
 };
 
 //==============================================================================
@@ -248,23 +351,29 @@ class RenderingOpSequenceCalculator
 public:
     //==============================================================================
     RenderingOpSequenceCalculator (AudioProcessorGraph& graph_,
-                                   const Array<void*>& orderedNodes_,
-                                   Array<void*>& renderingOps)
+                                   const ReferenceCountedArray<AudioProcessorGraph::Node>& orderedNodes_,
+                                   const Array<AudioProcessorGraph::Connection>& connections_,
+                                   RenderingProgram& program,
+                                   const bool canReuseBuffers_)
         : graph (graph_),
           orderedNodes (orderedNodes_),
-          totalLatency (0)
+          connections (connections_),
+          totalLatency (0),
+          canReuseBuffers (canReuseBuffers_)
     {
         nodeIds.add ((uint32) zeroNodeID); // first buffer is read-only zeros
         channels.add (0);
 
         midiNodeIds.add ((uint32) zeroNodeID);
 
+        createConnectionTables();
+
         for (int i = 0; i < orderedNodes.size(); ++i)
         {
-            createRenderingOpsForNode ((AudioProcessorGraph::Node*) orderedNodes.getUnchecked(i),
-                                       renderingOps, i);
+            createRenderingOpsForNode (orderedNodes.getObjectPointerUnchecked (i), program, i);
 
-            markAnyUnusedBuffersAsFree (i);
+            if (canReuseBuffers)
+                markAnyUnusedBuffersAsFree (i);
         }
 
         graph.setLatencySamples (totalLatency);
@@ -276,63 +385,114 @@ public:
 private:
     //==============================================================================
     AudioProcessorGraph& graph;
-    const Array<void*>& orderedNodes;
+    const ReferenceCountedArray<AudioProcessorGraph::Node>& orderedNodes;
+    const Array<AudioProcessorGraph::Connection>& connections;
     Array <int> channels;
     Array <uint32> nodeIds, midiNodeIds;
 
-    enum { freeNodeID = 0xffffffff, zeroNodeID = 0xfffffffe };
+    enum { freeNodeID = 0xffffffff, zeroNodeID = 0xfffffffe, reservedNodeID = 0xfffffffd };
 
     static bool isNodeBusy (uint32 nodeID) noexcept { return nodeID != freeNodeID && nodeID != zeroNodeID; }
 
-    Array <uint32> nodeDelayIDs;
-    Array <int> nodeDelays;
+    HashMap <int, int> nodeDelays;
     int totalLatency;
 
-    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
+    // When rendering in parallel, every buffer is only ever used by one node, so that the
+    // only dependencies between nodes are the ones created by their connections.
+    const bool canReuseBuffers;
+
+    int getNodeDelay (const uint32 nodeID) const                    { return nodeDelays [(int) nodeID]; }
+    void setNodeDelay (const uint32 nodeID, const int latency)      { nodeDelays.set ((int) nodeID, latency); }
 
-    void setNodeDelay (const uint32 nodeID, const int latency)
+    int getInputLatencyForNode (const int stepIndex) const
     {
-        const int index = nodeDelayIDs.indexOf (nodeID);
+        const Array<const AudioProcessorGraph::Connection*>& inputs = *inputConnections.getUnchecked (stepIndex);
+        int maxLatency = 0;
 
-        if (index >= 0)
-        {
-            nodeDelays.set (index, latency);
-        }
-        else
-        {
-            nodeDelayIDs.add (nodeID);
-            nodeDelays.add (latency);
-        }
+        for (int i = 0; i < inputs.size(); ++i)
+            maxLatency = jmax (maxLatency, getNodeDelay (inputs.getUnchecked(i)->sourceNodeId));
+
+        return maxLatency;
     }
 
-    int getInputLatencyForNode (const uint32 nodeID) const
+    //==============================================================================
+    // For each step, this holds the connections that feed into its node, in the same order
+    // as a backwards scan through the connection list would find them.
+    OwnedArray <Array<const AudioProcessorGraph::Connection*> > inputConnections;
+
+    // For each output channel that's connected to something, this records the last step that
+    // reads it, and the input channel that it feeds at that step (or multipleChannels if it
+    // feeds more than one).
+    struct LastUse
     {
-        int maxLatency = 0;
+        int stepIndex, inputChannel;
+    };
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
-        {
-            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+    enum { multipleChannels = -2 };
+
+    HashMap <int64, LastUse> lastUses;
+
+    static int64 getOutputKey (const uint32 nodeId, const int outputChannel) noexcept
+    {
+        // (the node ID goes in the low bits, as that's what the default hash function uses)
+        return (((int64) outputChannel) << 32) | (int64) nodeId;
+    }
+
+    void createConnectionTables()
+    {
+        HashMap <int, int> stepIndexes;
 
-            if (c->destNodeId == nodeID)
-                maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNodeId));
+        for (int i = 0; i < orderedNodes.size(); ++i)
+        {
+            stepIndexes.set ((int) orderedNodes.getObjectPointerUnchecked (i)->nodeId, i);
+            inputConnections.add (new Array<const AudioProcessorGraph::Connection*>());
         }
 
-        return maxLatency;
+        for (int i = connections.size(); --i >= 0;)
+        {
+            const AudioProcessorGraph::Connection* const c = &connections.getReference (i);
+
+            if (! stepIndexes.contains ((int) c->destNodeId))
+                continue;
+
+            const int stepIndex = stepIndexes [(int) c->destNodeId];
+            inputConnections.getUnchecked (stepIndex)->add (c);
+
+            if (c->destChannelIndex != AudioProcessorGraph::midiChannelIndex
+                 && c->destChannelIndex >= orderedNodes.getObjectPointerUnchecked (stepIndex)->getProcessor()->getNumInputChannels())
+                continue;
+
+            const int64 key = getOutputKey (c->sourceNodeId, c->sourceChannelIndex);
+            LastUse use = { stepIndex, c->destChannelIndex };
+
+            if (lastUses.contains (key))
+            {
+                const LastUse previous (lastUses [key]);
+
+                if (previous.stepIndex > stepIndex)
+                    use = previous;
+                else if (previous.stepIndex == stepIndex && previous.inputChannel != c->destChannelIndex)
+                    use.inputChannel = multipleChannels;
+            }
+
+            lastUses.set (key, use);
+        }
     }
 
     //==============================================================================
     void createRenderingOpsForNode (AudioProcessorGraph::Node* const node,
-                                    Array<void*>& renderingOps,
+                                    RenderingProgram& program,
                                     const int ourRenderingIndex)
     {
         const int numIns = node->getProcessor()->getNumInputChannels();
         const int numOuts = node->getProcessor()->getNumOutputChannels();
         const int totalChans = jmax (numIns, numOuts);
+        const Array<const AudioProcessorGraph::Connection*>& inputs = *inputConnections.getUnchecked (ourRenderingIndex);
 
         Array <int> audioChannelsToUse;
         int midiBufferToUse = -1;
 
-        int maxLatency = getInputLatencyForNode (node->nodeId);
+        int maxLatency = getInputLatencyForNode (ourRenderingIndex);
 
         for (int inputChan = 0; inputChan < numIns; ++inputChan)
         {
@@ -340,11 +500,11 @@ private:
             Array <uint32> sourceNodes;
             Array<int> sourceOutputChans;
 
-            for (int i = graph.getNumConnections(); --i >= 0;)
+            for (int i = 0; i < inputs.size(); ++i)
             {
-                const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+                const AudioProcessorGraph::Connection* const c = inputs.getUnchecked (i);
 
-                if (c->destNodeId == node->nodeId && c->destChannelIndex == inputChan)
+                if (c->destChannelIndex == inputChan)
                 {
                     sourceNodes.add (c->sourceNodeId);
                     sourceOutputChans.add (c->sourceChannelIndex);
@@ -365,7 +525,7 @@ private:
                 else
                 {
                     bufIndex = getFreeBuffer (false);
-                    renderingOps.add (new ClearChannelOp (bufIndex));
+                    program.addClearChannel (bufIndex);
                 }
             }
             else if (sourceNodes.size() == 1)
@@ -392,7 +552,7 @@ private:
                     // need to use a copy of it..
                     const int newFreeBuffer = getFreeBuffer (false);
 
-                    renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
+                    program.addCopyChannel (bufIndex, newFreeBuffer);
 
                     bufIndex = newFreeBuffer;
                 }
@@ -400,7 +560,7 @@ private:
                 const int nodeDelay = getNodeDelay (srcNode);
 
                 if (nodeDelay < maxLatency)
-                    renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                    program.addDelayChannel (bufIndex, maxLatency - nodeDelay);
             }
             else
             {
@@ -426,7 +586,7 @@ private:
 
                         const int nodeDelay = getNodeDelay (sourceNodes.getUnchecked (i));
                         if (nodeDelay < maxLatency)
-                            renderingOps.add (new DelayChannelOp (sourceBufIndex, maxLatency - nodeDelay));
+                            program.addDelayChannel (sourceBufIndex, maxLatency - nodeDelay);
 
                         break;
                     }
@@ -438,23 +598,26 @@ private:
                     bufIndex = getFreeBuffer (false);
                     jassert (bufIndex != 0);
 
+                    // (stops this buffer being handed out again if one of the other inputs needs a delayed copy)
+                    markBufferAsContaining (bufIndex, (uint32) reservedNodeID, 0);
+
                     const int srcIndex = getBufferContaining (sourceNodes.getUnchecked (0),
                                                               sourceOutputChans.getUnchecked (0));
                     if (srcIndex < 0)
                     {
                         // if not found, this is probably a feedback loop
-                        renderingOps.add (new ClearChannelOp (bufIndex));
+                        program.addClearChannel (bufIndex);
                     }
                     else
                     {
-                        renderingOps.add (new CopyChannelOp (srcIndex, bufIndex));
+                        program.addCopyChannel (srcIndex, bufIndex);
                     }
 
                     reusableInputIndex = 0;
                     const int nodeDelay = getNodeDelay (sourceNodes.getFirst());
 
                     if (nodeDelay < maxLatency)
-                        renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
+                        program.addDelayChannel (bufIndex, maxLatency - nodeDelay);
                 }
 
                 for (int j = 0; j < sourceNodes.size(); ++j)
@@ -473,18 +636,18 @@ private:
                                                            sourceNodes.getUnchecked(j),
                                                            sourceOutputChans.getUnchecked(j)))
                                 {
-                                    renderingOps.add (new DelayChannelOp (srcIndex, maxLatency - nodeDelay));
+                                    program.addDelayChannel (srcIndex, maxLatency - nodeDelay);
                                 }
                                 else // buffer is reused elsewhere, can't be delayed
                                 {
                                     const int bufferToDelay = getFreeBuffer (false);
-                                    renderingOps.add (new CopyChannelOp (srcIndex, bufferToDelay));
-                                    renderingOps.add (new DelayChannelOp (bufferToDelay, maxLatency - nodeDelay));
+                                    program.addCopyChannel (srcIndex, bufferToDelay);
+                                    program.addDelayChannel (bufferToDelay, maxLatency - nodeDelay);
                                     srcIndex = bufferToDelay;
                                 }
                             }
 
-                            renderingOps.add (new AddChannelOp (srcIndex, bufIndex));
+                            program.addAddChannel (srcIndex, bufIndex);
                         }
                     }
                 }
@@ -509,11 +672,11 @@ private:
         // Now the same thing for midi..
         Array <uint32> midiSourceNodes;
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
+        for (int i = 0; i < inputs.size(); ++i)
         {
-            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+            const AudioProcessorGraph::Connection* const c = inputs.getUnchecked (i);
 
-            if (c->destNodeId == node->nodeId && c->destChannelIndex == AudioProcessorGraph::midiChannelIndex)
+            if (c->destChannelIndex == AudioProcessorGraph::midiChannelIndex)
                 midiSourceNodes.add (c->sourceNodeId);
         }
 
@@ -523,7 +686,7 @@ private:
             midiBufferToUse = getFreeBuffer (true); // need to pick a buffer even if the processor doesn't use midi
 
             if (node->getProcessor()->acceptsMidi() || node->getProcessor()->producesMidi())
-                renderingOps.add (new ClearMidiBufferOp (midiBufferToUse));
+                program.addClearMidiBuffer (midiBufferToUse);
         }
         else if (midiSourceNodes.size() == 1)
         {
@@ -541,7 +704,7 @@ private:
                     // can't mess up this channel because it's needed later by another node, so we
                     // need to use a copy of it..
                     const int newFreeBuffer = getFreeBuffer (true);
-                    renderingOps.add (new CopyMidiBufferOp (midiBufferToUse, newFreeBuffer));
+                    program.addCopyMidiBuffer (midiBufferToUse, newFreeBuffer);
                     midiBufferToUse = newFreeBuffer;
                 }
             }
@@ -583,9 +746,9 @@ private:
                 const int srcIndex = getBufferContaining (midiSourceNodes.getUnchecked(0),
                                                           AudioProcessorGraph::midiChannelIndex);
                 if (srcIndex >= 0)
-                    renderingOps.add (new CopyMidiBufferOp (srcIndex, midiBufferToUse));
+                    program.addCopyMidiBuffer (srcIndex, midiBufferToUse);
                 else
-                    renderingOps.add (new ClearMidiBufferOp (midiBufferToUse));
+                    program.addClearMidiBuffer (midiBufferToUse);
 
                 reusableInputIndex = 0;
             }
@@ -597,7 +760,7 @@ private:
                     const int srcIndex = getBufferContaining (midiSourceNodes.getUnchecked(j),
                                                               AudioProcessorGraph::midiChannelIndex);
                     if (srcIndex >= 0)
-                        renderingOps.add (new AddMidiBufferOp (srcIndex, midiBufferToUse));
+                        program.addAddMidiBuffer (srcIndex, midiBufferToUse);
                 }
             }
         }
@@ -611,29 +774,32 @@ private:
         if (numOuts == 0)
             totalLatency = maxLatency;
 
-        renderingOps.add (new ProcessBufferOp (node, audioChannelsToUse,
-                                               totalChans, midiBufferToUse));
+        program.addProcess (node, audioChannelsToUse, totalChans, midiBufferToUse);
     }
 
     //==============================================================================
     int getFreeBuffer (const bool forMidi)
     {
+        const uint32 newBufferID = (uint32) (canReuseBuffers ? freeNodeID : reservedNodeID);
+
         if (forMidi)
         {
-            for (int i = 1; i < midiNodeIds.size(); ++i)
-                if (midiNodeIds.getUnchecked(i) == freeNodeID)
-                    return i;
+            if (canReuseBuffers)
+                for (int i = 1; i < midiNodeIds.size(); ++i)
+                    if (midiNodeIds.getUnchecked(i) == freeNodeID)
+                        return i;
 
-            midiNodeIds.add ((uint32) freeNodeID);
+            midiNodeIds.add (newBufferID);
             return midiNodeIds.size() - 1;
         }
         else
         {
-            for (int i = 1; i < nodeIds.size(); ++i)
-                if (nodeIds.getUnchecked(i) == freeNodeID)
-                    return i;
+            if (canReuseBuffers)
+                for (int i = 1; i < nodeIds.size(); ++i)
+                    if (nodeIds.getUnchecked(i) == freeNodeID)
+                        return i;
 
-            nodeIds.add ((uint32) freeNodeID);
+            nodeIds.add (newBufferID);
             channels.add (0);
             return nodeIds.size() - 1;
         }
@@ -688,36 +854,21 @@ private:
         }
     }
 
-    bool isBufferNeededLater (int stepIndexToSearchFrom,
-                              int inputChannelOfIndexToIgnore,
+    bool isBufferNeededLater (const int stepIndexToSearchFrom,
+                              const int inputChannelOfIndexToIgnore,
                               const uint32 nodeId,
                               const int outputChanIndex) const
     {
-        while (stepIndexToSearchFrom < orderedNodes.size())
-        {
-            const AudioProcessorGraph::Node* const node = (const AudioProcessorGraph::Node*) orderedNodes.getUnchecked (stepIndexToSearchFrom);
+        const int64 key = getOutputKey (nodeId, outputChanIndex);
 
-            if (outputChanIndex == AudioProcessorGraph::midiChannelIndex)
-            {
-                if (inputChannelOfIndexToIgnore != AudioProcessorGraph::midiChannelIndex
-                     && graph.getConnectionBetween (nodeId, AudioProcessorGraph::midiChannelIndex,
-                                                    node->nodeId, AudioProcessorGraph::midiChannelIndex) != nullptr)
-                    return true;
-            }
-            else
-            {
-                for (int i = 0; i < node->getProcessor()->getNumInputChannels(); ++i)
-                    if (i != inputChannelOfIndexToIgnore
-                         && graph.getConnectionBetween (nodeId, outputChanIndex,
-                                                        node->nodeId, i) != nullptr)
-                        return true;
-            }
+        if (! lastUses.contains (key))
+            return false;
 
-            inputChannelOfIndexToIgnore = -1;
-            ++stepIndexToSearchFrom;
-        }
+        const LastUse lastUse (lastUses [key]);
 
-        return false;
+        return lastUse.stepIndex > stepIndexToSearchFrom
+                || (lastUse.stepIndex == stepIndexToSearchFrom
+                     && lastUse.inputChannel != inputChannelOfIndexToIgnore);
     }
 
     void markBufferAsContaining (int bufferNum, uint32 nodeId, int outputIndex)
@@ -741,136 +892,358 @@ private:
 };
 
 //==============================================================================
-// Holds a fast lookup table for checking which nodes are inputs to others.
-class ConnectionLookupTable
+struct ConnectionSorter
 {
-public:
-    explicit ConnectionLookupTable (const OwnedArray<AudioProcessorGraph::Connection>& connections)
+    static int compareElements (const AudioProcessorGraph::Connection* const first,
+                                const AudioProcessorGraph::Connection* const second) noexcept
     {
-        for (int i = 0; i < connections.size(); ++i)
-        {
-            const AudioProcessorGraph::Connection* const c = connections.getUnchecked(i);
+        if (first->sourceNodeId < second->sourceNodeId)                return -1;
+        if (first->sourceNodeId > second->sourceNodeId)                return 1;
+        if (first->destNodeId < second->destNodeId)                    return -1;
+        if (first->destNodeId > second->destNodeId)                    return 1;
+        if (first->sourceChannelIndex < second->sourceChannelIndex)    return -1;
+        if (first->sourceChannelIndex > second->sourceChannelIndex)    return 1;
+        if (first->destChannelIndex < second->destChannelIndex)        return -1;
+        if (first->destChannelIndex > second->destChannelIndex)        return 1;
 
-            int index;
-            Entry* entry = findEntry (c->destNodeId, index);
+        return 0;
+    }
+};
 
-            if (entry == nullptr)
-            {
-                entry = new Entry (c->destNodeId);
-                entries.insert (index, entry);
-            }
+//==============================================================================
+/** A group of consecutive ops which prepare the inputs for a node and then process it.
 
-            entry->srcNodes.add (c->sourceNodeId);
-        }
-    }
+    Stages are sorted into "waves": all the stages in a wave only depend on stages in
+    earlier waves, so can be performed concurrently.
+*/
+struct RenderingStage
+{
+    int firstOp, numOps, wave, firstStageInWave;
+};
 
-    bool isAnInputTo (const uint32 possibleInputId,
-                      const uint32 possibleDestinationId) const noexcept
+struct RenderingStageSorter
+{
+    static int compareElements (const RenderingStage& first, const RenderingStage& second) noexcept
     {
-        return isAnInputToRecursive (possibleInputId, possibleDestinationId, entries.size());
+        return first.wave - second.wave;
     }
+};
 
-private:
-    //==============================================================================
-    struct Entry
+/** Splits a program into per-node stages, and works out the earliest wave in which each
+    stage can run without altering the result that the serial sequence would produce.
+*/
+static void createRenderingStages (const RenderingProgram& program, Array<RenderingStage>& stages)
+{
+    // For each buffer, these hold the earliest wave that may follow the last stage that wrote
+    // to it or read from it (a missing entry being zero).
+    HashMap<int, int> wavesAfterLastWrite, wavesAfterLastRead;
+    int stageStart = 0;
+
+    for (int i = 0; i < program.getNumInstructions(); ++i)
     {
-        explicit Entry (const uint32 destNodeId_) noexcept : destNodeId (destNodeId_) {}
+        if (! program.isProcessInstruction (i)
+             && i < program.getNumInstructions() - 1)
+            continue;
 
-        const uint32 destNodeId;
-        SortedSet<uint32> srcNodes;
+        BufferUsage usage;
 
-        JUCE_DECLARE_NON_COPYABLE (Entry)
-    };
+        for (int j = stageStart; j <= i; ++j)
+            program.getBuffersUsed (j, usage);
 
-    OwnedArray<Entry> entries;
+        int wave = 0;
 
-    bool isAnInputToRecursive (const uint32 possibleInputId,
-                               const uint32 possibleDestinationId,
-                               int recursionCheck) const noexcept
-    {
-        int index;
+        for (int j = usage.reads.size(); --j >= 0;)
+            wave = jmax (wave, wavesAfterLastWrite [usage.reads.getUnchecked (j)]);
 
-        if (const Entry* const entry = findEntry (possibleDestinationId, index))
-        {
-            const SortedSet<uint32>& srcNodes = entry->srcNodes;
+        for (int j = usage.writes.size(); --j >= 0;)
+            wave = jmax (wave, wavesAfterLastWrite [usage.writes.getUnchecked (j)],
+                               wavesAfterLastRead [usage.writes.getUnchecked (j)]);
 
-            if (srcNodes.contains (possibleInputId))
-                return true;
+        for (int j = usage.reads.size(); --j >= 0;)
+        {
+            const int buffer = usage.reads.getUnchecked (j);
+            wavesAfterLastRead.set (buffer, jmax (wave + 1, wavesAfterLastRead [buffer]));
+        }
 
-            if (--recursionCheck >= 0)
-            {
-                for (int i = 0; i < srcNodes.size(); ++i)
-                    if (isAnInputToRecursive (possibleInputId, srcNodes.getUnchecked(i), recursionCheck))
-                        return true;
-            }
+        for (int j = usage.writes.size(); --j >= 0;)
+        {
+            const int buffer = usage.writes.getUnchecked (j);
+            wavesAfterLastWrite.set (buffer, wave + 1);
+            wavesAfterLastRead.remove (buffer);
         }
 
-        return false;
+        const RenderingStage stage = { stageStart, i + 1 - stageStart, wave, 0 };
+        stages.add (stage);
+        stageStart = i + 1;
     }
 
-    Entry* findEntry (const uint32 destNodeId, int& insertIndex) const noexcept
-    {
-        Entry* result = nullptr;
+    RenderingStageSorter sorter;
+    stages.sort (sorter, true);
 
-        int start = 0;
-        int end = entries.size();
+    for (int i = 0; i < stages.size(); ++i)
+    {
+        RenderingStage& stage = stages.getReference (i);
+        stage.firstStageInWave = (i > 0 && stages.getReference (i - 1).wave == stage.wave)
+                                    ? stages.getReference (i - 1).firstStageInWave : i;
+    }
+}
 
-        for (;;)
-        {
-            if (start >= end)
-            {
-                break;
-            }
-            else if (destNodeId == entries.getUnchecked (start)->destNodeId)
-            {
-                result = entries.getUnchecked (start);
-                break;
-            }
-            else
-            {
-                const int halfway = (start + end) / 2;
+}
 
-                if (halfway == start)
-                {
-                    if (destNodeId >= entries.getUnchecked (halfway)->destNodeId)
-                        ++start;
+//==============================================================================
+/** A copy of the graph's nodes, in rendering order, and of its connections.
 
-                    break;
-                }
-                else if (destNodeId >= entries.getUnchecked (halfway)->destNodeId)
-                    start = halfway;
-                else
-                    end = halfway;
-            }
-        }
+    The graph is only edited on the message thread, so that's where these are made. A
+    rendering sequence is built from one of them rather than from the graph itself, which
+    means it can be built on another thread without locking the message thread.
+*/
+class AudioProcessorGraph::Snapshot  : public ReferenceCountedObject
+{
+public:
+    Snapshot (const Array<Node*>& renderOrder, const OwnedArray<Connection>& graphConnections)
+    {
+        for (int i = 0; i < renderOrder.size(); ++i)
+            nodes.add (renderOrder.getUnchecked (i));
 
-        insertIndex = start;
-        return result;
+        for (int i = 0; i < graphConnections.size(); ++i)
+            connections.add (*graphConnections.getUnchecked (i));
     }
 
-    JUCE_DECLARE_NON_COPYABLE (ConnectionLookupTable)
+    ReferenceCountedArray<Node> nodes;
+    Array<Connection> connections;
+
+    typedef ReferenceCountedObjectPtr<Snapshot> Ptr;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (Snapshot)
 };
 
 //==============================================================================
-struct ConnectionSorter
+/** A complete, ready-to-run set of rendering ops, along with the buffers they work on.
+
+    These are built from a Snapshot and handed over to the audio thread with an atomic
+    pointer swap, and the audio thread hands back the ones it has finished with so that
+    they can be deleted somewhere that's allowed to block.
+*/
+class AudioProcessorGraph::RenderingSequence
 {
-    static int compareElements (const AudioProcessorGraph::Connection* const first,
-                                const AudioProcessorGraph::Connection* const second) noexcept
+public:
+    RenderingSequence()
+        : renderingBuffers (1, 1),
+          nextRetired (nullptr)
     {
-        if (first->sourceNodeId < second->sourceNodeId)                return -1;
-        if (first->sourceNodeId > second->sourceNodeId)                return 1;
-        if (first->destNodeId < second->destNodeId)                    return -1;
-        if (first->destNodeId > second->destNodeId)                    return 1;
-        if (first->sourceChannelIndex < second->sourceChannelIndex)    return -1;
-        if (first->sourceChannelIndex > second->sourceChannelIndex)    return 1;
-        if (first->destChannelIndex < second->destChannelIndex)        return -1;
-        if (first->destChannelIndex > second->destChannelIndex)        return 1;
-
-        return 0;
     }
-};
 
-}
+    /** Allocates the buffers, once the program has been filled in. */
+    void prepare (const int numBuffers, const int numMidiBuffers, const int blockSize)
+    {
+        renderingBuffers.setSize (numBuffers, blockSize);
+        renderingBuffers.clear();
+
+        for (int i = 0; i < numMidiBuffers; ++i)
+        {
+            // (reserving space here means the midi ops won't need to allocate while rendering)
+            MidiBuffer* const m = new MidiBuffer();
+            m->ensureSize (midiBufferSizeToReserve);
+            midiBuffers.add (m);
+        }
+
+        program.prepare (renderingBuffers, midiBuffers);
+    }
+
+    void perform (const int numSamples)
+    {
+        program.perform (0, program.getNumInstructions(), numSamples);
+    }
+
+    GraphRenderingOps::RenderingProgram program;
+    Array<GraphRenderingOps::RenderingStage> stages;
+    AudioSampleBuffer renderingBuffers;
+    OwnedArray<MidiBuffer> midiBuffers;
+
+    RenderingSequence* nextRetired;
+
+    enum { midiBufferSizeToReserve = 8192 };
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (RenderingSequence)
+};
+
+//==============================================================================
+/** A set of real-time threads that help the audio thread to perform the stages of the
+    rendering sequence which don't depend on each other.
+
+    Each thread (including the audio thread) repeatedly grabs the next stage in the list,
+    waits until all the stages of the previous waves have finished, and then performs it.
+    Because stages are handed out in order, a thread can only ever be waiting for stages
+    that another thread is already working on, so this can't deadlock.
+*/
+class AudioProcessorGraph::RenderingThreadPool
+{
+public:
+    RenderingThreadPool (const int numThreads)
+        : nextStage ((int) noMoreStages), numStagesDone (0), numBusyThreads (0), blockCount (0),
+          currentSequence (nullptr), currentNumSamples (0),
+          spinTimeTicks (Time::secondsToHighResolutionTicks (0.0005))
+    {
+        for (int i = 0; i < numThreads; ++i)
+        {
+            RenderThread* const t = new RenderThread (*this, i);
+            threads.add (t);
+            t->startThread (9);
+        }
+    }
+
+    int getNumThreads() const noexcept      { return threads.size(); }
+
+    void perform (RenderingSequence& sequence, const int numSamples)
+    {
+        jassert (sequence.stages.size() > 0);
+
+        currentSequence = &sequence;
+        currentNumSamples = numSamples;
+
+        numStagesDone = 0;
+        nextStage = 0;
+        ++blockCount;
+
+        // Threads that are still spinning will see the new block count by themselves, so only
+        // the ones that have gone to sleep need waking up
+        for (int i = threads.size(); --i >= 0;)
+        {
+            RenderThread& t = *threads.getUnchecked(i);
+
+            if (t.isSleeping.get() != 0)
+                t.startEvent.signal();
+        }
+
+        performStages();
+
+        // any threads that only wake up after this point will find nothing left to do
+        waitUntilAtLeast (numStagesDone, sequence.stages.size());
+        nextStage = (int) noMoreStages;
+
+        while (numBusyThreads.get() > 0)
+            Thread::yield();
+    }
+
+private:
+    //==============================================================================
+    class RenderThread  : public Thread
+    {
+    public:
+        RenderThread (RenderingThreadPool& owner_, const int index)
+            : Thread ("Graph rendering thread " + String (index + 1)),
+              owner (owner_)
+        {
+        }
+
+        ~RenderThread()
+        {
+            signalThreadShouldExit();
+            startEvent.signal();
+            stopThread (4000);
+        }
+
+        void run()
+        {
+            int lastBlock = owner.blockCount.get();
+
+            while (! threadShouldExit())
+            {
+                if (owner.waitForNextBlock (*this, lastBlock) && ! threadShouldExit())
+                {
+                    lastBlock = owner.blockCount.get();
+                    owner.performStages();
+                }
+            }
+        }
+
+        WaitableEvent startEvent;
+        Atomic<int> isSleeping;
+
+    private:
+        RenderingThreadPool& owner;
+
+        JUCE_DECLARE_NON_COPYABLE (RenderThread)
+    };
+
+    enum { noMoreStages = 0x3fffffff };
+
+    OwnedArray<RenderThread> threads;
+    Atomic<int> nextStage, numStagesDone, numBusyThreads, blockCount;
+
+    RenderingSequence* currentSequence;
+    int currentNumSamples;
+    const int64 spinTimeTicks;
+
+    // Waits for the audio thread to start a block after lastBlock. The thread spins for a short
+    // time first, because with small audio buffers the next block will often arrive before an
+    // event could have woken it, and only then goes to sleep until it's signalled.
+    bool waitForNextBlock (RenderThread& thread, const int lastBlock)
+    {
+        const int64 spinEndTime = Time::getHighResolutionTicks() + spinTimeTicks;
+
+        for (int spins = 0; blockCount.get() == lastBlock; ++spins)
+        {
+            if (spins > 64)
+            {
+                if (thread.threadShouldExit())
+                    return false;
+
+                if (Time::getHighResolutionTicks() >= spinEndTime)
+                {
+                    // (the block count must be checked again after setting the flag, or a block
+                    // that started just before it was set would never signal the event)
+                    thread.isSleeping = 1;
+
+                    if (blockCount.get() == lastBlock)
+                        thread.startEvent.wait (500);
+
+                    thread.isSleeping = 0;
+                    return blockCount.get() != lastBlock;
+                }
+
+                Thread::yield();
+            }
+        }
+
+        return true;
+    }
+
+    void performStages()
+    {
+        ++numBusyThreads;
+
+        for (;;)
+        {
+            const int stageIndex = (nextStage += 1) - 1;
+
+            // (a thread that wakes up late will find noMoreStages, and mustn't touch the sequence)
+            if (stageIndex >= (int) noMoreStages || stageIndex >= currentSequence->stages.size())
+                break;
+
+            RenderingSequence& sequence = *currentSequence;
+            const GraphRenderingOps::RenderingStage& stage = sequence.stages.getReference (stageIndex);
+            waitUntilAtLeast (numStagesDone, stage.firstStageInWave);
+
+            sequence.program.perform (stage.firstOp, stage.numOps, currentNumSamples);
+
+            ++numStagesDone;
+        }
+
+        --numBusyThreads;
+    }
+
+    static void waitUntilAtLeast (const Atomic<int>& value, const int target) noexcept
+    {
+        for (int spins = 0; value.get() < target; ++spins)
+            if (spins > 64)
+                Thread::yield();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (RenderingThreadPool)
+};
 
 //==============================================================================
 AudioProcessorGraph::Connection::Connection (const uint32 sourceNodeId_, const int sourceChannelIndex_,
@@ -884,7 +1257,8 @@ AudioProcessorGraph::Connection::Connection (const uint32 sourceNodeId_, const i
 AudioProcessorGraph::Node::Node (const uint32 nodeId_, AudioProcessor* const processor_) noexcept
     : nodeId (nodeId_),
       processor (processor_),
-      isPrepared (false)
+      isPrepared (false),
+      renderIndex (0)
 {
     jassert (processor != nullptr);
 }
@@ -924,14 +1298,18 @@ void AudioProcessorGraph::Node::setParentGraph (AudioProcessorGraph* const graph
 //==============================================================================
 AudioProcessorGraph::AudioProcessorGraph()
     : lastNodeId (0),
-      renderingBuffers (1, 1),
+      renderOrderNeedsSorting (false),
+      currentSequence (nullptr),
       currentAudioOutputBuffer (1, 1)
 {
+    snapshot = new Snapshot (renderOrder, connections);
 }
 
 AudioProcessorGraph::~AudioProcessorGraph()
 {
     clearRenderingSequence();
+    renderingThreadPool = nullptr;
+    snapshot = nullptr;
     clear();
 }
 
@@ -943,6 +1321,8 @@ const String AudioProcessorGraph::getName() const
 //==============================================================================
 void AudioProcessorGraph::clear()
 {
+    renderOrder.clear();
+    renderOrderNeedsSorting = false;
     nodes.clear();
     connections.clear();
     triggerAsyncUpdate();
@@ -992,6 +1372,10 @@ AudioProcessorGraph::Node* AudioProcessorGraph::addNode (AudioProcessor* const n
 
     Node* const n = new Node (nodeId, newProcessor);
     nodes.add (n);
+
+    n->renderIndex = renderOrder.size();
+    renderOrder.add (n);
+
     triggerAsyncUpdate();
 
     n->setParentGraph (this);
@@ -1006,7 +1390,13 @@ bool AudioProcessorGraph::removeNode (const uint32 nodeId)
     {
         if (nodes.getUnchecked(i)->nodeId == nodeId)
         {
-            nodes.getUnchecked(i)->setParentGraph (nullptr);
+            Node* const n = nodes.getUnchecked(i);
+            renderOrder.remove (n->renderIndex);
+
+            for (int j = n->renderIndex; j < renderOrder.size(); ++j)
+                renderOrder.getUnchecked(j)->renderIndex = j;
+
+            n->setParentGraph (nullptr);
             nodes.remove (i);
             triggerAsyncUpdate();
 
@@ -1085,6 +1475,8 @@ bool AudioProcessorGraph::addConnection (const uint32 sourceNodeId,
     GraphRenderingOps::ConnectionSorter sorter;
     connections.addSorted (sorter, new Connection (sourceNodeId, sourceChannelIndex,
                                                    destNodeId, destChannelIndex));
+
+    updateRenderOrder (getNodeForId (sourceNodeId), getNodeForId (destNodeId));
     triggerAsyncUpdate();
     return true;
 }
@@ -1167,22 +1559,190 @@ bool AudioProcessorGraph::removeIllegalConnections()
 }
 
 //==============================================================================
-static void deleteRenderOpArray (Array<void*>& ops)
+/*  The nodes are kept in a topologically sorted order, which is updated incrementally
+    whenever a connection is added (removing things can't invalidate the order).
+
+    If a new connection goes backwards, only the nodes between its two ends that are
+    downstream of its destination or upstream of its source need to be rearranged
+    (this is the Pearce-Kelly algorithm). Feedback loops can't be sorted, so if one is
+    found, a full sort is done before each rebuild until it's removed again.
+*/
+void AudioProcessorGraph::updateRenderOrder (Node* const source, Node* const dest)
+{
+    jassert (source != nullptr && dest != nullptr);
+
+    if (renderOrderNeedsSorting || source->renderIndex < dest->renderIndex)
+        return;
+
+    Array<Node*> downstreamNodes, upstreamNodes;
+
+    if (! findNodesToReorder (dest, source->renderIndex, true, downstreamNodes))
+    {
+        renderOrderNeedsSorting = true; // this connection has created a feedback loop
+        return;
+    }
+
+    findNodesToReorder (source, dest->renderIndex, false, upstreamNodes);
+
+    // The upstream nodes get moved in front of the downstream ones, re-using the same set of
+    // slots, and otherwise keeping their existing order..
+    SortedSet<int> upstreamSlots, downstreamSlots;
+
+    for (int i = upstreamNodes.size(); --i >= 0;)
+        upstreamSlots.add (upstreamNodes.getUnchecked(i)->renderIndex);
+
+    for (int i = downstreamNodes.size(); --i >= 0;)
+        downstreamSlots.add (downstreamNodes.getUnchecked(i)->renderIndex);
+
+    Array<Node*> movedNodes;
+
+    for (int i = 0; i < upstreamSlots.size(); ++i)
+        movedNodes.add (renderOrder.getUnchecked (upstreamSlots.getUnchecked(i)));
+
+    for (int i = 0; i < downstreamSlots.size(); ++i)
+        movedNodes.add (renderOrder.getUnchecked (downstreamSlots.getUnchecked(i)));
+
+    upstreamSlots.addSet (downstreamSlots);
+
+    for (int i = 0; i < movedNodes.size(); ++i)
+    {
+        Node* const n = movedNodes.getUnchecked(i);
+        n->renderIndex = upstreamSlots.getUnchecked(i);
+        renderOrder.set (n->renderIndex, n);
+    }
+}
+
+bool AudioProcessorGraph::findNodesToReorder (Node* const startNode, const int limitIndex,
+                                              const bool searchDownstream, Array<Node*>& found) const
+{
+    found.add (startNode);
+
+    for (int i = 0; i < found.size(); ++i)
+    {
+        const uint32 nodeId = found.getUnchecked(i)->nodeId;
+
+        for (int j = connections.size(); --j >= 0;)
+        {
+            const Connection* const c = connections.getUnchecked(j);
+
+            if ((searchDownstream ? c->sourceNodeId : c->destNodeId) != nodeId)
+                continue;
+
+            Node* const n = getNodeForId (searchDownstream ? c->destNodeId : c->sourceNodeId);
+
+            if (n == nullptr)
+                continue;
+
+            if (searchDownstream && n->renderIndex == limitIndex)
+                return false;
+
+            if ((searchDownstream ? n->renderIndex < limitIndex
+                                  : n->renderIndex > limitIndex)
+                  && ! found.contains (n))
+                found.add (n);
+        }
+    }
+
+    return true;
+}
+
+void AudioProcessorGraph::sortRenderOrder()
 {
-    for (int i = ops.size(); --i >= 0;)
-        delete static_cast<GraphRenderingOps::AudioGraphRenderingOp*> (ops.getUnchecked(i));
+    // Kahn's algorithm - the nodes are added in the order they were added to the graph unless
+    // their inputs get in the way, and feedback loops are broken at their earliest node.
+    HashMap<int, int> nodeIndexes;
+
+    for (int i = 0; i < nodes.size(); ++i)
+        nodeIndexes.set ((int) nodes.getUnchecked(i)->nodeId, i);
+
+    Array<int> numInputs;
+    numInputs.insertMultiple (0, 0, nodes.size());
+
+    for (int i = connections.size(); --i >= 0;)
+    {
+        const Connection* const c = connections.getUnchecked(i);
+
+        if (nodeIndexes.contains ((int) c->sourceNodeId) && nodeIndexes.contains ((int) c->destNodeId))
+            numInputs.getReference (nodeIndexes [(int) c->destNodeId]) += 1;
+    }
+
+    SortedSet<int> readyNodes, remainingNodes;
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        remainingNodes.add (i);
+
+        if (numInputs.getUnchecked(i) == 0)
+            readyNodes.add (i);
+    }
+
+    renderOrder.clearQuick();
+    renderOrderNeedsSorting = false;
+
+    while (remainingNodes.size() > 0)
+    {
+        int index;
+
+        if (readyNodes.size() > 0)
+        {
+            index = readyNodes.getFirst();
+            readyNodes.remove (0);
+        }
+        else
+        {
+            index = remainingNodes.getFirst();
+            renderOrderNeedsSorting = true;
+        }
+
+        remainingNodes.removeValue (index);
+
+        Node* const n = nodes.getUnchecked (index);
+        n->renderIndex = renderOrder.size();
+        renderOrder.add (n);
+
+        // connections are sorted by source, so this node's outputs are all together..
+        const Connection c (n->nodeId, 0, 0, 0);
+        GraphRenderingOps::ConnectionSorter sorter;
+        int i = jmax (0, connections.indexOfSorted (sorter, &c));
+
+        while (i < connections.size() && connections.getUnchecked(i)->sourceNodeId < n->nodeId)
+            ++i;
+
+        for (; i < connections.size() && connections.getUnchecked(i)->sourceNodeId == n->nodeId; ++i)
+        {
+            const int destIndex = nodeIndexes.contains ((int) connections.getUnchecked(i)->destNodeId)
+                                    ? nodeIndexes [(int) connections.getUnchecked(i)->destNodeId] : -1;
+
+            if (destIndex >= 0 && --numInputs.getReference (destIndex) == 0
+                 && remainingNodes.contains (destIndex))
+                readyNodes.add (destIndex);
+        }
+    }
 }
 
+//==============================================================================
 void AudioProcessorGraph::clearRenderingSequence()
 {
-    Array<void*> oldOps;
+    // NB: this must only be called when the audio callback isn't running
+    deleteSequenceList (pendingSequence.exchange (nullptr));
+    deleteSequenceList (currentSequence);
+    currentSequence = nullptr;
+    deleteRetiredSequences();
+}
 
+void AudioProcessorGraph::deleteSequenceList (RenderingSequence* sequence)
+{
+    while (sequence != nullptr)
     {
-        const ScopedLock sl (getCallbackLock());
-        renderingOps.swapWithArray (oldOps);
+        RenderingSequence* const next = sequence->nextRetired;
+        delete sequence;
+        sequence = next;
     }
+}
 
-    deleteRenderOpArray (oldOps);
+void AudioProcessorGraph::deleteRetiredSequences()
+{
+    deleteSequenceList (retiredSequences.exchange (nullptr));
 }
 
 bool AudioProcessorGraph::isAnInputTo (const uint32 possibleInputId,
@@ -1205,64 +1765,93 @@ bool AudioProcessorGraph::isAnInputTo (const uint32 possibleInputId,
     return false;
 }
 
-void AudioProcessorGraph::buildRenderingSequence()
+void AudioProcessorGraph::updateSnapshot()
 {
-    Array<void*> newRenderingOps;
-    int numRenderingBuffersNeeded = 2;
-    int numMidiBuffersNeeded = 1;
+    if (renderOrderNeedsSorting)
+        sortRenderOrder();
+
+    const Snapshot::Ptr newSnapshot (new Snapshot (renderOrder, connections));
+    Snapshot::Ptr oldSnapshot;
 
     {
-        MessageManagerLock mml;
+        const ScopedLock sl (snapshotLock);
+        oldSnapshot = snapshot;
+        snapshot = newSnapshot;
+    }
 
-        Array<void*> orderedNodes;
+    // (the old snapshot is released outside the lock, because it may be the last thing that's
+    // holding on to some removed nodes)
+}
 
-        {
-            const GraphRenderingOps::ConnectionLookupTable table (connections);
+void AudioProcessorGraph::buildRenderingSequence()
+{
+    // (this stops a rebuild on the message thread from running at the same time as one that
+    // prepareToPlay() has started on the audio device's thread)
+    const ScopedLock sl (buildLock);
 
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                Node* const node = nodes.getUnchecked(i);
+    Snapshot::Ptr graphSnapshot;
 
-                node->prepare (getSampleRate(), getBlockSize(), this);
+    {
+        const ScopedLock ssl (snapshotLock);
+        graphSnapshot = snapshot;
+    }
 
-                int j = 0;
-                for (; j < orderedNodes.size(); ++j)
-                    if (table.isAnInputTo (node->nodeId, ((Node*) orderedNodes.getUnchecked(j))->nodeId))
-                      break;
+    for (int i = 0; i < graphSnapshot->nodes.size(); ++i)
+        graphSnapshot->nodes.getObjectPointerUnchecked (i)->prepare (getSampleRate(), getBlockSize(), this);
 
-                orderedNodes.insert (j, node);
-            }
-        }
+    const bool renderInParallel = (renderingThreadPool != nullptr);
+    ScopedPointer<RenderingSequence> newSequence (new RenderingSequence());
 
-        GraphRenderingOps::RenderingOpSequenceCalculator calculator (*this, orderedNodes, newRenderingOps);
+    GraphRenderingOps::RenderingOpSequenceCalculator calculator (*this, graphSnapshot->nodes, graphSnapshot->connections,
+                                                                 newSequence->program, ! renderInParallel);
 
-        numRenderingBuffersNeeded = calculator.getNumBuffersNeeded();
-        numMidiBuffersNeeded = calculator.getNumMidiBuffersNeeded();
-    }
+    newSequence->prepare (calculator.getNumBuffersNeeded(),
+                          calculator.getNumMidiBuffersNeeded(),
+                          getBlockSize());
 
-    {
-        // swap over to the new rendering sequence..
-        const ScopedLock sl (getCallbackLock());
+    if (renderInParallel)
+        GraphRenderingOps::createRenderingStages (newSequence->program, newSequence->stages);
 
-        renderingBuffers.setSize (numRenderingBuffersNeeded, getBlockSize());
-        renderingBuffers.clear();
+    // Any sequences that the audio thread has already swapped out are finished with, so they can
+    // go now. The one it's about to swap out will be deleted by the next rebuild, or when the
+    // graph is released.
+    deleteRetiredSequences();
 
-        for (int i = midiBuffers.size(); --i >= 0;)
-            midiBuffers.getUnchecked(i)->clear();
+    // Hand the new sequence over to the audio thread, which will pick it up at the start of its
+    // next block. If it hasn't yet taken the last one we gave it, that one can be deleted here.
+    deleteSequenceList (pendingSequence.exchange (newSequence.release()));
+}
 
-        while (midiBuffers.size() < numMidiBuffersNeeded)
-            midiBuffers.add (new MidiBuffer());
+void AudioProcessorGraph::handleAsyncUpdate()
+{
+    updateSnapshot();
+    buildRenderingSequence();
+}
 
-        renderingOps.swapWithArray (newRenderingOps);
-    }
+//==============================================================================
+void AudioProcessorGraph::setNumRenderingThreads (const int numThreads)
+{
+    jassert (numThreads >= 0);
 
-    // delete the old ones..
-    deleteRenderOpArray (newRenderingOps);
+    if (numThreads != getNumRenderingThreads())
+    {
+        ScopedPointer<RenderingThreadPool> newPool (numThreads > 0 ? new RenderingThreadPool (numThreads)
+                                                                   : nullptr);
+
+        {
+            const ScopedLock sl (getCallbackLock());
+            renderingThreadPool.swapWith (newPool);
+        }
+
+        // the sequence needs rebuilding with a different buffer layout - until that happens,
+        // the existing sequence will either run serially, or in parallel if it has stages.
+        triggerAsyncUpdate();
+    }
 }
 
-void AudioProcessorGraph::handleAsyncUpdate()
+int AudioProcessorGraph::getNumRenderingThreads() const noexcept
 {
-    buildRenderingSequence();
+    return renderingThreadPool != nullptr ? renderingThreadPool->getNumThreads() : 0;
 }
 
 //==============================================================================
@@ -1272,6 +1861,13 @@ void AudioProcessorGraph::prepareToPlay (double /*sampleRate*/, int estimatedSam
     currentAudioOutputBuffer.setSize (jmax (1, getNumOutputChannels()), estimatedSamplesPerBlock);
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
+    currentMidiOutputBuffer.ensureSize (RenderingSequence::midiBufferSizeToReserve);
+
+    // If this is the message thread, any edits that are still waiting for the async update can
+    // be included now. On any other thread, the last snapshot is used, and the async update
+    // will rebuild the sequence with those edits once it arrives.
+    if (MessageManager::getInstance()->isThisTheMessageThread())
+        updateSnapshot();
 
     clearRenderingSequence();
     buildRenderingSequence();
@@ -1282,8 +1878,7 @@ void AudioProcessorGraph::releaseResources()
     for (int i = 0; i < nodes.size(); ++i)
         nodes.getUnchecked(i)->unprepare();
 
-    renderingBuffers.setSize (1, 1);
-    midiBuffers.clear();
+    clearRenderingSequence();
 
     currentAudioInputBuffer = nullptr;
     currentAudioOutputBuffer.setSize (1, 1);
@@ -1309,12 +1904,27 @@ void AudioProcessorGraph::processBlock (AudioSampleBuffer& buffer, MidiBuffer& m
     currentMidiInputBuffer = &midiMessages;
     currentMidiOutputBuffer.clear();
 
-    for (int i = 0; i < renderingOps.size(); ++i)
+    if (RenderingSequence* const newSequence = pendingSequence.exchange (nullptr))
     {
-        GraphRenderingOps::AudioGraphRenderingOp* const op
-            = (GraphRenderingOps::AudioGraphRenderingOp*) renderingOps.getUnchecked(i);
+        // pass the old sequence back to be deleted by the next rebuild..
+        if (currentSequence != nullptr)
+        {
+            do
+            {
+                currentSequence->nextRetired = retiredSequences.get();
+            }
+            while (! retiredSequences.compareAndSetBool (currentSequence, currentSequence->nextRetired));
+        }
 
-        op->perform (renderingBuffers, midiBuffers, numSamples);
+        currentSequence = newSequence;
+    }
+
+    if (currentSequence != nullptr)
+    {
+        if (renderingThreadPool != nullptr && currentSequence->stages.size() > 0)
+            renderingThreadPool->perform (*currentSequence, numSamples);
+        else
+            currentSequence->perform (numSamples);
     }
 
     for (int i = 0; i < buffer.getNumChannels(); ++i)
@@ -1530,3 +2140,361 @@ void AudioProcessorGraph::AudioGraphIOProcessor::setParentGraph (AudioProcessorG
         updateHostDisplay();
     }
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioProcessorGraphTests  : public UnitTest
+{
+public:
+    AudioProcessorGraphTests() : UnitTest ("AudioProcessorGraph") {}
+
+    // A processor with some internal state, so that its output depends on the order in
+    // which it receives its blocks.
+    class TestProcessor  : public AudioProcessor
+    {
+    public:
+        TestProcessor (const int numIns, const int numOuts, const int latency,
+                       const bool usesMidi_, const int64 seed)
+            : processingOrder (nullptr), usesMidi (usesMidi_), random (seed), state (0)
+        {
+            setPlayConfigDetails (numIns, numOuts, 44100.0, 256);
+            setLatencySamples (latency);
+        }
+
+        const String getName() const                                { return "Test"; }
+        void prepareToPlay (double, int)                            {}
+        void releaseResources()                                     {}
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midi)
+        {
+            if (processingOrder != nullptr)
+                processingOrder->add (this);
+
+            const float midiLevel = usesMidi ? midi.getNumEvents() * 0.01f : 0.0f;
+
+            for (int chan = 0; chan < getNumOutputChannels(); ++chan)
+            {
+                float* const data = buffer.getSampleData (chan);
+                const bool hasInput = chan < getNumInputChannels();
+
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                {
+                    state = state * 0.5f + (hasInput ? data[i] * 0.25f : 0.0f) + (random.nextFloat() - 0.5f) * 0.1f;
+                    data[i] = state + midiLevel;
+                }
+            }
+
+            if (usesMidi)
+                midi.addEvent (MidiMessage::noteOn (1, random.nextInt (128), 1.0f),
+                               random.nextInt (buffer.getNumSamples()));
+        }
+
+        const String getInputChannelName (int) const                { return String::empty; }
+        const String getOutputChannelName (int) const               { return String::empty; }
+        bool isInputChannelStereoPair (int) const                   { return false; }
+        bool isOutputChannelStereoPair (int) const                  { return false; }
+        bool silenceInProducesSilenceOut() const                    { return false; }
+        double getTailLengthSeconds() const                         { return 0; }
+        bool acceptsMidi() const                                    { return usesMidi; }
+        bool producesMidi() const                                   { return usesMidi; }
+        AudioProcessorEditor* createEditor()                        { return nullptr; }
+        bool hasEditor() const                                      { return false; }
+        int getNumParameters()                                      { return 0; }
+        const String getParameterName (int)                         { return String::empty; }
+        float getParameter (int)                                    { return 0; }
+        const String getParameterText (int)                         { return String::empty; }
+        void setParameter (int, float)                              {}
+        int getNumPrograms()                                        { return 0; }
+        int getCurrentProgram()                                     { return 0; }
+        void setCurrentProgram (int)                                {}
+        const String getProgramName (int)                           { return String::empty; }
+        void changeProgramName (int, const String&)                 {}
+        void getStateInformation (juce::MemoryBlock&)               {}
+        void setStateInformation (const void*, int)                 {}
+
+        Array<AudioProcessor*>* processingOrder;
+
+    private:
+        const bool usesMidi;
+        Random random;
+        float state;
+    };
+
+    // Does nothing, so that timing a graph of these measures only the graph's own overhead.
+    class EmptyProcessor  : public TestProcessor
+    {
+    public:
+        EmptyProcessor (const int latency)  : TestProcessor (2, 2, latency, false, 0) {}
+
+        void processBlock (AudioSampleBuffer&, MidiBuffer&) {}
+    };
+
+    static void createRandomGraph (AudioProcessorGraph& graph, const int64 seed)
+    {
+        Random r (seed);
+        graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+
+        const uint32 audioIn  = graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode))->nodeId;
+        const uint32 audioOut = graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode))->nodeId;
+        const uint32 midiIn   = graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode))->nodeId;
+
+        Array<uint32> sources;
+        sources.add (audioIn);
+
+        for (int i = 0; i < 40; ++i)
+        {
+            const bool usesMidi = r.nextInt (4) == 0;
+            const uint32 nodeId = graph.addNode (new TestProcessor (1 + r.nextInt (3), 1 + r.nextInt (3),
+                                                                    r.nextInt (5) == 0 ? r.nextInt (100) : 0,
+                                                                    usesMidi, r.nextInt64()))->nodeId;
+
+            for (int j = 1 + r.nextInt (3); --j >= 0;)
+                graph.addConnection (sources [r.nextInt (sources.size())], r.nextInt (3), nodeId, r.nextInt (3));
+
+            if (usesMidi)
+                graph.addConnection (midiIn, AudioProcessorGraph::midiChannelIndex,
+                                     nodeId, AudioProcessorGraph::midiChannelIndex);
+
+            sources.add (nodeId);
+        }
+
+        for (int i = 0; i < 10; ++i)
+            graph.addConnection (sources [r.nextInt (sources.size())], r.nextInt (3), audioOut, r.nextInt (2));
+    }
+
+    static void render (AudioProcessorGraph& graph, AudioSampleBuffer& result, const int64 seed)
+    {
+        Random r (seed);
+        const int blockSize = 256;
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+
+        for (int pos = 0; pos < result.getNumSamples(); pos += blockSize)
+        {
+            for (int chan = 0; chan < 2; ++chan)
+                for (int i = 0; i < blockSize; ++i)
+                    block.getSampleData (chan)[i] = r.nextFloat() - 0.5f;
+
+            midi.clear();
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.0f), r.nextInt (blockSize));
+
+            graph.processBlock (block, midi);
+
+            for (int chan = 0; chan < 2; ++chan)
+                result.copyFrom (chan, pos, block, chan, 0, blockSize);
+        }
+    }
+
+    // Prepares a graph in the way that an audio device does, from a thread of its own.
+    class PrepareThread  : public Thread
+    {
+    public:
+        PrepareThread (AudioProcessorGraph& graph_)  : Thread ("Graph preparer"), graph (graph_) {}
+
+        void run()      { graph.prepareToPlay (44100.0, 256); }
+
+    private:
+        AudioProcessorGraph& graph;
+
+        JUCE_DECLARE_NON_COPYABLE (PrepareThread)
+    };
+
+    bool wasProcessedInOrder (AudioProcessorGraph& graph, Array<AudioProcessor*>& processingOrder)
+    {
+        AudioSampleBuffer block (2, 256);
+        MidiBuffer midi;
+
+        graph.prepareToPlay (44100.0, 256);
+        processingOrder.clearQuick();
+        graph.processBlock (block, midi);
+
+        if (processingOrder.size() != graph.getNumNodes())
+            return false;
+
+        for (int i = graph.getNumConnections(); --i >= 0;)
+        {
+            const AudioProcessorGraph::Connection* const c = graph.getConnection (i);
+
+            if (processingOrder.indexOf (graph.getNodeForId (c->sourceNodeId)->getProcessor())
+                  > processingOrder.indexOf (graph.getNodeForId (c->destNodeId)->getProcessor()))
+                return false;
+        }
+
+        return true;
+    }
+
+    void runTest()
+    {
+        beginTest ("Render ordering");
+
+        {
+            Random r (1234);
+            Array<AudioProcessor*> processingOrder;
+            AudioProcessorGraph graph;
+            graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+
+            // nodes are added in a random order, and then connected up in ascending
+            // order of their ranks, so that most connections go against the current order
+            Array<uint32> nodesByRank;
+
+            for (int i = 0; i < 60; ++i)
+            {
+                TestProcessor* const p = new TestProcessor (2, 2, 0, false, i);
+                p->processingOrder = &processingOrder;
+                nodesByRank.insert (r.nextInt (nodesByRank.size() + 1), graph.addNode (p)->nodeId);
+            }
+
+            for (int i = 0; i < 150; ++i)
+            {
+                const int src = r.nextInt (nodesByRank.size() - 1);
+                const int dst = src + 1 + r.nextInt (nodesByRank.size() - src - 1);
+                graph.addConnection (nodesByRank [src], r.nextInt (2), nodesByRank [dst], r.nextInt (2));
+            }
+
+            expect (wasProcessedInOrder (graph, processingOrder));
+
+            for (int i = 0; i < 10; ++i)
+            {
+                const uint32 nodeId = nodesByRank [r.nextInt (nodesByRank.size())];
+                graph.removeNode (nodeId);
+                nodesByRank.removeFirstMatchingValue (nodeId);
+            }
+
+            for (int i = 0; i < 50; ++i)
+            {
+                const int src = r.nextInt (nodesByRank.size() - 1);
+                const int dst = src + 1 + r.nextInt (nodesByRank.size() - src - 1);
+                graph.addConnection (nodesByRank [src], r.nextInt (2), nodesByRank [dst], r.nextInt (2));
+            }
+
+            expect (wasProcessedInOrder (graph, processingOrder));
+
+            // a feedback loop can't be sorted, but every node must still get processed..
+            graph.addConnection (nodesByRank.getLast(), 0, nodesByRank.getFirst(), 0);
+            wasProcessedInOrder (graph, processingOrder);
+            expectEquals (processingOrder.size(), graph.getNumNodes());
+
+            graph.disconnectNode (nodesByRank.getLast());
+            expect (wasProcessedInOrder (graph, processingOrder));
+            graph.releaseResources();
+        }
+
+        beginTest ("Parallel rendering");
+
+        for (int64 seed = 1; seed <= 5; ++seed)
+        {
+            AudioSampleBuffer serialResult (2, 256 * 50), parallelResult (2, 256 * 50);
+
+            {
+                AudioProcessorGraph graph;
+                createRandomGraph (graph, seed);
+                graph.prepareToPlay (44100.0, 256);
+                render (graph, serialResult, seed);
+                graph.releaseResources();
+            }
+
+            {
+                AudioProcessorGraph graph;
+                createRandomGraph (graph, seed);
+                graph.setNumRenderingThreads (3);
+                graph.prepareToPlay (44100.0, 256);
+                render (graph, parallelResult, seed);
+                graph.releaseResources();
+            }
+
+            for (int chan = 0; chan < 2; ++chan)
+                expect (memcmp (serialResult.getSampleData (chan), parallelResult.getSampleData (chan),
+                                sizeof (float) * (size_t) serialResult.getNumSamples()) == 0);
+        }
+
+        beginTest ("Preparing on another thread");
+
+        {
+            AudioSampleBuffer expected (2, 256 * 20), result (2, 256 * 20);
+
+            {
+                AudioProcessorGraph graph;
+                createRandomGraph (graph, 10);
+                graph.prepareToPlay (44100.0, 256);
+                render (graph, expected, 10);
+                graph.releaseResources();
+            }
+
+            // The message thread is blocked while the other thread prepares the graph, so this
+            // would never finish if the rebuild had to lock the message thread. It uses the
+            // snapshot that was taken when the graph was last prepared on the message thread.
+            AudioProcessorGraph graph;
+            createRandomGraph (graph, 10);
+            graph.prepareToPlay (44100.0, 256);
+            graph.releaseResources();
+
+            PrepareThread thread (graph);
+            thread.startThread();
+            expect (thread.waitForThreadToExit (10000));
+
+            render (graph, result, 10);
+            graph.releaseResources();
+
+            for (int chan = 0; chan < 2; ++chan)
+                expect (memcmp (expected.getSampleData (chan), result.getSampleData (chan),
+                                sizeof (float) * (size_t) result.getNumSamples()) == 0);
+        }
+
+        beginTest ("Rendering overhead");
+
+        {
+            const int numNodes = 128, blockSize = 64, numBlocks = 4000;
+
+            Random r (4321);
+            AudioProcessorGraph graph;
+            graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+            Array<uint32> nodeIds;
+
+            nodeIds.add (graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode))->nodeId);
+
+            for (int i = 0; i < numNodes; ++i)
+            {
+                // each node mixes a couple of earlier ones, and a few add some latency to be compensated for
+                const uint32 nodeId = graph.addNode (new EmptyProcessor ((i % 16) == 15 ? 32 : 0))->nodeId;
+
+                for (int j = 0; j < 2; ++j)
+                {
+                    const uint32 sourceId = nodeIds [jmax (0, nodeIds.size() - 1 - r.nextInt (8))];
+                    graph.addConnection (sourceId, 0, nodeId, 0);
+                    graph.addConnection (sourceId, 1, nodeId, 1);
+                }
+
+                nodeIds.add (nodeId);
+            }
+
+            const uint32 outputId = graph.addNode (new AudioProcessorGraph::AudioGraphIOProcessor (AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode))->nodeId;
+            graph.addConnection (nodeIds.getLast(), 0, outputId, 0);
+            graph.addConnection (nodeIds.getLast(), 1, outputId, 1);
+
+            graph.prepareToPlay (44100.0, blockSize);
+
+            AudioSampleBuffer buffer (2, blockSize);
+            MidiBuffer midi;
+            buffer.clear();
+
+            const int64 startTime = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numBlocks; ++i)
+                graph.processBlock (buffer, midi);
+
+            const double microsecondsPerBlock = 1.0e6 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTime)
+                                                  / numBlocks;
+
+            logMessage (String (numNodes) + " nodes, " + String (blockSize) + " samples per block: "
+                          + String (microsecondsPerBlock, 2) + " microseconds per block");
+
+            expect (buffer.getMagnitude (0, blockSize) == 0);
+            graph.releaseResources();
+        }
+    }
+};
+
+static AudioProcessorGraphTests audioProcessorGraphTests;
+
+#endif
@@ -93,6 +93,7 @@ public:
 
         const ScopedPointer<AudioProcessor> processor;
         bool isPrepared;
+        int renderIndex;
 
         Node (uint32 nodeId, AudioProcessor*) noexcept;
 
@@ -256,6 +257,38 @@ public:
     */
     static const int midiChannelIndex;
 
+    //==============================================================================
+    /** Enables multi-threaded rendering of the graph.
+
+        By default, the graph's nodes are all processed serially on the audio thread. If
+        you give it some extra threads, nodes which don't depend on each other's output
+        are processed concurrently by the audio thread and this pool of helper threads,
+        which is handy for big graphs of heavyweight processors on a multi-core machine.
+
+        The output will be exactly the same as when rendering serially, but bear in mind
+        that your processors' processBlock() methods may now be called on different threads
+        from one block to the next (although never concurrently for the same processor).
+
+        After each block, the helper threads spin for about half a millisecond waiting for
+        the next one, so that they can start on it without the cost of being woken up, and
+        only then go to sleep. While that means they'll use some CPU between blocks, the
+        audio thread only has to signal the threads that have gone to sleep. The audio
+        thread itself still has to wait whenever it needs the output of a node that another
+        thread is processing, and at the end of each block it waits for the helpers to finish
+        their last nodes. It does this by spinning and yielding rather than by blocking on a
+        lock, but a helper thread that gets pre-empted by the OS can still hold it up.
+
+        @param numThreads   the number of helper threads to create, in addition to the
+                            audio thread - a value of 0 turns off parallel rendering
+        @see getNumRenderingThreads
+    */
+    void setNumRenderingThreads (int numThreads);
+
+    /** Returns the number of helper threads that are being used to render the graph.
+        @see setNumRenderingThreads
+    */
+    int getNumRenderingThreads() const noexcept;
+
 
     //==============================================================================
     /** A special type of AudioProcessor that can live inside an AudioProcessorGraph
@@ -396,9 +429,19 @@ private:
     ReferenceCountedArray <Node> nodes;
     OwnedArray <Connection> connections;
     uint32 lastNodeId;
-    AudioSampleBuffer renderingBuffers;
-    OwnedArray <MidiBuffer> midiBuffers;
-    Array<void*> renderingOps;
+    Array<Node*> renderOrder;
+    bool renderOrderNeedsSorting;
+
+    class Snapshot;
+    ReferenceCountedObjectPtr<Snapshot> snapshot;
+    CriticalSection snapshotLock, buildLock;
+
+    class RenderingSequence;
+    RenderingSequence* currentSequence;
+    Atomic<RenderingSequence*> pendingSequence, retiredSequences;
+
+    class RenderingThreadPool;
+    ScopedPointer<RenderingThreadPool> renderingThreadPool;
 
     friend class AudioGraphIOProcessor;
     AudioSampleBuffer* currentAudioInputBuffer;
@@ -408,7 +451,13 @@ private:
 
     void handleAsyncUpdate();
     void clearRenderingSequence();
+    void updateSnapshot();
     void buildRenderingSequence();
+    void deleteRetiredSequences();
+    static void deleteSequenceList (RenderingSequence*);
+    void updateRenderOrder (Node* source, Node* dest);
+    bool findNodesToReorder (Node* startNode, int limitIndex, bool searchDownstream, Array<Node*>& found) const;
+    void sortRenderOrder();
     bool isAnInputTo (uint32 possibleInputId, uint32 possibleDestinationId, int recursionCheck) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessorGraph)
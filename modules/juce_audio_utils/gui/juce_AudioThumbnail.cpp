@@ -264,11 +264,16 @@ class AudioThumbnail::ThumbData
 {
 public:
     ThumbData (const int numThumbSamples)
-        : peakLevel (-1)
     {
         ensureSize (numThumbSamples);
     }
 
+    /* As well as the full-resolution data, this keeps a pyramid of coarser levels, each one
+       holding the combined range of groups of entries from the level below it, so that the
+       range of any section can be found without scanning all the entries in it.
+    */
+    enum { levelRatio = 4 };
+
     inline MinMaxValue* getData (const int thumbSampleIndex) noexcept
     {
         jassert (thumbSampleIndex < data.size());
@@ -289,14 +294,24 @@ public:
             char mx = -128;
             char mn = 127;
 
-            while (startSample <= endSample)
+            // Take the entries at either end which only partly cover a group from this level,
+            // and then move up to the next level for the groups in between..
+            for (int level = 0; startSample <= endSample; ++level)
             {
-                const MinMaxValue& v = data.getReference (startSample);
+                const Array<MinMaxValue>& values = getLevel (level);
+                const bool isTopLevel = level >= levels.size();
+
+                while (startSample <= endSample && (isTopLevel || startSample % levelRatio != 0))
+                    addToRange (values.getReference (startSample++), mn, mx);
+
+                while (startSample <= endSample && endSample % levelRatio != levelRatio - 1)
+                    addToRange (values.getReference (endSample--), mn, mx);
 
-                if (v.getMinValue() < mn)  mn = v.getMinValue();
-                if (v.getMaxValue() > mx)  mx = v.getMaxValue();
+                if (startSample > endSample)
+                    break;
 
-                ++startSample;
+                startSample /= levelRatio;
+                endSample /= levelRatio;
             }
 
             if (mn <= mx)
@@ -311,8 +326,6 @@ public:
 
     void write (const MinMaxValue* const values, const int startIndex, const int numValues)
     {
-        resetPeak();
-
         if (startIndex + numValues > data.size())
             ensureSize (startIndex + numValues);
 
@@ -320,37 +333,128 @@ public:
 
         for (int i = 0; i < numValues; ++i)
             dest[i] = values[i];
+
+        updateLevels (startIndex, startIndex + numValues - 1);
     }
 
-    void resetPeak() noexcept
+    int getPeak() const noexcept
     {
-        peakLevel = -1;
+        const Array<MinMaxValue>& top = getLevel (levels.size());
+        int peak = 0;
+
+        for (int i = 0; i < top.size(); ++i)
+            peak = jmax (peak, top.getReference (i).getPeak());
+
+        return peak;
     }
 
-    int getPeak() noexcept
+    //==============================================================================
+    static int getNumLevelsNeeded (int numThumbSamples) noexcept
     {
-        if (peakLevel < 0)
+        int numLevels = 0;
+
+        while (numThumbSamples > 1)
         {
-            for (int i = 0; i < data.size(); ++i)
-            {
-                const int peak = data[i].getPeak();
-                if (peak > peakLevel)
-                    peakLevel = peak;
-            }
+            numThumbSamples = (numThumbSamples + levelRatio - 1) / levelRatio;
+            ++numLevels;
         }
 
-        return peakLevel;
+        return numLevels;
+    }
+
+    void rebuildLevels()
+    {
+        updateLevels (0, data.size() - 1);
+    }
+
+    void readLevels (InputStream& input)
+    {
+        for (int i = 0; i < levels.size(); ++i)
+        {
+            Array<MinMaxValue>& level = *levels.getUnchecked (i);
+
+            for (int j = 0; j < level.size(); ++j)
+                level.getReference (j).read (input);
+        }
+    }
+
+    void writeLevels (OutputStream& output) const
+    {
+        for (int i = 0; i < levels.size(); ++i)
+        {
+            Array<MinMaxValue>& level = *levels.getUnchecked (i);
+
+            for (int j = 0; j < level.size(); ++j)
+                level.getReference (j).write (output);
+        }
     }
 
 private:
     Array <MinMaxValue> data;
-    int peakLevel;
+    OwnedArray <Array <MinMaxValue> > levels;
+
+    const Array<MinMaxValue>& getLevel (const int level) const noexcept
+    {
+        return level == 0 ? data : *levels.getUnchecked (level - 1);
+    }
+
+    static inline void addToRange (const MinMaxValue& v, char& mn, char& mx) noexcept
+    {
+        if (v.getMinValue() < mn)  mn = v.getMinValue();
+        if (v.getMaxValue() > mx)  mx = v.getMaxValue();
+    }
+
+    // Recalculates the entries in the coarser levels which cover a range of the data
+    void updateLevels (int startIndex, int endIndex)
+    {
+        for (int level = 0; level < levels.size() && startIndex <= endIndex; ++level)
+        {
+            const Array<MinMaxValue>& source = getLevel (level);
+            MinMaxValue* const dest = levels.getUnchecked (level)->getRawDataPointer();
+
+            startIndex /= levelRatio;
+            endIndex /= levelRatio;
+
+            for (int i = startIndex; i <= endIndex; ++i)
+            {
+                const int end = jmin ((i + 1) * levelRatio, source.size());
+                char mx = -128;
+                char mn = 127;
+
+                for (int j = i * levelRatio; j < end; ++j)
+                    addToRange (source.getReference (j), mn, mx);
+
+                dest[i].set (mn, mx);
+            }
+        }
+    }
 
     void ensureSize (const int thumbSamples)
     {
-        const int extraNeeded = thumbSamples - data.size();
+        const int oldSize = data.size();
+        const int extraNeeded = thumbSamples - oldSize;
+
         if (extraNeeded > 0)
+        {
             data.insertMultiple (-1, MinMaxValue(), extraNeeded);
+
+            const int numLevels = getNumLevelsNeeded (thumbSamples);
+            int levelSize = thumbSamples;
+
+            for (int i = 0; i < numLevels; ++i)
+            {
+                levelSize = (levelSize + levelRatio - 1) / levelRatio;
+
+                if (i >= levels.size())
+                    levels.add (new Array<MinMaxValue>());
+
+                Array<MinMaxValue>& level = *levels.getUnchecked (i);
+                level.insertMultiple (-1, MinMaxValue(), levelSize - level.size());
+            }
+
+            // (the last group that was already there may now include some of the new entries)
+            updateLevels (jmax (0, oldSize - 1), thumbSamples - 1);
+        }
     }
 };
 
@@ -589,7 +693,8 @@ bool AudioThumbnail::loadFrom (InputStream& rawInput)
     int32 numThumbnailSamples = input.readInt();  // Number of samples in the thumbnail data.
     numChannels = input.readInt();                // Number of audio channels.
     sampleRate = input.readInt();                 // Source sample rate.
-    input.skipNextBytes (16);                     // (reserved)
+    const int numLevels = input.readInt();        // Number of coarser levels stored after the thumbnail data (may be 0).
+    input.skipNextBytes (12);                     // (reserved)
 
     createChannels (numThumbnailSamples);
 
@@ -597,6 +702,16 @@ bool AudioThumbnail::loadFrom (InputStream& rawInput)
         for (int chan = 0; chan < numChannels; ++chan)
             channels.getUnchecked(chan)->getData(i)->read (input);
 
+    const bool levelsWereSaved = numLevels > 0 && numLevels == ThumbData::getNumLevelsNeeded (numThumbnailSamples);
+
+    for (int chan = 0; chan < numChannels; ++chan)
+    {
+        if (levelsWereSaved)
+            channels.getUnchecked(chan)->readLevels (input);
+        else
+            channels.getUnchecked(chan)->rebuildLevels();
+    }
+
     return true;
 }
 
@@ -613,12 +728,16 @@ void AudioThumbnail::saveTo (OutputStream& output) const
     output.writeInt (numThumbnailSamples);
     output.writeInt (numChannels);
     output.writeInt ((int) sampleRate);
-    output.writeInt64 (0);
+    output.writeInt (ThumbData::getNumLevelsNeeded (numThumbnailSamples));
+    output.writeInt (0);
     output.writeInt64 (0);
 
     for (int i = 0; i < numThumbnailSamples; ++i)
         for (int chan = 0; chan < numChannels; ++chan)
             channels.getUnchecked(chan)->getData(i)->write (output);
+
+    for (int chan = 0; chan < numChannels; ++chan)
+        channels.getUnchecked(chan)->writeLevels (output);
 }
 
 //==============================================================================
@@ -669,6 +788,46 @@ void AudioThumbnail::setReader (AudioFormatReader* newReader, int64 hash)
         setDataSource (new LevelDataSource (*this, newReader, hash));
 }
 
+bool AudioThumbnail::scanReader (AudioFormatReader& reader)
+{
+    clear();
+
+    if (reader.sampleRate <= 0 || reader.lengthInSamples <= 0)
+        return false;
+
+    reset ((int) reader.numChannels, reader.sampleRate, reader.lengthInSamples);
+
+    const int numThumbSamps = (int) ((reader.lengthInSamples + samplesPerThumbSample - 1) / samplesPerThumbSample);
+    const int blockSize = jmin (numThumbSamps, 1024);
+
+    HeapBlock<MinMaxValue> levelData ((size_t) blockSize * 2);
+    MinMaxValue* levels[2] = { levelData, levelData + blockSize };
+
+    for (int firstThumbIndex = 0; firstThumbIndex < numThumbSamps; firstThumbIndex += blockSize)
+    {
+        const int numToDo = jmin (blockSize, numThumbSamps - firstThumbIndex);
+
+        for (int i = 0; i < numToDo; ++i)
+        {
+            const int64 startSample = (firstThumbIndex + i) * (int64) samplesPerThumbSample;
+            float lowestLeft, highestLeft, lowestRight, highestRight;
+
+            reader.readMaxLevels (startSample, jmin ((int64) samplesPerThumbSample, reader.lengthInSamples - startSample),
+                                  lowestLeft, highestLeft, lowestRight, highestRight);
+
+            levels[0][i].setFloat (lowestLeft, highestLeft);
+            levels[1][i].setFloat (lowestRight, highestRight);
+        }
+
+        setLevels (levels, firstThumbIndex, 2, numToDo);
+    }
+
+    // (setLevels will have rounded these up to a whole number of thumbnail samples)
+    const ScopedLock sl (lock);
+    totalSamples = numSamplesFinished = reader.lengthInSamples;
+    return true;
+}
+
 int64 AudioThumbnail::getHashCode() const
 {
     return source == nullptr ? 0 : source->hashCode;
@@ -804,3 +963,171 @@ void AudioThumbnail::drawChannels (Graphics& g, const Rectangle<int>& area, doub
                      startTimeSeconds, endTimeSeconds, i, verticalZoomFactor);
     }
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioThumbnailTests  : public UnitTest
+{
+public:
+    AudioThumbnailTests() : UnitTest ("AudioThumbnail") {}
+
+    // With two source samples per thumbnail sample at this rate, the start and end times of a
+    // range of thumbnail samples can be given exactly.
+    enum { samplesPerThumbSample = 2, sampleRate = 2048 };
+
+    static double getTimeOfThumbSample (const int index) noexcept
+    {
+        return index * (double) samplesPerThumbSample / sampleRate;
+    }
+
+    static void getMinMax (const AudioThumbnail& thumb, const int channel, const int first, const int last,
+                           float& minValue, float& maxValue)
+    {
+        thumb.getApproximateMinMax (getTimeOfThumbSample (first), getTimeOfThumbSample (last),
+                                    channel, minValue, maxValue);
+    }
+
+    // Checks the min and max of a range against a scan of each of the thumbnail samples in it.
+    void checkRange (const AudioThumbnail& thumb, const int channel, const int numThumbSamples,
+                     const int first, const int last)
+    {
+        float expectedMin = 1.0f, expectedMax = -1.0f;
+
+        for (int i = first; i <= jmin (last, numThumbSamples - 1); ++i)
+        {
+            float mn, mx;
+            getMinMax (thumb, channel, i, i, mn, mx);
+            expectedMin = jmin (expectedMin, mn);
+            expectedMax = jmax (expectedMax, mx);
+        }
+
+        float mn, mx;
+        getMinMax (thumb, channel, first, last, mn, mx);
+        expect (mn == expectedMin && mx == expectedMax,
+                "range " + String (first) + " to " + String (last) + " of " + String (numThumbSamples));
+    }
+
+    void checkRandomRanges (const AudioThumbnail& thumb, const int numThumbSamples, const int numRanges)
+    {
+        Random r (numThumbSamples);
+
+        for (int i = 0; i < numRanges; ++i)
+        {
+            const int first = r.nextInt (numThumbSamples);
+            const int last = first + r.nextInt (numThumbSamples - first + 8);
+
+            for (int chan = 0; chan < thumb.getNumChannels(); ++chan)
+                checkRange (thumb, chan, numThumbSamples, first, last);
+        }
+    }
+
+    static void fillWithNoise (AudioSampleBuffer& buffer, Random& r)
+    {
+        for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.getSampleData (chan)[i] = r.nextFloat() * 2.0f - 1.0f;
+    }
+
+    // Adds random audio to a thumbnail in blocks of random sizes, so that its data has to grow
+    // as it goes.
+    static void addNoise (AudioThumbnail& thumb, const int numThumbSamples, Random& r)
+    {
+        thumb.reset (2, sampleRate, 0);
+
+        for (int pos = 0; pos < numThumbSamples;)
+        {
+            const int numToDo = jmin (1 + r.nextInt (300), numThumbSamples - pos);
+            AudioSampleBuffer audio (2, numToDo * samplesPerThumbSample);
+            fillWithNoise (audio, r);
+
+            thumb.addBlock (pos * (int64) samplesPerThumbSample, audio, 0, audio.getNumSamples());
+            pos += numToDo;
+        }
+    }
+
+    static MemoryBlock getThumbData (const AudioThumbnail& thumb)
+    {
+        MemoryOutputStream out;
+        thumb.saveTo (out);
+        return out.getMemoryBlock();
+    }
+
+    // (each level is a quarter of the size of the one below it, down to a single entry)
+    static int getNumLevelsNeeded (int numThumbSamples) noexcept
+    {
+        int numLevels = 0;
+
+        for (; numThumbSamples > 1; numThumbSamples = (numThumbSamples + 3) / 4)
+            ++numLevels;
+
+        return numLevels;
+    }
+
+    void runTest()
+    {
+        AudioFormatManager formats;
+        AudioThumbnailCache cache (1);
+        Random r (1234);
+
+        const int sizes[] = { 1, 2, 3, 4, 5, 7, 15, 16, 17, 63, 64, 65, 255, 256, 257, 1000, 1025, 4097,
+                              r.nextInt (10000) + 1, r.nextInt (10000) + 1, r.nextInt (10000) + 1 };
+
+        beginTest ("Min and max of ranges");
+
+        for (int i = 0; i < numElementsInArray (sizes); ++i)
+        {
+            AudioThumbnail thumb (samplesPerThumbSample, formats, cache);
+            addNoise (thumb, sizes[i], r);
+            checkRandomRanges (thumb, sizes[i], 50);
+
+            // overwriting a section has to update the coarser levels that cover it
+            const int start = r.nextInt (sizes[i]);
+            const int length = 1 + r.nextInt (sizes[i] - start);
+            AudioSampleBuffer audio (2, length * samplesPerThumbSample);
+            audio.clear();
+            thumb.addBlock (start * (int64) samplesPerThumbSample, audio, 0, audio.getNumSamples());
+
+            checkRandomRanges (thumb, sizes[i], 50);
+            checkRange (thumb, 0, sizes[i], start, start + length - 1);
+            checkRange (thumb, 1, sizes[i], 0, sizes[i] - 1);
+        }
+
+        beginTest ("Saving and loading");
+
+        for (int i = 0; i < numElementsInArray (sizes); ++i)
+        {
+            AudioThumbnail thumb (samplesPerThumbSample, formats, cache);
+            addNoise (thumb, sizes[i], r);
+            const MemoryBlock saved (getThumbData (thumb));
+
+            {
+                AudioThumbnail loaded (samplesPerThumbSample, formats, cache);
+                MemoryInputStream in (saved, false);
+                expect (loaded.loadFrom (in));
+                expect (getThumbData (loaded) == saved);
+                checkRandomRanges (loaded, sizes[i], 20);
+            }
+
+            // Older files have no levels after the thumbnail data, and their level count is 0,
+            // so the levels have to be rebuilt when they're loaded..
+            const int headerSize = 52, numLevelsPosition = 36;
+            MemoryBlock oldFormat (saved.getData(), (size_t) (headerSize + sizes[i] * 2 * 2));
+            expectEquals ((int) ByteOrder::littleEndianInt (addBytesToPointer (saved.getData(), numLevelsPosition)),
+                          getNumLevelsNeeded (sizes[i]));
+            *(int*) addBytesToPointer (oldFormat.getData(), numLevelsPosition) = 0;
+
+            {
+                AudioThumbnail loaded (samplesPerThumbSample, formats, cache);
+                MemoryInputStream in (oldFormat, false);
+                expect (loaded.loadFrom (in));
+                expect (getThumbData (loaded) == saved);
+                checkRandomRanges (loaded, sizes[i], 20);
+            }
+        }
+    }
+};
+
+static AudioThumbnailTests audioThumbnailTests;
+
+#endif
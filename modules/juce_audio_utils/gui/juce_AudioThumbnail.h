@@ -44,7 +44,9 @@ class AudioThumbnailCache;
     listeners should repaint themselves.
 
     The thumbnail stores an internal low-res version of the wave data, and this can
-    be loaded and saved to avoid having to scan the file again.
+    be loaded and saved to avoid having to scan the file again. It also keeps a set of
+    progressively coarser copies of this data, so that drawing a zoomed-out view of a
+    very long file doesn't involve scanning every low-res sample in it.
 
     @see AudioThumbnailCache, AudioThumbnailBase
 */
@@ -100,6 +102,18 @@ public:
     */
     void setReader (AudioFormatReader* newReader, int64 hashCode);
 
+    /** Clears the thumbnail and then scans the whole of an audio stream into it, on
+        the calling thread.
+
+        Unlike setReader(), this doesn't use the cache's background thread and doesn't
+        keep hold of the reader, so it's handy if you want to create thumbnails on threads
+        of your own (see AudioThumbnailGenerator). If the reader is a
+        MemoryMappedAudioFormatReader, you must map the whole file before calling this.
+
+        @returns true if the reader contained some audio
+    */
+    bool scanReader (AudioFormatReader& reader);
+
     /** Resets the thumbnail, ready for adding data with the specified format.
         If you're going to generate a thumbnail yourself, call this before using addBlock()
         to add the data.
@@ -55,6 +55,227 @@ private:
     JUCE_LEAK_DETECTOR (ThumbnailCacheEntry)
 };
 
+//==============================================================================
+/*  The store file is a header followed by a sequence of records, each of which is a
+    hash code, a size, and then the thumbnail data. When a thumbnail is replaced, the new
+    version is just appended, and a removed thumbnail is marked by a record with no data,
+    so when the file is opened, the last record for each hash code is the one that counts.
+
+    The space used by the records that have been superseded is reclaimed by rewriting the
+    file with just the live ones, whenever there are more dead bytes than live ones. That
+    keeps the file to less than twice the size of the thumbnails it holds.
+*/
+class AudioThumbnailCache::PersistentStore
+{
+public:
+    PersistentStore (const File& f)
+        : file (f), endOfValidData (0), numLiveBytes (0)
+    {
+    }
+
+    bool open()
+    {
+        if (! file.existsAsFile())
+        {
+            FileOutputStream out (file);
+            out.writeInt (getMagicHeader());
+            out.flush();
+
+            endOfValidData = out.getPosition();
+            return out.getStatus().wasOk();
+        }
+
+        {
+            FileInputStream in (file);
+
+            if (in.failedToOpen() || in.readInt() != getMagicHeader())
+                return false;
+
+            const int64 totalLength = in.getTotalLength();
+            int64 pos = in.getPosition();
+
+            while (pos + headerSize <= totalLength)
+            {
+                const int64 hash = in.readInt64();
+                const int64 size = in.readInt64();
+
+                if (size < 0 || pos + headerSize + size > totalLength)
+                    break; // (a truncated record, which will get overwritten by the next one)
+
+                if (size > 0)
+                    setRecord (hash, pos, size);
+                else
+                    removeRecord (hash);
+
+                pos += headerSize + size;
+                in.setPosition (pos);
+            }
+
+            endOfValidData = pos;
+        }
+
+        compactIfNeeded();
+        return true;
+    }
+
+    bool contains (const int64 hash) const
+    {
+        return index.contains (hash);
+    }
+
+    bool read (const int64 hash, MemoryBlock& data) const
+    {
+        if (index.contains (hash))
+        {
+            FileInputStream in (file);
+
+            if (in.openedOk() && in.setPosition (index [hash].position) && in.readInt64() == hash)
+            {
+                const int64 size = in.readInt64();
+                return in.readIntoMemoryBlock (data, (ssize_t) size) == (int) size;
+            }
+        }
+
+        return false;
+    }
+
+    void write (const int64 hash, const MemoryBlock& data)
+    {
+        const int64 size = (int64) data.getSize();
+
+        if (size > 0 && appendRecord (hash, data))
+        {
+            setRecord (hash, endOfValidData - headerSize - size, size);
+            compactIfNeeded();
+        }
+    }
+
+    void remove (const int64 hash)
+    {
+        if (index.contains (hash) && appendRecord (hash, MemoryBlock()))
+        {
+            removeRecord (hash);
+            compactIfNeeded();
+        }
+    }
+
+    const File file;
+
+private:
+    enum { headerSize = 16 };
+
+    struct Record
+    {
+        int64 position, size;
+    };
+
+    HashMap<int64, Record> index;
+    int64 endOfValidData, numLiveBytes;
+
+    static int getMagicHeader() noexcept
+    {
+        return (int) ByteOrder::littleEndianInt ("ThmS");
+    }
+
+    void setRecord (const int64 hash, const int64 position, const int64 size)
+    {
+        removeRecord (hash);
+
+        const Record r = { position, size };
+        index.set (hash, r);
+        numLiveBytes += headerSize + size;
+    }
+
+    void removeRecord (const int64 hash)
+    {
+        if (index.contains (hash))
+        {
+            numLiveBytes -= headerSize + index [hash].size;
+            index.remove (hash);
+        }
+    }
+
+    bool appendRecord (const int64 hash, const MemoryBlock& data)
+    {
+        FileOutputStream out (file);
+
+        if (out.failedToOpen() || ! out.setPosition (endOfValidData))
+            return false;
+
+        out.writeInt64 (hash);
+        out.writeInt64 ((int64) data.getSize());
+        out << data;
+        out.flush();
+
+        if (! out.getStatus().wasOk())
+            return false;
+
+        endOfValidData = out.getPosition();
+        out.truncate();
+        return true;
+    }
+
+    void compactIfNeeded()
+    {
+        const int64 numDeadBytes = endOfValidData - (int64) sizeof (int) - numLiveBytes;
+
+        if (numDeadBytes > numLiveBytes)
+            compact();
+    }
+
+    // Copies the live records into a new file, which then replaces the old one. If anything
+    // goes wrong, the old file and index are left as they were.
+    bool compact()
+    {
+        TemporaryFile temp (file);
+        HashMap<int64, Record> newIndex;
+        int64 newEnd = 0;
+
+        {
+            FileInputStream in (file);
+            FileOutputStream out (temp.getFile());
+
+            if (in.failedToOpen() || out.failedToOpen())
+                return false;
+
+            out.writeInt (getMagicHeader());
+
+            for (HashMap<int64, Record>::Iterator i (index); i.next();)
+            {
+                const Record r (i.getValue());
+                MemoryBlock data;
+
+                if (! (in.setPosition (r.position + headerSize)
+                        && in.readIntoMemoryBlock (data, (ssize_t) r.size) == (int) r.size))
+                    return false;
+
+                const Record newRecord = { out.getPosition(), r.size };
+                newIndex.set (i.getKey(), newRecord);
+
+                out.writeInt64 (i.getKey());
+                out.writeInt64 (r.size);
+                out << data;
+            }
+
+            out.flush();
+
+            if (! out.getStatus().wasOk())
+                return false;
+
+            newEnd = out.getPosition();
+        }
+
+        if (! temp.overwriteTargetFileWithTemporary())
+            return false;
+
+        index.swapWith (newIndex);
+        endOfValidData = newEnd;
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (PersistentStore)
+};
+
 //==============================================================================
 AudioThumbnailCache::AudioThumbnailCache (const int maxNumThumbs)
     : thread ("thumb cache"),
@@ -77,6 +298,18 @@ AudioThumbnailCache::ThumbnailCacheEntry* AudioThumbnailCache::findThumbFor (con
     return nullptr;
 }
 
+AudioThumbnailCache::ThumbnailCacheEntry* AudioThumbnailCache::createEntryFor (const int64 hash)
+{
+    ThumbnailCacheEntry* const te = new ThumbnailCacheEntry (hash);
+
+    if (thumbs.size() < maxNumThumbsToStore)
+        thumbs.add (te);
+    else
+        thumbs.set (findOldestThumb(), te);
+
+    return te;
+}
+
 int AudioThumbnailCache::findOldestThumb() const
 {
     int oldest = 0;
@@ -109,6 +342,21 @@ bool AudioThumbnailCache::loadThumb (AudioThumbnailBase& thumb, const int64 hash
         return true;
     }
 
+    if (store != nullptr)
+    {
+        MemoryBlock data;
+
+        if (store->read (hashCode, data))
+        {
+            ThumbnailCacheEntry* const te = createEntryFor (hashCode);
+            te->data.swapWith (data);
+
+            MemoryInputStream in (te->data, false);
+            thumb.loadFrom (in);
+            return true;
+        }
+    }
+
     return loadNewThumb (thumb, hashCode);
 }
 
@@ -119,20 +367,16 @@ void AudioThumbnailCache::storeThumb (const AudioThumbnailBase& thumb,
     ThumbnailCacheEntry* te = findThumbFor (hashCode);
 
     if (te == nullptr)
-    {
-        te = new ThumbnailCacheEntry (hashCode);
-
-        if (thumbs.size() < maxNumThumbsToStore)
-            thumbs.add (te);
-        else
-            thumbs.set (findOldestThumb(), te);
-    }
+        te = createEntryFor (hashCode);
 
     {
         MemoryOutputStream out (te->data, false);
         thumb.saveTo (out);
     }
 
+    if (store != nullptr)
+        store->write (hashCode, te->data);
+
     saveNewlyFinishedThumbnail (thumb, hashCode);
 }
 
@@ -149,6 +393,39 @@ void AudioThumbnailCache::removeThumb (const int64 hashCode)
     for (int i = thumbs.size(); --i >= 0;)
         if (thumbs.getUnchecked(i)->hash == hashCode)
             thumbs.remove (i);
+
+    if (store != nullptr)
+        store->remove (hashCode);
+}
+
+bool AudioThumbnailCache::containsThumb (const int64 hashCode) const
+{
+    const ScopedLock sl (lock);
+    return findThumbFor (hashCode) != nullptr
+            || (store != nullptr && store->contains (hashCode));
+}
+
+bool AudioThumbnailCache::setPersistentStore (const File& storeFile)
+{
+    ScopedPointer<PersistentStore> newStore;
+
+    if (storeFile != File::nonexistent)
+    {
+        newStore = new PersistentStore (storeFile);
+
+        if (! newStore->open())
+            return false;
+    }
+
+    const ScopedLock sl (lock);
+    store = newStore;
+    return true;
+}
+
+File AudioThumbnailCache::getPersistentStore() const
+{
+    const ScopedLock sl (lock);
+    return store != nullptr ? store->file : File::nonexistent;
 }
 
 static inline int getThumbnailCacheFileMagicHeader() noexcept
@@ -190,3 +467,183 @@ bool AudioThumbnailCache::loadNewThumb (AudioThumbnailBase&, int64)
 {
     return false;
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioThumbnailCacheTests  : public UnitTest
+{
+public:
+    AudioThumbnailCacheTests() : UnitTest ("AudioThumbnailCache") {}
+
+    enum { samplesPerThumbSample = 64 };
+
+    // Fills a thumbnail with some random audio, stores it in the cache, and returns its data.
+    static MemoryBlock storeThumb (AudioThumbnailCache& cache, const int64 hash,
+                                   const int numSamples, const int64 seed)
+    {
+        AudioSampleBuffer audio (2, numSamples);
+        Random r (seed);
+
+        for (int chan = 0; chan < audio.getNumChannels(); ++chan)
+            for (int i = 0; i < numSamples; ++i)
+                audio.getSampleData (chan)[i] = r.nextFloat() * 2.0f - 1.0f;
+
+        AudioFormatManager formats;
+        AudioThumbnail thumb (samplesPerThumbSample, formats, cache);
+        thumb.reset (audio.getNumChannels(), 44100.0, numSamples);
+        thumb.addBlock (0, audio, 0, numSamples);
+
+        cache.storeThumb (thumb, hash);
+        return getThumbData (thumb);
+    }
+
+    static MemoryBlock getThumbData (const AudioThumbnail& thumb)
+    {
+        MemoryOutputStream out;
+        thumb.saveTo (out);
+        return out.getMemoryBlock();
+    }
+
+    static bool loadsThumb (AudioThumbnailCache& cache, const int64 hash, const MemoryBlock& expected)
+    {
+        AudioFormatManager formats;
+        AudioThumbnail thumb (samplesPerThumbSample, formats, cache);
+        return cache.loadThumb (thumb, hash) && getThumbData (thumb) == expected;
+    }
+
+    // Appends a record to a store file by hand, the way the store writes them.
+    static void appendRecord (const File& storeFile, const int64 hash, const MemoryBlock& data, const int64 size)
+    {
+        FileOutputStream out (storeFile);
+        out.writeInt64 (hash);
+        out.writeInt64 (size);
+        out << data;
+    }
+
+    void runTest()
+    {
+        // (the in-memory caches hold only one thumbnail, so most of the loads come from the store)
+        beginTest ("Persistent store");
+        {
+            TemporaryFile temp (".thumbstore");
+            const File storeFile (temp.getFile());
+            MemoryBlock a, b;
+
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+                storeThumb (cache, 1, 10000, 1);
+                b = storeThumb (cache, 2, 20000, 2);
+                a = storeThumb (cache, 1, 5000, 3);
+                storeThumb (cache, 3, 8000, 4);
+                cache.removeThumb (3);
+
+                expect (loadsThumb (cache, 1, a));
+                expect (loadsThumb (cache, 2, b));
+                expect (! cache.containsThumb (3));
+            }
+
+            // the last record for each thumbnail is the one that's used when the store is reopened..
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+                expect (cache.containsThumb (1) && cache.containsThumb (2) && ! cache.containsThumb (3));
+                expect (loadsThumb (cache, 1, a));
+                expect (loadsThumb (cache, 2, b));
+            }
+
+            // ..a truncated record at the end is ignored, and overwritten by the next one
+            appendRecord (storeFile, 4, a, (int64) a.getSize() + 100);
+
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+                expect (! cache.containsThumb (4));
+                expect (loadsThumb (cache, 1, a));
+                expect (loadsThumb (cache, 2, b));
+                b = storeThumb (cache, 4, 3000, 5);
+            }
+
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+                expect (loadsThumb (cache, 4, b));
+                expect (loadsThumb (cache, 1, a));
+            }
+
+            // a file that isn't a store is rejected
+            {
+                TemporaryFile other (".thumbstore");
+                other.getFile().replaceWithText ("not a thumbnail store");
+
+                AudioThumbnailCache cache (1);
+                expect (! cache.setPersistentStore (other.getFile()));
+            }
+        }
+
+        beginTest ("Store compaction");
+        {
+            TemporaryFile temp (".thumbstore");
+            const File storeFile (temp.getFile());
+            const int64 headerSize = 16;
+
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+
+                // replacing a thumbnail over and over shouldn't make the file any bigger than
+                // twice the size of the live data..
+                MemoryBlock data;
+
+                for (int i = 0; i < 50; ++i)
+                {
+                    data = storeThumb (cache, 1, 10000, i);
+                    expect (storeFile.getSize() <= 4 + 2 * (headerSize + (int64) data.getSize()));
+                }
+
+                expect (loadsThumb (cache, 1, data));
+
+                // ..and once everything has been removed, there's nothing left but the header
+                for (int i = 2; i < 10; ++i)
+                    storeThumb (cache, i, 10000, i);
+
+                for (int i = 1; i < 10; ++i)
+                    cache.removeThumb (i);
+
+                expectEquals (storeFile.getSize(), (int64) 4);
+            }
+
+            // a file with more dead records than live ones is compacted when it's opened
+            MemoryBlock a, b;
+
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+                a = storeThumb (cache, 1, 10000, 1);
+                b = storeThumb (cache, 2, 10000, 2);
+            }
+
+            const int64 liveSize = storeFile.getSize();
+
+            for (int i = 0; i < 3; ++i)
+                appendRecord (storeFile, 1, a, (int64) a.getSize());
+
+            appendRecord (storeFile, 3, b, (int64) b.getSize());
+            appendRecord (storeFile, 3, MemoryBlock(), 0);
+
+            {
+                AudioThumbnailCache cache (1);
+                expect (cache.setPersistentStore (storeFile));
+                expectEquals (storeFile.getSize(), liveSize);
+                expect (loadsThumb (cache, 1, a));
+                expect (loadsThumb (cache, 2, b));
+                expect (! cache.containsThumb (3));
+            }
+        }
+    }
+};
+
+static AudioThumbnailCacheTests audioThumbnailCacheTests;
+
+#endif
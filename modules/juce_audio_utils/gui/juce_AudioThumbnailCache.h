@@ -72,9 +72,16 @@ public:
     */
     void storeThumb (const AudioThumbnailBase& thumb, int64 hashCode);
 
-    /** Tells the cache to forget about the thumb with the given hashcode. */
+    /** Tells the cache to forget about the thumb with the given hashcode.
+        If there's a persistent store, the thumb is removed from that too.
+    */
     void removeThumb (int64 hashCode);
 
+    /** Returns true if the cache has some data for this hashcode, either in memory
+        or in its persistent store.
+    */
+    bool containsThumb (int64 hashCode) const;
+
     //==============================================================================
     /** Attempts to re-load a saved cache of thumbnails from a stream.
         The cache data must have been written by the writeToStream() method.
@@ -87,6 +94,31 @@ public:
     */
     void writeToStream (OutputStream& stream);
 
+    //==============================================================================
+    /** Makes the cache keep a copy of every thumbnail that it stores in a file, and look
+        in that file for any thumbnails that it can't find in memory.
+
+        All the thumbnails are kept in this one file, so that a large library of audio
+        files doesn't need thousands of little thumbnail files. New data is appended to
+        the end of the file, and when it's opened, the cache reads the position of each
+        thumbnail to build an index, so loading one later only needs a single seek.
+
+        The store isn't limited by the maxNumThumbsToStore value that was given to the
+        constructor, but thumbnails that have been replaced or removed don't take up space
+        for long: whenever their old data outweighs the live data, the file is rewritten
+        without it.
+
+        If the file doesn't exist, it'll be created. Pass File::nonexistent to stop using
+        a persistent store.
+
+        @returns false if the file couldn't be opened or isn't a thumbnail store
+    */
+    bool setPersistentStore (const File& storeFile);
+
+    /** Returns the file that was set with setPersistentStore(). */
+    File getPersistentStore() const;
+
+    //==============================================================================
     /** Returns the thread that client thumbnails can use. */
     TimeSliceThread& getTimeSliceThread() noexcept      { return thread; }
 
@@ -106,12 +138,16 @@ private:
     TimeSliceThread thread;
 
     class ThumbnailCacheEntry;
+    class PersistentStore;
     friend class OwnedArray<ThumbnailCacheEntry>;
+    friend class ScopedPointer<PersistentStore>;
     OwnedArray<ThumbnailCacheEntry> thumbs;
+    ScopedPointer<PersistentStore> store;
     CriticalSection lock;
     int maxNumThumbsToStore;
 
     ThumbnailCacheEntry* findThumbFor (int64 hash) const;
+    ThumbnailCacheEntry* createEntryFor (int64 hash);
     int findOldestThumb() const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioThumbnailCache)
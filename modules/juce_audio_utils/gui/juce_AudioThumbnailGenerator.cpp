@@ -0,0 +1,327 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+class AudioThumbnailGenerator::GeneratorJob  : public ThreadPoolJob
+{
+public:
+    GeneratorJob (AudioThumbnailGenerator& owner_, const File& file_)
+        : ThreadPoolJob ("Thumbnail: " + file_.getFileName()),
+          owner (owner_), file (file_), hasRun (false)
+    {
+    }
+
+    ~GeneratorJob()
+    {
+        // (if the job was removed before it could run, the file no longer counts)
+        if (! hasRun)
+            --(owner.numFilesAdded);
+    }
+
+    JobStatus runJob()
+    {
+        hasRun = true;
+
+        bool isMemoryMapped = false;
+        const ScopedPointer<AudioFormatReader> reader (owner.createReaderFor (file, isMemoryMapped));
+
+        if (reader != nullptr && ! shouldExit())
+        {
+            AudioThumbnail thumb (owner.samplesPerThumbSample, owner.formatManager, owner.cache);
+
+            if (thumb.scanReader (*reader))
+            {
+                owner.cache.storeThumb (thumb, FileInputSource (file).hashCode());
+
+                if (isMemoryMapped)
+                    ++(owner.numFilesMemoryMapped);
+
+                owner.numSamplesScanned += reader->lengthInSamples;
+                owner.numBytesScanned += file.getSize();
+                ++(owner.numFilesFinished);
+                owner.fileFinished();
+                return jobHasFinished;
+            }
+        }
+
+        ++(owner.numFilesFailed);
+        owner.fileFinished();
+        return jobHasFinished;
+    }
+
+private:
+    AudioThumbnailGenerator& owner;
+    const File file;
+    bool hasRun;
+
+    JUCE_DECLARE_NON_COPYABLE (GeneratorJob)
+};
+
+//==============================================================================
+AudioThumbnailGenerator::AudioThumbnailGenerator (const int samplesPerThumbSample_,
+                                                  AudioFormatManager& formatManager_,
+                                                  AudioThumbnailCache& cache_,
+                                                  const int numThreads)
+    : samplesPerThumbSample (samplesPerThumbSample_),
+      formatManager (formatManager_),
+      cache (cache_),
+      pool (jmax (1, numThreads)),
+      startTime (0), finishTime (0)
+{
+}
+
+AudioThumbnailGenerator::~AudioThumbnailGenerator()
+{
+    pool.removeAllJobs (true, -1);
+}
+
+void AudioThumbnailGenerator::addFile (const File& file)
+{
+    if (cache.containsThumb (FileInputSource (file).hashCode()))
+        return;
+
+    {
+        const ScopedLock sl (timeLock);
+
+        if (numFilesAdded.get() == numFilesFinished.get() + numFilesFailed.get())
+            startTime = Time::getMillisecondCounterHiRes();
+
+        ++numFilesAdded;
+    }
+
+    pool.addJob (new GeneratorJob (*this, file), true);
+}
+
+void AudioThumbnailGenerator::addFiles (const Array<File>& files)
+{
+    for (int i = 0; i < files.size(); ++i)
+        addFile (files.getReference (i));
+}
+
+void AudioThumbnailGenerator::cancelPendingFiles()
+{
+    pool.removeAllJobs (false, 0);
+    fileFinishedEvent.signal();
+}
+
+bool AudioThumbnailGenerator::waitUntilFinished (const int timeOutMilliseconds) const
+{
+    const uint32 endTime = Time::getMillisecondCounter() + (uint32) timeOutMilliseconds;
+
+    while (numFilesFinished.get() + numFilesFailed.get() < numFilesAdded.get())
+    {
+        if (timeOutMilliseconds >= 0 && Time::getMillisecondCounter() >= endTime)
+            return false;
+
+        fileFinishedEvent.wait (100);
+    }
+
+    return true;
+}
+
+void AudioThumbnailGenerator::fileFinished()
+{
+    {
+        const ScopedLock sl (timeLock);
+        finishTime = Time::getMillisecondCounterHiRes();
+    }
+
+    fileFinishedEvent.signal();
+    sendChangeMessage();
+}
+
+AudioFormatReader* AudioThumbnailGenerator::createReaderFor (const File& file, bool& isMemoryMapped)
+{
+    if (AudioFormat* const format = formatManager.findFormatForFileExtension (file.getFileExtension()))
+    {
+        ScopedPointer<MemoryMappedAudioFormatReader> mappedReader (format->createMemoryMappedReader (file));
+
+        // (this can fail if there's not enough address space, in which case a normal reader will do)
+        if (mappedReader != nullptr && mappedReader->mapEntireFile())
+        {
+            isMemoryMapped = true;
+            return mappedReader.release();
+        }
+    }
+
+    isMemoryMapped = false;
+    return formatManager.createReaderFor (file);
+}
+
+//==============================================================================
+AudioThumbnailGenerator::Progress AudioThumbnailGenerator::getProgress() const
+{
+    Progress p;
+    p.numFilesAdded         = numFilesAdded.get();
+    p.numFilesFinished      = numFilesFinished.get();
+    p.numFilesFailed        = numFilesFailed.get();
+    p.numFilesMemoryMapped  = numFilesMemoryMapped.get();
+    p.numSamplesScanned     = numSamplesScanned.get();
+    p.numBytesScanned       = numBytesScanned.get();
+
+    const bool isBusy = p.numFilesFinished + p.numFilesFailed < p.numFilesAdded;
+
+    const ScopedLock sl (timeLock);
+    p.secondsElapsed = jmax (0.0, ((isBusy ? Time::getMillisecondCounterHiRes() : finishTime) - startTime) / 1000.0);
+    return p;
+}
+
+void AudioThumbnailGenerator::resetProgress()
+{
+    // You can't do this while files are being scanned!
+    jassert (pool.getNumJobs() == 0);
+
+    const ScopedLock sl (timeLock);
+    numFilesAdded = 0;
+    numFilesFinished = 0;
+    numFilesFailed = 0;
+    numFilesMemoryMapped = 0;
+    numSamplesScanned = 0;
+    numBytesScanned = 0;
+    startTime = finishTime = 0;
+}
+
+double AudioThumbnailGenerator::Progress::getProportionComplete() const noexcept
+{
+    return numFilesAdded > 0 ? jlimit (0.0, 1.0, (numFilesFinished + numFilesFailed) / (double) numFilesAdded)
+                             : 1.0;
+}
+
+double AudioThumbnailGenerator::Progress::getFilesPerSecond() const noexcept
+{
+    return secondsElapsed > 0 ? (numFilesFinished + numFilesFailed) / secondsElapsed : 0.0;
+}
+
+double AudioThumbnailGenerator::Progress::getBytesPerSecond() const noexcept
+{
+    return secondsElapsed > 0 ? numBytesScanned / secondsElapsed : 0.0;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class AudioThumbnailGeneratorTests  : public UnitTest
+{
+public:
+    AudioThumbnailGeneratorTests() : UnitTest ("AudioThumbnailGenerator") {}
+
+    enum { samplesPerThumbSample = 256 };
+
+    static void writeNoiseFile (const File& file, const int numChannels, const int numSamples, const int64 seed)
+    {
+        AudioSampleBuffer audio (numChannels, numSamples);
+        Random r (seed);
+
+        for (int chan = 0; chan < numChannels; ++chan)
+            for (int i = 0; i < numSamples; ++i)
+                audio.getSampleData (chan)[i] = r.nextFloat() * 2.0f - 1.0f;
+
+        WavAudioFormat wav;
+        ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (file.createOutputStream(), 44100.0,
+                                                                      (unsigned int) numChannels, 16,
+                                                                      StringPairArray(), 0));
+        writer->writeFromAudioSampleBuffer (audio, 0, numSamples);
+    }
+
+    static MemoryBlock getThumbData (const AudioThumbnail& thumb)
+    {
+        MemoryOutputStream out;
+        thumb.saveTo (out);
+        return out.getMemoryBlock();
+    }
+
+    void runTest()
+    {
+        beginTest ("Generated thumbnails");
+
+        const File folder (File::getSpecialLocation (File::tempDirectory)
+                             .getNonexistentChildFile ("thumbnail_generator_test", String::empty));
+        folder.createDirectory();
+
+        Array<File> files;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            files.add (folder.getChildFile ("test" + String (i) + ".wav"));
+            writeNoiseFile (files.getLast(), 1 + i % 2, 30000 + 7777 * i, i);
+        }
+
+        const File badFile (folder.getChildFile ("bad.wav"));
+        badFile.replaceWithText ("not a wav file");
+
+        AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        {
+            // (the in-memory cache only holds one thumbnail, so the others have to be loaded from the store)
+            AudioThumbnailCache cache (1);
+            expect (cache.setPersistentStore (folder.getChildFile ("thumbs.store")));
+
+            AudioThumbnailGenerator generator (samplesPerThumbSample, formats, cache, 2);
+            generator.addFiles (files);
+            generator.addFile (badFile);
+            expect (generator.waitUntilFinished (20000));
+
+            const AudioThumbnailGenerator::Progress progress (generator.getProgress());
+            expectEquals (progress.numFilesAdded, files.size() + 1);
+            expectEquals (progress.numFilesFinished, files.size());
+            expectEquals (progress.numFilesFailed, 1);
+            expectEquals (progress.numFilesMemoryMapped, files.size());
+
+            for (int i = 0; i < files.size(); ++i)
+            {
+                const File& file = files.getReference (i);
+
+                // the generated data should be the same as a thumbnail that scanned the file itself..
+                AudioThumbnailCache scratchCache (1);
+                AudioThumbnail expected (samplesPerThumbSample, formats, scratchCache);
+                ScopedPointer<AudioFormatReader> reader (formats.createReaderFor (file));
+                expect (expected.scanReader (*reader));
+
+                AudioThumbnail thumb (samplesPerThumbSample, formats, cache);
+                expect (cache.loadThumb (thumb, FileInputSource (file).hashCode()));
+                expect (thumb.isFullyLoaded());
+                expect (getThumbData (thumb) == getThumbData (expected));
+
+                // ..and a thumbnail that's given the file should pick it up from the cache
+                // rather than scanning it again
+                AudioThumbnail thumbForFile (samplesPerThumbSample, formats, cache);
+                thumbForFile.setSource (new FileInputSource (file));
+                expect (thumbForFile.isFullyLoaded());
+                expect (getThumbData (thumbForFile) == getThumbData (expected));
+            }
+
+            // files that are already in the cache are skipped
+            generator.resetProgress();
+            generator.addFiles (files);
+            expectEquals (generator.getProgress().numFilesAdded, 0);
+        }
+
+        folder.deleteRecursively();
+    }
+};
+
+static AudioThumbnailGeneratorTests audioThumbnailGeneratorTests;
+
+#endif
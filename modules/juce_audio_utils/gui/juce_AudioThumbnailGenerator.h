@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_AUDIOTHUMBNAILGENERATOR_JUCEHEADER__
+#define __JUCE_AUDIOTHUMBNAILGENERATOR_JUCEHEADER__
+
+#include "juce_AudioThumbnailCache.h"
+
+
+//==============================================================================
+/**
+    Creates thumbnails for a batch of audio files, using a pool of threads.
+
+    This is for situations like importing a large library of files, where
+    scanning them one at a time on the AudioThumbnailCache's thread would take far
+    too long. Each file that you add is scanned by a job on the generator's thread
+    pool, and the result is stored in the cache, using the same hash code that a
+    FileInputSource for that file would have, so that when an AudioThumbnail is later
+    given a FileInputSource for the file, it'll load the data from the cache instead
+    of scanning it again.
+
+    If the format supports it (see AudioFormat::createMemoryMappedReader()), the
+    files are memory-mapped, so that scanning them doesn't involve copying the
+    data through a stream.
+
+    To get the most out of this, give your cache a persistent store (see
+    AudioThumbnailCache::setPersistentStore()) which is large enough to hold
+    all the results.
+
+    The generator is a ChangeBroadcaster, and it sends a change message each time
+    a file has been finished, so you can use getProgress() to update a progress bar.
+
+    @see AudioThumbnailCache, AudioThumbnail
+*/
+class JUCE_API  AudioThumbnailGenerator  : public ChangeBroadcaster
+{
+public:
+    //==============================================================================
+    /** Creates a generator.
+
+        @param sourceSamplesPerThumbnailSample  the resolution of the thumbnails to create. This
+                                must be the same as the value that your AudioThumbnail objects
+                                use, or they won't be able to use the data
+        @param formatManagerToUse   the formats that can be used to open the files
+        @param cacheToUse           the cache in which to store the thumbnails. This must not be
+                                    deleted while the generator exists
+        @param numThreads           the number of threads to use. Scanning memory-mapped files
+                                    is usually limited by the CPU rather than the disk, so
+                                    one thread per CPU is a good choice
+    */
+    AudioThumbnailGenerator (int sourceSamplesPerThumbnailSample,
+                             AudioFormatManager& formatManagerToUse,
+                             AudioThumbnailCache& cacheToUse,
+                             int numThreads = SystemStats::getNumCpus());
+
+    /** Destructor.
+        This will cancel any files that haven't yet been started, and wait for the
+        ones that are being scanned to finish.
+    */
+    ~AudioThumbnailGenerator();
+
+    //==============================================================================
+    /** Adds a file to the queue of files to scan.
+        If the cache already contains a thumbnail for the file, it won't be scanned again.
+    */
+    void addFile (const File& file);
+
+    /** Adds a set of files to the queue of files to scan. */
+    void addFiles (const Array<File>& files);
+
+    /** Removes any files that haven't yet been started. */
+    void cancelPendingFiles();
+
+    /** Blocks until all the files that were added have been finished.
+        @returns false if the timeout expired first
+    */
+    bool waitUntilFinished (int timeOutMilliseconds = -1) const;
+
+    //==============================================================================
+    /** Describes how far the generator has got. @see getProgress */
+    struct Progress
+    {
+        int numFilesAdded;          /**< The number of files that have been added, not including
+                                         any that were skipped or cancelled. */
+        int numFilesFinished;       /**< The number of files that have been scanned successfully. */
+        int numFilesFailed;         /**< The number of files that couldn't be opened. */
+        int numFilesMemoryMapped;   /**< The number of finished files that could be memory-mapped. */
+        int64 numSamplesScanned;    /**< The total length, in samples, of the files that have been scanned. */
+        int64 numBytesScanned;      /**< The total size of the files that have been scanned. */
+        double secondsElapsed;      /**< The time since the generator last started working. */
+
+        /** Returns the proportion of the files that are done, from 0 to 1. */
+        double getProportionComplete() const noexcept;
+
+        /** Returns the number of files that are being scanned per second. */
+        double getFilesPerSecond() const noexcept;
+
+        /** Returns the number of bytes of audio data that are being scanned per second. */
+        double getBytesPerSecond() const noexcept;
+    };
+
+    /** Returns the generator's current progress. */
+    Progress getProgress() const;
+
+    /** Clears the counters that are returned by getProgress().
+        This can only be done when the generator isn't busy.
+    */
+    void resetProgress();
+
+private:
+    //==============================================================================
+    class GeneratorJob;
+    friend class GeneratorJob;
+
+    const int samplesPerThumbSample;
+    AudioFormatManager& formatManager;
+    AudioThumbnailCache& cache;
+    ThreadPool pool;
+
+    Atomic<int> numFilesAdded, numFilesFinished, numFilesFailed, numFilesMemoryMapped;
+    Atomic<int64> numSamplesScanned, numBytesScanned;
+    double startTime, finishTime;
+    CriticalSection timeLock;
+    WaitableEvent fileFinishedEvent;
+
+    AudioFormatReader* createReaderFor (const File&, bool& isMemoryMapped);
+    void fileFinished();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioThumbnailGenerator)
+};
+
+
+#endif   // __JUCE_AUDIOTHUMBNAILGENERATOR_JUCEHEADER__
@@ -47,6 +47,9 @@ namespace juce
 #ifndef __JUCE_AUDIOTHUMBNAILCACHE_JUCEHEADER__
  #include "gui/juce_AudioThumbnailCache.h"
 #endif
+#ifndef __JUCE_AUDIOTHUMBNAILGENERATOR_JUCEHEADER__
+ #include "gui/juce_AudioThumbnailGenerator.h"
+#endif
 #ifndef __JUCE_MIDIKEYBOARDCOMPONENT_JUCEHEADER__
  #include "gui/juce_MidiKeyboardComponent.h"
 #endif
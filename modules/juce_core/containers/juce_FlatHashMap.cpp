@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#if JUCE_UNIT_TESTS
+
+class FlatHashMapTests  : public UnitTest
+{
+public:
+    FlatHashMapTests() : UnitTest ("FlatHashMap") {}
+
+    template <class MapType>
+    static bool mapsMatch (MapType& map, HashMap<int, int>& reference)
+    {
+        if (map.size() != reference.size())
+            return false;
+
+        for (HashMap<int, int>::Iterator i (reference); i.next();)
+        {
+            const int* const value = map.getValuePointer (i.getKey());
+
+            if (value == nullptr || *value != i.getValue())
+                return false;
+        }
+
+        int numIterated = 0;
+
+        for (typename MapType::Iterator i (map); i.next();)
+        {
+            if (! reference.contains (i.getKey()))
+                return false;
+
+            ++numIterated;
+        }
+
+        return numIterated == map.size();
+    }
+
+    void runTest()
+    {
+        beginTest ("Adding and removing");
+        {
+            Random r (0x1234);
+            FlatHashMap<int, int> map;
+            HashMap<int, int> reference;
+
+            for (int i = 0; i < 100000; ++i)
+            {
+                // (a small key range, so that there are plenty of collisions and removals)
+                const int key = r.nextInt (5000) - 2500;
+
+                switch (r.nextInt (4))
+                {
+                    case 0:  map.remove (key); reference.remove (key); break;
+                    case 1:  map.getReference (key) += i; reference.set (key, reference [key] + i); break;
+                    default: map.set (key, i); reference.set (key, i); break;
+                }
+
+                if (i % 10000 == 0)
+                    expect (mapsMatch (map, reference));
+            }
+
+            expect (mapsMatch (map, reference));
+            expect (isPowerOfTwo (map.getNumSlots()));
+
+            map.clear();
+            expectEquals (map.size(), 0);
+            expect (! map.contains (0));
+        }
+
+        beginTest ("Removing values");
+        {
+            FlatHashMap<int, int> map;
+
+            for (int i = 0; i < 10000; ++i)
+                map.set (i, i % 3);
+
+            map.removeValue (1);
+            expectEquals (map.size(), 6667);
+            expect (! map.containsValue (1));
+            expect (map.containsValue (2));
+
+            for (int i = 0; i < 10000; ++i)
+                expect (map.contains (i) == (i % 3 != 1));
+        }
+
+        beginTest ("Heterogeneous lookup");
+        {
+            FlatHashMap<String, int> strings;
+            strings.set ("alpha", 1);
+            strings.set (String ("beta"), 2);
+
+            expectEquals (strings ["alpha"], 1);
+            expectEquals (strings [String ("beta")], 2);
+            expect (strings.contains ("beta"));
+            expect (! strings.contains ("gamma"));
+
+            strings.remove ("alpha");
+            expect (! strings.contains (String ("alpha")));
+
+            FlatHashMap<int64, int> numbers;
+            numbers.set (-7, 1);
+            numbers.set (literal64bit (0x100000000), 2);
+
+            expectEquals (numbers [-7], 1);
+            expectEquals (numbers [literal64bit (0x100000000)], 2);
+            expect (! numbers.contains (0));
+        }
+
+        beginTest ("Performance");
+        {
+            // (raise this to 10000000 to compare at the largest sizes)
+            const int maxNumItems = 1000000;
+
+            for (int numItems = 1000; numItems <= maxNumItems; numItems *= 10)
+            {
+                Random r (numItems);
+                HeapBlock<int> keys ((size_t) numItems);
+
+                for (int i = 0; i < numItems; ++i)
+                    keys[i] = r.nextInt();
+
+                const String hashMapResult (timeMap<HashMap<int, int> > (keys, numItems));
+                const String flatMapResult (timeMap<FlatHashMap<int, int> > (keys, numItems));
+
+                logMessage (String (numItems) + " items, ns per insert/find/miss/iterate:");
+                logMessage ("    HashMap:     " + hashMapResult);
+                logMessage ("    FlatHashMap: " + flatMapResult);
+            }
+        }
+    }
+
+    template <class MapType>
+    String timeMap (const HeapBlock<int>& keys, const int numItems)
+    {
+        MapType map;
+        int64 total = 0;
+        String result;
+
+        int64 start = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numItems; ++i)
+            map.set (keys[i], i);
+
+        result << getNanosecondsPerItem (start, numItems) << " / ";
+        start = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numItems; ++i)
+            total += map [keys[i]];
+
+        result << getNanosecondsPerItem (start, numItems) << " / ";
+        start = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numItems; ++i)
+            total += map [keys[i] ^ 0x5555] ? 1 : 0;
+
+        result << getNanosecondsPerItem (start, numItems) << " / ";
+        start = Time::getHighResolutionTicks();
+
+        for (typename MapType::Iterator i (map); i.next();)
+            total += i.getValue();
+
+        result << getNanosecondsPerItem (start, numItems);
+
+        expect (total != 0);
+        return result;
+    }
+
+    static String getNanosecondsPerItem (const int64 startTicks, const int numItems)
+    {
+        const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+        return String (seconds * 1.0e9 / numItems, 1);
+    }
+};
+
+static FlatHashMapTests flatHashMapTests;
+
+#endif
@@ -0,0 +1,506 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_FLATHASHMAP_JUCEHEADER__
+#define __JUCE_FLATHASHMAP_JUCEHEADER__
+
+#include "juce_HashMap.h"
+#include "../memory/juce_HeapBlock.h"
+
+
+//==============================================================================
+/**
+    Holds a set of mappings between some key/value pairs, stored in a single open-addressed table.
+
+    This has much the same interface as HashMap, but rather than allocating a separate
+    object for each item and chaining them together, it keeps all the items in one
+    contiguous block, using robin-hood hashing. This makes it much more cache-friendly,
+    and it never allocates except when the table needs to grow, which it does automatically
+    whenever it becomes 7/8 full.
+
+    The hash function class must provide a full-width hash of each key, in the form:
+
+    @code
+    struct MyHashGenerator
+    {
+        static uint32 generateHash (MyKeyType key)
+        {
+            // All the bits of the result should be well-mixed, because the
+            // map uses the lower bits to choose a slot.
+            return someFunctionOfMyKeyType (key);
+        }
+    };
+    @endcode
+
+    The lookup methods are templates, so you can search for a key using any type for which
+    the hash class has a generateHash() method that returns the same hash as the equivalent
+    KeyType, and which can be compared with KeyType using operator==. For example, using the
+    DefaultHashFunctions, a FlatHashMap<String, int> can be searched with a const char*
+    without having to create a temporary String.
+
+    @code
+    FlatHashMap<String, int> map;
+    map.set ("one", 1);
+    map.getReference ("two") += 2;
+
+    DBG (map ["one"]); // prints "1"
+
+    for (FlatHashMap<String, int>::Iterator i (map); i.next();)
+        DBG (i.getKey() << " -> " << i.getValue());
+    @endcode
+
+    Unlike HashMap, adding or removing items can move the other items around, so any pointers
+    or references to values in the map, or any iterators, become invalid when the map is modified.
+
+    @see HashMap, DefaultHashFunctions
+*/
+template <typename KeyType,
+          typename ValueType,
+          class HashFunctionToUse = DefaultHashFunctions,
+          class TypeOfCriticalSectionToUse = DummyCriticalSection>
+class FlatHashMap
+{
+private:
+    typedef PARAMETER_TYPE (KeyType)   KeyTypeParameter;
+    typedef PARAMETER_TYPE (ValueType) ValueTypeParameter;
+
+public:
+    //==============================================================================
+    /** Creates an empty map. */
+    FlatHashMap() noexcept
+       : numItems (0), numSlots (0)
+    {
+    }
+
+    /** Destructor. */
+    ~FlatHashMap()
+    {
+        clear();
+    }
+
+    //==============================================================================
+    /** Removes all values from the map.
+        Note that this will clear the content, but won't free the storage that's allocated.
+    */
+    void clear()
+    {
+        const ScopedLockType sl (getLock());
+
+        for (int i = 0; i < numSlots; ++i)
+        {
+            if (hashes[i] != 0)
+            {
+                entries[i].~Entry();
+                hashes[i] = 0;
+            }
+        }
+
+        numItems = 0;
+    }
+
+    /** Returns the current number of items in the map. */
+    inline int size() const noexcept
+    {
+        return numItems;
+    }
+
+    /** Returns the number of slots in the table, which will always be a power of two. */
+    inline int getNumSlots() const noexcept
+    {
+        return numSlots;
+    }
+
+    /** Makes sure that the table is large enough to hold a given number of items
+        without having to grow again.
+    */
+    void ensureStorageAllocated (const int minNumItems)
+    {
+        const ScopedLockType sl (getLock());
+
+        int newNumSlots = jmax ((int) minimumNumSlots, numSlots);
+
+        while (getMaxNumItems (newNumSlots) < minNumItems)
+            newNumSlots *= 2;
+
+        if (newNumSlots != numSlots)
+            resize (newNumSlots);
+    }
+
+    //==============================================================================
+    /** Returns the value corresponding to a given key.
+        If the map doesn't contain the key, a default instance of the value type is returned.
+    */
+    template <typename KeyTypeToLookFor>
+    ValueType operator[] (const KeyTypeToLookFor& keyToLookFor) const
+    {
+        const ScopedLockType sl (getLock());
+        const int slot = findSlot (keyToLookFor);
+        return slot >= 0 ? entries[slot].value : ValueType();
+    }
+
+    /** Returns a reference to the value corresponding to a given key.
+        If the map doesn't contain the key, a default instance of the value type is added first.
+        The reference is only valid until the map is next modified.
+    */
+    ValueType& getReference (KeyTypeParameter key)
+    {
+        const ScopedLockType sl (getLock());
+        int slot = findSlot (key);
+
+        if (slot < 0)
+            slot = insert (hashKey (key), key, ValueType());
+
+        return entries[slot].value;
+    }
+
+    /** Returns a pointer to the value corresponding to a given key, or nullptr if it's not there.
+        The pointer is only valid until the map is next modified.
+    */
+    template <typename KeyTypeToLookFor>
+    ValueType* getValuePointer (const KeyTypeToLookFor& keyToLookFor)
+    {
+        const ScopedLockType sl (getLock());
+        const int slot = findSlot (keyToLookFor);
+        return slot >= 0 ? &(entries[slot].value) : nullptr;
+    }
+
+    /** Returns a pointer to the value corresponding to a given key, or nullptr if it's not there.
+        The pointer is only valid until the map is next modified.
+    */
+    template <typename KeyTypeToLookFor>
+    const ValueType* getValuePointer (const KeyTypeToLookFor& keyToLookFor) const
+    {
+        const ScopedLockType sl (getLock());
+        const int slot = findSlot (keyToLookFor);
+        return slot >= 0 ? &(entries[slot].value) : nullptr;
+    }
+
+    /** Returns true if the map contains an item with the specied key. */
+    template <typename KeyTypeToLookFor>
+    bool contains (const KeyTypeToLookFor& keyToLookFor) const
+    {
+        const ScopedLockType sl (getLock());
+        return findSlot (keyToLookFor) >= 0;
+    }
+
+    /** Returns true if the map contains at least one occurrence of a given value. */
+    bool containsValue (ValueTypeParameter valueToLookFor) const
+    {
+        const ScopedLockType sl (getLock());
+
+        for (int i = 0; i < numSlots; ++i)
+            if (hashes[i] != 0 && entries[i].value == valueToLookFor)
+                return true;
+
+        return false;
+    }
+
+    //==============================================================================
+    /** Adds or replaces an element in the map.
+        If there's already an item with the given key, this will replace its value. Otherwise, a new item
+        will be added to the map.
+    */
+    void set (KeyTypeParameter newKey, ValueTypeParameter newValue)
+    {
+        const ScopedLockType sl (getLock());
+        const int slot = findSlot (newKey);
+
+        if (slot >= 0)
+            entries[slot].value = newValue;
+        else
+            insert (hashKey (newKey), newKey, newValue);
+    }
+
+    /** Removes the item with the given key, if there is one. */
+    template <typename KeyTypeToLookFor>
+    void remove (const KeyTypeToLookFor& keyToRemove)
+    {
+        const ScopedLockType sl (getLock());
+        const int slot = findSlot (keyToRemove);
+
+        if (slot >= 0)
+            removeSlot (slot);
+    }
+
+    /** Removes all items with the given value. */
+    void removeValue (ValueTypeParameter valueToRemove)
+    {
+        const ScopedLockType sl (getLock());
+
+        for (int i = 0; i < numSlots;)
+        {
+            // (removing an item can shift the next one back into this slot, so it needs re-checking)
+            if (hashes[i] != 0 && entries[i].value == valueToRemove)
+                removeSlot (i);
+            else
+                ++i;
+        }
+    }
+
+    //==============================================================================
+    /** Efficiently swaps the contents of two maps. */
+    void swapWith (FlatHashMap& otherHashMap) noexcept
+    {
+        const ScopedLockType lock1 (getLock());
+        const ScopedLockType lock2 (otherHashMap.getLock());
+
+        entries.swapWith (otherHashMap.entries);
+        hashes.swapWith (otherHashMap.hashes);
+        std::swap (numItems, otherHashMap.numItems);
+        std::swap (numSlots, otherHashMap.numSlots);
+    }
+
+    //==============================================================================
+    /** Returns the CriticalSection that locks this structure.
+        To lock, you can call getLock().enter() and getLock().exit(), or preferably use
+        an object of ScopedLockType as an RAII lock for it.
+    */
+    inline const TypeOfCriticalSectionToUse& getLock() const noexcept      { return lock; }
+
+    /** Returns the type of scoped lock to use for locking this array */
+    typedef typename TypeOfCriticalSectionToUse::ScopedLockType ScopedLockType;
+
+    //==============================================================================
+    /** Iterates over the items in a FlatHashMap.
+
+        To use it, repeatedly call next() until it returns false, e.g.
+        @code
+        FlatHashMap <String, String> myMap;
+
+        for (FlatHashMap<String, String>::Iterator i (myMap); i.next();)
+            DBG (i.getKey() << " -> " << i.getValue());
+        @endcode
+
+        The order in which items are iterated bears no resemblence to the order in which
+        they were originally added!
+
+        As soon as you call any non-const methods on the original map, any iterators that
+        were created beforehand will cease to be valid, and should not be used.
+
+        @see FlatHashMap
+    */
+    class Iterator
+    {
+    public:
+        //==============================================================================
+        Iterator (const FlatHashMap& hashMapToIterate) noexcept
+            : hashMap (hashMapToIterate), index (-1)
+        {}
+
+        /** Moves to the next item, if one is available.
+            When this returns true, you can get the item's key and value using getKey() and
+            getValue(). If it returns false, the iteration has finished and you should stop.
+        */
+        bool next() noexcept
+        {
+            while (++index < hashMap.numSlots)
+                if (hashMap.hashes[index] != 0)
+                    return true;
+
+            return false;
+        }
+
+        /** Returns the current item's key.
+            This should only be called when a call to next() has just returned true.
+        */
+        const KeyType& getKey() const noexcept
+        {
+            jassert (isPositiveAndBelow (index, hashMap.numSlots));
+            return hashMap.entries[index].key;
+        }
+
+        /** Returns the current item's value.
+            This should only be called when a call to next() has just returned true.
+        */
+        const ValueType& getValue() const noexcept
+        {
+            jassert (isPositiveAndBelow (index, hashMap.numSlots));
+            return hashMap.entries[index].value;
+        }
+
+    private:
+        //==============================================================================
+        const FlatHashMap& hashMap;
+        int index;
+
+        JUCE_DECLARE_NON_COPYABLE (Iterator)
+    };
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        Entry (KeyTypeParameter k, ValueTypeParameter v)  : key (k), value (v) {}
+
+        KeyType key;
+        ValueType value;
+    };
+
+    enum { minimumNumSlots = 16 };
+    friend class Iterator;
+
+    HeapBlock<Entry> entries;   // (only the slots with a non-zero hash contain a constructed Entry)
+    HeapBlock<uint32> hashes;
+    int numItems, numSlots;
+    TypeOfCriticalSectionToUse lock;
+
+    static int getMaxNumItems (const int numSlotsToUse) noexcept
+    {
+        return numSlotsToUse - numSlotsToUse / 8;
+    }
+
+    // A zero hash is used to mark an empty slot, so no key is allowed to have one.
+    template <typename KeyTypeToHash>
+    static uint32 hashKey (const KeyTypeToHash& key) noexcept
+    {
+        const uint32 hash = (uint32) HashFunctionToUse::generateHash (key);
+        return hash != 0 ? hash : 1;
+    }
+
+    // Returns how far the item with this hash has been placed from its ideal slot.
+    int getProbeDistance (const uint32 hash, const int slot) const noexcept
+    {
+        return (int) (((uint32) slot - hash) & (uint32) (numSlots - 1));
+    }
+
+    template <typename KeyTypeToLookFor>
+    int findSlot (const KeyTypeToLookFor& key) const
+    {
+        if (numItems == 0)
+            return -1;
+
+        const uint32 hash = hashKey (key);
+        const int mask = numSlots - 1;
+
+        for (int slot = (int) (hash & (uint32) mask), distance = 0;; slot = (slot + 1) & mask, ++distance)
+        {
+            const uint32 h = hashes[slot];
+
+            // (if this slot's item is closer to home than our key would be, our key can't be in the table)
+            if (h == 0 || distance > getProbeDistance (h, slot))
+                return -1;
+
+            if (h == hash && entries[slot].key == key)
+                return slot;
+        }
+    }
+
+    // Adds a key that's known not to be in the map, and returns the slot where it was put.
+    int insert (const uint32 hash, KeyTypeParameter key, ValueTypeParameter value)
+    {
+        if (numItems >= getMaxNumItems (numSlots))
+            resize (jmax ((int) minimumNumSlots, numSlots * 2));
+
+        return insertEntry (hash, Entry (key, value));
+    }
+
+    int insertEntry (uint32 hash, Entry entry)
+    {
+        const int mask = numSlots - 1;
+        int insertedSlot = -1;
+
+        for (int slot = (int) (hash & (uint32) mask), distance = 0;; slot = (slot + 1) & mask, ++distance)
+        {
+            const uint32 h = hashes[slot];
+
+            if (h == 0)
+            {
+                new (entries + slot) Entry (entry);
+                hashes[slot] = hash;
+                ++numItems;
+                return insertedSlot >= 0 ? insertedSlot : slot;
+            }
+
+            const int existingDistance = getProbeDistance (h, slot);
+
+            // Robin-hood: an item that's further from its home slot takes the place of one
+            // that's closer to its own, and the displaced item carries on looking.
+            if (existingDistance < distance)
+            {
+                std::swap (entry, entries[slot]);
+                std::swap (hash, hashes[slot]);
+                distance = existingDistance;
+
+                if (insertedSlot < 0)
+                    insertedSlot = slot;
+            }
+        }
+    }
+
+    // Removes an item, then shifts back any items that follow it until one is found
+    // that's already in its home slot.
+    void removeSlot (int slot)
+    {
+        const int mask = numSlots - 1;
+        entries[slot].~Entry();
+
+        for (;;)
+        {
+            const int next = (slot + 1) & mask;
+            const uint32 h = hashes[next];
+
+            if (h == 0 || getProbeDistance (h, next) == 0)
+                break;
+
+            new (entries + slot) Entry (entries[next]);
+            entries[next].~Entry();
+            hashes[slot] = h;
+            slot = next;
+        }
+
+        hashes[slot] = 0;
+        --numItems;
+    }
+
+    void resize (const int newNumSlots)
+    {
+        jassert (isPowerOfTwo (newNumSlots) && getMaxNumItems (newNumSlots) >= numItems);
+
+        HeapBlock<Entry> oldEntries;
+        HeapBlock<uint32> oldHashes;
+        oldEntries.swapWith (entries);
+        oldHashes.swapWith (hashes);
+        const int oldNumSlots = numSlots;
+
+        entries.malloc ((size_t) newNumSlots);
+        hashes.calloc ((size_t) newNumSlots);
+        numSlots = newNumSlots;
+        numItems = 0;
+
+        for (int i = 0; i < oldNumSlots; ++i)
+        {
+            if (oldHashes[i] != 0)
+            {
+                insertEntry (oldHashes[i], oldEntries[i]);
+                oldEntries[i].~Entry();
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FlatHashMap)
+};
+
+
+#endif   // __JUCE_FLATHASHMAP_JUCEHEADER__
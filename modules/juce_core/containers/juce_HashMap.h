@@ -34,20 +34,70 @@
 //==============================================================================
 /**
     A simple class to generate hash functions for some primitive types, intended for
-    use with the HashMap class.
-    @see HashMap
+    use with the HashMap and FlatHashMap classes.
+
+    The single-argument versions return a full-width hash whose bits are all well
+    mixed, so that any subset of them can be used as a table index. The int and int64
+    versions produce the same hash for the same numeric value, and the const char*
+    version produces the same hash as a String containing the same text.
+
+    @see HashMap, FlatHashMap
 */
 class DefaultHashFunctions
 {
 public:
     /** Generates a simple hash from an integer. */
-    static int generateHash (const int key, const int upperLimit) noexcept        { return std::abs (key) % upperLimit; }
+    static int generateHash (const int key, const int upperLimit) noexcept        { return (int) (generateHash (key) % (uint32) upperLimit); }
     /** Generates a simple hash from an int64. */
-    static int generateHash (const int64 key, const int upperLimit) noexcept      { return std::abs ((int) key) % upperLimit; }
+    static int generateHash (const int64 key, const int upperLimit) noexcept      { return (int) (generateHash (key) % (uint32) upperLimit); }
     /** Generates a simple hash from a string. */
-    static int generateHash (const String& key, const int upperLimit) noexcept    { return (int) (((uint32) key.hashCode()) % (uint32) upperLimit); }
+    static int generateHash (const String& key, const int upperLimit) noexcept    { return (int) (generateHash (key) % (uint32) upperLimit); }
     /** Generates a simple hash from a variant. */
     static int generateHash (const var& key, const int upperLimit) noexcept       { return generateHash (key.toString(), upperLimit); }
+
+    //==============================================================================
+    /** Generates a full-width hash from an integer. */
+    static uint32 generateHash (const int key) noexcept                           { return generateHash ((int64) key); }
+
+    /** Generates a full-width hash from an int64. */
+    static uint32 generateHash (const int64 key) noexcept
+    {
+        uint64 n = (uint64) key;
+        n ^= n >> 33;
+        n *= literal64bit (0xff51afd7ed558ccd);
+        n ^= n >> 33;
+        n *= literal64bit (0xc4ceb9fe1a85ec53);
+        n ^= n >> 33;
+        return (uint32) n;
+    }
+
+    /** Generates a full-width hash from a string. */
+    static uint32 generateHash (const String& key) noexcept                       { return mixBits ((uint32) key.hashCode()); }
+
+    /** Generates a full-width hash from a string, without needing to create a String object. */
+    static uint32 generateHash (const char* key) noexcept
+    {
+        uint32 n = 0;
+
+        for (CharPointer_UTF8 t (key); ! t.isEmpty();)
+            n = 31 * n + (uint32) t.getAndAdvance();
+
+        return mixBits (n);
+    }
+
+    /** Generates a full-width hash from a variant. */
+    static uint32 generateHash (const var& key) noexcept                          { return generateHash (key.toString()); }
+
+private:
+    static uint32 mixBits (uint32 n) noexcept
+    {
+        n ^= n >> 16;
+        n *= 0x85ebca6b;
+        n ^= n >> 13;
+        n *= 0xc2b2ae35;
+        n ^= n >> 16;
+        return n;
+    }
 };
 
 
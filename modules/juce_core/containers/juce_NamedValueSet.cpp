@@ -46,8 +46,7 @@ NamedValueSet::NamedValue& NamedValueSet::NamedValue::operator= (const NamedValu
 
 #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
 NamedValueSet::NamedValue::NamedValue (NamedValue&& other) noexcept
-    : nextListItem (static_cast <LinkedListPointer<NamedValue>&&> (other.nextListItem)),
-      name (static_cast <Identifier&&> (other.name)),
+    : name (static_cast <Identifier&&> (other.name)),
       value (static_cast <var&&> (other.value))
 {
 }
@@ -59,7 +58,6 @@ inline NamedValueSet::NamedValue::NamedValue (const Identifier& n, var&& v)
 
 NamedValueSet::NamedValue& NamedValueSet::NamedValue::operator= (NamedValue&& other) noexcept
 {
-    nextListItem = static_cast <LinkedListPointer<NamedValue>&&> (other.nextListItem);
     name = static_cast <Identifier&&> (other.name);
     value = static_cast <var&&> (other.value);
     return *this;
@@ -71,61 +69,74 @@ bool NamedValueSet::NamedValue::operator== (const NamedValueSet::NamedValue& oth
     return name == other.name && value == other.value;
 }
 
+//==============================================================================
+// Maps each name to its position in the values array. Identifiers are pooled, so
+// the name's string pointer is all that needs to be hashed.
+class NamedValueSet::Index
+{
+public:
+    Index() noexcept {}
+
+    struct IdentifierHash
+    {
+        static uint32 generateHash (const Identifier& name) noexcept
+        {
+            return DefaultHashFunctions::generateHash ((int64) (pointer_sized_int) name.getCharPointer().getAddress());
+        }
+    };
+
+    FlatHashMap<Identifier, int, IdentifierHash> positions;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (Index)
+};
+
 //==============================================================================
 NamedValueSet::NamedValueSet() noexcept
 {
 }
 
 NamedValueSet::NamedValueSet (const NamedValueSet& other)
+    : values (other.values)
 {
-    values.addCopyOfList (other.values);
+    updateIndex();
 }
 
 NamedValueSet& NamedValueSet::operator= (const NamedValueSet& other)
 {
-    clear();
-    values.addCopyOfList (other.values);
+    values = other.values;
+    updateIndex();
     return *this;
 }
 
 #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
 NamedValueSet::NamedValueSet (NamedValueSet&& other) noexcept
-    : values (static_cast <LinkedListPointer<NamedValue>&&> (other.values))
+    : values (static_cast <Array<NamedValue>&&> (other.values))
 {
+    hashIndex.swapWith (other.hashIndex);
 }
 
 NamedValueSet& NamedValueSet::operator= (NamedValueSet&& other) noexcept
 {
-    other.values.swapWith (values);
+    other.values.swapWithArray (values);
+    other.hashIndex.swapWith (hashIndex);
     return *this;
 }
 #endif
 
 NamedValueSet::~NamedValueSet()
 {
-    clear();
 }
 
 void NamedValueSet::clear()
 {
-    values.deleteAll();
+    values.clear();
+    hashIndex = nullptr;
 }
 
 bool NamedValueSet::operator== (const NamedValueSet& other) const
 {
-    const NamedValue* i1 = values;
-    const NamedValue* i2 = other.values;
-
-    while (i1 != nullptr && i2 != nullptr)
-    {
-        if (! (*i1 == *i2))
-            return false;
-
-        i1 = i1->nextListItem;
-        i2 = i2->nextListItem;
-    }
-
-    return true;
+    return values == other.values;
 }
 
 bool NamedValueSet::operator!= (const NamedValueSet& other) const
@@ -138,11 +149,55 @@ int NamedValueSet::size() const noexcept
     return values.size();
 }
 
+int NamedValueSet::indexOf (const Identifier& name) const noexcept
+{
+    if (hashIndex != nullptr)
+    {
+        const int* const position = hashIndex->positions.getValuePointer (name);
+        return position != nullptr ? *position : -1;
+    }
+
+    const NamedValue* const v = values.begin();
+
+    for (int i = 0; i < values.size(); ++i)
+        if (v[i].name == name)
+            return i;
+
+    return -1;
+}
+
+void NamedValueSet::updateIndex()
+{
+    if (values.size() <= indexThreshold)
+    {
+        hashIndex = nullptr;
+        return;
+    }
+
+    if (hashIndex == nullptr)
+        hashIndex = new Index();
+
+    hashIndex->positions.clear();
+    hashIndex->positions.ensureStorageAllocated (values.size());
+
+    for (int i = 0; i < values.size(); ++i)
+        hashIndex->positions.set (values.getReference (i).name, i);
+}
+
+void NamedValueSet::indexNewValue()
+{
+    const int newPosition = values.size() - 1;
+
+    if (hashIndex != nullptr)
+        hashIndex->positions.set (values.getReference (newPosition).name, newPosition);
+    else if (values.size() > indexThreshold)
+        updateIndex();
+}
+
 const var& NamedValueSet::operator[] (const Identifier& name) const
 {
-    for (NamedValue* i = values; i != nullptr; i = i->nextListItem)
-        if (i->name == name)
-            return i->value;
+    if (const var* const v = getVarPointer (name))
+        return *v;
 
     return var::null;
 }
@@ -157,111 +212,89 @@ var NamedValueSet::getWithDefault (const Identifier& name, const var& defaultRet
 
 var* NamedValueSet::getVarPointer (const Identifier& name) const noexcept
 {
-    for (NamedValue* i = values; i != nullptr; i = i->nextListItem)
-        if (i->name == name)
-            return &(i->value);
-
-    return nullptr;
+    const int i = indexOf (name);
+    return i >= 0 ? &(values.getReference (i).value) : nullptr;
 }
 
 #if JUCE_COMPILER_SUPPORTS_MOVE_SEMANTICS
 bool NamedValueSet::set (const Identifier& name, var&& newValue)
 {
-    LinkedListPointer<NamedValue>* i = &values;
-
-    while (i->get() != nullptr)
+    if (var* const v = getVarPointer (name))
     {
-        NamedValue* const v = i->get();
-
-        if (v->name == name)
-        {
-            if (v->value.equalsWithSameType (newValue))
-                return false;
-
-            v->value = static_cast <var&&> (newValue);
-            return true;
-        }
+        if (v->equalsWithSameType (newValue))
+            return false;
 
-        i = &(v->nextListItem);
+        *v = static_cast <var&&> (newValue);
+        return true;
     }
 
-    i->insertNext (new NamedValue (name, static_cast <var&&> (newValue)));
+    values.add (NamedValue());
+    NamedValue& nv = values.getReference (values.size() - 1);
+    nv.name = name;
+    nv.value = static_cast <var&&> (newValue);
+
+    indexNewValue();
     return true;
 }
 #endif
 
 bool NamedValueSet::set (const Identifier& name, const var& newValue)
 {
-    LinkedListPointer<NamedValue>* i = &values;
-
-    while (i->get() != nullptr)
+    if (var* const v = getVarPointer (name))
     {
-        NamedValue* const v = i->get();
-
-        if (v->name == name)
-        {
-            if (v->value.equalsWithSameType (newValue))
-                return false;
-
-            v->value = newValue;
-            return true;
-        }
+        if (v->equalsWithSameType (newValue))
+            return false;
 
-        i = &(v->nextListItem);
+        *v = newValue;
+        return true;
     }
 
-    i->insertNext (new NamedValue (name, newValue));
+    values.add (NamedValue (name, newValue));
+    indexNewValue();
     return true;
 }
 
 bool NamedValueSet::contains (const Identifier& name) const
 {
-    return getVarPointer (name) != nullptr;
+    return indexOf (name) >= 0;
 }
 
 bool NamedValueSet::remove (const Identifier& name)
 {
-    LinkedListPointer<NamedValue>* i = &values;
+    const int i = indexOf (name);
 
-    for (;;)
-    {
-        NamedValue* const v = i->get();
+    if (i < 0)
+        return false;
 
-        if (v == nullptr)
-            break;
+    values.remove (i);
 
-        if (v->name == name)
-        {
-            delete i->removeNext();
-            return true;
-        }
-
-        i = &(v->nextListItem);
-    }
+    // (removing from the end doesn't move any other values, so only that name needs unindexing)
+    if (hashIndex != nullptr && i == values.size() && values.size() > indexThreshold)
+        hashIndex->positions.remove (name);
+    else
+        updateIndex();
 
-    return false;
+    return true;
 }
 
 const Identifier NamedValueSet::getName (const int index) const
 {
-    const NamedValue* const v = values[index];
-    jassert (v != nullptr);
-    return v->name;
+    jassert (isPositiveAndBelow (index, values.size()));
+    return values.getReference (index).name;
 }
 
 const var& NamedValueSet::getValueAt (const int index) const
 {
-    const NamedValue* const v = values[index];
-    jassert (v != nullptr);
-    return v->value;
+    jassert (isPositiveAndBelow (index, values.size()));
+    return values.getReference (index).value;
 }
 
 void NamedValueSet::setFromXmlAttributes (const XmlElement& xml)
 {
     clear();
-    LinkedListPointer<NamedValue>::Appender appender (values);
 
     const int numAtts = xml.getNumAttributes(); // xxx inefficient - should write an att iterator..
+    values.ensureStorageAllocated (numAtts);
 
     for (int i = 0; i < numAtts; ++i)
     {
@@ -274,33 +307,136 @@ void NamedValueSet::setFromXmlAttributes (const XmlElement& xml)
 
             if (mb.fromBase64Encoding (value))
             {
-                appender.append (new NamedValue (name.substring (7), var (mb)));
+                values.add (NamedValue (name.substring (7), var (mb)));
                 continue;
             }
         }
 
-        appender.append (new NamedValue (name, var (value)));
+        values.add (NamedValue (name, var (value)));
     }
+
+    updateIndex();
 }
 
 void NamedValueSet::copyToXmlAttributes (XmlElement& xml) const
 {
-    for (NamedValue* i = values; i != nullptr; i = i->nextListItem)
+    for (int i = 0; i < values.size(); ++i)
     {
-        if (const MemoryBlock* mb = i->value.getBinaryData())
+        const NamedValue& v = values.getReference (i);
+
+        if (const MemoryBlock* mb = v.value.getBinaryData())
         {
-            xml.setAttribute ("base64:" + i->name.toString(),
+            xml.setAttribute ("base64:" + v.name.toString(),
                               mb->toBase64Encoding());
         }
         else
         {
             // These types can't be stored as XML!
-            jassert (! i->value.isObject());
-            jassert (! i->value.isMethod());
-            jassert (! i->value.isArray());
+            jassert (! v.value.isObject());
+            jassert (! v.value.isMethod());
+            jassert (! v.value.isArray());
 
-            xml.setAttribute (i->name.toString(),
-                              i->value.toString());
+            xml.setAttribute (v.name.toString(),
+                              v.value.toString());
         }
     }
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class NamedValueSetTests  : public UnitTest
+{
+public:
+    NamedValueSetTests() : UnitTest ("NamedValueSet") {}
+
+    static Identifier getName (const int i)
+    {
+        return Identifier ("prop" + String (i));
+    }
+
+    bool setMatches (const NamedValueSet& set, const Array<int>& names)
+    {
+        if (set.size() != names.size())
+            return false;
+
+        for (int i = 0; i < names.size(); ++i)
+        {
+            const Identifier name (getName (names.getUnchecked (i)));
+
+            if (set.getName (i) != name
+                 || (int) set.getValueAt (i) != names.getUnchecked (i)
+                 || (int) set [name] != names.getUnchecked (i)
+                 || ! set.contains (name))
+                return false;
+        }
+
+        return true;
+    }
+
+    void runTest()
+    {
+        beginTest ("Adding and removing");
+        {
+            Random r (0x5678);
+            NamedValueSet set;
+            Array<int> names;   // (the names that should be in the set, in order)
+
+            for (int i = 0; i < 20000; ++i)
+            {
+                // (keeps the size wandering back and forth across the point where it gets indexed)
+                const int n = r.nextInt (40);
+                const Identifier name (getName (n));
+
+                if (r.nextBool())
+                {
+                    expect (set.set (name, n) == ! names.contains (n));
+                    names.addIfNotAlreadyThere (n);
+                }
+                else
+                {
+                    expect (set.remove (name) == names.contains (n));
+                    names.removeFirstMatchingValue (n);
+                }
+
+                expect (! set.contains (getName (n + 100)));
+
+                if (i % 100 == 0)
+                    expect (setMatches (set, names));
+            }
+
+            const NamedValueSet copy (set);
+            expect (copy == set);
+            expect (setMatches (copy, names));
+
+            set.set ("extra", var::null);
+            expect (copy != set);
+
+            set.clear();
+            expectEquals (set.size(), 0);
+            expect (set [getName (names.getFirst())].isVoid());
+        }
+
+        beginTest ("Changing values");
+        {
+            NamedValueSet set;
+
+            for (int i = 0; i < 50; ++i)
+                set.set (getName (i), i);
+
+            expect (! set.set (getName (10), 10));
+            expect (set.set (getName (10), "10"));
+            expect (set.set (getName (10), 11));
+
+            var* const v = set.getVarPointer (getName (49));
+            expect (v != nullptr && (int) *v == 49);
+            expectEquals ((int) set.getWithDefault (getName (10), 0), 11);
+            expectEquals ((int) set.getWithDefault (getName (50), 123), 123);
+            expectEquals (set.size(), 50);
+        }
+    }
+};
+
+static NamedValueSetTests namedValueSetTests;
+
+#endif
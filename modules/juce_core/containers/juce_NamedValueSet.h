@@ -27,11 +27,9 @@
 #define __JUCE_NAMEDVALUESET_JUCEHEADER__
 
 #include "juce_Variant.h"
-#include "../containers/juce_LinkedListPointer.h"
+#include "juce_Array.h"
+#include "../memory/juce_ScopedPointer.h"
 class XmlElement;
-#ifndef DOXYGEN
- class JSONFormatter;
-#endif
 
 
 //==============================================================================
@@ -39,6 +37,11 @@ class XmlElement;
 
     This can be used as a basic structure to hold a set of var object, which can
     be retrieved by using their identifier.
+
+    The values are kept in a contiguous array in the order in which they were added,
+    and are looked up by comparing their Identifier pointers. A set that grows beyond
+    a handful of values also builds a hash index of its names, so that looking up or
+    changing a value in a large set doesn't involve a linear search.
 */
 class JUCE_API  NamedValueSet
 {
@@ -102,7 +105,8 @@ public:
     bool remove (const Identifier& name);
 
     /** Returns the name of the value at a given index.
-        The index must be between 0 and size() - 1.
+        The index must be between 0 and size() - 1. Values are kept in the order in
+        which they were added.
     */
     const Identifier getName (int index) const;
 
@@ -120,6 +124,9 @@ public:
 
         Do not use this method unless you really need access to the internal var object
         for some reason - for normal reading and writing always prefer operator[]() and set().
+
+        The pointer that is returned is only valid until the next time a value is added to
+        or removed from the set.
     */
     var* getVarPointer (const Identifier& name) const noexcept;
 
@@ -148,18 +155,23 @@ private:
        #endif
         bool operator== (const NamedValue& other) const noexcept;
 
-        LinkedListPointer<NamedValue> nextListItem;
         Identifier name;
         var value;
-
-    private:
-        JUCE_LEAK_DETECTOR (NamedValue)
     };
 
-    friend class LinkedListPointer<NamedValue>;
-    LinkedListPointer<NamedValue> values;
+    class Index;
+    friend class Index;
+
+    Array<NamedValue> values;
+    ScopedPointer<Index> hashIndex;  // (only created once the set has more than indexThreshold values)
+
+    enum { indexThreshold = 16 };
+
+    int indexOf (const Identifier& name) const noexcept;
+    void indexNewValue();
+    void updateIndex();
 
-    friend class JSONFormatter;
+    JUCE_LEAK_DETECTOR (NamedValueSet)
 };
 
 
@@ -457,23 +457,18 @@ private:
         if (! allOnOneLine)
             out << newLine;
 
-        LinkedListPointer<NamedValueSet::NamedValue>* i = &(props.values);
+        const int numProps = props.size();
 
-        for (;;)
+        for (int i = 0; i < numProps; ++i)
         {
-            NamedValueSet::NamedValue* const v = i->get();
-
-            if (v == nullptr)
-                break;
-
             if (! allOnOneLine)
                 writeSpaces (out, indentLevel + indentSize);
 
-            writeString (out, v->name);
+            writeString (out, props.getName (i));
             out << ": ";
-            write (out, v->value, indentLevel + indentSize, allOnOneLine);
+            write (out, props.getValueAt (i), indentLevel + indentSize, allOnOneLine);
 
-            if (v->nextListItem.get() != nullptr)
+            if (i < numProps - 1)
             {
                 if (allOnOneLine)
                     out << ", ";
@@ -482,8 +477,6 @@ private:
             }
             else if (! allOnOneLine)
                 out << newLine;
-
-            i = &(v->nextListItem);
         }
 
         if (! allOnOneLine)
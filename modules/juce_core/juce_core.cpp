@@ -108,6 +108,7 @@ namespace juce
 
 #include "containers/juce_AbstractFifo.cpp"
 #include "containers/juce_DynamicObject.cpp"
+#include "containers/juce_FlatHashMap.cpp"
 #include "containers/juce_NamedValueSet.cpp"
 #include "containers/juce_PropertySet.cpp"
 #include "containers/juce_Variant.cpp"
@@ -163,6 +163,9 @@ namespace juce
 #ifndef __JUCE_ELEMENTCOMPARATOR_JUCEHEADER__
  #include "containers/juce_ElementComparator.h"
 #endif
+#ifndef __JUCE_FLATHASHMAP_JUCEHEADER__
+ #include "containers/juce_FlatHashMap.h"
+#endif
 #ifndef __JUCE_HASHMAP_JUCEHEADER__
  #include "containers/juce_HashMap.h"
 #endif
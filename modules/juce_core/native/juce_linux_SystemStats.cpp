@@ -138,6 +138,9 @@ SystemStats::CPUFlags::CPUFlags()
     hasSSE   = flags.contains ("sse");
     hasSSE2  = flags.contains ("sse2");
     has3DNow = flags.contains ("3dnow");
+    hasAVX   = flags.containsWholeWord ("avx");
+    hasAVX2  = flags.containsWholeWord ("avx2");
+    hasFMA   = flags.containsWholeWord ("fma");
 
     numCpus = LinuxStatsHelpers::getCpuInfo ("processor").getIntValue() + 1;
 }
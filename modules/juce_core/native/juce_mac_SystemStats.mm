@@ -62,6 +62,13 @@ namespace SystemStatsHelpers
 
         a = la; b = lb; c = lc; d = ld;
     }
+
+    static uint64 getXCR0()
+    {
+        uint32 lo = 0, hi = 0;
+        asm (".byte 0x0f, 0x01, 0xd0" : "=a" (lo), "=d" (hi) : "c" (0)); // (xgetbv)
+        return (((uint64) hi) << 32) | lo;
+    }
    #endif
 }
 
@@ -76,11 +83,37 @@ SystemStats::CPUFlags::CPUFlags()
     hasSSE   = (features    & (1u << 25)) != 0;
     hasSSE2  = (features    & (1u << 26)) != 0;
     has3DNow = (extFeatures & (1u << 31)) != 0;
+
+    // AVX also needs the OS to be saving the YMM registers, which XGETBV tells us
+    const bool osSavesYMMRegisters = (dummy & (1u << 27)) != 0 && (SystemStatsHelpers::getXCR0() & 6) == 6;
+
+    hasAVX  = osSavesYMMRegisters && (dummy & (1u << 28)) != 0;
+    hasFMA  = hasAVX && (dummy & (1u << 12)) != 0;
+    hasAVX2 = false;
+
+   #if JUCE_64BIT // (the sub-leaf in ecx is only passed to cpuid in 64-bit builds)
+    if (hasAVX)
+    {
+        uint32 maxLeaf = 0, b = 0, c = 0, d = 0;
+        SystemStatsHelpers::doCPUID (maxLeaf, b, c, d, 0);
+
+        if (maxLeaf >= 7)
+        {
+            uint32 a = 0;
+            b = c = d = 0;
+            SystemStatsHelpers::doCPUID (a, b, c, d, 7);
+            hasAVX2 = (b & (1u << 5)) != 0;
+        }
+    }
+   #endif
    #else
     hasMMX = false;
     hasSSE = false;
     hasSSE2 = false;
     has3DNow = false;
+    hasAVX = false;
+    hasAVX2 = false;
+    hasFMA = false;
    #endif
 
    #if JUCE_IOS || (MAC_OS_X_VERSION_MIN_REQUIRED >= MAC_OS_X_VERSION_10_5)
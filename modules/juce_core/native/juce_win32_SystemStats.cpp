@@ -101,6 +101,32 @@ String SystemStats::getCpuVendor()
 
 
 //==============================================================================
+static void juce_getAVXFlags (bool& hasAVX, bool& hasAVX2, bool& hasFMA)
+{
+    hasAVX = hasAVX2 = hasFMA = false;
+
+   #if JUCE_USE_INTRINSICS && _MSC_FULL_VER >= 160040219 // (_xgetbv needs VC2010 SP1)
+    int info [4];
+    __cpuid (info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid (info, 1);
+
+    // AVX also needs the OS to be saving the YMM registers, which XGETBV tells us
+    if ((info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv (0) & 6) == 6)
+    {
+        hasAVX = true;
+        hasFMA = (info[2] & (1 << 12)) != 0;
+
+        if (maxLeaf >= 7)
+        {
+            __cpuidex (info, 7, 0);
+            hasAVX2 = (info[1] & (1 << 5)) != 0;
+        }
+    }
+   #endif
+}
+
 SystemStats::CPUFlags::CPUFlags()
 {
     hasMMX   = IsProcessorFeaturePresent (PF_MMX_INSTRUCTIONS_AVAILABLE) != 0;
@@ -112,6 +138,12 @@ SystemStats::CPUFlags::CPUFlags()
     has3DNow = IsProcessorFeaturePresent (PF_3DNOW_INSTRUCTIONS_AVAILABLE) != 0;
    #endif
 
+    bool avx, avx2, fma;
+    juce_getAVXFlags (avx, avx2, fma);
+    hasAVX  = avx;
+    hasAVX2 = avx2;
+    hasFMA  = fma;
+
     SYSTEM_INFO systemInfo;
     GetNativeSystemInfo (&systemInfo);
     numCpus = (int) systemInfo.dwNumberOfProcessors;
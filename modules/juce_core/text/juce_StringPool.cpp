@@ -23,57 +23,133 @@
   ==============================================================================
 */
 
-StringPool::StringPool() noexcept   {}
-StringPool::~StringPool()           {}
-
 namespace StringPoolHelpers
 {
-    template <class StringType>
-    String::CharPointerType getPooledStringFromArray (Array<String>& strings,
-                                                      StringType newString,
-                                                      const CriticalSection& lock)
+    enum { numStripesLog2 = 5 };
+
+    template <class CharPointerType>
+    static uint32 calculateHash (CharPointerType text) noexcept
+    {
+        uint32 n = 0;
+
+        while (const juce_wchar c = text.getAndAdvance())
+            n = n * 31 + (uint32) c;
+
+        // (mix the bits so that both the top and bottom bits are usable)
+        n ^= n >> 16;
+        n *= 0x85ebca6b;
+        n ^= n >> 13;
+        n *= 0xc2b2ae35;
+        n ^= n >> 16;
+        return n;
+    }
+}
+
+//==============================================================================
+/*  Each stripe is an open-addressed hash table of indexes into its own list of strings,
+    and has its own lock. The top bits of a string's hash choose the stripe, and the bottom
+    bits choose its slot.
+*/
+class StringPool::Stripe
+{
+public:
+    Stripe() noexcept  : numSlots (0) {}
+
+    template <class StringType, class CharPointerType>
+    String::CharPointerType getPooled (const StringType& original, CharPointerType text, const uint32 hash)
     {
         const ScopedLock sl (lock);
-        int start = 0;
-        int end = strings.size();
 
-        for (;;)
+        if (numSlots > 0)
         {
-            if (start >= end)
+            for (int slot = (int) (hash & (uint32) (numSlots - 1));; slot = (slot + 1) & (numSlots - 1))
             {
-                jassert (start <= end);
-                strings.insert (start, newString);
-                return strings.getReference (start).getCharPointer();
-            }
-            else
-            {
-                const String& startString = strings.getReference (start);
-
-                if (startString == newString)
-                    return startString.getCharPointer();
+                const int index = slots[slot];
 
-                const int halfway = (start + end) >> 1;
+                if (index < 0)
+                    break;
 
-                if (halfway == start)
+                if (hashes.getUnchecked (index) == hash)
                 {
-                    if (startString.compare (newString) < 0)
-                        ++start;
+                    const String& s = strings.getReference (index);
 
-                    strings.insert (start, newString);
-                    return strings.getReference (start).getCharPointer();
+                    if (s.getCharPointer().compare (text) == 0)
+                        return s.getCharPointer();
                 }
-
-                const int comp = strings.getReference (halfway).compare (newString);
-
-                if (comp == 0)
-                    return strings.getReference (halfway).getCharPointer();
-                else if (comp < 0)
-                    start = halfway;
-                else
-                    end = halfway;
             }
         }
+
+        if ((strings.size() + 1) * 4 > numSlots * 3)
+            resize (jmax (64, numSlots * 2));
+
+        const int index = strings.size();
+        strings.add (String (original));
+        hashes.add (hash);
+        insertIntoSlots (index);
+
+        return strings.getReference (index).getCharPointer();
+    }
+
+    int size() const noexcept
+    {
+        const ScopedLock sl (lock);
+        return strings.size();
+    }
+
+    String::CharPointerType getString (const int index) const noexcept
+    {
+        const ScopedLock sl (lock);
+        return strings [index].getCharPointer();
     }
+
+private:
+    CriticalSection lock;
+    Array<String> strings;
+    Array<uint32> hashes;
+    HeapBlock<int> slots;
+    int numSlots;
+
+    void insertIntoSlots (const int index) noexcept
+    {
+        int slot = (int) (hashes.getUnchecked (index) & (uint32) (numSlots - 1));
+
+        while (slots[slot] >= 0)
+            slot = (slot + 1) & (numSlots - 1);
+
+        slots[slot] = index;
+    }
+
+    void resize (const int newNumSlots)
+    {
+        slots.malloc ((size_t) newNumSlots);
+        numSlots = newNumSlots;
+
+        for (int i = 0; i < numSlots; ++i)
+            slots[i] = -1;
+
+        for (int i = 0; i < strings.size(); ++i)
+            insertIntoSlots (i);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Stripe)
+};
+
+//==============================================================================
+StringPool::StringPool()
+{
+    for (int i = 0; i < (1 << StringPoolHelpers::numStripesLog2); ++i)
+        stripes.add (new Stripe());
+}
+
+StringPool::~StringPool() {}
+
+template <class StringType, class CharPointerType>
+String::CharPointerType StringPool::getPooled (const StringType& original, CharPointerType text)
+{
+    const uint32 hash = StringPoolHelpers::calculateHash (text);
+
+    return stripes.getUnchecked ((int) (hash >> (32 - StringPoolHelpers::numStripesLog2)))
+                ->getPooled (original, text, hash);
 }
 
 String::CharPointerType StringPool::getPooledString (const String& s)
@@ -81,7 +157,7 @@ String::CharPointerType StringPool::getPooledString (const String& s)
     if (s.isEmpty())
         return String::empty.getCharPointer();
 
-    return StringPoolHelpers::getPooledStringFromArray (strings, s, lock);
+    return getPooled (s, s.getCharPointer());
 }
 
 String::CharPointerType StringPool::getPooledString (const char* const s)
@@ -89,7 +165,7 @@ String::CharPointerType StringPool::getPooledString (const char* const s)
     if (s == nullptr || *s == 0)
         return String::empty.getCharPointer();
 
-    return StringPoolHelpers::getPooledStringFromArray (strings, s, lock);
+    return getPooled (s, CharPointer_ASCII (s));
 }
 
 String::CharPointerType StringPool::getPooledString (const wchar_t* const s)
@@ -97,15 +173,169 @@ String::CharPointerType StringPool::getPooledString (const wchar_t* const s)
     if (s == nullptr || *s == 0)
         return String::empty.getCharPointer();
 
-    return StringPoolHelpers::getPooledStringFromArray (strings, s, lock);
+    return getPooled (s, castToCharPointer_wchar_t (s));
 }
 
 int StringPool::size() const noexcept
 {
-    return strings.size();
+    int total = 0;
+
+    for (int i = 0; i < stripes.size(); ++i)
+        total += stripes.getUnchecked(i)->size();
+
+    return total;
 }
 
-String::CharPointerType StringPool::operator[] (const int index) const noexcept
+String::CharPointerType StringPool::operator[] (int index) const noexcept
 {
-    return strings [index].getCharPointer();
+    for (int i = 0; i < stripes.size(); ++i)
+    {
+        const Stripe* const stripe = stripes.getUnchecked(i);
+        const int stripeSize = stripe->size();
+
+        if (isPositiveAndBelow (index, stripeSize))
+            return stripe->getString (index);
+
+        index -= stripeSize;
+    }
+
+    return String::empty.getCharPointer();
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class StringPoolTests  : public UnitTest
+{
+public:
+    StringPoolTests() : UnitTest ("StringPool") {}
+
+    static String getTestString (const int n)
+    {
+        return "identifier_" + String (n * 7919) + "_" + String (n);
+    }
+
+    class PoolingThread  : public Thread
+    {
+    public:
+        PoolingThread (StringPool& pool_, const StringArray& names_, const int numIterations_)
+            : Thread ("StringPool test"), pool (pool_), names (names_),
+              numIterations (numIterations_), results ((size_t) names_.size())
+        {
+        }
+
+        void run()
+        {
+            for (int j = 0; j < numIterations; ++j)
+                for (int i = 0; i < names.size(); ++i)
+                    results[i] = pool.getPooledString (names[i]);
+        }
+
+        StringPool& pool;
+        const StringArray& names;
+        const int numIterations;
+        HeapBlock<String::CharPointerType> results;
+    };
+
+    void runTest()
+    {
+        beginTest ("Pooling");
+        {
+            StringPool pool;
+            const int numStrings = 10000;
+            Array<String::CharPointerType> pooled;
+
+            expect (pool.getPooledString (String::empty) == String::empty.getCharPointer());
+            expect (pool.getPooledString ((const char*) nullptr) == String::empty.getCharPointer());
+            expectEquals (pool.size(), 0);
+
+            for (int i = 0; i < numStrings; ++i)
+                pooled.add (pool.getPooledString (getTestString (i)));
+
+            expectEquals (pool.size(), numStrings);
+
+            for (int i = 0; i < numStrings; ++i)
+            {
+                const String s (getTestString (i));
+                expect (pooled.getReference (i) == pool.getPooledString (s));
+                expect (pooled.getReference (i) == pool.getPooledString (s.toUTF8().getAddress()));
+                expect (pooled.getReference (i) == pool.getPooledString (s.toWideCharPointer()));
+                expect (String (pooled.getReference (i)) == s);
+            }
+
+            expectEquals (pool.size(), numStrings);
+
+            StringArray all;
+
+            for (int i = 0; i < pool.size(); ++i)
+                all.add (String (pool[i]));
+
+            all.sort (false);
+            all.removeDuplicates (false);
+            expectEquals (all.size(), numStrings);
+        }
+
+        beginTest ("Threads");
+        {
+            StringPool pool;
+            StringArray names;
+
+            for (int i = 0; i < 2000; ++i)
+                names.add (getTestString (i));
+
+            OwnedArray<PoolingThread> threads;
+
+            for (int i = 0; i < 4; ++i)
+                threads.add (new PoolingThread (pool, names, 10));
+
+            for (int i = 0; i < threads.size(); ++i)
+                threads.getUnchecked(i)->startThread();
+
+            for (int i = 0; i < threads.size(); ++i)
+                threads.getUnchecked(i)->waitForThreadToExit (-1);
+
+            expectEquals (pool.size(), names.size());
+
+            for (int i = 0; i < names.size(); ++i)
+                for (int j = 0; j < threads.size(); ++j)
+                    expect (threads.getUnchecked(j)->results[i] == pool.getPooledString (names[i]));
+        }
+
+        beginTest ("Performance");
+        {
+            StringArray names;
+
+            for (int i = 0; i < 100000; ++i)
+                names.add (getTestString (i));
+
+            for (int numThreads = 1; numThreads <= 8; numThreads *= 2)
+            {
+                StringPool pool;
+                OwnedArray<PoolingThread> threads;
+                const int numIterations = 4;
+
+                for (int i = 0; i < numThreads; ++i)
+                    threads.add (new PoolingThread (pool, names, numIterations));
+
+                const int64 start = Time::getHighResolutionTicks();
+
+                for (int i = 0; i < threads.size(); ++i)
+                    threads.getUnchecked(i)->startThread();
+
+                for (int i = 0; i < threads.size(); ++i)
+                    threads.getUnchecked(i)->waitForThreadToExit (-1);
+
+                const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+                const int numLookups = numThreads * numIterations * names.size();
+                expectEquals (pool.size(), names.size());
+
+                logMessage (String (numThreads) + " threads: " + String (numLookups) + " lookups in "
+                              + String (elapsed * 1000.0, 1) + "ms (" + String ((int) (numLookups / elapsed)) + " lookups/sec)");
+            }
+        }
+    }
+};
+
+static StringPoolTests stringPoolTests;
+
+#endif
@@ -27,7 +27,7 @@
 #define __JUCE_STRINGPOOL_JUCEHEADER__
 
 #include "juce_String.h"
-#include "../containers/juce_Array.h"
+#include "../containers/juce_OwnedArray.h"
 
 
 //==============================================================================
@@ -40,13 +40,17 @@
     is returned every time a matching string is asked for. This means that it's trivial to
     compare two pooled strings for equality, as you can simply compare their pointers. It
     also cuts down on storage if you're using many copies of the same string.
+
+    The strings are kept in a hash table which is split into a number of independently-locked
+    sections, so looking up a string that's already in the pool takes constant time, and
+    several threads can use the same pool without contending for a single lock.
 */
 class JUCE_API  StringPool
 {
 public:
     //==============================================================================
     /** Creates an empty pool. */
-    StringPool() noexcept;
+    StringPool();
 
     /** Destructor */
     ~StringPool();
@@ -80,12 +84,20 @@ public:
     /** Returns the number of strings in the pool. */
     int size() const noexcept;
 
-    /** Returns one of the strings in the pool, by index. */
+    /** Returns one of the strings in the pool, by index.
+        The strings aren't kept in any particular order.
+    */
     String::CharPointerType operator[] (int index) const noexcept;
 
 private:
-    Array <String> strings;
-    CriticalSection lock;
+    //==============================================================================
+    class Stripe;
+    OwnedArray<Stripe> stripes;
+
+    template <class StringType, class CharPointerType>
+    String::CharPointerType getPooled (const StringType&, CharPointerType);
+
+    JUCE_DECLARE_NON_COPYABLE (StringPool)
 };
 
 
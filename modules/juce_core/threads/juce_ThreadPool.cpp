@@ -28,7 +28,8 @@ ThreadPoolJob::ThreadPoolJob (const String& name)
       pool (nullptr),
       shouldStop (false),
       isActive (false),
-      shouldBeDeleted (false)
+      shouldBeDeleted (false),
+      priority (ThreadPool::normalPriority)
 {
 }
 
@@ -54,12 +55,199 @@ void ThreadPoolJob::signalJobShouldExit()
     shouldStop = true;
 }
 
+//==============================================================================
+ThreadPool::JobHandle::JobHandle()
+    : finishedEvent (true)
+{
+}
+
+ThreadPool::JobHandle::~JobHandle()
+{
+}
+
+bool ThreadPool::JobHandle::isFinished() const noexcept
+{
+    return finished.get() != 0;
+}
+
+bool ThreadPool::JobHandle::wasCancelled() const noexcept
+{
+    return cancelled.get() != 0;
+}
+
+bool ThreadPool::JobHandle::waitForCompletion (const int timeOutMs) const
+{
+    return isFinished() || finishedEvent.wait (timeOutMs);
+}
+
+void ThreadPool::JobHandle::markAsFinished (const bool jobWasRun) noexcept
+{
+    cancelled = jobWasRun ? 0 : 1;
+    finished = 1;
+    finishedEvent.signal();
+}
+
+//==============================================================================
+/*  The jobs that belong to one of the pool's threads.
+
+    Each priority level has a circular FIFO of jobs that are waiting to run. Once a job
+    has been taken by a thread (which may be a different thread that has stolen it),
+    it moves to the list of running jobs until it's finished, so that every job in the
+    pool is always in exactly one of the queues.
+*/
+class ThreadPool::JobQueue
+{
+public:
+    JobQueue() {}
+
+    void addWaitingJob (ThreadPoolJob* const job)
+    {
+        waiting [job->priority].add (job);
+        ++numWaiting;
+    }
+
+    ThreadPoolJob* takeNextJob (const int priority, OwnedArray<ThreadPoolJob>& deletionList)
+    {
+        if (numWaiting.get() == 0)
+            return nullptr;
+
+        const ScopedLock sl (lock);
+        JobFifo& fifo = waiting [priority];
+
+        while (fifo.size() > 0)
+        {
+            ThreadPoolJob* const job = fifo.removeFirst();
+            --numWaiting;
+
+            if (job->shouldStop)
+            {
+                ThreadPool& pool = *(job->pool);
+                pool.jobFinished();
+                pool.addToDeleteList (deletionList, job);
+                continue;
+            }
+
+            job->isActive = true;
+            running.add (job);
+            return job;
+        }
+
+        return nullptr;
+    }
+
+    int indexOfWaitingJob (const int priority, const ThreadPoolJob* const job) const noexcept
+    {
+        const JobFifo& fifo = waiting [priority];
+
+        for (int i = 0; i < fifo.size(); ++i)
+            if (fifo[i] == job)
+                return i;
+
+        return -1;
+    }
+
+    bool contains (const ThreadPoolJob* const job) const noexcept
+    {
+        for (int p = 0; p < numPriorities; ++p)
+            if (indexOfWaitingJob (p, job) >= 0)
+                return true;
+
+        return running.contains (const_cast <ThreadPoolJob*> (job));
+    }
+
+    template <typename Callback>
+    void callForEachJob (Callback& callback) const
+    {
+        for (int i = 0; i < running.size(); ++i)
+            callback (running.getUnchecked (i));
+
+        for (int p = numPriorities; --p >= 0;)
+            for (int i = 0; i < waiting[p].size(); ++i)
+                callback (waiting[p][i]);
+    }
+
+    //==============================================================================
+    /*  A circular buffer of jobs, which can have jobs taken from the front in
+        constant time, unlike an Array.
+    */
+    class JobFifo
+    {
+    public:
+        JobFifo() noexcept : start (0), numItems (0), capacity (0) {}
+
+        int size() const noexcept                       { return numItems; }
+
+        ThreadPoolJob* operator[] (const int index) const noexcept
+        {
+            jassert (isPositiveAndBelow (index, numItems));
+            return items [(start + index) & (capacity - 1)];
+        }
+
+        void add (ThreadPoolJob* const job)
+        {
+            if (numItems == capacity)
+                grow();
+
+            items [(start + numItems++) & (capacity - 1)] = job;
+        }
+
+        ThreadPoolJob* removeFirst() noexcept
+        {
+            jassert (numItems > 0);
+            ThreadPoolJob* const job = items [start];
+            start = (start + 1) & (capacity - 1);
+            --numItems;
+            return job;
+        }
+
+        void remove (const int index) noexcept
+        {
+            jassert (isPositiveAndBelow (index, numItems));
+
+            for (int i = index; i < numItems - 1; ++i)
+                items [(start + i) & (capacity - 1)] = items [(start + i + 1) & (capacity - 1)];
+
+            --numItems;
+        }
+
+    private:
+        HeapBlock<ThreadPoolJob*> items;
+        int start, numItems, capacity; // (the capacity is always a power of 2)
+
+        void grow()
+        {
+            const int newCapacity = jmax (16, capacity * 2);
+            HeapBlock<ThreadPoolJob*> newItems ((size_t) newCapacity);
+
+            for (int i = 0; i < numItems; ++i)
+                newItems[i] = (*this)[i];
+
+            items.swapWith (newItems);
+            capacity = newCapacity;
+            start = 0;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (JobFifo)
+    };
+
+    enum { numPriorities = ThreadPool::highPriority + 1 };
+
+    CriticalSection lock;
+    JobFifo waiting [numPriorities];
+    Array<ThreadPoolJob*> running;
+    Atomic<int> numWaiting; // (this can be checked without locking, to skip empty queues quickly)
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (JobQueue)
+};
+
 //==============================================================================
 class ThreadPool::ThreadPoolThread  : public Thread
 {
 public:
-    ThreadPoolThread (ThreadPool& pool_)
+    ThreadPoolThread (ThreadPool& pool_, const int index_)
         : Thread ("Pool"),
+          index (index_),
           pool (pool_)
     {
     }
@@ -68,11 +256,24 @@ public:
     {
         while (! threadShouldExit())
         {
-            if (! pool.runNextJob())
-                wait (500);
+            if (! pool.runNextJob (*this))
+            {
+                // Once a thread has said that it's idle, it must check for work again before
+                // going to sleep, in case a job was added just before it set the flag..
+                isIdle = 1;
+
+                if (! pool.isAnyJobWaiting())
+                    wait (500);
+
+                isIdle = 0;
+            }
         }
     }
 
+    const int index;
+    JobQueue queue;
+    Atomic<int> isIdle;
+
 private:
     ThreadPool& pool;
 
@@ -100,8 +301,8 @@ ThreadPool::~ThreadPool()
 
 void ThreadPool::createThreads (int numThreads)
 {
-    for (int i = jmax (1, numThreads); --i >= 0;)
-        threads.add (new ThreadPoolThread (*this));
+    for (int i = 0; i < jmax (1, numThreads); ++i)
+        threads.add (new ThreadPoolThread (*this, i));
 
     for (int i = threads.size(); --i >= 0;)
         threads.getUnchecked(i)->startThread();
@@ -116,7 +317,7 @@ void ThreadPool::stopThreads()
         threads.getUnchecked(i)->stopThread (500);
 }
 
-void ThreadPool::addJob (ThreadPoolJob* const job, const bool deleteJobWhenFinished)
+void ThreadPool::addJob (ThreadPoolJob* const job, const bool deleteJobWhenFinished, const JobPriority priority)
 {
     jassert (job != nullptr);
     jassert (job->pool == nullptr);
@@ -127,38 +328,131 @@ void ThreadPool::addJob (ThreadPoolJob* const job, const bool deleteJobWhenFinis
         job->shouldStop = false;
         job->isActive = false;
         job->shouldBeDeleted = deleteJobWhenFinished;
+        job->priority = jlimit ((int) lowPriority, (int) highPriority, (int) priority);
+
+        // Jobs that are added by one of our own threads go into its own queue, and
+        // the others are shared out between all the threads' queues.
+        ThreadPoolThread* thread = dynamic_cast <ThreadPoolThread*> (Thread::getCurrentThread());
+
+        if (thread == nullptr || ! threads.contains (thread))
+            thread = threads.getUnchecked ((int) ((uint32) (++nextQueueIndex) % (uint32) threads.size()));
+
+        ++numJobs;
 
         {
-            const ScopedLock sl (lock);
-            jobs.add (job);
+            const ScopedLock sl (thread->queue.lock);
+            thread->queue.addWaitingJob (job);
         }
 
-        for (int i = threads.size(); --i >= 0;)
-            threads.getUnchecked(i)->notify();
+        wakeUpIdleThread (thread->index);
     }
 }
 
+void ThreadPool::wakeUpIdleThread (const int preferredThreadIndex)
+{
+    const int numThreads = threads.size();
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        ThreadPoolThread* const thread = threads.getUnchecked ((preferredThreadIndex + i) % numThreads);
+
+        if (thread->isIdle.compareAndSetBool (0, 1))
+        {
+            thread->notify();
+            break;
+        }
+    }
+}
+
+bool ThreadPool::isAnyJobWaiting() const noexcept
+{
+    for (int i = threads.size(); --i >= 0;)
+        if (threads.getUnchecked(i)->queue.numWaiting.get() > 0)
+            return true;
+
+    return false;
+}
+
 int ThreadPool::getNumJobs() const
 {
-    return jobs.size();
+    return numJobs.get();
+}
+
+namespace ThreadPoolHelpers
+{
+    struct JobFinder
+    {
+        JobFinder (const int index_) noexcept : index (index_), result (nullptr) {}
+
+        void operator() (ThreadPoolJob* const job) noexcept
+        {
+            if (index-- == 0)
+                result = job;
+        }
+
+        int index;
+        ThreadPoolJob* result;
+    };
+
+    struct JobNameCollector
+    {
+        JobNameCollector (StringArray& names_, const bool onlyActiveJobs_)
+            : names (names_), onlyActiveJobs (onlyActiveJobs_)
+        {}
+
+        void operator() (const ThreadPoolJob* const job)
+        {
+            if (job->isRunning() || ! onlyActiveJobs)
+                names.add (job->getJobName());
+        }
+
+        StringArray& names;
+        const bool onlyActiveJobs;
+
+        JUCE_DECLARE_NON_COPYABLE (JobNameCollector)
+    };
 }
 
 ThreadPoolJob* ThreadPool::getJob (const int index) const
 {
-    const ScopedLock sl (lock);
-    return jobs [index];
+    ThreadPoolHelpers::JobFinder finder (index);
+
+    for (int i = 0; i < threads.size() && finder.result == nullptr && index >= 0; ++i)
+    {
+        const JobQueue& queue = threads.getUnchecked(i)->queue;
+        const ScopedLock sl (queue.lock);
+        queue.callForEachJob (finder);
+    }
+
+    return finder.result;
 }
 
 bool ThreadPool::contains (const ThreadPoolJob* const job) const
 {
-    const ScopedLock sl (lock);
-    return jobs.contains (const_cast <ThreadPoolJob*> (job));
+    for (int i = threads.size(); --i >= 0;)
+    {
+        const JobQueue& queue = threads.getUnchecked(i)->queue;
+        const ScopedLock sl (queue.lock);
+
+        if (queue.contains (job))
+            return true;
+    }
+
+    return false;
 }
 
 bool ThreadPool::isJobRunning (const ThreadPoolJob* const job) const
 {
-    const ScopedLock sl (lock);
-    return jobs.contains (const_cast <ThreadPoolJob*> (job)) && job->isActive;
+    for (int i = threads.size(); --i >= 0;)
+    {
+        const JobQueue& queue = threads.getUnchecked(i)->queue;
+        const ScopedLock sl (queue.lock);
+
+        if (queue.running.contains (const_cast <ThreadPoolJob*> (job)))
+            return job->isActive;
+    }
+
+    return false;
 }
 
 bool ThreadPool::waitForJobToFinish (const ThreadPoolJob* const job,
@@ -189,21 +483,29 @@ bool ThreadPool::removeJob (ThreadPoolJob* const job,
 
     if (job != nullptr)
     {
-        const ScopedLock sl (lock);
-
-        if (jobs.contains (job))
+        for (int i = threads.size(); --i >= 0;)
         {
-            if (job->isActive)
+            JobQueue& queue = threads.getUnchecked(i)->queue;
+            const ScopedLock sl (queue.lock);
+
+            if (queue.running.contains (job))
             {
                 if (interruptIfRunning)
                     job->signalJobShouldExit();
 
                 dontWait = false;
+                break;
             }
-            else
+
+            const int index = queue.indexOfWaitingJob (job->priority, job);
+
+            if (index >= 0)
             {
-                jobs.removeFirstMatchingValue (job);
+                queue.waiting [job->priority].remove (index);
+                --(queue.numWaiting);
+                jobFinished();
                 addToDeleteList (deletionList, job);
+                break;
             }
         }
     }
@@ -219,25 +521,37 @@ bool ThreadPool::removeAllJobs (const bool interruptRunningJobs, const int timeO
     {
         OwnedArray<ThreadPoolJob> deletionList;
 
+        for (int t = threads.size(); --t >= 0;)
         {
-            const ScopedLock sl (lock);
+            JobQueue& queue = threads.getUnchecked(t)->queue;
+            const ScopedLock sl (queue.lock);
 
-            for (int i = jobs.size(); --i >= 0;)
+            for (int i = queue.running.size(); --i >= 0;)
             {
-                ThreadPoolJob* const job = jobs.getUnchecked(i);
+                ThreadPoolJob* const job = queue.running.getUnchecked(i);
 
                 if (selectedJobsToRemove == nullptr || selectedJobsToRemove->isJobSuitable (job))
                 {
-                    if (job->isActive)
-                    {
-                        jobsToWaitFor.add (job);
+                    jobsToWaitFor.add (job);
 
-                        if (interruptRunningJobs)
-                            job->signalJobShouldExit();
-                    }
-                    else
+                    if (interruptRunningJobs)
+                        job->signalJobShouldExit();
+                }
+            }
+
+            for (int p = 0; p < JobQueue::numPriorities; ++p)
+            {
+                JobQueue::JobFifo& fifo = queue.waiting[p];
+
+                for (int i = fifo.size(); --i >= 0;)
+                {
+                    ThreadPoolJob* const job = fifo[i];
+
+                    if (selectedJobsToRemove == nullptr || selectedJobsToRemove->isJobSuitable (job))
                     {
-                        jobs.remove (i);
+                        fifo.remove (i);
+                        --(queue.numWaiting);
+                        jobFinished();
                         addToDeleteList (deletionList, job);
                     }
                 }
@@ -272,13 +586,13 @@ bool ThreadPool::removeAllJobs (const bool interruptRunningJobs, const int timeO
 StringArray ThreadPool::getNamesOfAllJobs (const bool onlyReturnActiveJobs) const
 {
     StringArray s;
-    const ScopedLock sl (lock);
+    ThreadPoolHelpers::JobNameCollector collector (s, onlyReturnActiveJobs);
 
-    for (int i = 0; i < jobs.size(); ++i)
+    for (int i = 0; i < threads.size(); ++i)
     {
-        const ThreadPoolJob* const job = jobs.getUnchecked(i);
-        if (job->isActive || ! onlyReturnActiveJobs)
-            s.add (job->getJobName());
+        const JobQueue& queue = threads.getUnchecked(i)->queue;
+        const ScopedLock sl (queue.lock);
+        queue.callForEachJob (collector);
     }
 
     return s;
@@ -295,40 +609,29 @@ bool ThreadPool::setThreadPriorities (const int newPriority)
     return ok;
 }
 
-ThreadPoolJob* ThreadPool::pickNextJobToRun()
+bool ThreadPool::runNextJob (ThreadPoolThread& thread)
 {
-    OwnedArray<ThreadPoolJob> deletionList;
+    ThreadPoolJob* job = nullptr;
+    JobQueue* queue = nullptr;
 
     {
-        const ScopedLock sl (lock);
+        OwnedArray<ThreadPoolJob> deletionList;
+        const int numThreads = threads.size();
 
-        for (int i = 0; i < jobs.size(); ++i)
+        // Look in our own queue first, and then try to steal from the others, starting
+        // with the one after ours so that the threads don't all pick on the same victim..
+        for (int p = JobQueue::numPriorities; --p >= 0 && job == nullptr;)
         {
-            ThreadPoolJob* job = jobs[i];
-
-            if (job != nullptr && ! job->isActive)
+            for (int i = 0; i < numThreads; ++i)
             {
-                if (job->shouldStop)
-                {
-                    jobs.remove (i);
-                    addToDeleteList (deletionList, job);
-                    --i;
-                    continue;
-                }
+                queue = &(threads.getUnchecked ((thread.index + i) % numThreads)->queue);
 
-                job->isActive = true;
-                return job;
+                if ((job = queue->takeNextJob (p, deletionList)) != nullptr)
+                    break;
             }
         }
     }
 
-    return nullptr;
-}
-
-bool ThreadPool::runNextJob()
-{
-    ThreadPoolJob* const job = pickNextJobToRun();
-
     if (job == nullptr)
         return false;
 
@@ -343,30 +646,31 @@ bool ThreadPool::runNextJob()
     OwnedArray<ThreadPoolJob> deletionList;
 
     {
-        const ScopedLock sl (lock);
+        const ScopedLock sl (queue->lock);
+        queue->running.removeFirstMatchingValue (job);
+        job->isActive = false;
 
-        if (jobs.contains (job))
+        if (result != ThreadPoolJob::jobNeedsRunningAgain || job->shouldStop)
         {
-            job->isActive = false;
-
-            if (result != ThreadPoolJob::jobNeedsRunningAgain || job->shouldStop)
-            {
-                jobs.removeFirstMatchingValue (job);
-                addToDeleteList (deletionList, job);
-
-                jobFinishedSignal.signal();
-            }
-            else
-            {
-                // move the job to the end of the queue if it wants another go
-                jobs.move (jobs.indexOf (job), -1);
-            }
+            jobFinished();
+            addToDeleteList (deletionList, job);
+        }
+        else
+        {
+            // put the job at the back of the queue if it wants another go
+            queue->addWaitingJob (job);
         }
     }
 
     return true;
 }
 
+void ThreadPool::jobFinished() noexcept
+{
+    --numJobs;
+    jobFinishedSignal.signal();
+}
+
 void ThreadPool::addToDeleteList (OwnedArray<ThreadPoolJob>& deletionList, ThreadPoolJob* const job) const
 {
     job->shouldStop = true;
@@ -375,3 +679,379 @@ void ThreadPool::addToDeleteList (OwnedArray<ThreadPoolJob>& deletionList, Threa
     if (job->shouldBeDeleted)
         deletionList.add (job);
 }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ThreadPoolTests  : public UnitTest
+{
+public:
+    ThreadPoolTests() : UnitTest ("ThreadPool") {}
+
+    struct CountingJob  : public ThreadPoolJob
+    {
+        CountingJob (Atomic<int>& counter_, const int numRuns_ = 1)
+            : ThreadPoolJob ("counter"), counter (counter_), numRuns (numRuns_)
+        {}
+
+        JobStatus runJob()
+        {
+            ++counter;
+            return --numRuns > 0 ? jobNeedsRunningAgain : jobHasFinished;
+        }
+
+        Atomic<int>& counter;
+        int numRuns;
+    };
+
+    // keeps a thread busy until it's told to stop
+    struct BlockingJob  : public ThreadPoolJob
+    {
+        BlockingJob() : ThreadPoolJob ("blocker") {}
+
+        JobStatus runJob()
+        {
+            release.wait (10000);
+            return jobHasFinished;
+        }
+
+        WaitableEvent release;
+    };
+
+    struct OrderRecordingJob  : public ThreadPoolJob
+    {
+        OrderRecordingJob (Array<int>& order_, const int id_)
+            : ThreadPoolJob ("recorder"), order (order_), id (id_)
+        {}
+
+        JobStatus runJob()
+        {
+            order.add (id);
+            return jobHasFinished;
+        }
+
+        Array<int>& order;
+        const int id;
+    };
+
+    // a job which splits itself into more jobs until it reaches the required depth
+    struct FanOutJob  : public ThreadPoolJob
+    {
+        FanOutJob (ThreadPool& pool_, Atomic<int>& counter_, const int depth_)
+            : ThreadPoolJob (String::empty), pool (pool_), counter (counter_), depth (depth_)
+        {}
+
+        JobStatus runJob()
+        {
+            ++counter;
+
+            if (depth > 0)
+                for (int i = 0; i < 4; ++i)
+                    pool.addJob (new FanOutJob (pool, counter, depth - 1), true);
+
+            return jobHasFinished;
+        }
+
+        ThreadPool& pool;
+        Atomic<int>& counter;
+        const int depth;
+    };
+
+    struct Incrementer
+    {
+        Incrementer (Atomic<int>& counter_) : counter (&counter_) {}
+        void operator()() const     { ++*counter; }
+        Atomic<int>* counter;
+    };
+
+    struct NameSelector  : public ThreadPool::JobSelector
+    {
+        bool isJobSuitable (ThreadPoolJob* job)     { return job->getJobName() == "counter"; }
+    };
+
+    //==============================================================================
+    // A cut-down version of how the pool used to work, for the benchmark to compare against:
+    // all the jobs live in one array behind one lock, each thread scans the array for a job that
+    // isn't already running, and adding a job wakes every thread.
+    class SingleLockPool
+    {
+    public:
+        SingleLockPool (const int numThreads)
+        {
+            for (int i = 0; i < numThreads; ++i)
+                threads.add (new PoolThread (*this));
+
+            for (int i = 0; i < numThreads; ++i)
+                threads.getUnchecked(i)->startThread();
+        }
+
+        ~SingleLockPool()
+        {
+            for (int i = threads.size(); --i >= 0;)
+                threads.getUnchecked(i)->signalThreadShouldExit();
+
+            for (int i = threads.size(); --i >= 0;)
+                threads.getUnchecked(i)->notify();
+
+            threads.clear();
+
+            for (int i = jobs.size(); --i >= 0;)
+                delete jobs.getUnchecked(i);
+        }
+
+        // (jobs are always deleted when they finish)
+        void addJob (ThreadPoolJob* const job, bool)
+        {
+            {
+                const ScopedLock sl (lock);
+                jobs.add (job);
+            }
+
+            for (int i = threads.size(); --i >= 0;)
+                threads.getUnchecked(i)->notify();
+        }
+
+        int getNumJobs() const
+        {
+            const ScopedLock sl (lock);
+            return jobs.size();
+        }
+
+    private:
+        struct PoolThread  : public Thread
+        {
+            PoolThread (SingleLockPool& owner_) : Thread ("Pool"), owner (owner_) {}
+            ~PoolThread()   { stopThread (5000); }
+
+            void run()
+            {
+                while (! threadShouldExit())
+                    if (! owner.runNextJob())
+                        wait (500);
+            }
+
+            SingleLockPool& owner;
+        };
+
+        CriticalSection lock;
+        Array<ThreadPoolJob*> jobs, runningJobs;
+        OwnedArray<PoolThread> threads;
+
+        bool runNextJob()
+        {
+            ThreadPoolJob* job = nullptr;
+
+            {
+                const ScopedLock sl (lock);
+
+                for (int i = 0; i < jobs.size(); ++i)
+                {
+                    if (! runningJobs.contains (jobs.getUnchecked(i)))
+                    {
+                        job = jobs.getUnchecked(i);
+                        runningJobs.add (job);
+                        break;
+                    }
+                }
+            }
+
+            if (job == nullptr)
+                return false;
+
+            const ThreadPoolJob::JobStatus result = job->runJob();
+
+            {
+                const ScopedLock sl (lock);
+                runningJobs.removeFirstMatchingValue (job);
+
+                if (result == ThreadPoolJob::jobNeedsRunningAgain)
+                {
+                    jobs.move (jobs.indexOf (job), -1);
+                    return true;
+                }
+
+                jobs.removeFirstMatchingValue (job);
+            }
+
+            delete job;
+            return true;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (SingleLockPool)
+    };
+
+    template <class PoolType>
+    static void waitForAllJobs (PoolType& pool)
+    {
+        while (pool.getNumJobs() > 0)
+            Thread::sleep (1);
+    }
+
+    // Returns the number of jobs per second that the pool managed to get through
+    template <class PoolType>
+    double timeJobs (PoolType& pool, const int numJobs)
+    {
+        Atomic<int> counter;
+        const int64 start = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numJobs; ++i)
+            pool.addJob (new CountingJob (counter), true);
+
+        waitForAllJobs (pool);
+
+        const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        expectEquals (counter.get(), numJobs);
+        return numJobs / elapsed;
+    }
+
+    static void waitUntilRunning (ThreadPool& pool, ThreadPoolJob& job)
+    {
+        while (! pool.isJobRunning (&job))
+            Thread::sleep (1);
+    }
+
+    void runTest()
+    {
+        beginTest ("Running jobs");
+        {
+            ThreadPool pool (4);
+            Atomic<int> counter;
+
+            for (int i = 0; i < 1000; ++i)
+                pool.addJob (new CountingJob (counter, i % 3 + 1), true);
+
+            waitForAllJobs (pool);
+            expectEquals (counter.get(), 333 * 6 + 1);
+
+            counter = 0;
+            pool.addJob (new FanOutJob (pool, counter, 5), true);
+            waitForAllJobs (pool);
+            expectEquals (counter.get(), 1 + 4 + 16 + 64 + 256 + 1024);
+        }
+
+        beginTest ("Priorities");
+        {
+            ThreadPool pool (1);
+            BlockingJob blocker;
+            pool.addJob (&blocker, false);
+            waitUntilRunning (pool, blocker);
+
+            Array<int> order; // (the pool only has one thread, so this doesn't need a lock)
+            pool.addJob (new OrderRecordingJob (order, 0), true, ThreadPool::lowPriority);
+            pool.addJob (new OrderRecordingJob (order, 1), true, ThreadPool::normalPriority);
+            pool.addJob (new OrderRecordingJob (order, 2), true, ThreadPool::highPriority);
+            pool.addJob (new OrderRecordingJob (order, 3), true, ThreadPool::normalPriority);
+            pool.addJob (new OrderRecordingJob (order, 4), true, ThreadPool::highPriority);
+
+            blocker.release.signal();
+            waitForAllJobs (pool);
+
+            const int expectedOrder[] = { 2, 4, 1, 3, 0 };
+            expect (order == Array<int> (expectedOrder, numElementsInArray (expectedOrder)));
+        }
+
+        beginTest ("Removing jobs");
+        {
+            ThreadPool pool (2);
+            BlockingJob blockers[2];
+
+            for (int i = 0; i < 2; ++i)
+            {
+                pool.addJob (&blockers[i], false);
+                waitUntilRunning (pool, blockers[i]);
+            }
+
+            Atomic<int> counter;
+            CountingJob waitingJob (counter);
+            pool.addJob (&waitingJob, false);
+
+            for (int i = 0; i < 10; ++i)
+                pool.addJob (new CountingJob (counter), true);
+
+            expectEquals (pool.getNumJobs(), 13);
+            expect (pool.contains (&waitingJob) && ! pool.isJobRunning (&waitingJob));
+            expect (pool.isJobRunning (&blockers[0]) && pool.isJobRunning (&blockers[1]));
+            expectEquals (pool.getNamesOfAllJobs (true).size(), 2);
+            expectEquals (pool.getNamesOfAllJobs (false).size(), 13);
+
+            int numJobsFound = 0;
+
+            while (pool.getJob (numJobsFound) != nullptr)
+                ++numJobsFound;
+
+            expectEquals (numJobsFound, 13);
+
+            expect (pool.removeJob (&waitingJob, false, 0));
+            expect (! pool.contains (&waitingJob));
+
+            NameSelector selector;
+            expect (pool.removeAllJobs (false, 0, &selector));
+            expectEquals (pool.getNumJobs(), 2);
+
+            blockers[0].release.signal();
+            blockers[1].release.signal();
+            waitForAllJobs (pool);
+            expectEquals (counter.get(), 0);
+        }
+
+        beginTest ("Function jobs");
+        {
+            ThreadPool pool (2);
+            Atomic<int> counter;
+            ReferenceCountedArray<ThreadPool::JobHandle> handles;
+
+            for (int i = 0; i < 100; ++i)
+                handles.add (pool.addJob (Incrementer (counter)));
+
+            for (int i = 0; i < handles.size(); ++i)
+                expect (handles.getUnchecked(i)->waitForCompletion (5000));
+
+            expectEquals (counter.get(), 100);
+            expect (! handles.getFirst()->wasCancelled());
+
+            BlockingJob blockers[2];
+
+            for (int i = 0; i < 2; ++i)
+            {
+                pool.addJob (&blockers[i], false);
+                waitUntilRunning (pool, blockers[i]);
+            }
+
+            const ThreadPool::JobHandle::Ptr cancelledJob (pool.addJob (Incrementer (counter)));
+            expect (! cancelledJob->isFinished());
+            expect (! cancelledJob->waitForCompletion (10));
+
+            pool.removeAllJobs (true, 5000);
+            expect (cancelledJob->isFinished() && cancelledJob->wasCancelled());
+            expectEquals (counter.get(), 100);
+        }
+
+        beginTest ("Performance");
+        {
+            const int numJobs = 50000;
+
+            for (int numThreads = 1; numThreads <= 8; numThreads *= 2)
+            {
+                double singleLockJobsPerSec, jobsPerSec;
+
+                {
+                    SingleLockPool pool (numThreads);
+                    singleLockJobsPerSec = timeJobs (pool, numJobs);
+                }
+
+                {
+                    ThreadPool pool (numThreads);
+                    jobsPerSec = timeJobs (pool, numJobs);
+                }
+
+                logMessage (String (numThreads) + " threads, " + String (numJobs) + " jobs: single-lock pool "
+                              + String (roundToInt (singleLockJobsPerSec)) + " jobs/sec, ThreadPool "
+                              + String (roundToInt (jobsPerSec)) + " jobs/sec");
+            }
+        }
+    }
+};
+
+static ThreadPoolTests threadPoolTests;
+
+#endif
@@ -27,9 +27,11 @@
 #define __JUCE_THREADPOOL_JUCEHEADER__
 
 #include "juce_Thread.h"
+#include "juce_WaitableEvent.h"
 #include "../text/juce_StringArray.h"
 #include "../containers/juce_Array.h"
 #include "../containers/juce_OwnedArray.h"
+#include "../memory/juce_ReferenceCountedObject.h"
 class ThreadPool;
 class ThreadPoolThread;
 
@@ -127,6 +129,7 @@ private:
     String jobName;
     ThreadPool* pool;
     bool shouldStop, isActive, shouldBeDeleted;
+    int priority;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThreadPoolJob)
 };
@@ -139,6 +142,12 @@ private:
     When a ThreadPoolJob object is added to the ThreadPool's list, its runJob() method
     will be called by the next pooled thread that becomes free.
 
+    Each thread has its own queue of jobs, so the threads don't all have to fight over a
+    single list. New jobs are shared out between the queues, and a thread which runs out
+    of work will take jobs from the other threads' queues, so that none of them sit idle
+    while there's still work to do. Within each priority level, the jobs in a queue are
+    run in the order in which they were added.
+
     @see ThreadPoolJob, Thread
 */
 class JUCE_API  ThreadPool
@@ -186,6 +195,60 @@ public:
         virtual bool isJobSuitable (ThreadPoolJob* job) = 0;
     };
 
+    //==============================================================================
+    /** The priorities that can be given to jobs when they're added to the pool.
+
+        No job will be started while there's a job with a higher priority waiting to run.
+        Note that this doesn't affect the priority of the threads themselves - for that,
+        see setThreadPriorities().
+    */
+    enum JobPriority
+    {
+        lowPriority = 0,
+        normalPriority,
+        highPriority
+    };
+
+    //==============================================================================
+    /** A waitable object that tells you when a job which was added with
+        addJob (FunctionType) has finished.
+
+        @see ThreadPool::addJob
+    */
+    class JUCE_API  JobHandle  : public ReferenceCountedObject
+    {
+    public:
+        /** Creates an unfinished handle - you won't need to create these yourself. */
+        JobHandle();
+
+        /** Destructor. */
+        ~JobHandle();
+
+        /** Returns true once the job has either run or been removed from the pool. */
+        bool isFinished() const noexcept;
+
+        /** Returns true if the job was removed from the pool before it got a chance to run. */
+        bool wasCancelled() const noexcept;
+
+        /** Blocks until the job has finished, or the timeout expires.
+
+            A negative timeout will wait forever. Returns true if the job has finished.
+        */
+        bool waitForCompletion (int timeOutMilliseconds = -1) const;
+
+        /** A pointer to a JobHandle. */
+        typedef ReferenceCountedObjectPtr<JobHandle> Ptr;
+
+    private:
+        friend class ThreadPool;
+        WaitableEvent finishedEvent;
+        Atomic<int> finished, cancelled;
+
+        void markAsFinished (bool jobWasRun) noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (JobHandle)
+    };
+
     //==============================================================================
     /** Adds a job to the queue.
 
@@ -203,7 +266,28 @@ public:
         been removed from the pool.
     */
     void addJob (ThreadPoolJob* job,
-                 bool deleteJobWhenFinished);
+                 bool deleteJobWhenFinished,
+                 JobPriority priority = normalPriority);
+
+    /** Adds a function or function-object to the queue, to be called once by the next free thread.
+
+        This is a lightweight alternative to writing a ThreadPoolJob subclass for short
+        tasks. The object can be anything that can be called with no arguments, e.g. a
+        lambda or a functor class, and it'll be copied and kept by the pool until it has
+        been run.
+
+        The JobHandle that is returned can be used to find out when the function has been
+        called, or to block until it has.
+    */
+    template <typename FunctionType>
+    JobHandle::Ptr addJob (const FunctionType& function,
+                           JobPriority priority = normalPriority)
+    {
+        FunctionJob<FunctionType>* const job = new FunctionJob<FunctionType> (function);
+        const JobHandle::Ptr handle (job->handle);
+        addJob (job, true, priority);
+        return handle;
+    }
 
     /** Tries to remove a job from the pool.
 
@@ -288,18 +372,46 @@ public:
 
 private:
     //==============================================================================
-    Array <ThreadPoolJob*> jobs;
+    template <typename FunctionType>
+    class FunctionJob  : public ThreadPoolJob
+    {
+    public:
+        FunctionJob (const FunctionType& f)
+            : ThreadPoolJob (String::empty), function (f), handle (new JobHandle()), hasRun (false)
+        {}
+
+        ~FunctionJob()
+        {
+            handle->markAsFinished (hasRun);
+        }
+
+        JobStatus runJob()
+        {
+            hasRun = true;
+            function();
+            return jobHasFinished;
+        }
+
+        FunctionType function;
+        const JobHandle::Ptr handle;
+        bool hasRun;
+
+        JUCE_DECLARE_NON_COPYABLE (FunctionJob)
+    };
 
+    class JobQueue;
     class ThreadPoolThread;
     friend class ThreadPoolThread;
     friend class OwnedArray <ThreadPoolThread>;
     OwnedArray <ThreadPoolThread> threads;
 
-    CriticalSection lock;
+    Atomic<int> numJobs, nextQueueIndex;
     WaitableEvent jobFinishedSignal;
 
-    bool runNextJob();
-    ThreadPoolJob* pickNextJobToRun();
+    bool runNextJob (ThreadPoolThread&);
+    bool isAnyJobWaiting() const noexcept;
+    void wakeUpIdleThread (int preferredThreadIndex);
+    void jobFinished() noexcept;
     void addToDeleteList (OwnedArray<ThreadPoolJob>&, ThreadPoolJob*) const;
     void createThreads (int numThreads);
     void stopThreads();
@@ -39,6 +39,9 @@ namespace juce
 #ifndef __JUCE_VALUETREE_JUCEHEADER__
  #include "values/juce_ValueTree.h"
 #endif
+#ifndef __JUCE_VALUETREESNAPSHOT_JUCEHEADER__
+ #include "values/juce_ValueTreeSnapshot.h"
+#endif
 #ifndef __JUCE_UNDOABLEACTION_JUCEHEADER__
  #include "undomanager/juce_UndoableAction.h"
 #endif
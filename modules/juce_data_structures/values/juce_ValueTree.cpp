@@ -1096,6 +1096,46 @@ public:
             ValueTree v4 = v2.createCopy();
             expect (v1.isEquivalentTo (v4));
         }
+
+        beginTest ("Property access performance");
+
+        for (int numProperties = 4; numProperties <= 256; numProperties *= 4)
+        {
+            Array<Identifier> names;
+
+            for (int i = 0; i < numProperties; ++i)
+                names.add (Identifier ("property" + String (i)));
+
+            ValueTree v ("Test");
+
+            for (int i = 0; i < numProperties; ++i)
+                v.setProperty (names.getReference (i), i, nullptr);
+
+            const int numOperations = 1000000;
+            Random r (numProperties);
+            HeapBlock<int> order ((size_t) numOperations);
+
+            for (int i = 0; i < numOperations; ++i)
+                order[i] = r.nextInt (numProperties);
+
+            int64 total = 0;
+            const int64 startGet = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numOperations; ++i)
+                total += (int) v.getProperty (names.getReference (order[i]));
+
+            const int64 startSet = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numOperations; ++i)
+                v.setProperty (names.getReference (order[i]), i, nullptr);
+
+            const int64 end = Time::getHighResolutionTicks();
+            expect (total >= 0 && v.getNumProperties() == numProperties);
+
+            logMessage (String (numProperties) + " properties, ns per getProperty/setProperty: "
+                          + String (Time::highResolutionTicksToSeconds (startSet - startGet) * 1.0e9 / numOperations, 1) + " / "
+                          + String (Time::highResolutionTicksToSeconds (end - startSet) * 1.0e9 / numOperations, 1));
+        }
     }
 };
 
@@ -498,6 +498,7 @@ private:
     //==============================================================================
     class SharedObject;
     friend class SharedObject;
+    friend class ValueTreeSnapshot;
 
     ReferenceCountedObjectPtr<SharedObject> object;
     ListenerList<Listener> listeners;
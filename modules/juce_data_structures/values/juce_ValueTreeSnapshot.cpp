@@ -0,0 +1,646 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+/*  The snapshot format. All values are little-endian uint32s, and everything is
+    aligned to 4 bytes.
+
+    Header:         magic, version, total size, number of strings, string table offset,
+                    root node offset
+    Node:           type string index, number of properties, number of children,
+                    then { name string index, value offset, value size } for each property,
+                    then the offset of each child node
+    String table:   the offset of each null-terminated UTF-8 name
+
+    Property values are stored in the format used by var::writeToStream(). Each node is
+    written after all of its children, so a child's offset is always lower than its
+    parent's, which means that even corrupt data can't make a node its own descendant.
+*/
+namespace ValueTreeSnapshotFormat
+{
+    const uint32 magic       = 0x6e735456; // "VTsn"
+    const uint32 version     = 1;
+    const int headerSize     = 24;
+    const int nodeHeaderSize = 12;
+    const int propertySize   = 12;
+}
+
+//==============================================================================
+class ValueTreeSnapshot::Writer
+{
+public:
+    Writer() : failed (false)
+    {
+        body.writeRepeatedByte (0, ValueTreeSnapshotFormat::headerSize);
+    }
+
+    bool write (const ValueTree& tree, OutputStream& output)
+    {
+        const uint32 root = writeNode (tree);
+        const uint32 stringTable = writeStringTable();
+
+        if (failed || body.getDataSize() > 0x7fffffff)
+            return false;
+
+        output.writeInt ((int) ValueTreeSnapshotFormat::magic);
+        output.writeInt ((int) ValueTreeSnapshotFormat::version);
+        output.writeInt ((int) body.getDataSize());
+        output.writeInt (strings.size());
+        output.writeInt ((int) stringTable);
+        output.writeInt ((int) root);
+
+        return output.write (addBytesToPointer (body.getData(), ValueTreeSnapshotFormat::headerSize),
+                             body.getDataSize() - ValueTreeSnapshotFormat::headerSize);
+    }
+
+private:
+    MemoryOutputStream body;
+    StringArray strings;
+    FlatHashMap<String, int> stringIndexes;
+    bool failed;
+
+    uint32 getPosition() const noexcept      { return (uint32) body.getDataSize(); }
+
+    void align()
+    {
+        body.writeRepeatedByte (0, (size_t) ((4 - (body.getDataSize() & 3)) & 3));
+    }
+
+    int getStringIndex (const String& s)
+    {
+        if (const int* const existing = stringIndexes.getValuePointer (s))
+            return *existing;
+
+        stringIndexes.set (s, strings.size());
+        strings.add (s);
+        return strings.size() - 1;
+    }
+
+    uint32 writeNode (const ValueTree& tree)
+    {
+        const int numProperties = tree.getNumProperties();
+        const int numChildren = tree.getNumChildren();
+        HeapBlock<uint32> propertyOffsets ((size_t) numProperties + 1), propertySizes ((size_t) numProperties + 1);
+        HeapBlock<uint32> childOffsets ((size_t) numChildren + 1);
+
+        for (int i = 0; i < numProperties; ++i)
+        {
+            propertyOffsets[i] = getPosition();
+            tree.getProperty (tree.getPropertyName (i)).writeToStream (body);
+            propertySizes[i] = getPosition() - propertyOffsets[i];
+            align();
+        }
+
+        for (int i = 0; i < numChildren; ++i)
+            childOffsets[i] = writeNode (tree.getChild (i));
+
+        const uint32 nodeOffset = getPosition();
+        body.writeInt (getStringIndex (tree.getType().toString()));
+        body.writeInt (numProperties);
+        body.writeInt (numChildren);
+
+        for (int i = 0; i < numProperties; ++i)
+        {
+            body.writeInt (getStringIndex (tree.getPropertyName (i).toString()));
+            body.writeInt ((int) propertyOffsets[i]);
+            body.writeInt ((int) propertySizes[i]);
+        }
+
+        for (int i = 0; i < numChildren; ++i)
+            body.writeInt ((int) childOffsets[i]);
+
+        // (offsets are stored as 32-bit values, so bail out if the data gets too big for them)
+        if (body.getDataSize() > 0x7fffffff)
+            failed = true;
+
+        return nodeOffset;
+    }
+
+    uint32 writeStringTable()
+    {
+        HeapBlock<uint32> stringOffsets ((size_t) strings.size() + 1);
+
+        for (int i = 0; i < strings.size(); ++i)
+        {
+            stringOffsets[i] = getPosition();
+            body.writeString (strings[i]);
+        }
+
+        align();
+        const uint32 tableOffset = getPosition();
+
+        for (int i = 0; i < strings.size(); ++i)
+            body.writeInt ((int) stringOffsets[i]);
+
+        return tableOffset;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Writer)
+};
+
+bool ValueTreeSnapshot::write (const ValueTree& tree, OutputStream& output)
+{
+    if (! tree.isValid())
+        return false;
+
+    Writer writer;
+    return writer.write (tree, output);
+}
+
+//==============================================================================
+ValueTreeSnapshot::ValueTreeSnapshot (const File& file)
+    : mappedFile (new MemoryMappedFile (file, MemoryMappedFile::readOnly)),
+      data (nullptr), dataSize (0), numStrings (0), stringTable (0), root (0)
+{
+    openData (mappedFile->getData(), mappedFile->getSize());
+}
+
+ValueTreeSnapshot::ValueTreeSnapshot (const void* const sourceData, const size_t numBytes)
+    : data (nullptr), dataSize (0), numStrings (0), stringTable (0), root (0)
+{
+    openData (sourceData, numBytes);
+}
+
+ValueTreeSnapshot::~ValueTreeSnapshot()
+{
+}
+
+void ValueTreeSnapshot::openData (const void* const sourceData, const size_t numBytes)
+{
+    using namespace ValueTreeSnapshotFormat;
+
+    if (sourceData == nullptr || numBytes < (size_t) headerSize)
+        return;
+
+    data = static_cast <const uint8*> (sourceData);
+    dataSize = numBytes;
+
+    if (readUInt (0) != magic || readUInt (4) != version || readUInt (8) > numBytes)
+        return;
+
+    dataSize = readUInt (8);
+    numStrings = readUInt (12);
+    stringTable = readUInt (16);
+
+    if (stringTable < (uint32) headerSize || (uint64) stringTable + numStrings * (uint64) 4 > dataSize)
+        return;
+
+    identifiers.insertMultiple (0, Identifier(), (int) numStrings);
+
+    if (isNodeInRange (readUInt (20)))
+        root = readUInt (20);
+}
+
+ValueTreeSnapshot::Node ValueTreeSnapshot::getRoot() const noexcept
+{
+    return isValid() ? Node (*this, root) : Node();
+}
+
+uint32 ValueTreeSnapshot::readUInt (const size_t offset) const noexcept
+{
+    jassert (offset + 4 <= dataSize);
+    return ByteOrder::littleEndianInt (data + offset);
+}
+
+bool ValueTreeSnapshot::isNodeInRange (const uint32 offset) const noexcept
+{
+    using namespace ValueTreeSnapshotFormat;
+
+    if (offset < (uint32) headerSize || (offset & 3) != 0 || (uint64) offset + nodeHeaderSize > dataSize)
+        return false;
+
+    return (uint64) offset + nodeHeaderSize
+             + readUInt (offset + 4) * (uint64) propertySize
+             + readUInt (offset + 8) * (uint64) 4 <= dataSize;
+}
+
+Identifier ValueTreeSnapshot::getIdentifier (const uint32 stringIndex) const
+{
+    if (stringIndex >= numStrings)
+        return Identifier();
+
+    Identifier& name = identifiers.getReference ((int) stringIndex);
+
+    if (name.isNull())
+    {
+        const uint32 offset = readUInt (stringTable + stringIndex * 4);
+
+        if (offset < dataSize)
+        {
+            const char* const text = reinterpret_cast <const char*> (data + offset);
+            const int maxBytes = (int) jmin (dataSize - offset, (size_t) 0x7fffffff);
+
+            if (*text != 0 && memchr (text, 0, (size_t) maxBytes) != nullptr
+                  && CharPointer_UTF8::isValidString (text, maxBytes))
+                name = Identifier (String (CharPointer_UTF8 (text)));
+        }
+    }
+
+    return name;
+}
+
+//==============================================================================
+ValueTreeSnapshot::Node::Node() noexcept
+    : snapshot (nullptr), offset (0), numProperties (0), numChildren (0)
+{
+}
+
+ValueTreeSnapshot::Node::Node (const ValueTreeSnapshot& s, const uint32 nodeOffset) noexcept
+    : snapshot (nullptr), offset (0), numProperties (0), numChildren (0)
+{
+    if (s.isNodeInRange (nodeOffset))
+    {
+        snapshot = &s;
+        offset = nodeOffset;
+        numProperties = (int) s.readUInt (nodeOffset + 4);
+        numChildren = (int) s.readUInt (nodeOffset + 8);
+    }
+}
+
+Identifier ValueTreeSnapshot::Node::getType() const
+{
+    return snapshot != nullptr ? snapshot->getIdentifier (snapshot->readUInt (offset)) : Identifier();
+}
+
+bool ValueTreeSnapshot::Node::hasType (const Identifier& typeName) const
+{
+    return isValid() && getType() == typeName;
+}
+
+int ValueTreeSnapshot::Node::getNumProperties() const noexcept
+{
+    return numProperties;
+}
+
+uint32 ValueTreeSnapshot::Node::getPropertyEntry (const int index) const noexcept
+{
+    jassert (isPositiveAndBelow (index, numProperties));
+    return offset + (uint32) (ValueTreeSnapshotFormat::nodeHeaderSize + ValueTreeSnapshotFormat::propertySize * index);
+}
+
+Identifier ValueTreeSnapshot::Node::getPropertyName (const int index) const
+{
+    if (! isPositiveAndBelow (index, numProperties))
+        return Identifier();
+
+    return snapshot->getIdentifier (snapshot->readUInt (getPropertyEntry (index)));
+}
+
+var ValueTreeSnapshot::Node::getPropertyValue (const int index) const
+{
+    if (! isPositiveAndBelow (index, numProperties))
+        return var::null;
+
+    const uint32 entry = getPropertyEntry (index);
+    const uint32 valueOffset = snapshot->readUInt (entry + 4);
+    const uint32 valueSize = snapshot->readUInt (entry + 8);
+
+    if ((uint64) valueOffset + valueSize > snapshot->dataSize)
+        return var::null;
+
+    MemoryInputStream in (snapshot->data + valueOffset, valueSize, false);
+    return var::readFromStream (in);
+}
+
+int ValueTreeSnapshot::Node::indexOfProperty (const Identifier& name) const
+{
+    for (int i = 0; i < numProperties; ++i)
+        if (getPropertyName (i) == name)
+            return i;
+
+    return -1;
+}
+
+var ValueTreeSnapshot::Node::getProperty (const Identifier& name) const
+{
+    return getPropertyValue (indexOfProperty (name));
+}
+
+var ValueTreeSnapshot::Node::getProperty (const Identifier& name, const var& defaultReturnValue) const
+{
+    const int index = indexOfProperty (name);
+    return index >= 0 ? getPropertyValue (index) : defaultReturnValue;
+}
+
+bool ValueTreeSnapshot::Node::hasProperty (const Identifier& name) const
+{
+    return indexOfProperty (name) >= 0;
+}
+
+int ValueTreeSnapshot::Node::getNumChildren() const noexcept
+{
+    return numChildren;
+}
+
+ValueTreeSnapshot::Node ValueTreeSnapshot::Node::getChild (const int index) const
+{
+    if (! isPositiveAndBelow (index, numChildren))
+        return Node();
+
+    const uint32 childOffset = snapshot->readUInt (offset + (uint32) (ValueTreeSnapshotFormat::nodeHeaderSize
+                                                                         + ValueTreeSnapshotFormat::propertySize * numProperties
+                                                                         + 4 * index));
+
+    // (children are always written before their parents, so anything else means the data is corrupt)
+    if (childOffset >= offset)
+        return Node();
+
+    return Node (*snapshot, childOffset);
+}
+
+ValueTreeSnapshot::Node ValueTreeSnapshot::Node::getChildWithName (const Identifier& type) const
+{
+    for (int i = 0; i < numChildren; ++i)
+    {
+        const Node child (getChild (i));
+
+        if (child.hasType (type))
+            return child;
+    }
+
+    return Node();
+}
+
+ValueTree ValueTreeSnapshot::Node::createValueTree() const
+{
+    const Identifier type (getType());
+
+    if (type.isNull())
+        return ValueTree::invalid;
+
+    ValueTree v (type);
+
+    for (int i = 0; i < numProperties; ++i)
+    {
+        const Identifier name (getPropertyName (i));
+
+        if (name.isValid())
+            v.object->properties.set (name, getPropertyValue (i));
+    }
+
+    v.object->children.ensureStorageAllocated (numChildren);
+
+    for (int i = 0; i < numChildren; ++i)
+    {
+        ValueTree child (getChild (i).createValueTree());
+
+        if (child.isValid())
+        {
+            v.object->children.add (child.object);
+            child.object->parent = v.object;
+        }
+    }
+
+    return v;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ValueTreeSnapshotTests  : public UnitTest
+{
+public:
+    ValueTreeSnapshotTests() : UnitTest ("ValueTreeSnapshot") {}
+
+    static ValueTree createRandomTree (Random& r, const int depth)
+    {
+        ValueTree v ("Node" + String (r.nextInt (5)));
+
+        for (int i = r.nextInt (8); --i >= 0;)
+        {
+            const Identifier name ("prop" + String (r.nextInt (20)));
+
+            switch (r.nextInt (5))
+            {
+                case 0:  v.setProperty (name, r.nextInt(), nullptr); break;
+                case 1:  v.setProperty (name, r.nextDouble(), nullptr); break;
+                case 2:  v.setProperty (name, r.nextBool(), nullptr); break;
+                case 3:  v.setProperty (name, String::repeatedString ("abc\xc3\xa9", r.nextInt (20)), nullptr); break;
+                default: v.setProperty (name, r.nextInt64(), nullptr); break;
+            }
+        }
+
+        if (depth < 5)
+            for (int i = r.nextInt (6); --i >= 0;)
+                v.addChild (createRandomTree (r, depth + 1), -1, nullptr);
+
+        return v;
+    }
+
+    // Builds something shaped like a large session: tracks, each containing lots of clips.
+    static ValueTree createSessionTree (const int numTracks, const int numClipsPerTrack)
+    {
+        ValueTree session ("SESSION");
+        session.setProperty ("name", "Benchmark", nullptr);
+
+        for (int t = 0; t < numTracks; ++t)
+        {
+            ValueTree track ("TRACK");
+            track.setProperty ("name", "Track " + String (t), nullptr);
+            track.setProperty ("volume", 0.8, nullptr);
+            track.setProperty ("pan", 0.0, nullptr);
+
+            for (int c = 0; c < numClipsPerTrack; ++c)
+            {
+                ValueTree clip ("CLIP");
+                clip.setProperty ("file", "/audio/track" + String (t) + "/clip" + String (c) + ".wav", nullptr);
+                clip.setProperty ("start", c * 44100.0, nullptr);
+                clip.setProperty ("length", 44100.0, nullptr);
+                clip.setProperty ("offset", 0, nullptr);
+                clip.setProperty ("gain", 1.0, nullptr);
+                clip.setProperty ("fadeIn", 64, nullptr);
+                clip.setProperty ("fadeOut", 64, nullptr);
+                clip.setProperty ("colour", "ff336699", nullptr);
+                track.addChild (clip, -1, nullptr);
+            }
+
+            session.addChild (track, -1, nullptr);
+        }
+
+        return session;
+    }
+
+    static bool nodeMatchesTree (const ValueTreeSnapshot::Node& node, const ValueTree& tree)
+    {
+        if (! node.hasType (tree.getType())
+             || node.getNumProperties() != tree.getNumProperties()
+             || node.getNumChildren() != tree.getNumChildren())
+            return false;
+
+        for (int i = 0; i < tree.getNumProperties(); ++i)
+        {
+            const Identifier name (tree.getPropertyName (i));
+
+            if (node.getPropertyName (i) != name
+                 || ! node.getProperty (name).equalsWithSameType (tree [name]))
+                return false;
+        }
+
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+            if (! nodeMatchesTree (node.getChild (i), tree.getChild (i)))
+                return false;
+
+        return true;
+    }
+
+    static double timeInMs (const int64 startTicks)
+    {
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    }
+
+    void runTest()
+    {
+        beginTest ("Round trip");
+        {
+            Random r (0x1234);
+
+            for (int i = 0; i < 20; ++i)
+            {
+                const ValueTree tree (createRandomTree (r, 0));
+                MemoryOutputStream out;
+                expect (ValueTreeSnapshot::write (tree, out));
+
+                ValueTreeSnapshot snapshot (out.getData(), out.getDataSize());
+                expect (snapshot.isValid());
+                expect (nodeMatchesTree (snapshot.getRoot(), tree));
+                expect (snapshot.getRoot().createValueTree().isEquivalentTo (tree));
+            }
+        }
+
+        beginTest ("Node access");
+        {
+            const ValueTree session (createSessionTree (10, 10));
+            MemoryOutputStream out;
+            expect (ValueTreeSnapshot::write (session, out));
+
+            ValueTreeSnapshot snapshot (out.getData(), out.getDataSize());
+            const ValueTreeSnapshot::Node root (snapshot.getRoot());
+
+            expect (root.hasType ("SESSION"));
+            expect (root.getProperty ("name").toString() == "Benchmark");
+            expect (root.getProperty ("missing", 123).equalsWithSameType (123));
+            expect (! root.hasProperty ("missing"));
+            expect (root.getChildWithName ("TRACK").isValid());
+            expect (! root.getChildWithName ("CLIP").isValid());
+            expect (! root.getChild (10).isValid());
+            expect (! root.getChild (-1).isValid());
+
+            const ValueTree track (root.getChild (7).createValueTree());
+            expect (track.isEquivalentTo (session.getChild (7)));
+            expect (! track.getParent().isValid());
+
+            expect (! ValueTreeSnapshot::Node().createValueTree().isValid());
+            expect (! ValueTreeSnapshot::write (ValueTree::invalid, out));
+        }
+
+        beginTest ("Corrupt data");
+        {
+            Random r (0x5678);
+            const ValueTree tree (createRandomTree (r, 0));
+            MemoryOutputStream out;
+            ValueTreeSnapshot::write (tree, out);
+            const MemoryBlock original (out.getData(), out.getDataSize());
+
+            expect (! ValueTreeSnapshot (original.getData(), 20).isValid());
+            expect (! ValueTreeSnapshot (original.getData(), original.getSize() - 4).isValid());
+            expect (! ValueTreeSnapshot (nullptr, 0).isValid());
+
+            for (int i = 0; i < 200; ++i)
+            {
+                MemoryBlock corrupted (original);
+
+                for (int j = 1 + r.nextInt (8); --j >= 0;)
+                    corrupted [r.nextInt ((int) corrupted.getSize())] = (char) r.nextInt (256);
+
+                // (all that matters is that it doesn't crash or hang)
+                ValueTreeSnapshot snapshot (corrupted.getData(), corrupted.getSize());
+                snapshot.getRoot().createValueTree();
+            }
+        }
+
+        beginTest ("Files");
+        {
+            const ValueTree session (createSessionTree (5, 5));
+            TemporaryFile tempFile;
+
+            {
+                FileOutputStream out (tempFile.getFile());
+                expect (ValueTreeSnapshot::write (session, out));
+            }
+
+            ValueTreeSnapshot snapshot (tempFile.getFile());
+            expect (snapshot.isValid());
+            expect (snapshot.getRoot().createValueTree().isEquivalentTo (session));
+            expect (! ValueTreeSnapshot (File::nonexistent).isValid());
+        }
+
+        beginTest ("Load performance");
+        {
+            const ValueTree session (createSessionTree (200, 250));
+
+            MemoryOutputStream streamData;
+            session.writeToStream (streamData);
+
+            const String xmlText (ScopedPointer<XmlElement> (session.createXml())->createDocument (String::empty));
+
+            MemoryOutputStream snapshotData;
+            ValueTreeSnapshot::write (session, snapshotData);
+
+            logMessage ("Sizes: stream " + File::descriptionOfSizeInBytes ((int64) streamData.getDataSize())
+                          + ", XML " + File::descriptionOfSizeInBytes ((int64) xmlText.getNumBytesAsUTF8())
+                          + ", snapshot " + File::descriptionOfSizeInBytes ((int64) snapshotData.getDataSize()));
+
+            int64 start = Time::getHighResolutionTicks();
+            const ValueTree fromStream (ValueTree::readFromData (streamData.getData(), streamData.getDataSize()));
+            const double streamTime = timeInMs (start);
+
+            start = Time::getHighResolutionTicks();
+            const ScopedPointer<XmlElement> xml (XmlDocument::parse (xmlText));
+            const ValueTree fromXml (ValueTree::fromXml (*xml));
+            const double xmlTime = timeInMs (start);
+
+            start = Time::getHighResolutionTicks();
+            ValueTreeSnapshot snapshot (snapshotData.getData(), snapshotData.getDataSize());
+            const ValueTree oneTrack (snapshot.getRoot().getChild (100).createValueTree());
+            const double partialTime = timeInMs (start);
+
+            start = Time::getHighResolutionTicks();
+            const ValueTree fromSnapshot (snapshot.getRoot().createValueTree());
+            const double fullTime = timeInMs (start);
+
+            expect (fromStream.isEquivalentTo (session));
+            expect (fromXml.getNumChildren() == session.getNumChildren());
+            expect (oneTrack.isEquivalentTo (session.getChild (100)));
+            expect (fromSnapshot.isEquivalentTo (session));
+
+            logMessage ("Load times: stream " + String (streamTime, 1) + "ms, XML " + String (xmlTime, 1)
+                          + "ms, snapshot (one track) " + String (partialTime, 2)
+                          + "ms, snapshot (whole tree) " + String (fullTime, 1) + "ms");
+        }
+    }
+};
+
+static ValueTreeSnapshotTests valueTreeSnapshotTests;
+
+#endif
@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_VALUETREESNAPSHOT_JUCEHEADER__
+#define __JUCE_VALUETREESNAPSHOT_JUCEHEADER__
+
+#include "juce_ValueTree.h"
+
+
+//==============================================================================
+/**
+    A read-only, memory-mappable binary image of a ValueTree.
+
+    ValueTree::readFromStream() has to parse and allocate every node, property and
+    name in a tree before any of it can be used. A snapshot is laid out so that it can
+    be used directly from a memory-mapped file instead: all the type and property names
+    are kept once in a string table, and each node stores the offsets of its children,
+    so that a node can be reached without reading anything else in the file.
+
+    Opening a snapshot only checks its header, and you then browse it with Node objects,
+    which are just lightweight handles into the data. Nodes, names and values are only
+    decoded when you actually ask for them, and when you need a real ValueTree for part
+    of the data, Node::createValueTree() will build one for just that subtree.
+
+    @code
+    // Saving:
+    FileOutputStream out (sessionFile);
+    ValueTreeSnapshot::write (sessionTree, out);
+
+    // Loading only the part you need:
+    ValueTreeSnapshot snapshot (sessionFile);
+    ValueTree mixer (snapshot.getRoot().getChildWithName ("MIXER").createValueTree());
+    @endcode
+
+    A snapshot never changes once it's been opened, but the names it decodes are cached
+    internally, so an instance shouldn't be used by more than one thread at once.
+
+    @see ValueTree::writeToStream
+*/
+class JUCE_API  ValueTreeSnapshot
+{
+public:
+    //==============================================================================
+    /** Memory-maps a file that was written with write().
+        If the file can't be opened or doesn't contain a valid snapshot, isValid()
+        will return false.
+    */
+    explicit ValueTreeSnapshot (const File& file);
+
+    /** Opens a snapshot from a block of memory that was written with write().
+
+        The data isn't copied, so it must remain valid for as long as this object
+        and any Nodes that were obtained from it are in use.
+    */
+    ValueTreeSnapshot (const void* data, size_t numBytes);
+
+    /** Destructor. */
+    ~ValueTreeSnapshot();
+
+    //==============================================================================
+    /** Writes a tree to a stream in the snapshot format.
+        @returns false if the tree was invalid, too large to store, or the stream failed
+    */
+    static bool write (const ValueTree& tree, OutputStream& output);
+
+    //==============================================================================
+    /** Returns true if the data was opened successfully. */
+    bool isValid() const noexcept                       { return root != 0; }
+
+    class Node;
+
+    /** Returns the top-level node of the snapshot, or an invalid node if the
+        snapshot couldn't be opened.
+    */
+    Node getRoot() const noexcept;
+
+    //==============================================================================
+    /**
+        A handle to one node of a ValueTreeSnapshot.
+
+        Nodes are cheap to copy, and only read the parts of the snapshot's data that
+        you ask for. A Node must not be used after its snapshot has been deleted.
+    */
+    class JUCE_API  Node
+    {
+    public:
+        /** Creates an invalid node. */
+        Node() noexcept;
+
+        /** Returns true if this refers to an actual node. */
+        bool isValid() const noexcept                   { return snapshot != nullptr; }
+
+        /** Returns the node's type name. */
+        Identifier getType() const;
+
+        /** Returns true if the node has this type. */
+        bool hasType (const Identifier& typeName) const;
+
+        //==============================================================================
+        /** Returns the number of properties that the node has. */
+        int getNumProperties() const noexcept;
+
+        /** Returns the name of one of the node's properties. */
+        Identifier getPropertyName (int index) const;
+
+        /** Decodes and returns the value of one of the node's properties. */
+        var getPropertyValue (int index) const;
+
+        /** Decodes and returns the value of a named property, or a void var if there's
+            no such property.
+        */
+        var getProperty (const Identifier& name) const;
+
+        /** Decodes and returns the value of a named property, or the default value
+            if there's no such property.
+        */
+        var getProperty (const Identifier& name, const var& defaultReturnValue) const;
+
+        /** Returns true if the node has a property with this name. */
+        bool hasProperty (const Identifier& name) const;
+
+        //==============================================================================
+        /** Returns the number of child nodes. */
+        int getNumChildren() const noexcept;
+
+        /** Returns one of the node's children, or an invalid node if the index is
+            out of range.
+        */
+        Node getChild (int index) const;
+
+        /** Returns the first child node with the given type, or an invalid node if
+            there isn't one.
+        */
+        Node getChildWithName (const Identifier& type) const;
+
+        //==============================================================================
+        /** Builds a ValueTree containing a copy of this node and all of its children.
+            If the node is invalid, this returns ValueTree::invalid.
+        */
+        ValueTree createValueTree() const;
+
+    private:
+        //==============================================================================
+        friend class ValueTreeSnapshot;
+        const ValueTreeSnapshot* snapshot;
+        uint32 offset;
+        int numProperties, numChildren;
+
+        Node (const ValueTreeSnapshot&, uint32 offset) noexcept;
+        uint32 getPropertyEntry (int index) const noexcept;
+        int indexOfProperty (const Identifier&) const;
+    };
+
+private:
+    //==============================================================================
+    ScopedPointer<MemoryMappedFile> mappedFile;
+    const uint8* data;
+    size_t dataSize;
+    uint32 numStrings, stringTable, root;
+    mutable Array<Identifier> identifiers;  // (each name is only pooled the first time it's needed)
+
+    void openData (const void*, size_t);
+    Identifier getIdentifier (uint32 stringIndex) const;
+    uint32 readUInt (size_t offset) const noexcept;
+    bool isNodeInRange (uint32 offset) const noexcept;
+    class Writer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ValueTreeSnapshot)
+};
+
+
+#endif   // __JUCE_VALUETREESNAPSHOT_JUCEHEADER__
@@ -57,6 +57,8 @@
  #include <X11/Xutil.h>
  #undef KeyPress
  #include <unistd.h>
+ #include <sys/epoll.h>
+ #include <sys/eventfd.h>
 #endif
 
 //==============================================================================
@@ -85,6 +85,9 @@ namespace juce
 #ifndef __JUCE_INTERPROCESSCONNECTIONSERVER_JUCEHEADER__
  #include "interprocess/juce_InterprocessConnectionServer.h"
 #endif
+#ifndef __JUCE_LINUX_EVENTLOOP_JUCEHEADER__
+ #include "native/juce_linux_EventLoop.h"
+#endif
 #ifndef __JUCE_SCOPEDXLOCK_JUCEHEADER__
  #include "native/juce_ScopedXLock.h"
 #endif
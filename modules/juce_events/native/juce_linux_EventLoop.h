@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+#ifndef __JUCE_LINUX_EVENTLOOP_JUCEHEADER__
+#define __JUCE_LINUX_EVENTLOOP_JUCEHEADER__
+
+
+//==============================================================================
+#if JUCE_LINUX || DOXYGEN
+
+/** Lets you watch file descriptors from the message thread's event loop (Only available in Linux!).
+
+    This is handy for things like sockets, pipes or device handles that need servicing
+    on the message thread, because it avoids having to create a thread just to wait
+    for them.
+*/
+namespace LinuxEventLoop
+{
+    /** A callback that can be registered with registerFdCallback(). */
+    class JUCE_API  FdCallback
+    {
+    public:
+        /** Destructor. */
+        virtual ~FdCallback() {}
+
+        /** Called on the message thread when the file descriptor has some data ready to
+            read, or has been closed or hit an error.
+
+            The event loop keeps calling this for as long as the descriptor stays readable,
+            so it should read whatever's available.
+        */
+        virtual void fdReady (int fd) = 0;
+    };
+
+    /** Starts watching a file descriptor.
+
+        The callback will be invoked on the message thread whenever the descriptor is
+        ready to read. The callback object isn't deleted by the event loop, and must be
+        unregistered with unregisterFdCallback() before it's deleted or before the
+        descriptor is closed.
+
+        This must be called after the MessageManager has been created.
+        Returns false if the descriptor couldn't be watched.
+    */
+    JUCE_API bool JUCE_CALLTYPE registerFdCallback (int fd, FdCallback* callback);
+
+    /** Stops watching a file descriptor that was passed to registerFdCallback(). */
+    JUCE_API void JUCE_CALLTYPE unregisterFdCallback (int fd);
+}
+
+#endif
+#endif   // __JUCE_LINUX_EVENTLOOP_JUCEHEADER__
@@ -42,21 +42,38 @@ ScopedXLock::ScopedXLock()       { XLockDisplay (display); }
 ScopedXLock::~ScopedXLock()      { XUnlockDisplay (display); }
 
 //==============================================================================
+/*  Messages are posted onto a lock-free stack, and the message thread takes the whole stack
+    in one go and reverses it into a FIFO list, which it then works through. A poster only
+    needs to wake the message thread (by signalling an eventfd) when it finds the stack empty,
+    because otherwise there's already a wake-up pending.
+
+    The message thread sleeps in epoll_wait(), watching the eventfd, the X server connection,
+    and any file descriptors that have been registered with LinuxEventLoop::registerFdCallback().
+*/
 class InternalMessageQueue
 {
 public:
     InternalMessageQueue()
-        : bytesInSocket (0),
+        : pendingMessages (nullptr),
+          windowSystemFd (-1),
           totalEventCount (0)
     {
-        int ret = ::socketpair (AF_LOCAL, SOCK_STREAM, 0, fd);
-        (void) ret; jassert (ret == 0);
+        wakeUpFd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+        jassert (wakeUpFd >= 0);
+
+        epollFd = epoll_create (16);
+        jassert (epollFd >= 0);
+
+        addToEpoll (wakeUpFd);
     }
 
     ~InternalMessageQueue()
     {
-        close (fd[0]);
-        close (fd[1]);
+        deleteMessages (pendingMessages);
+        deleteMessages (incomingMessages.exchange (nullptr));
+
+        close (epollFd);
+        close (wakeUpFd);
 
         clearSingletonInstance();
     }
@@ -64,39 +81,46 @@ public:
     //==============================================================================
     void postMessage (MessageManager::MessageBase* const msg)
     {
-        const int maxBytesInSocketQueue = 128;
-
-        ScopedLock sl (lock);
-        queue.add (msg);
+        msg->incReferenceCount();
+        QueuedMessage* const qm = new QueuedMessage (msg);
 
-        if (bytesInSocket < maxBytesInSocketQueue)
+        for (;;)
         {
-            ++bytesInSocket;
+            QueuedMessage* const head = incomingMessages.get();
+            qm->next = head;
 
-            ScopedUnlock ul (lock);
-            const unsigned char x = 0xff;
-            size_t bytesWritten = write (fd[0], &x, 1);
-            (void) bytesWritten;
+            if (incomingMessages.compareAndSetBool (qm, head))
+            {
+                if (head == nullptr)
+                {
+                    const uint64 one = 1;
+                    ssize_t bytesWritten = write (wakeUpFd, &one, sizeof (one));
+                    (void) bytesWritten;
+                }
+
+                break;
+            }
         }
     }
 
-    bool isEmpty() const
+    bool isEmpty() const noexcept
     {
-        ScopedLock sl (lock);
-        return queue.size() == 0;
+        return pendingMessages == nullptr && incomingMessages.get() == nullptr;
     }
 
     bool dispatchNextEvent()
     {
-        // This alternates between giving priority to XEvents or internal messages,
-        // to keep everything running smoothly..
-        if ((++totalEventCount & 1) != 0)
-            return dispatchNextXEvent() || dispatchNextInternalMessage();
-
-        return dispatchNextInternalMessage() || dispatchNextXEvent();
+        // This rotates the priority between XEvents, internal messages and file descriptor
+        // callbacks, to keep everything running smoothly..
+        switch (++totalEventCount % 3)
+        {
+            case 0:   return dispatchNextXEvent() || dispatchInternalMessages() || dispatchFdCallbacks (0);
+            case 1:   return dispatchInternalMessages() || dispatchFdCallbacks (0) || dispatchNextXEvent();
+            default:  return dispatchFdCallbacks (0) || dispatchNextXEvent() || dispatchInternalMessages();
+        }
     }
 
-    // Wait for an event (either XEvent, or an internal Message)
+    // Wait for an event (either XEvent, an internal Message, or a registered file descriptor)
     bool sleepUntilEvent (const int timeoutMs)
     {
         if (! isEmpty())
@@ -109,48 +133,98 @@ public:
                 return true;
         }
 
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = timeoutMs * 1000;
-        int fd0 = getWaitHandle();
-        int fdmax = fd0;
+        return dispatchFdCallbacks (timeoutMs) || ! isEmpty();
+    }
 
-        fd_set readset;
-        FD_ZERO (&readset);
-        FD_SET (fd0, &readset);
+    //==============================================================================
+    void setWindowSystemFd (const int fd)
+    {
+        jassert (windowSystemFd < 0);
+        windowSystemFd = fd;
+        addToEpoll (fd);
+    }
 
-        if (display != 0)
+    bool registerFdCallback (const int fd, LinuxEventLoop::FdCallback* const callback)
+    {
+        jassert (fd >= 0 && callback != nullptr);
+
+        const ScopedLock sl (callbackLock);
+
+        for (int i = fdCallbacks.size(); --i >= 0;)
         {
-            ScopedXLock xlock;
-            int fd1 = XConnectionNumber (display);
-            FD_SET (fd1, &readset);
-            fdmax = jmax (fd0, fd1);
+            if (fdCallbacks.getReference(i).fd == fd)
+            {
+                fdCallbacks.getReference(i).callback = callback;
+                return true;
+            }
         }
 
-        const int ret = select (fdmax + 1, &readset, 0, 0, &tv);
-        return (ret > 0); // ret <= 0 if error or timeout
+        if (! addToEpoll (fd))
+            return false;
+
+        const FdCallbackInfo info = { fd, callback };
+        fdCallbacks.add (info);
+        return true;
+    }
+
+    void unregisterFdCallback (const int fd)
+    {
+        const ScopedLock sl (callbackLock);
+
+        for (int i = fdCallbacks.size(); --i >= 0;)
+        {
+            if (fdCallbacks.getReference(i).fd == fd)
+            {
+                epoll_ctl (epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                fdCallbacks.remove (i);
+            }
+        }
     }
 
     //==============================================================================
     juce_DeclareSingleton_SingleThreaded_Minimal (InternalMessageQueue);
 
 private:
-    CriticalSection lock;
-    ReferenceCountedArray <MessageManager::MessageBase> queue;
-    int fd[2];
-    int bytesInSocket;
+    struct QueuedMessage
+    {
+        QueuedMessage (MessageManager::MessageBase* const m) noexcept  : message (m), next (nullptr) {}
+
+        MessageManager::MessageBase* message;
+        QueuedMessage* next;
+    };
+
+    struct FdCallbackInfo
+    {
+        int fd;
+        LinuxEventLoop::FdCallback* callback;
+    };
+
+    Atomic<QueuedMessage*> incomingMessages;
+    QueuedMessage* pendingMessages; // (only touched by the message thread)
+    int wakeUpFd, epollFd, windowSystemFd;
     int totalEventCount;
 
-    int getWaitHandle() const noexcept      { return fd[1]; }
+    CriticalSection callbackLock;
+    Array<FdCallbackInfo> fdCallbacks;
 
-    static bool setNonBlocking (int handle)
+    bool addToEpoll (const int fd)
     {
-        int socketFlags = fcntl (handle, F_GETFL, 0);
-        if (socketFlags == -1)
-            return false;
+        struct epoll_event e;
+        zerostruct (e);
+        e.events = EPOLLIN;
+        e.data.fd = fd;
+
+        return epoll_ctl (epollFd, EPOLL_CTL_ADD, fd, &e) == 0;
+    }
 
-        socketFlags |= O_NONBLOCK;
-        return fcntl (handle, F_SETFL, socketFlags) == 0;
+    static void deleteMessages (QueuedMessage* qm)
+    {
+        while (qm != nullptr)
+        {
+            const ScopedPointer<QueuedMessage> toDelete (qm);
+            qm->message->decReferenceCount();
+            qm = qm->next;
+        }
     }
 
     static bool dispatchNextXEvent()
@@ -177,41 +251,115 @@ private:
         return true;
     }
 
-    MessageManager::MessageBase::Ptr popNextMessage()
+    // Takes all the messages that have been posted so far, and puts them in order.
+    void fetchIncomingMessages() noexcept
     {
-        const ScopedLock sl (lock);
+        jassert (pendingMessages == nullptr);
 
-        if (bytesInSocket > 0)
-        {
-            --bytesInSocket;
+        QueuedMessage* qm = incomingMessages.exchange (nullptr);
 
-            const ScopedUnlock ul (lock);
-            unsigned char x;
-            size_t numBytes = read (fd[1], &x, 1);
-            (void) numBytes;
+        while (qm != nullptr)
+        {
+            QueuedMessage* const next = qm->next;
+            qm->next = pendingMessages;
+            pendingMessages = qm;
+            qm = next;
         }
-
-        return queue.removeAndReturn (0);
     }
 
-    bool dispatchNextInternalMessage()
+    // Delivers a batch of messages, leaving any that are posted while it's doing so for later.
+    bool dispatchInternalMessages()
     {
-        if (const MessageManager::MessageBase::Ptr msg = popNextMessage())
+        if (pendingMessages == nullptr)
         {
+            fetchIncomingMessages();
+
+            if (pendingMessages == nullptr)
+                return false;
+        }
+
+        for (int maxMessagesInBatch = 256; --maxMessagesInBatch >= 0 && pendingMessages != nullptr;)
+        {
+            const ScopedPointer<QueuedMessage> qm (pendingMessages);
+            pendingMessages = qm->next;
+
+            const MessageManager::MessageBase::Ptr msg (qm->message);
+            msg->decReferenceCount();
+
             JUCE_TRY
             {
                 msg->messageCallback();
-                return true;
             }
             JUCE_CATCH_EXCEPTION
         }
 
-        return false;
+        return true;
+    }
+
+    // Waits for any of the file descriptors to become ready, and calls any registered callbacks.
+    bool dispatchFdCallbacks (const int timeoutMs)
+    {
+        if (timeoutMs == 0 && fdCallbacks.size() == 0)
+            return false;
+
+        struct epoll_event events [16];
+        const int numEvents = epoll_wait (epollFd, events, numElementsInArray (events), timeoutMs);
+        bool anyCallbacks = false;
+
+        for (int i = 0; i < numEvents; ++i)
+        {
+            const int fd = events[i].data.fd;
+
+            if (fd == wakeUpFd)
+            {
+                uint64 count;
+                ssize_t bytesRead = read (wakeUpFd, &count, sizeof (count));
+                (void) bytesRead;
+            }
+            else if (fd != windowSystemFd)
+            {
+                const ScopedLock sl (callbackLock);
+
+                for (int j = fdCallbacks.size(); --j >= 0;)
+                {
+                    if (fdCallbacks.getReference(j).fd == fd)
+                    {
+                        anyCallbacks = true;
+
+                        JUCE_TRY
+                        {
+                            fdCallbacks.getReference(j).callback->fdReady (fd);
+                        }
+                        JUCE_CATCH_EXCEPTION
+
+                        break;
+                    }
+                }
+            }
+        }
+
+        return anyCallbacks;
     }
 };
 
 juce_ImplementSingleton_SingleThreaded (InternalMessageQueue);
 
+//==============================================================================
+bool JUCE_CALLTYPE LinuxEventLoop::registerFdCallback (const int fd, FdCallback* const callback)
+{
+    if (InternalMessageQueue* const queue = InternalMessageQueue::getInstanceWithoutCreating())
+        return queue->registerFdCallback (fd, callback);
+
+    jassertfalse; // The MessageManager has to be created before you can use this!
+    return false;
+}
+
+void JUCE_CALLTYPE LinuxEventLoop::unregisterFdCallback (const int fd)
+{
+    if (InternalMessageQueue* const queue = InternalMessageQueue::getInstanceWithoutCreating())
+        queue->unregisterFdCallback (fd);
+}
+
 
 //==============================================================================
 namespace LinuxErrorHandling
@@ -335,6 +483,8 @@ void MessageManager::doPlatformSpecificInitialisation()
                                                   0, 0, 1, 1, 0, 0, InputOnly,
                                                   DefaultVisual (display, screen),
                                                   CWEventMask, &swa);
+
+        InternalMessageQueue::getInstance()->setWindowSystemFd (XConnectionNumber (display));
     }
 }
 
@@ -23,6 +23,14 @@
   ==============================================================================
 */
 
+/*  The timers are kept in a hierarchical timing wheel. Level 0 has a slot for each of the
+    next 64 milliseconds, and each level above that has 64 slots that each cover 64 times
+    as long as the slots in the level below. Each slot is a doubly-linked list of timers, so
+    adding or removing a timer takes constant time. When the wheel's current time crosses
+    the start of a slot in a higher level, the timers in that slot get redistributed into
+    the levels below it, and when it reaches a level 0 slot, all the timers in that slot are
+    due and are moved onto a list which the message thread works through in one callback.
+*/
 class Timer::TimerThread  : private Thread,
                             private DeletedAtShutdown,
                             private AsyncUpdater
@@ -32,9 +40,14 @@ public:
 
     TimerThread()
         : Thread ("Juce Timer"),
-          firstTimer (nullptr),
+          currentTick (0),
+          nextWakeTick (0),
+          lastTickTime (Time::getMillisecondCounter()),
+          numTimers (0),
           callbackNeeded (0)
     {
+        zeromem (lists, sizeof (lists));
+        resetStatistics();
         triggerAsyncUpdate();
     }
 
@@ -66,7 +79,7 @@ public:
                                                        : (std::numeric_limits<uint32>::max() - (lastTime - now)));
             lastTime = now;
 
-            const int timeUntilFirstTimer = getTimeUntilFirstTimer (elapsed);
+            const int timeUntilFirstTimer = advance (elapsed, now);
 
             if (timeUntilFirstTimer <= 0)
             {
@@ -104,7 +117,7 @@ public:
             {
                 // don't wait for too long because running this loop also helps keep the
                 // Time::getApproximateMillisecondTimer value stay up-to-date
-                wait (jlimit (1, 50, timeUntilFirstTimer));
+                wait (timeUntilFirstTimer);
             }
         }
     }
@@ -113,12 +126,21 @@ public:
     {
         const LockType::ScopedLockType sl (lock);
 
-        while (firstTimer != nullptr && firstTimer->countdownMs <= 0)
+        if (lists [dueList] != nullptr)
+            ++numCallbackMessages;
+
+        while (lists [dueList] != nullptr)
         {
-            Timer* const t = firstTimer;
-            t->countdownMs = t->periodMs;
+            Timer* const t = lists [dueList];
+            const int64 now = getCurrentTick();
+
+            const int lateness = (int) jmax ((int64) 0, now - t->dueTime);
+            ++numCallbacks;
+            totalLatenessMs += lateness;
+            maxLatenessMs = jmax (maxLatenessMs, lateness);
 
             removeTimer (t);
+            t->dueTime = now + t->periodMs;
             addTimer (t);
 
             const LockType::ScopedUnlockType ul (lock);
@@ -157,6 +179,7 @@ public:
         if (instance == nullptr)
             instance = new TimerThread();
 
+        tim->dueTime = instance->getCurrentTick() + tim->periodMs;
         instance->addTimer (tim);
     }
 
@@ -170,25 +193,54 @@ public:
     {
         if (instance != nullptr)
         {
-            tim->countdownMs = newCounter;
-            tim->periodMs = newCounter;
+            tim->periodMs = jmax (1, newCounter);
 
-            if ((tim->next != nullptr && tim->next->countdownMs < tim->countdownMs)
-                 || (tim->previous != nullptr && tim->previous->countdownMs > tim->countdownMs))
-            {
-                instance->removeTimer (tim);
-                instance->addTimer (tim);
-            }
+            instance->removeTimer (tim);
+            tim->dueTime = instance->getCurrentTick() + newCounter;
+            instance->addTimer (tim);
         }
     }
 
+    void getStatistics (Timer::LatenessStatistics& stats) const noexcept
+    {
+        stats.numTimersRunning    = numTimers;
+        stats.numCallbacks        = numCallbacks;
+        stats.numCallbackMessages = numCallbackMessages;
+        stats.totalLatenessMs     = totalLatenessMs;
+        stats.maxLatenessMs       = maxLatenessMs;
+    }
+
+    void resetStatistics() noexcept
+    {
+        numCallbacks = 0;
+        numCallbackMessages = 0;
+        totalLatenessMs = 0;
+        maxLatenessMs = 0;
+    }
+
     static TimerThread* instance;
     static LockType lock;
 
 private:
-    Timer* volatile firstTimer;
+    enum
+    {
+        slotBits = 6,
+        numSlots = 1 << slotBits,
+        numLevels = 4,
+        overflowList = numLevels * numSlots,  // timers that are too far in the future for the wheel
+        dueList,                              // timers that are waiting for their callback
+        numLists
+    };
+
+    Timer* lists [numLists];
+    int64 currentTick, nextWakeTick;
+    uint32 lastTickTime;
+    int numTimers;
     Atomic <int> callbackNeeded;
 
+    int64 numCallbacks, numCallbackMessages, totalLatenessMs;
+    int maxLatenessMs;
+
     struct CallTimersMessage  : public MessageManager::MessageBase
     {
         CallTimersMessage() {}
@@ -201,6 +253,28 @@ private:
     };
 
     //==============================================================================
+    // Returns the wheel's time, allowing for the time that's passed since the thread last advanced it.
+    int64 getCurrentTick() const noexcept
+    {
+        return currentTick + (int64) (Time::getMillisecondCounter() - lastTickTime);
+    }
+
+    int getListFor (const int64 dueTime) const noexcept
+    {
+        if (dueTime <= currentTick)
+            return dueList;
+
+        for (int level = 0; level < numLevels; ++level)
+        {
+            const int shift = level * slotBits;
+
+            if ((dueTime >> shift) - (currentTick >> shift) < numSlots)
+                return level * numSlots + (int) ((dueTime >> shift) & (numSlots - 1));
+        }
+
+        return overflowList;
+    }
+
     void addTimer (Timer* const t) noexcept
     {
        #if JUCE_DEBUG
@@ -209,68 +283,151 @@ private:
         jassert (! timerExists (t));
        #endif
 
-        Timer* i = firstTimer;
+        ++numTimers;
+        insertIntoList (t, getListFor (t->dueTime));
+
+        if (t->dueTime < nextWakeTick)
+            notify();
+    }
+
+    void removeTimer (Timer* const t) noexcept
+    {
+       #if JUCE_DEBUG
+        // trying to remove a timer that's not here - shouldn't get to this point,
+        // so if you get this assertion, let me know!
+        jassert (timerExists (t));
+       #endif
+
+        --numTimers;
+        removeFromList (t);
+    }
 
-        if (i == nullptr || i->countdownMs > t->countdownMs)
+    void insertIntoList (Timer* const t, const int listIndex) noexcept
+    {
+        // (appending to the due list keeps the callbacks in the order that they became due)
+        if (listIndex == dueList && lists [dueList] != nullptr)
         {
-            t->next = firstTimer;
-            firstTimer = t;
+            Timer* last = lists [dueList]->previous;
+            last->next = t;
+            t->previous = last;
+            t->next = nullptr;
+            lists [dueList]->previous = t;
         }
         else
         {
-            while (i->next != nullptr && i->next->countdownMs <= t->countdownMs)
-                i = i->next;
+            Timer* const first = lists [listIndex];
+            t->next = first;
+            t->previous = first != nullptr ? first->previous : t;
 
-            jassert (i != nullptr);
+            if (first != nullptr)
+                first->previous = t;
 
-            t->next = i->next;
-            t->previous = i;
-            i->next = t;
+            lists [listIndex] = t;
         }
 
-        if (t->next != nullptr)
-            t->next->previous = t;
-
-        jassert ((t->next == nullptr || t->next->countdownMs >= t->countdownMs)
-                  && (t->previous == nullptr || t->previous->countdownMs <= t->countdownMs));
-
-        notify();
+        t->listIndex = listIndex;
     }
 
-    void removeTimer (Timer* const t) noexcept
+    /*  Each list's first timer uses its 'previous' pointer to refer to the last timer in
+        the list, so both ends can be reached in constant time.
+    */
+    void removeFromList (Timer* const t) noexcept
     {
-       #if JUCE_DEBUG
-        // trying to remove a timer that's not here - shouldn't get to this point,
-        // so if you get this assertion, let me know!
-        jassert (timerExists (t));
-       #endif
+        Timer*& first = lists [t->listIndex];
 
-        if (t->previous != nullptr)
+        if (first == t)
         {
-            jassert (firstTimer != t);
-            t->previous->next = t->next;
+            first = t->next;
+
+            if (first != nullptr)
+                first->previous = t->previous;
         }
         else
         {
-            jassert (firstTimer == t);
-            firstTimer = t->next;
-        }
+            t->previous->next = t->next;
 
-        if (t->next != nullptr)
-            t->next->previous = t->previous;
+            if (t->next != nullptr)
+                t->next->previous = t->previous;
+            else
+                first->previous = t->previous;
+        }
 
         t->next = nullptr;
         t->previous = nullptr;
+        t->listIndex = -1;
+    }
+
+    void redistributeList (const int listIndex) noexcept
+    {
+        Timer* t = lists [listIndex];
+        lists [listIndex] = nullptr;
+
+        while (t != nullptr)
+        {
+            Timer* const next = t->next;
+            insertIntoList (t, getListFor (t->dueTime));
+            t = next;
+        }
+    }
+
+    void moveForwardOneTick() noexcept
+    {
+        ++currentTick;
+
+        if ((currentTick & ((((int64) 1) << (numLevels * slotBits)) - 1)) == 0)
+            redistributeList (overflowList);
+
+        for (int level = numLevels; --level > 0;)
+        {
+            const int shift = level * slotBits;
+
+            if ((currentTick & ((((int64) 1) << shift) - 1)) == 0)
+                redistributeList (level * numSlots + (int) ((currentTick >> shift) & (numSlots - 1)));
+        }
+
+        redistributeList ((int) (currentTick & (numSlots - 1)));
     }
 
-    int getTimeUntilFirstTimer (const int numMillisecsElapsed) const
+    // Advances the wheel and returns the number of milliseconds until it next needs to be advanced.
+    int advance (const int numMillisecsElapsed, const uint32 now) noexcept
     {
         const LockType::ScopedLockType sl (lock);
 
-        for (Timer* t = firstTimer; t != nullptr; t = t->next)
-            t->countdownMs -= numMillisecsElapsed;
+        if (numMillisecsElapsed < numSlots * numSlots)
+        {
+            for (int i = numMillisecsElapsed; --i >= 0;)
+                moveForwardOneTick();
+        }
+        else
+        {
+            // (after a long gap, it's quicker to just re-sort all the timers than to step through every tick)
+            currentTick += numMillisecsElapsed;
+
+            for (int i = 0; i < dueList; ++i)
+                redistributeList (i);
+        }
+
+        lastTickTime = now;
+
+        if (lists [dueList] != nullptr)
+            return 0;
+
+        // Look for the next occupied level 0 slot before the wheel reaches the next
+        // level 1 slot, at which point some more timers may need to move down.
+        int ticksToWait = numSlots - (int) (currentTick & (numSlots - 1));
 
-        return firstTimer != nullptr ? firstTimer->countdownMs : 1000;
+        for (int i = 1; i < ticksToWait; ++i)
+        {
+            if (lists [(int) ((currentTick + i) & (numSlots - 1))] != nullptr)
+            {
+                ticksToWait = i;
+                break;
+            }
+        }
+
+        ticksToWait = jmin (ticksToWait, 50);
+        nextWakeTick = currentTick + ticksToWait;
+        return ticksToWait;
     }
 
     void handleAsyncUpdate()
@@ -281,9 +438,10 @@ private:
    #if JUCE_DEBUG
     bool timerExists (Timer* const t) const noexcept
     {
-        for (Timer* tt = firstTimer; tt != nullptr; tt = tt->next)
-            if (tt == t)
-                return true;
+        for (int i = 0; i < numLists; ++i)
+            for (Timer* tt = lists[i]; tt != nullptr; tt = tt->next)
+                if (tt == t)
+                    return true;
 
         return false;
     }
@@ -301,8 +459,9 @@ static SortedSet <Timer*> activeTimers;
 #endif
 
 Timer::Timer() noexcept
-   : countdownMs (0),
+   : dueTime (0),
      periodMs (0),
+     listIndex (-1),
      previous (nullptr),
      next (nullptr)
 {
@@ -313,8 +472,9 @@ Timer::Timer() noexcept
 }
 
 Timer::Timer (const Timer&) noexcept
-   : countdownMs (0),
+   : dueTime (0),
      periodMs (0),
+     listIndex (-1),
      previous (nullptr),
      next (nullptr)
 {
@@ -344,7 +504,6 @@ void Timer::startTimer (const int interval) noexcept
 
     if (periodMs == 0)
     {
-        countdownMs = interval;
         periodMs = jmax (1, interval);
         TimerThread::add (this);
     }
@@ -375,3 +534,35 @@ void JUCE_CALLTYPE Timer::callPendingTimersSynchronously()
     if (TimerThread::instance != nullptr)
         TimerThread::instance->callTimersSynchronously();
 }
+
+//==============================================================================
+Timer::LatenessStatistics JUCE_CALLTYPE Timer::getLatenessStatistics()
+{
+    LatenessStatistics stats;
+    zerostruct (stats);
+
+    const TimerThread::LockType::ScopedLockType sl (TimerThread::lock);
+
+    if (TimerThread::instance != nullptr)
+        TimerThread::instance->getStatistics (stats);
+
+    return stats;
+}
+
+void JUCE_CALLTYPE Timer::resetLatenessStatistics()
+{
+    const TimerThread::LockType::ScopedLockType sl (TimerThread::lock);
+
+    if (TimerThread::instance != nullptr)
+        TimerThread::instance->resetStatistics();
+}
+
+double Timer::LatenessStatistics::getAverageLatenessMs() const noexcept
+{
+    return numCallbacks > 0 ? totalLatenessMs / (double) numCallbacks : 0.0;
+}
+
+double Timer::LatenessStatistics::getAverageCallbacksPerMessage() const noexcept
+{
+    return numCallbackMessages > 0 ? numCallbacks / (double) numCallbackMessages : 0.0;
+}
@@ -122,10 +122,43 @@ public:
     */
     static void JUCE_CALLTYPE callPendingTimersSynchronously();
 
+    //==============================================================================
+    /** Describes how promptly timer callbacks are being delivered.
+        @see getLatenessStatistics
+    */
+    struct JUCE_API  LatenessStatistics
+    {
+        int numTimersRunning;       /**< The number of timers that are currently running. */
+        int64 numCallbacks;         /**< The number of callbacks made since the statistics were reset. */
+        int64 numCallbackMessages;  /**< The number of messages that were used to deliver those callbacks. */
+        int64 totalLatenessMs;      /**< The total time by which all those callbacks were late. */
+        int maxLatenessMs;          /**< The longest time by which any one callback was late. */
+
+        /** Returns the average time by which each callback was late. */
+        double getAverageLatenessMs() const noexcept;
+
+        /** Returns the average number of timers that were called back by each message. */
+        double getAverageCallbacksPerMessage() const noexcept;
+    };
+
+    /** Returns some statistics about the timer callbacks that have been made so far.
+
+        A callback's lateness is the time between the moment it was due and the moment
+        that the message thread actually got around to calling it, so this can be used
+        to find out whether the message thread is keeping up.
+
+        @see resetLatenessStatistics
+    */
+    static LatenessStatistics JUCE_CALLTYPE getLatenessStatistics();
+
+    /** Clears the counters that are returned by getLatenessStatistics(). */
+    static void JUCE_CALLTYPE resetLatenessStatistics();
+
 private:
     class TimerThread;
     friend class TimerThread;
-    int countdownMs, periodMs;
+    int64 dueTime;
+    int periodMs, listIndex;
     Timer* previous;
     Timer* next;
 
@@ -105,6 +105,17 @@ public:
     virtual void setFont (const Font& newFont) = 0;
     virtual const Font& getFont() = 0;
     virtual void drawGlyph (int glyphNumber, const AffineTransform& transform) = 0;
+
+    /** Draws a run of glyphs in the current font, each one at its position with the
+        transform applied. Contexts that can draw a batch of glyphs more quickly than
+        drawing them one at a time can override this.
+    */
+    virtual void drawGlyphs (const int* glyphNumbers, const Point<float>* positions, int numGlyphs, const AffineTransform& transform)
+    {
+        for (int i = 0; i < numGlyphs; ++i)
+            drawGlyph (glyphNumbers[i], AffineTransform::translation (positions[i].x, positions[i].y).followedBy (transform));
+    }
+
     virtual bool drawTextLayout (const AttributedString&, const Rectangle<float>&)  { return false; }
 };
 
@@ -23,6 +23,277 @@
   ==============================================================================
 */
 
+//==============================================================================
+/*  Records the drawing operations of a deferred renderer and replays them over a set of
+    horizontal bands, each with its own state stack. Every band keeps the whole clip region
+    but is only allowed to touch the pixels in its own rows, so that paths and glyphs are
+    rasterised exactly as they would be in normal mode. Clipping and state changes are both
+    applied to the renderer's own state (so that queries like getClipBounds() give the same
+    answers as in normal mode) and recorded, while drawing operations are only recorded.
+
+    Glyphs are rendered into the glyph cache's shared images on the recording thread, so the
+    worker threads never need to touch a typeface.
+*/
+class LowLevelGraphicsSoftwareRenderer::DeferredRenderer
+{
+public:
+    typedef RenderingHelpers::SoftwareRendererSavedState StateType;
+    typedef RenderingHelpers::SavedStateStack<StateType> StateStack;
+
+    DeferredRenderer (const Image& image, const Point<int>& origin, const RectangleList& initialClip,
+                      ThreadPool& threadPoolToUse, int numBands)
+        : threadPool (threadPoolToUse)
+    {
+        const Rectangle<int> area (initialClip.getBounds().getIntersection (image.getBounds()));
+        numBands = jlimit (1, jmax (1, area.getHeight()), numBands);
+
+        for (int i = 0; i < numBands; ++i)
+        {
+            const int top    = area.getY() + (area.getHeight() * i) / numBands;
+            const int bottom = area.getY() + (area.getHeight() * (i + 1)) / numBands;
+
+            StateType* const state = new StateType (image, initialClip, origin.x, origin.y);
+            state->restrictDrawingToBand (Rectangle<int> (area.getX(), top, area.getWidth(), bottom - top));
+
+            bands.add (new Band (*this, state));
+        }
+    }
+
+    ~DeferredRenderer()
+    {
+        flush();
+    }
+
+    //==============================================================================
+    struct Command
+    {
+        virtual ~Command() {}
+        virtual void render (StateStack&) const = 0;
+    };
+
+    void add (Command* const command)
+    {
+        commands.add (command);
+    }
+
+    void flush()
+    {
+        if (commands.size() > 0)
+        {
+            for (int i = 1; i < bands.size(); ++i)
+                threadPool.addJob (bands.getUnchecked (i), false);
+
+            bands.getUnchecked (0)->render();
+
+            for (int i = 1; i < bands.size(); ++i)
+                threadPool.waitForJobToFinish (bands.getUnchecked (i), -1);
+
+            commands.clear();
+        }
+    }
+
+    //==============================================================================
+    struct SetOrigin  : public Command
+    {
+        SetOrigin (int x_, int y_) noexcept : x (x_), y (y_) {}
+        void render (StateStack& s) const       { s->transform.setOrigin (x, y); }
+        const int x, y;
+    };
+
+    struct AddTransform  : public Command
+    {
+        AddTransform (const AffineTransform& t) noexcept : transform (t) {}
+        void render (StateStack& s) const       { s->transform.addTransform (transform); }
+        const AffineTransform transform;
+    };
+
+    struct ClipToRectangle  : public Command
+    {
+        ClipToRectangle (const Rectangle<int>& r) noexcept : area (r) {}
+        void render (StateStack& s) const       { s->clipToRectangle (area); }
+        const Rectangle<int> area;
+    };
+
+    struct ClipToRectangleList  : public Command
+    {
+        ClipToRectangleList (const RectangleList& r) : list (r) {}
+        void render (StateStack& s) const       { s->clipToRectangleList (list); }
+        const RectangleList list;
+    };
+
+    struct ExcludeClipRectangle  : public Command
+    {
+        ExcludeClipRectangle (const Rectangle<int>& r) noexcept : area (r) {}
+        void render (StateStack& s) const       { s->excludeClipRectangle (area); }
+        const Rectangle<int> area;
+    };
+
+    struct ClipToPath  : public Command
+    {
+        ClipToPath (const Path& p, const AffineTransform& t) : path (p), transform (t) {}
+        void render (StateStack& s) const       { s->clipToPath (path, transform); }
+        const Path path;
+        const AffineTransform transform;
+    };
+
+    struct ClipToImageAlpha  : public Command
+    {
+        ClipToImageAlpha (const Image& i, const AffineTransform& t) : image (i), transform (t) {}
+        void render (StateStack& s) const       { s->clipToImageAlpha (image, transform); }
+        const Image image;
+        const AffineTransform transform;
+    };
+
+    struct SaveState  : public Command
+    {
+        void render (StateStack& s) const       { s.save(); }
+    };
+
+    struct RestoreState  : public Command
+    {
+        void render (StateStack& s) const       { s.restore(); }
+    };
+
+    struct BeginTransparencyLayer  : public Command
+    {
+        BeginTransparencyLayer (float o) noexcept : opacity (o) {}
+        void render (StateStack& s) const       { s.beginTransparencyLayer (opacity); }
+        const float opacity;
+    };
+
+    struct EndTransparencyLayer  : public Command
+    {
+        void render (StateStack& s) const       { s.endTransparencyLayer(); }
+    };
+
+    struct SetFill  : public Command
+    {
+        SetFill (const FillType& f) : fillType (f) {}
+        void render (StateStack& s) const       { s->fillType = fillType; }
+        const FillType fillType;
+    };
+
+    struct SetOpacity  : public Command
+    {
+        SetOpacity (float o) noexcept : opacity (o) {}
+        void render (StateStack& s) const       { s->fillType.setOpacity (opacity); }
+        const float opacity;
+    };
+
+    struct SetInterpolationQuality  : public Command
+    {
+        SetInterpolationQuality (Graphics::ResamplingQuality q) noexcept : quality (q) {}
+        void render (StateStack& s) const       { s->interpolationQuality = quality; }
+        const Graphics::ResamplingQuality quality;
+    };
+
+    struct FillRect  : public Command
+    {
+        FillRect (const Rectangle<int>& r, bool replace) noexcept : area (r), replaceExistingContents (replace) {}
+        void render (StateStack& s) const       { s->fillRect (area, replaceExistingContents); }
+        const Rectangle<int> area;
+        const bool replaceExistingContents;
+    };
+
+    struct FillRectFloat  : public Command
+    {
+        FillRectFloat (const Rectangle<float>& r) noexcept : area (r) {}
+        void render (StateStack& s) const       { s->fillRect (area); }
+        const Rectangle<float> area;
+    };
+
+    struct FillPath  : public Command
+    {
+        FillPath (const Path& p, const AffineTransform& t) : path (p), transform (t) {}
+        void render (StateStack& s) const       { s->fillPath (path, transform); }
+        const Path path;
+        const AffineTransform transform;
+    };
+
+    struct DrawImage  : public Command
+    {
+        DrawImage (const Image& i, const AffineTransform& t) : image (i), transform (t) {}
+        void render (StateStack& s) const       { s->renderImage (image, transform, nullptr); }
+        const Image image;
+        const AffineTransform transform;
+    };
+
+    // A cached glyph, positioned relative to the current origin.
+    struct FillAlphaMask  : public Command
+    {
+        FillAlphaMask (const Image& m, const Rectangle<int>& area, int x_, int y_) : mask (m), maskArea (area), x (x_), y (y_) {}
+        void render (StateStack& s) const       { s->fillAlphaMask (mask, maskArea, x, y); }
+        const Image mask;
+        const Rectangle<int> maskArea;
+        const int x, y;
+    };
+
+    // A glyph that has already been transformed into device space.
+    struct FillDeviceSpaceEdgeTable  : public Command
+    {
+        FillDeviceSpaceEdgeTable (EdgeTable* et) noexcept : edgeTable (et) {}
+
+        void render (StateStack& s) const
+        {
+            if (s->clip != nullptr)
+                s->fillShape (new RenderingHelpers::ClipRegions::EdgeTableRegion (*edgeTable), false);
+        }
+
+        const ScopedPointer<EdgeTable> edgeTable;
+    };
+
+    // Used as the target for a GlyphCache, so that cached glyphs get recorded instead of drawn.
+    struct GlyphRecorder
+    {
+        GlyphRecorder (DeferredRenderer& o) noexcept : owner (o) {}
+
+        void fillAlphaMask (const Image& mask, const Rectangle<int>& maskArea, const int x, const int y)
+        {
+            owner.add (new FillAlphaMask (mask, maskArea, x, y));
+        }
+
+        DeferredRenderer& owner;
+    };
+
+private:
+    //==============================================================================
+    class Band  : public ThreadPoolJob
+    {
+    public:
+        Band (DeferredRenderer& o, StateType* initialState)
+            : ThreadPoolJob ("Rendering band"), owner (o), state (initialState)
+        {
+        }
+
+        JobStatus runJob()
+        {
+            render();
+            return jobHasFinished;
+        }
+
+        void render()
+        {
+            const OwnedArray<Command>& commands = owner.commands;
+
+            for (int i = 0; i < commands.size(); ++i)
+                commands.getUnchecked (i)->render (state);
+        }
+
+    private:
+        DeferredRenderer& owner;
+        StateStack state;
+
+        JUCE_DECLARE_NON_COPYABLE (Band)
+    };
+
+    ThreadPool& threadPool;
+    OwnedArray<Band> bands;
+    OwnedArray<Command> commands;
+
+    JUCE_DECLARE_NON_COPYABLE (DeferredRenderer)
+};
+
+//==============================================================================
 LowLevelGraphicsSoftwareRenderer::LowLevelGraphicsSoftwareRenderer (const Image& image)
     : savedState (new RenderingHelpers::SoftwareRendererSavedState (image, image.getBounds()))
 {
@@ -34,29 +305,86 @@ LowLevelGraphicsSoftwareRenderer::LowLevelGraphicsSoftwareRenderer (const Image&
 {
 }
 
-LowLevelGraphicsSoftwareRenderer::~LowLevelGraphicsSoftwareRenderer() {}
+LowLevelGraphicsSoftwareRenderer::LowLevelGraphicsSoftwareRenderer (const Image& image, const Point<int>& origin,
+                                                                    const RectangleList& initialClip,
+                                                                    ThreadPool& threadPool, const int numBands)
+    : savedState (new RenderingHelpers::SoftwareRendererSavedState (image, initialClip, origin.x, origin.y)),
+      deferredRenderer (new DeferredRenderer (image, origin, initialClip, threadPool, numBands))
+{
+}
+
+LowLevelGraphicsSoftwareRenderer::~LowLevelGraphicsSoftwareRenderer()
+{
+    flush();
+}
+
+void LowLevelGraphicsSoftwareRenderer::flush()
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->flush();
+}
 
 //==============================================================================
 bool LowLevelGraphicsSoftwareRenderer::isVectorDevice() const                         { return false; }
 
-void LowLevelGraphicsSoftwareRenderer::setOrigin (int x, int y)                       { savedState->transform.setOrigin (x, y); }
-void LowLevelGraphicsSoftwareRenderer::addTransform (const AffineTransform& t)        { savedState->transform.addTransform (t); }
+void LowLevelGraphicsSoftwareRenderer::setOrigin (int x, int y)
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::SetOrigin (x, y));
+
+    savedState->transform.setOrigin (x, y);
+}
+
+void LowLevelGraphicsSoftwareRenderer::addTransform (const AffineTransform& t)
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::AddTransform (t));
+
+    savedState->transform.addTransform (t);
+}
+
 float LowLevelGraphicsSoftwareRenderer::getScaleFactor()                              { return savedState->transform.getScaleFactor(); }
 
 Rectangle<int> LowLevelGraphicsSoftwareRenderer::getClipBounds() const                { return savedState->getClipBounds(); }
 bool LowLevelGraphicsSoftwareRenderer::isClipEmpty() const                            { return savedState->clip == nullptr; }
 
-bool LowLevelGraphicsSoftwareRenderer::clipToRectangle (const Rectangle<int>& r)      { return savedState->clipToRectangle (r); }
-bool LowLevelGraphicsSoftwareRenderer::clipToRectangleList (const RectangleList& r)   { return savedState->clipToRectangleList (r); }
-void LowLevelGraphicsSoftwareRenderer::excludeClipRectangle (const Rectangle<int>& r) { savedState->excludeClipRectangle (r); }
+bool LowLevelGraphicsSoftwareRenderer::clipToRectangle (const Rectangle<int>& r)
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::ClipToRectangle (r));
+
+    return savedState->clipToRectangle (r);
+}
+
+bool LowLevelGraphicsSoftwareRenderer::clipToRectangleList (const RectangleList& r)
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::ClipToRectangleList (r));
+
+    return savedState->clipToRectangleList (r);
+}
+
+void LowLevelGraphicsSoftwareRenderer::excludeClipRectangle (const Rectangle<int>& r)
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::ExcludeClipRectangle (r));
+
+    savedState->excludeClipRectangle (r);
+}
 
 void LowLevelGraphicsSoftwareRenderer::clipToPath (const Path& path, const AffineTransform& transform)
 {
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::ClipToPath (path, transform));
+
     savedState->clipToPath (path, transform);
 }
 
 void LowLevelGraphicsSoftwareRenderer::clipToImageAlpha (const Image& sourceImage, const AffineTransform& transform)
 {
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::ClipToImageAlpha (sourceImage, transform));
+
     savedState->clipToImageAlpha (sourceImage, transform);
 }
 
@@ -66,42 +394,97 @@ bool LowLevelGraphicsSoftwareRenderer::clipRegionIntersects (const Rectangle<int
 }
 
 //==============================================================================
-void LowLevelGraphicsSoftwareRenderer::saveState()                              { savedState.save(); }
-void LowLevelGraphicsSoftwareRenderer::restoreState()                           { savedState.restore(); }
+void LowLevelGraphicsSoftwareRenderer::saveState()
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::SaveState());
+
+    savedState.save();
+}
+
+void LowLevelGraphicsSoftwareRenderer::restoreState()
+{
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::RestoreState());
+
+    savedState.restore();
+}
 
-void LowLevelGraphicsSoftwareRenderer::beginTransparencyLayer (float opacity)   { savedState.beginTransparencyLayer (opacity); }
-void LowLevelGraphicsSoftwareRenderer::endTransparencyLayer()                   { savedState.endTransparencyLayer(); }
+void LowLevelGraphicsSoftwareRenderer::beginTransparencyLayer (float opacity)
+{
+    if (deferredRenderer != nullptr)
+    {
+        // (the recorded state only needs to track the clip and transform, which a layer doesn't change)
+        deferredRenderer->add (new DeferredRenderer::BeginTransparencyLayer (opacity));
+        savedState.save();
+    }
+    else
+    {
+        savedState.beginTransparencyLayer (opacity);
+    }
+}
+
+void LowLevelGraphicsSoftwareRenderer::endTransparencyLayer()
+{
+    if (deferredRenderer != nullptr)
+    {
+        deferredRenderer->add (new DeferredRenderer::EndTransparencyLayer());
+        savedState.restore();
+    }
+    else
+    {
+        savedState.endTransparencyLayer();
+    }
+}
 
 //==============================================================================
 void LowLevelGraphicsSoftwareRenderer::setFill (const FillType& fillType)
 {
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::SetFill (fillType));
+
     savedState->fillType = fillType;
 }
 
 void LowLevelGraphicsSoftwareRenderer::setOpacity (float newOpacity)
 {
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::SetOpacity (newOpacity));
+
     savedState->fillType.setOpacity (newOpacity);
 }
 
 void LowLevelGraphicsSoftwareRenderer::setInterpolationQuality (Graphics::ResamplingQuality quality)
 {
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::SetInterpolationQuality (quality));
+
     savedState->interpolationQuality = quality;
 }
 
 //==============================================================================
 void LowLevelGraphicsSoftwareRenderer::fillRect (const Rectangle<int>& r, const bool replaceExistingContents)
 {
-    savedState->fillRect (r, replaceExistingContents);
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::FillRect (r, replaceExistingContents));
+    else
+        savedState->fillRect (r, replaceExistingContents);
 }
 
 void LowLevelGraphicsSoftwareRenderer::fillPath (const Path& path, const AffineTransform& transform)
 {
-    savedState->fillPath (path, transform);
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::FillPath (path, transform));
+    else
+        savedState->fillPath (path, transform);
 }
 
 void LowLevelGraphicsSoftwareRenderer::drawImage (const Image& sourceImage, const AffineTransform& transform)
 {
-    savedState->renderImage (sourceImage, transform, nullptr);
+    if (deferredRenderer != nullptr)
+        deferredRenderer->add (new DeferredRenderer::DrawImage (sourceImage, transform));
+    else
+        savedState->renderImage (sourceImage, transform, nullptr);
 }
 
 void LowLevelGraphicsSoftwareRenderer::drawLine (const Line <float>& line)
@@ -114,36 +497,303 @@ void LowLevelGraphicsSoftwareRenderer::drawLine (const Line <float>& line)
 void LowLevelGraphicsSoftwareRenderer::drawVerticalLine (const int x, const float top, const float bottom)
 {
     if (bottom > top)
-        savedState->fillRect (Rectangle<float> ((float) x, top, 1.0f, bottom - top));
+    {
+        const Rectangle<float> r ((float) x, top, 1.0f, bottom - top);
+
+        if (deferredRenderer != nullptr)
+            deferredRenderer->add (new DeferredRenderer::FillRectFloat (r));
+        else
+            savedState->fillRect (r);
+    }
 }
 
 void LowLevelGraphicsSoftwareRenderer::drawHorizontalLine (const int y, const float left, const float right)
 {
     if (right > left)
-        savedState->fillRect (Rectangle<float> (left, (float) y, right - left, 1.0f));
+    {
+        const Rectangle<float> r (left, (float) y, right - left, 1.0f);
+
+        if (deferredRenderer != nullptr)
+            deferredRenderer->add (new DeferredRenderer::FillRectFloat (r));
+        else
+            savedState->fillRect (r);
+    }
 }
 
 void LowLevelGraphicsSoftwareRenderer::drawGlyph (int glyphNumber, const AffineTransform& transform)
 {
     const Font& f = savedState->font;
 
+    if (transform.isOnlyTranslation() && savedState->transform.isOnlyTranslated)
+    {
+        const Point<float> position (transform.getTranslationX(), transform.getTranslationY());
+        drawGlyphs (&glyphNumber, &position, 1, AffineTransform::identity);
+    }
+    else
+    {
+        const float fontHeight = f.getHeight();
+        const AffineTransform glyphTransform (AffineTransform::scale (fontHeight * f.getHorizontalScale(), fontHeight)
+                                                              .followedBy (transform));
+
+        if (deferredRenderer != nullptr)
+        {
+            if (savedState->clip != nullptr)
+                if (EdgeTable* const et = f.getTypeface()->getEdgeTableForGlyph (glyphNumber, savedState->transform.getTransformWith (glyphTransform)))
+                    deferredRenderer->add (new DeferredRenderer::FillDeviceSpaceEdgeTable (et));
+        }
+        else
+        {
+            savedState->drawGlyph (f, glyphNumber, glyphTransform);
+        }
+    }
+}
+
+void LowLevelGraphicsSoftwareRenderer::drawGlyphs (const int* glyphNumbers, const Point<float>* positions,
+                                                   int numGlyphs, const AffineTransform& transform)
+{
     if (transform.isOnlyTranslation() && savedState->transform.isOnlyTranslated)
     {
         using namespace RenderingHelpers;
 
-        GlyphCache <CachedGlyphEdgeTable <SoftwareRendererSavedState>, SoftwareRendererSavedState>::getInstance()
-            .drawGlyph (*savedState, f, glyphNumber,
-                        transform.getTranslationX(),
-                        transform.getTranslationY());
+        if (deferredRenderer != nullptr)
+        {
+            DeferredRenderer::GlyphRecorder recorder (*deferredRenderer);
+
+            GlyphCache <CachedGlyphBitmap <DeferredRenderer::GlyphRecorder>, DeferredRenderer::GlyphRecorder>::getInstance()
+                .drawGlyphs (recorder, savedState->font, glyphNumbers, positions, numGlyphs,
+                             transform.getTranslationX(),
+                             transform.getTranslationY());
+        }
+        else
+        {
+            GlyphCache <CachedGlyphBitmap <SoftwareRendererSavedState>, SoftwareRendererSavedState>::getInstance()
+                .drawGlyphs (*savedState, savedState->font, glyphNumbers, positions, numGlyphs,
+                             transform.getTranslationX(),
+                             transform.getTranslationY());
+        }
     }
     else
     {
-        const float fontHeight = f.getHeight();
-        savedState->drawGlyph (f, glyphNumber,
-                               AffineTransform::scale (fontHeight * f.getHorizontalScale(), fontHeight)
-                                               .followedBy (transform));
+        LowLevelGraphicsContext::drawGlyphs (glyphNumbers, positions, numGlyphs, transform);
     }
 }
 
 void LowLevelGraphicsSoftwareRenderer::setFont (const Font& newFont)    { savedState->font = newFont; }
 const Font& LowLevelGraphicsSoftwareRenderer::getFont()                 { return savedState->font; }
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class SoftwareRendererTests  : public UnitTest
+{
+public:
+    SoftwareRendererTests() : UnitTest ("LowLevelGraphicsSoftwareRenderer") {}
+
+    static Typeface::Ptr createTestTypeface()
+    {
+        CustomTypeface* const typeface = new CustomTypeface();
+
+        for (juce_wchar c = 'a'; c <= 'z'; ++c)
+        {
+            Path p;
+            p.addEllipse (0.0f, -0.7f, 0.3f + (c % 5) * 0.1f, 0.7f);
+            p.addRectangle (0.05f * (c % 7), -0.9f, 0.08f, 0.9f);
+            p.setUsingNonZeroWinding (false);
+            typeface->addGlyph (c, p, 0.3f + (c % 5) * 0.1f + 0.1f);
+        }
+
+        return typeface;
+    }
+
+    // Draws something like a screenful of meters and waveforms, using most of the renderer's features.
+    static void drawTestScene (Graphics& g, const int width, const int height, const Font& font, const Image& sprite)
+    {
+        g.fillAll (Colours::darkgrey);
+        Random r (1234);
+
+        const int numMeters = 64;
+        const float meterWidth = width / (float) numMeters;
+
+        for (int i = 0; i < numMeters; ++i)
+        {
+            const float level = r.nextFloat();
+            g.setGradientFill (ColourGradient (Colours::red, 0.0f, 0.0f, Colours::green, 0.0f, height * 0.4f, false));
+            g.fillRect (i * meterWidth + 1.0f, height * 0.4f * (1.0f - level), meterWidth - 2.0f, height * 0.4f * level);
+            g.setColour (Colours::white.withAlpha (0.5f));
+            g.drawVerticalLine ((int) (i * meterWidth), 0.0f, height * 0.4f);
+        }
+
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            const float top = height * (0.42f + lane * 0.06f);
+            const float laneHeight = height * 0.05f;
+
+            Path waveform;
+            waveform.startNewSubPath (0.0f, top + laneHeight * 0.5f);
+
+            for (int x = 0; x < width; x += 2)
+                waveform.lineTo ((float) x, top + laneHeight * (0.5f + 0.45f * std::sin (x * 0.013f * (lane + 1)) * r.nextFloat()));
+
+            g.setColour (Colour::fromHSV (lane / 8.0f, 0.7f, 0.9f, 1.0f));
+            g.strokePath (waveform, PathStrokeType (1.5f));
+            g.drawHorizontalLine ((int) (top + laneHeight), 0.0f, (float) width);
+        }
+
+        g.setFont (font);
+        g.setColour (Colours::yellow);
+
+        for (int i = 0; i < 40; ++i)
+            g.drawSingleLineText ("the quick brown fox jumps over the lazy dog",
+                                  r.nextInt (width), r.nextInt (height));
+
+        g.saveState();
+        g.addTransform (AffineTransform::rotation (0.3f, width * 0.5f, height * 0.5f));
+        g.drawSingleLineText ("rotated text", width / 2, height / 2);
+        g.drawImageTransformed (sprite, AffineTransform::scale (3.3f).translated (width * 0.3f, height * 0.6f));
+        g.restoreState();
+
+        for (int i = 0; i < 20; ++i)
+            g.drawImageAt (sprite, r.nextInt (width), r.nextInt (height));
+
+        g.saveState();
+        Path clipShape;
+        clipShape.addEllipse (width * 0.6f, height * 0.1f, width * 0.3f, height * 0.7f);
+        g.reduceClipRegion (clipShape);
+        g.excludeClipRegion (Rectangle<int> (width * 3 / 4, height / 3, 50, 200));
+        g.setTiledImageFill (sprite, 7, 3, 0.8f);
+        g.fillAll();
+        g.restoreState();
+
+        g.beginTransparencyLayer (0.6f);
+        g.setColour (Colours::cyan);
+        g.fillRoundedRectangle (width * 0.1f + 0.3f, height * 0.8f + 0.6f, width * 0.5f, height * 0.15f, 20.0f);
+        g.setColour (Colours::black);
+        g.drawText ("layer", width / 10, height * 8 / 10, width / 2, height / 10, Justification::centred, false);
+        g.endTransparencyLayer();
+
+        g.setColour (Colours::blue.withAlpha (0.3f));
+        g.fillEllipse (width * 0.2f + 0.25f, height * 0.3f + 0.75f, width * 0.4f, height * 0.5f);
+    }
+
+    static Image createSprite()
+    {
+        Image sprite (Image::ARGB, 40, 30, true);
+        Graphics g (sprite);
+        g.setGradientFill (ColourGradient (Colours::orange, 0.0f, 0.0f, Colours::transparentBlack, 40.0f, 30.0f, true));
+        g.fillAll();
+        return sprite;
+    }
+
+    static bool imagesAreIdentical (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+
+        for (int y = 0; y < a.getHeight(); ++y)
+            if (memcmp (da.getLinePointer (y), db.getLinePointer (y), (size_t) (a.getWidth() * da.pixelStride)) != 0)
+                return false;
+
+        return true;
+    }
+
+    static double render (Image& image, const Point<int>& origin, const RectangleList& clip,
+                          const Font& font, const Image& sprite, ThreadPool* pool, int numBands)
+    {
+        image.clear (image.getBounds());
+        const int64 start = Time::getHighResolutionTicks();
+
+        {
+            ScopedPointer<LowLevelGraphicsSoftwareRenderer> renderer;
+
+            if (pool != nullptr)
+                renderer = new LowLevelGraphicsSoftwareRenderer (image, origin, clip, *pool, numBands);
+            else
+                renderer = new LowLevelGraphicsSoftwareRenderer (image, origin, clip);
+
+            Graphics g (renderer);
+            drawTestScene (g, image.getWidth(), image.getHeight(), font, sprite);
+        }
+
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+
+    void runTest()
+    {
+        const Font font (Font (createTestTypeface()).withHeight (17.0f));
+        const Image sprite (createSprite());
+        const int numThreads = jmax (2, SystemStats::getNumCpus());
+        ThreadPool pool (numThreads);
+
+        beginTest ("Deferred rendering");
+        {
+            const int width = 800, height = 600;
+            Image expected (Image::ARGB, width, height, true);
+            Image image (Image::ARGB, width, height, true);
+
+            RectangleList clip (Rectangle<int> (0, 0, width, height));
+            render (expected, Point<int>(), clip, font, sprite, nullptr, 0);
+
+            for (int numBands = 1; numBands <= 13; numBands += 3)
+            {
+                render (image, Point<int>(), clip, font, sprite, &pool, numBands);
+                expect (imagesAreIdentical (image, expected));
+            }
+
+            clip.clear();
+            clip.add (Rectangle<int> (10, 10, 300, 200));
+            clip.add (Rectangle<int> (200, 150, 500, 400));
+            clip.subtract (Rectangle<int> (250, 250, 40, 40));
+            const Point<int> origin (-13, 7);
+
+            render (expected, origin, clip, font, sprite, nullptr, 0);
+            render (image, origin, clip, font, sprite, &pool, 7);
+            expect (imagesAreIdentical (image, expected));
+        }
+
+        beginTest ("Flushing");
+        {
+            Image expected (Image::ARGB, 300, 200, true);
+            Image image (Image::ARGB, 300, 200, true);
+
+            {
+                Graphics g (expected);
+                g.fillAll (Colours::red);
+                g.setColour (Colours::green);
+                g.fillEllipse (10.5f, 10.5f, 200.0f, 150.0f);
+            }
+
+            LowLevelGraphicsSoftwareRenderer renderer (image, Point<int>(), RectangleList (image.getBounds()), pool, 4);
+            Graphics g (&renderer);
+            g.fillAll (Colours::red);
+            g.setColour (Colours::green);
+
+            renderer.flush();
+            expect (image.getPixelAt (100, 100) == Colours::red);
+
+            g.fillEllipse (10.5f, 10.5f, 200.0f, 150.0f);
+            renderer.flush();
+            expect (imagesAreIdentical (image, expected));
+        }
+
+        beginTest ("Performance");
+        {
+            const int width = 3840, height = 2160;
+            Image image (Image::ARGB, width, height, true);
+            const RectangleList clip (image.getBounds());
+
+            logMessage ("Rendering a " + String (width) + "x" + String (height) + " scene with "
+                          + String (numThreads) + " threads:");
+
+            render (image, Point<int>(), clip, font, sprite, nullptr, 0); // (warms up the caches)
+            logMessage ("  immediate: " + String (render (image, Point<int>(), clip, font, sprite, nullptr, 0), 1) + "ms");
+
+            for (int numBands = 1; numBands <= 16; numBands *= 2)
+                logMessage ("  deferred, " + String (numBands) + " bands: "
+                              + String (render (image, Point<int>(), clip, font, sprite, &pool, numBands), 1) + "ms");
+        }
+    }
+};
+
+static SoftwareRendererTests softwareRendererTests;
+
+#endif
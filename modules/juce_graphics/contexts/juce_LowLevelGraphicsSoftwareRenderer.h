@@ -36,6 +36,20 @@
 
     User code is not supposed to create instances of this class directly - do all your
     rendering via the Graphics class instead.
+
+    A renderer can also be created in a deferred mode, where instead of drawing each
+    operation immediately, it records them and then replays them on a ThreadPool, with
+    the clip region split into horizontal bands that are each rendered by a separate
+    job. The result is identical to what the normal mode would produce. To use this
+    for a window, you could override LookAndFeel::createGraphicsContext(), e.g.
+    @code
+    LowLevelGraphicsContext* createGraphicsContext (const Image& image, const Point<int>& origin,
+                                                    const RectangleList& initialClip)
+    {
+        return new LowLevelGraphicsSoftwareRenderer (image, origin, initialClip,
+                                                     renderingThreadPool, 8);
+    }
+    @endcode
 */
 class JUCE_API  LowLevelGraphicsSoftwareRenderer    : public LowLevelGraphicsContext
 {
@@ -44,8 +58,30 @@ public:
     LowLevelGraphicsSoftwareRenderer (const Image& imageToRenderOnto);
     LowLevelGraphicsSoftwareRenderer (const Image& imageToRenderOnto, const Point<int>& origin,
                                       const RectangleList& initialClip);
+
+    /** Creates a renderer which draws in parallel.
+
+        All the drawing operations are recorded, and when flush() is called or the
+        renderer is deleted, they're replayed on the given thread pool, with the clip
+        region split into the given number of horizontal bands. The calling thread
+        renders one of the bands itself, and then waits for the others to finish.
+
+        The image must be one whose pixel data can be accessed directly (e.g. a software
+        image), and any images that are drawn must not be changed until the operations
+        have been flushed.
+    */
+    LowLevelGraphicsSoftwareRenderer (const Image& imageToRenderOnto, const Point<int>& origin,
+                                      const RectangleList& initialClip,
+                                      ThreadPool& threadPoolToUse, int numBands);
+
     ~LowLevelGraphicsSoftwareRenderer();
 
+    /** When the renderer is in deferred mode, this renders all the operations that have
+        been recorded so far, and waits for them to be finished. In normal mode, this
+        does nothing.
+    */
+    void flush();
+
     bool isVectorDevice() const;
     void setOrigin (int x, int y);
     void addTransform (const AffineTransform&);
@@ -82,6 +118,7 @@ public:
     const Font& getFont();
     void drawGlyph (int glyphNumber, float x, float y);
     void drawGlyph (int glyphNumber, const AffineTransform&);
+    void drawGlyphs (const int* glyphNumbers, const Point<float>* positions, int numGlyphs, const AffineTransform&);
 
     const Image& getImage() const noexcept                                          { return savedState->image; }
     const RenderingHelpers::TranslationOrTransform& getTransform() const noexcept   { return savedState->transform; }
@@ -89,6 +126,11 @@ public:
 protected:
     RenderingHelpers::SavedStateStack <RenderingHelpers::SoftwareRendererSavedState> savedState;
 
+private:
+    class DeferredRenderer;
+    friend class DeferredRenderer;
+    ScopedPointer<DeferredRenderer> deferredRenderer;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LowLevelGraphicsSoftwareRenderer)
 };
 
@@ -75,9 +75,9 @@ struct JUCE_API  DropShadow
     shadow based on what gets drawn inside it. The shadow will also
     be applied to the component's children.
 
-    For speed, this doesn't use a proper gaussian blur, but cheats by
-    using a simple bilinear filter. If you need a really high-quality
-    shadow, check out ImageConvolutionKernel::createGaussianBlur()
+    The shadow is blurred with ImageConvolutionKernel::applyGaussianBlur(),
+    which approximates large blurs with a few passes of a box filter, so
+    its cost doesn't grow with the shadow's radius.
 
     @see Component::setComponentEffect
 */
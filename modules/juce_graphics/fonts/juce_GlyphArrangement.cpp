@@ -719,30 +719,55 @@ inline void GlyphArrangement::drawGlyphUnderline (const Graphics& g, const Posit
     g.fillPath (p, transform);
 }
 
-void GlyphArrangement::draw (const Graphics& g) const
+// Hands the glyphs to the context in runs that share the same font, so that it can draw each
+// run in one go rather than having to set up for every glyph.
+void GlyphArrangement::drawGlyphRuns (const Graphics& g, const AffineTransform& transform) const
 {
-    for (int i = 0; i < glyphs.size(); ++i)
+    LowLevelGraphicsContext& context = g.getInternalContext();
+
+    const int maxRunLength = 64;
+    int glyphNumbers [maxRunLength];
+    Point<float> positions [maxRunLength];
+
+    for (int i = 0; i < glyphs.size();)
     {
-        const PositionedGlyph& pg = glyphs.getReference(i);
+        const Font& font = glyphs.getReference(i).font;
+        int num = 0;
+
+        for (; i < glyphs.size() && num < maxRunLength; ++i)
+        {
+            const PositionedGlyph& pg = glyphs.getReference(i);
+
+            if (! (pg.font == font))
+                break;
 
-        if (pg.font.isUnderlined())
-            drawGlyphUnderline (g, pg, i, AffineTransform::identity);
+            if (font.isUnderlined())
+                drawGlyphUnderline (g, pg, i, transform);
+
+            if (! pg.isWhitespace())
+            {
+                glyphNumbers [num] = pg.glyph;
+                positions [num].setXY (pg.x, pg.y);
+                ++num;
+            }
+        }
 
-        pg.draw (g);
+        if (num > 0)
+        {
+            context.setFont (font);
+            context.drawGlyphs (glyphNumbers, positions, num, transform);
+        }
     }
 }
 
-void GlyphArrangement::draw (const Graphics& g, const AffineTransform& transform) const
+void GlyphArrangement::draw (const Graphics& g) const
 {
-    for (int i = 0; i < glyphs.size(); ++i)
-    {
-        const PositionedGlyph& pg = glyphs.getReference(i);
-
-        if (pg.font.isUnderlined())
-            drawGlyphUnderline (g, pg, i, transform);
+    drawGlyphRuns (g, AffineTransform::identity);
+}
 
-        pg.draw (g, transform);
-    }
+void GlyphArrangement::draw (const Graphics& g, const AffineTransform& transform) const
+{
+    drawGlyphRuns (g, transform);
 }
 
 void GlyphArrangement::createPath (Path& path) const
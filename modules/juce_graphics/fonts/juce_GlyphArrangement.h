@@ -309,6 +309,7 @@ private:
                           const Justification&, float minimumHorizontalScale);
     void spreadOutLine (int start, int numGlyphs, float targetWidth);
     void drawGlyphUnderline (const Graphics&, const PositionedGlyph&, int, const AffineTransform&) const;
+    void drawGlyphRuns (const Graphics&, const AffineTransform&) const;
 
     JUCE_LEAK_DETECTOR (GlyphArrangement)
 };
@@ -211,11 +211,22 @@ void TextLayout::draw (Graphics& g, const Rectangle<float>& area) const
             context.setFont (run.font);
             context.setFill (run.colour);
 
-            for (int k = 0; k < run.glyphs.size(); ++k)
+            const int maxBatchSize = 64;
+            int glyphNumbers [maxBatchSize];
+            Point<float> positions [maxBatchSize];
+
+            for (int k = 0; k < run.glyphs.size();)
             {
-                const Glyph& glyph = run.glyphs.getReference (k);
-                context.drawGlyph (glyph.glyphCode, AffineTransform::translation (lineOrigin.x + glyph.anchor.x,
-                                                                                  lineOrigin.y + glyph.anchor.y));
+                int num = 0;
+
+                for (; k < run.glyphs.size() && num < maxBatchSize; ++k, ++num)
+                {
+                    const Glyph& glyph = run.glyphs.getReference (k);
+                    glyphNumbers [num] = glyph.glyphCode;
+                    positions [num] = glyph.anchor;
+                }
+
+                context.drawGlyphs (glyphNumbers, positions, num, AffineTransform::translation (lineOrigin.x, lineOrigin.y));
             }
         }
     }
@@ -99,193 +99,866 @@ void ImageConvolutionKernel::createGaussianBlur (const float radius)
 }
 
 //==============================================================================
-void ImageConvolutionKernel::applyToImage (Image& destImage,
-                                           const Image& sourceImage,
-                                           const Rectangle<int>& destinationArea) const
+namespace ImageConvolutionHelpers
 {
-    if (sourceImage == destImage)
+    static bool canUseSSE2() noexcept
     {
-        destImage.duplicateIfShared();
+       #if JUCE_USE_SSE_INTRINSICS
+        return RenderingHelpers::PixelSpanHelpers::getSIMDLevel() >= RenderingHelpers::PixelSpanHelpers::sse2;
+       #else
+        return false;
+       #endif
     }
-    else
+
+    // dest[i] += src[i] * multiplier
+    static void addWithMultiply (float* dest, const float* src, const float multiplier, int num) noexcept
     {
-        if (sourceImage.getWidth() != destImage.getWidth()
-             || sourceImage.getHeight() != destImage.getHeight()
-             || sourceImage.getFormat() != destImage.getFormat())
+       #if JUCE_USE_SSE_INTRINSICS
+        if (canUseSSE2())
         {
-            jassertfalse;
-            return;
+            const __m128 m = _mm_set1_ps (multiplier);
+
+            for (; num >= 4; num -= 4)
+            {
+                _mm_storeu_ps (dest, _mm_add_ps (_mm_loadu_ps (dest), _mm_mul_ps (_mm_loadu_ps (src), m)));
+                dest += 4;
+                src += 4;
+            }
         }
+       #endif
+
+        while (--num >= 0)
+            *dest++ += *src++ * multiplier;
     }
 
-    const Rectangle<int> area (destinationArea.getIntersection (destImage.getBounds()));
+    // total[i] += added[i] - removed[i], then dest[i] = total[i] * multiplier
+    static void updateRunningTotal (float* total, float* dest, const float* added, const float* removed,
+                                    const float multiplier, int num) noexcept
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        if (canUseSSE2())
+        {
+            const __m128 m = _mm_set1_ps (multiplier);
+
+            for (; num >= 4; num -= 4)
+            {
+                const __m128 t = _mm_add_ps (_mm_loadu_ps (total), _mm_sub_ps (_mm_loadu_ps (added), _mm_loadu_ps (removed)));
+                _mm_storeu_ps (total, t);
+                _mm_storeu_ps (dest, _mm_mul_ps (t, m));
+                total += 4;
+                dest += 4;
+                added += 4;
+                removed += 4;
+            }
+        }
+       #endif
+
+        while (--num >= 0)
+        {
+            *total += *added++ - *removed++;
+            *dest++ = *total++ * multiplier;
+        }
+    }
 
-    if (area.isEmpty())
-        return;
+    static void loadLine (float* dest, const Image::BitmapData& srcData, const int x, const int y,
+                          const int width, const int numChannels) noexcept
+    {
+        zeromem (dest, sizeof (float) * (size_t) (width * numChannels));
 
-    const int right = area.getRight();
-    const int bottom = area.getBottom();
+        if (isPositiveAndBelow (y, srcData.height))
+        {
+            const int start = jmax (0, x);
+            const int end = jmin (srcData.width, x + width);
 
-    const Image::BitmapData destData (destImage, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
-                                      Image::BitmapData::writeOnly);
-    uint8* line = destData.data;
+            if (start < end)
+            {
+                const uint8* src = srcData.getPixelPointer (start, y);
+                dest += (start - x) * numChannels;
 
-    const Image::BitmapData srcData (sourceImage, Image::BitmapData::readOnly);
+                for (int i = (end - start) * numChannels; --i >= 0;)
+                    *dest++ = (float) *src++;
+            }
+        }
+    }
 
-    if (destData.pixelStride == 4)
+    static void storeLine (uint8* dest, const float* src, int num) noexcept
     {
-        for (int y = area.getY(); y < bottom; ++y)
+       #if JUCE_USE_SSE_INTRINSICS
+        if (canUseSSE2())
         {
-            uint8* dest = line;
-            line += destData.lineStride;
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 maxLevel = _mm_set1_ps (255.0f);
 
-            for (int x = area.getX(); x < right; ++x)
+            for (; num >= 16; num -= 16)
             {
-                float c1 = 0;
-                float c2 = 0;
-                float c3 = 0;
-                float c4 = 0;
+                const __m128i a = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (src),      zero), maxLevel));
+                const __m128i b = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (src + 4),  zero), maxLevel));
+                const __m128i c = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (src + 8),  zero), maxLevel));
+                const __m128i d = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (src + 12), zero), maxLevel));
+
+                _mm_storeu_si128 ((__m128i*) dest, _mm_packus_epi16 (_mm_packs_epi32 (a, b), _mm_packs_epi32 (c, d)));
+                src += 16;
+                dest += 16;
+            }
+        }
+       #endif
+
+        while (--num >= 0)
+            *dest++ = (uint8) jlimit (0, 255, roundToInt (*src++));
+    }
+
+    // Box-blurs a line of interleaved channels, producing one output pixel for each
+    // position at which the whole box fits inside the source.
+    static void boxBlurLine (const float* src, float* dest, const int numOut,
+                             const int numChannels, const int radius) noexcept
+    {
+        const int width = radius * 2 + 1;
+        const float multiplier = 1.0f / width;
+        float total[4] = { 0 };
+
+        for (int i = 0; i < width; ++i)
+            for (int c = 0; c < numChannels; ++c)
+                total[c] += src [i * numChannels + c];
+
+        for (int c = 0; c < numChannels; ++c)
+            dest[c] = total[c] * multiplier;
+
+        const float* added = src + width * numChannels;
+        const float* removed = src;
+
+        for (int x = 1; x < numOut; ++x)
+        {
+            dest += numChannels;
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                total[c] += *added++ - *removed++;
+                dest[c] = total[c] * multiplier;
+            }
+        }
+    }
+
+    // The same as boxBlurLine, but working down the columns of a block of lines.
+    static void boxBlurLines (const float* src, float* dest, float* total, const int numOut,
+                              const int lineLength, const int radius) noexcept
+    {
+        const int width = radius * 2 + 1;
+        const float multiplier = 1.0f / width;
+
+        zeromem (total, sizeof (float) * (size_t) lineLength);
+
+        for (int i = 0; i < width - 1; ++i)
+            addWithMultiply (total, src + i * lineLength, 1.0f, lineLength);
+
+        // the first window has nothing to remove, so it subtracts a line of zeros
+        float* const firstLine = dest;
+        zeromem (firstLine, sizeof (float) * (size_t) lineLength);
+        updateRunningTotal (total, firstLine, src + (width - 1) * lineLength, firstLine, multiplier, lineLength);
+
+        for (int y = 1; y < numOut; ++y)
+            updateRunningTotal (total, dest + y * lineLength, src + (y + width - 1) * lineLength,
+                                src + (y - 1) * lineLength, multiplier, lineLength);
+    }
+
+    //==============================================================================
+    /*  A one-dimensional filter, which is either a list of weights or a series of box blurs.
+        Each output pixel needs 'before' source pixels before it and 'after' pixels after it.
+    */
+    struct LinearFilter
+    {
+        LinearFilter() noexcept : numBoxes (0), before (0), after (0) {}
+
+        void setWeights (const Array<float>& newWeights, const int centre)
+        {
+            weights = newWeights;
+            numBoxes = 0;
+            before = centre;
+            after = jmax (0, weights.size() - 1 - centre);
+        }
+
+        void setGaussian (const float radius)
+        {
+            const int halfSize = radius > 0 ? (int) std::ceil (radius * 3.0f) : 0;
+            const double radiusFactor = halfSize > 0 ? -1.0 / (radius * radius * 2) : 0.0;
+
+            Array<float> newWeights;
+            double total = 0;
+
+            for (int i = -halfSize; i <= halfSize; ++i)
+            {
+                const double w = exp (radiusFactor * i * i);
+                newWeights.add ((float) w);
+                total += w;
+            }
+
+            for (int i = 0; i < newWeights.size(); ++i)
+                newWeights.getReference (i) = (float) (newWeights.getUnchecked (i) / total);
+
+            setWeights (newWeights, halfSize);
+        }
+
+        // Picks the widths of three box filters whose combined variance is as close as
+        // possible to that of a gaussian with the given radius.
+        void setBoxApproximation (const float radius)
+        {
+            const double variance = radius * radius;
+            const int n = numElementsInArray (boxRadii);
+
+            int lowerWidth = (int) std::sqrt (12.0 * variance / n + 1.0);
+
+            if ((lowerWidth & 1) == 0)
+                --lowerWidth;
+
+            lowerWidth = jmax (1, lowerWidth);
+
+            const int numLower = roundToInt ((12.0 * variance - n * lowerWidth * lowerWidth - 4.0 * n * lowerWidth - 3.0 * n)
+                                               / (-4.0 * lowerWidth - 4.0));
+
+            weights.clearQuick();
+            numBoxes = n;
+            before = after = 0;
+
+            for (int i = 0; i < n; ++i)
+            {
+                boxRadii[i] = ((i < numLower ? lowerWidth : lowerWidth + 2) - 1) / 2;
+                before += boxRadii[i];
+            }
+
+            after = before;
+        }
 
-                for (int yy = 0; yy < size; ++yy)
+        int getNumExtra() const noexcept    { return before + after; }
+
+        // Filters a line of (numOut + getNumExtra()) pixels into numOut pixels.
+        // The temp buffer needs to be twice the size of the source line.
+        void applyToLine (const float* src, float* dest, float* temp,
+                          const int numOut, const int numChannels) const noexcept
+        {
+            if (numBoxes > 0)
+            {
+                const int lineLength = (numOut + getNumExtra()) * numChannels;
+                int length = numOut + getNumExtra();
+
+                for (int i = 0; i < numBoxes; ++i)
                 {
-                    const int sy = y + yy - (size >> 1);
+                    length -= 2 * boxRadii[i];
+                    float* const target = (i == numBoxes - 1) ? dest : (temp + (i & 1) * lineLength);
+                    boxBlurLine (src, target, length, numChannels, boxRadii[i]);
+                    src = target;
+                }
+            }
+            else
+            {
+                const int num = numOut * numChannels;
+                zeromem (dest, sizeof (float) * (size_t) num);
 
-                    if (sy >= srcData.height)
-                        break;
+                for (int i = 0; i < weights.size(); ++i)
+                    if (weights.getUnchecked (i) != 0)
+                        addWithMultiply (dest, src + i * numChannels, weights.getUnchecked (i), num);
+            }
+        }
 
-                    if (sy >= 0)
-                    {
-                        int sx = x - (size >> 1);
-                        const uint8* src = srcData.getPixelPointer (sx, sy);
+        // Filters down the columns of (numOut + getNumExtra()) lines in 'src', returning a pointer
+        // to the numOut resulting lines, which will be in either 'src' or 'spare'.
+        float* applyToLines (float* src, float* spare, float* temp,
+                             const int numOut, const int lineLength) const noexcept
+        {
+            if (numBoxes > 0)
+            {
+                int numLines = numOut + getNumExtra();
 
-                        for (int xx = 0; xx < size; ++xx)
-                        {
-                            if (sx >= srcData.width)
-                                break;
-
-                            if (sx >= 0)
-                            {
-                                const float kernelMult = values [xx + yy * size];
-                                c1 += kernelMult * *src++;
-                                c2 += kernelMult * *src++;
-                                c3 += kernelMult * *src++;
-                                c4 += kernelMult * *src++;
-                            }
-                            else
-                            {
-                                src += 4;
-                            }
-
-                            ++sx;
-                        }
-                    }
+                for (int i = 0; i < numBoxes; ++i)
+                {
+                    numLines -= 2 * boxRadii[i];
+                    boxBlurLines (src, spare, temp, numLines, lineLength, boxRadii[i]);
+                    std::swap (src, spare);
                 }
 
-                *dest++ = (uint8) jmin (0xff, roundToInt (c1));
-                *dest++ = (uint8) jmin (0xff, roundToInt (c2));
-                *dest++ = (uint8) jmin (0xff, roundToInt (c3));
-                *dest++ = (uint8) jmin (0xff, roundToInt (c4));
+                return src;
             }
+
+            for (int y = 0; y < numOut; ++y)
+            {
+                float* const dest = spare + y * lineLength;
+                zeromem (dest, sizeof (float) * (size_t) lineLength);
+
+                for (int i = 0; i < weights.size(); ++i)
+                    if (weights.getUnchecked (i) != 0)
+                        addWithMultiply (dest, src + (y + i) * lineLength, weights.getUnchecked (i), lineLength);
+            }
+
+            return spare;
+        }
+
+        Array<float> weights;
+        int boxRadii[3], numBoxes, before, after;
+    };
+
+    // If the kernel is the product of a row and a column, this finds them.
+    static bool findSeparableFilters (const float* values, const int size,
+                                      LinearFilter& horizontal, LinearFilter& vertical)
+    {
+        if (size <= 0)
+            return false;
+
+        int peak = 0;
+
+        for (int i = 1; i < size * size; ++i)
+            if (std::abs (values[i]) > std::abs (values[peak]))
+                peak = i;
+
+        const float peakValue = values[peak];
+
+        if (peakValue == 0)
+            return false;
+
+        const int peakX = peak % size;
+        const int peakY = peak / size;
+        Array<float> row, column;
+
+        for (int i = 0; i < size; ++i)
+        {
+            row.add (values [i + peakY * size]);
+            column.add (values [peakX + i * size] / peakValue);
         }
+
+        const float tolerance = std::abs (peakValue) * 1.0e-5f;
+
+        for (int y = 0; y < size; ++y)
+            for (int x = 0; x < size; ++x)
+                if (std::abs (values [x + y * size] - row.getUnchecked (x) * column.getUnchecked (y)) > tolerance)
+                    return false;
+
+        horizontal.setWeights (row, size >> 1);
+        vertical.setWeights (column, size >> 1);
+        return true;
     }
-    else if (destData.pixelStride == 3)
+
+    //==============================================================================
+    /*  Renders the convolution a strip of lines at a time: the source lines each strip needs
+        are loaded and filtered horizontally, and then the vertical filter runs down the strip.
+        If there's no separable filter, 'kernel' is a full 2-D kernel that's applied in the
+        vertical stage instead.
+    */
+    class Convolver
     {
-        for (int y = area.getY(); y < bottom; ++y)
+    public:
+        Convolver (const Image::BitmapData& source, const Image::BitmapData& dest, const Rectangle<int>& area_,
+                   const LinearFilter& horizontal_, const LinearFilter& vertical_,
+                   const float* kernel_, const int kernelSize_) noexcept
+            : srcData (source), destData (dest), area (area_),
+              horizontal (horizontal_), vertical (vertical_),
+              kernel (kernel_), kernelSize (kernelSize_), numChannels (dest.pixelStride)
+        {
+        }
+
+        void render (const int top, const int bottom) const
+        {
+            const int rowsPerStrip = jmax (32, vertical.getNumExtra() * 2);
+            const int inputWidth = area.getWidth() + horizontal.getNumExtra();
+            const int inputLength = (kernel != nullptr ? inputWidth : area.getWidth()) * numChannels;
+            const int maxLines = rowsPerStrip + vertical.getNumExtra();
+
+            HeapBlock<float> lines ((size_t) (maxLines * inputLength)), spareLines ((size_t) (maxLines * inputLength));
+            HeapBlock<float> temp ((size_t) (jmax (inputWidth * numChannels * 3, inputLength)));
+
+            for (int y = top; y < bottom; y += rowsPerStrip)
+                renderStrip (y, jmin (bottom, y + rowsPerStrip), lines, spareLines, temp, inputWidth, inputLength);
+        }
+
+    private:
+        const Image::BitmapData& srcData;
+        const Image::BitmapData& destData;
+        const Rectangle<int> area;
+        const LinearFilter& horizontal;
+        const LinearFilter& vertical;
+        const float* const kernel;
+        const int kernelSize, numChannels;
+
+        void renderStrip (const int top, const int bottom, float* lines, float* spareLines, float* temp,
+                          const int inputWidth, const int inputLength) const noexcept
         {
-            uint8* dest = line;
-            line += destData.lineStride;
+            const int numOut = bottom - top;
+            const int numLines = numOut + vertical.getNumExtra();
+            const int sourceX = area.getX() - horizontal.before;
+            const int sourceY = top - vertical.before;
 
-            for (int x = area.getX(); x < right; ++x)
+            for (int i = 0; i < numLines; ++i)
             {
-                float c1 = 0;
-                float c2 = 0;
-                float c3 = 0;
+                float* const line = lines + i * inputLength;
 
-                for (int yy = 0; yy < size; ++yy)
+                if (kernel != nullptr)
                 {
-                    const int sy = y + yy - (size >> 1);
+                    loadLine (line, srcData, sourceX, sourceY + i, inputWidth, numChannels);
+                }
+                else
+                {
+                    loadLine (temp, srcData, sourceX, sourceY + i, inputWidth, numChannels);
+                    horizontal.applyToLine (temp, line, temp + inputWidth * numChannels, area.getWidth(), numChannels);
+                }
+            }
 
-                    if (sy >= srcData.height)
-                        break;
+            const int outputLength = area.getWidth() * numChannels;
+            const float* result;
 
-                    if (sy >= 0)
+            if (kernel != nullptr)
+            {
+                for (int y = 0; y < numOut; ++y)
+                {
+                    float* const dest = spareLines + y * outputLength;
+                    zeromem (dest, sizeof (float) * (size_t) outputLength);
+
+                    for (int ky = 0; ky < kernelSize; ++ky)
                     {
-                        int sx = x - (size >> 1);
-                        const uint8* src = srcData.getPixelPointer (sx, sy);
+                        const float* const src = lines + (y + ky) * inputLength;
 
-                        for (int xx = 0; xx < size; ++xx)
+                        for (int kx = 0; kx < kernelSize; ++kx)
                         {
-                            if (sx >= srcData.width)
-                                break;
-
-                            if (sx >= 0)
-                            {
-                                const float kernelMult = values [xx + yy * size];
-                                c1 += kernelMult * *src++;
-                                c2 += kernelMult * *src++;
-                                c3 += kernelMult * *src++;
-                            }
-                            else
-                            {
-                                src += 3;
-                            }
-
-                            ++sx;
+                            const float k = kernel [kx + ky * kernelSize];
+
+                            if (k != 0)
+                                addWithMultiply (dest, src + kx * numChannels, k, outputLength);
                         }
                     }
                 }
 
-                *dest++ = (uint8) roundToInt (c1);
-                *dest++ = (uint8) roundToInt (c2);
-                *dest++ = (uint8) roundToInt (c3);
+                result = spareLines;
             }
+            else
+            {
+                result = vertical.applyToLines (lines, spareLines, temp, numOut, outputLength);
+            }
+
+            for (int y = 0; y < numOut; ++y)
+                storeLine (destData.getLinePointer (top + y - area.getY()), result + y * outputLength, outputLength);
         }
-    }
-    else if (destData.pixelStride == 1)
+
+        JUCE_DECLARE_NON_COPYABLE (Convolver)
+    };
+
+    class ConvolutionJob  : public ThreadPoolJob
     {
-        for (int y = area.getY(); y < bottom; ++y)
+    public:
+        ConvolutionJob (const Convolver& c, const int top_, const int bottom_)
+            : ThreadPoolJob ("Image convolution"), convolver (c), top (top_), bottom (bottom_)
+        {
+        }
+
+        JobStatus runJob()
         {
-            uint8* dest = line;
-            line += destData.lineStride;
+            convolver.render (top, bottom);
+            return jobHasFinished;
+        }
+
+    private:
+        const Convolver& convolver;
+        const int top, bottom;
+
+        JUCE_DECLARE_NON_COPYABLE (ConvolutionJob)
+    };
+
+    static void convolve (Image& destImage, const Image& sourceImage, const Rectangle<int>& destinationArea,
+                          const LinearFilter& horizontal, const LinearFilter& vertical,
+                          const float* kernel, const int kernelSize, ThreadPool* threadPool)
+    {
+        // this keeps the source's pixels intact if the destination needs to be duplicated
+        const Image source (sourceImage);
 
-            for (int x = area.getX(); x < right; ++x)
+        if (source == destImage)
+        {
+            destImage.duplicateIfShared();
+        }
+        else
+        {
+            if (source.getWidth() != destImage.getWidth()
+                 || source.getHeight() != destImage.getHeight()
+                 || source.getFormat() != destImage.getFormat())
             {
-                float c1 = 0;
+                jassertfalse;
+                return;
+            }
+        }
 
-                for (int yy = 0; yy < size; ++yy)
-                {
-                    const int sy = y + yy - (size >> 1);
+        const Rectangle<int> area (destinationArea.getIntersection (destImage.getBounds()));
 
-                    if (sy >= srcData.height)
-                        break;
+        if (area.isEmpty())
+            return;
 
-                    if (sy >= 0)
-                    {
-                        int sx = x - (size >> 1);
-                        const uint8* src = srcData.getPixelPointer (sx, sy);
+        const Image::BitmapData destData (destImage, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                                          Image::BitmapData::writeOnly);
 
-                        for (int xx = 0; xx < size; ++xx)
+        const Image::BitmapData srcData (source, Image::BitmapData::readOnly);
+
+        if (destData.pixelStride > 4 || srcData.pixelStride != destData.pixelStride)
+        {
+            jassertfalse;
+            return;
+        }
+
+        const Convolver convolver (srcData, destData, area, horizontal, vertical, kernel, kernelSize);
+
+        const int numStrips = threadPool != nullptr ? jlimit (1, jmax (1, area.getHeight() / 32), SystemStats::getNumCpus())
+                                                    : 1;
+        OwnedArray<ConvolutionJob> jobs;
+
+        for (int i = 1; i < numStrips; ++i)
+        {
+            jobs.add (new ConvolutionJob (convolver,
+                                          area.getY() + (area.getHeight() * i) / numStrips,
+                                          area.getY() + (area.getHeight() * (i + 1)) / numStrips));
+            threadPool->addJob (jobs.getLast(), false);
+        }
+
+        convolver.render (area.getY(), area.getY() + area.getHeight() / numStrips);
+
+        for (int i = 0; i < jobs.size(); ++i)
+            threadPool->waitForJobToFinish (jobs.getUnchecked (i), -1);
+    }
+}
+
+//==============================================================================
+void ImageConvolutionKernel::applyToImage (Image& destImage,
+                                           const Image& sourceImage,
+                                           const Rectangle<int>& destinationArea,
+                                           ThreadPool* threadPool) const
+{
+    using namespace ImageConvolutionHelpers;
+    LinearFilter horizontal, vertical;
+
+    if (findSeparableFilters (values, size, horizontal, vertical))
+    {
+        convolve (destImage, sourceImage, destinationArea, horizontal, vertical, nullptr, 0, threadPool);
+    }
+    else
+    {
+        // The whole kernel gets applied by the vertical stage, so these filters just describe how
+        // many extra source pixels it needs around each destination pixel.
+        Array<float> span;
+        span.insertMultiple (0, 0.0f, size);
+        horizontal.setWeights (span, size >> 1);
+        vertical.setWeights (span, size >> 1);
+
+        convolve (destImage, sourceImage, destinationArea, horizontal, vertical, values, size, threadPool);
+    }
+}
+
+void ImageConvolutionKernel::applyGaussianBlur (Image& destImage,
+                                                const Image& sourceImage,
+                                                const Rectangle<int>& destinationArea,
+                                                const float blurRadius,
+                                                ThreadPool* threadPool)
+{
+    using namespace ImageConvolutionHelpers;
+    LinearFilter filter;
+
+    // Below this, the boxes get too narrow to be a good approximation, but an exact gaussian is
+    // still cheap enough.
+    if (blurRadius < 2.5f)
+        filter.setGaussian (blurRadius);
+    else
+        filter.setBoxApproximation (blurRadius);
+
+    convolve (destImage, sourceImage, destinationArea, filter, filter, nullptr, 0, threadPool);
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class ImageConvolutionKernelTests  : public UnitTest
+{
+public:
+    ImageConvolutionKernelTests() : UnitTest ("ImageConvolutionKernel") {}
+
+    static Image createRandomImage (Random& r, const Image::PixelFormat format, const int w, const int h)
+    {
+        Image image (format, w, h, false);
+        const Image::BitmapData data (image, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < h; ++y)
+            for (int i = 0; i < w * data.pixelStride; ++i)
+                data.getLinePointer (y)[i] = (uint8) r.nextInt (256);
+
+        return image;
+    }
+
+    static Image createTestPattern (const int w, const int h)
+    {
+        Image image (Image::ARGB, w, h, true);
+        Graphics g (image);
+
+        g.setColour (Colours::white);
+        g.fillEllipse (w * 0.1f, h * 0.2f, w * 0.3f, h * 0.5f);
+        g.setColour (Colours::orange.withAlpha (0.7f));
+        g.fillRect (w / 2, h / 4, w / 3, h / 2);
+        g.setColour (Colours::blue);
+        g.drawLine (0.0f, 0.0f, (float) w, (float) h, 3.0f);
+        return image;
+    }
+
+    // A plain 2-D convolution, treating pixels outside the image as zero.
+    static Image applyReferenceKernel (const ImageConvolutionKernel& kernel, const Image& source, const Rectangle<int>& area)
+    {
+        Image result (source.createCopy());
+        const int size = kernel.getKernelSize();
+
+        const Image::BitmapData src (source, Image::BitmapData::readOnly);
+        const Image::BitmapData dest (result, Image::BitmapData::writeOnly);
+
+        for (int y = area.getY(); y < area.getBottom(); ++y)
+        {
+            for (int x = area.getX(); x < area.getRight(); ++x)
+            {
+                for (int c = 0; c < src.pixelStride; ++c)
+                {
+                    double total = 0;
+
+                    for (int ky = 0; ky < size; ++ky)
+                    {
+                        for (int kx = 0; kx < size; ++kx)
                         {
-                            if (sx >= srcData.width)
-                                break;
-
-                            if (sx >= 0)
-                            {
-                                const float kernelMult = values [xx + yy * size];
-                                c1 += kernelMult * *src++;
-                            }
-                            else
-                            {
-                                src += 3;
-                            }
-
-                            ++sx;
+                            const int sx = x + kx - (size >> 1);
+                            const int sy = y + ky - (size >> 1);
+
+                            if (isPositiveAndBelow (sx, src.width) && isPositiveAndBelow (sy, src.height))
+                                total += kernel.getKernelValue (kx, ky) * src.getPixelPointer (sx, sy)[c];
                         }
                     }
+
+                    dest.getPixelPointer (x, y)[c] = (uint8) jlimit (0, 255, roundToInt (total));
                 }
+            }
+        }
+
+        return result;
+    }
+
+    static int getMaxDifference (const Image& a, const Image& b, double* rmsDifference = nullptr)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+        int maxDiff = 0;
+        double total = 0;
 
-                *dest++ = (uint8) roundToInt (c1);
+        for (int y = 0; y < da.height; ++y)
+        {
+            for (int i = 0; i < da.width * da.pixelStride; ++i)
+            {
+                const int diff = std::abs (da.getLinePointer (y)[i] - db.getLinePointer (y)[i]);
+                maxDiff = jmax (maxDiff, diff);
+                total += diff * diff;
             }
         }
+
+        if (rmsDifference != nullptr)
+            *rmsDifference = std::sqrt (total / (da.height * da.width * da.pixelStride));
+
+        return maxDiff;
     }
-}
+
+    static void createExactGaussian (ImageConvolutionKernel& kernel, const float radius)
+    {
+        jassert (kernel.getKernelSize() == 2 * (int) std::ceil (radius * 3.0f) + 1);
+        kernel.createGaussianBlur (radius);
+    }
+
+    template <class Function>
+    static double timeOperation (Function f, const int numRepetitions)
+    {
+        const int64 start = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numRepetitions; ++i)
+            f();
+
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) / numRepetitions;
+    }
+
+    struct KernelOperation
+    {
+        KernelOperation (const ImageConvolutionKernel& k, Image& i, ThreadPool* p) : kernel (k), image (i), pool (p) {}
+        void operator()() const     { kernel.applyToImage (image, image, image.getBounds(), pool); }
+
+        const ImageConvolutionKernel& kernel;
+        Image& image;
+        ThreadPool* pool;
+    };
+
+    struct BlurOperation
+    {
+        BlurOperation (float r, Image& i, ThreadPool* p) : radius (r), image (i), pool (p) {}
+        void operator()() const     { ImageConvolutionKernel::applyGaussianBlur (image, image, image.getBounds(), radius, pool); }
+
+        float radius;
+        Image& image;
+        ThreadPool* pool;
+    };
+
+    void runTest()
+    {
+        Random r (0x1234);
+        const Image::PixelFormat formats[] = { Image::ARGB, Image::RGB, Image::SingleChannel };
+
+        beginTest ("Separable kernels");
+
+        for (int i = 0; i < numElementsInArray (formats); ++i)
+        {
+            const Image source (createRandomImage (r, formats[i], 53, 41));
+
+            for (int size = 1; size < 9; ++size)
+            {
+                ImageConvolutionKernel kernel (size);
+                kernel.createGaussianBlur (size * 0.3f);
+                kernel.rescaleAllValues (1.3f);
+
+                const Rectangle<int> area (r.nextInt (8), r.nextInt (8), 40, 30);
+                Image result (source.createCopy());
+                kernel.applyToImage (result, source, area);
+
+                expect (getMaxDifference (result, applyReferenceKernel (kernel, source, area)) <= 1);
+            }
+        }
+
+        beginTest ("Other kernels");
+
+        for (int i = 0; i < numElementsInArray (formats); ++i)
+        {
+            const Image source (createRandomImage (r, formats[i], 37, 29));
+
+            for (int size = 0; size < 7; ++size)
+            {
+                ImageConvolutionKernel kernel (size);
+
+                for (int y = 0; y < size; ++y)
+                    for (int x = 0; x < size; ++x)
+                        kernel.setKernelValue (x, y, r.nextFloat() * 0.8f - 0.3f);
+
+                Image result (source.createCopy());
+                kernel.applyToImage (result, source, result.getBounds());
+
+                expect (getMaxDifference (result, applyReferenceKernel (kernel, source, source.getBounds())) <= 1);
+            }
+        }
+
+        beginTest ("In-place convolution");
+
+        {
+            const Image source (createRandomImage (r, Image::ARGB, 60, 70));
+            Image image (source.createCopy());
+
+            ImageConvolutionKernel kernel (5);
+            kernel.createGaussianBlur (1.5f);
+            kernel.applyToImage (image, image, image.getBounds());
+
+            expect (getMaxDifference (image, applyReferenceKernel (kernel, source, source.getBounds())) <= 1);
+
+            Image blurred (source.createCopy());
+            ImageConvolutionKernel::applyGaussianBlur (blurred, source, source.getBounds(), 5.0f);
+
+            image = source.createCopy();
+            ImageConvolutionKernel::applyGaussianBlur (image, image, image.getBounds(), 5.0f);
+            expect (getMaxDifference (image, blurred) == 0);
+        }
+
+        beginTest ("Gaussian blur");
+
+        {
+            const Image source (createTestPattern (120, 90));
+
+            for (int i = 0; i < 6; ++i)
+            {
+                const float radius = 0.7f + i * 0.7f;
+                ImageConvolutionKernel kernel (2 * (int) std::ceil (radius * 3.0f) + 1);
+                createExactGaussian (kernel, radius);
+
+                Image blurred (source.createCopy());
+                ImageConvolutionKernel::applyGaussianBlur (blurred, source, source.getBounds(), radius);
+
+                double rms = 0;
+                const int maxDiff = getMaxDifference (blurred, applyReferenceKernel (kernel, source, source.getBounds()), &rms);
+                expect (maxDiff <= (radius < 2.5f ? 1 : 8), "radius " + String (radius) + ": " + String (maxDiff));
+                expect (rms < 1.5);
+            }
+        }
+
+        beginTest ("Multi-threaded rendering");
+
+        {
+            ThreadPool pool (3);
+            const Image source (createRandomImage (r, Image::ARGB, 150, 211));
+
+            for (int i = 0; i < 4; ++i)
+            {
+                const float radius = 1.0f + i * 4.0f;
+                Image single (source.createCopy()), threaded (source.createCopy());
+
+                ImageConvolutionKernel::applyGaussianBlur (single, source, source.getBounds(), radius);
+                ImageConvolutionKernel::applyGaussianBlur (threaded, source, source.getBounds(), radius, &pool);
+                expect (getMaxDifference (single, threaded) == 0);
+            }
+
+            ImageConvolutionKernel kernel (4);
+
+            for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x)
+                    kernel.setKernelValue (x, y, r.nextFloat() * 0.2f);
+
+            Image single (source.createCopy()), threaded (source.createCopy());
+            kernel.applyToImage (single, source, source.getBounds());
+            kernel.applyToImage (threaded, source, source.getBounds(), &pool);
+            expect (getMaxDifference (single, threaded) == 0);
+        }
+
+        beginTest ("Performance");
+
+        {
+            ThreadPool pool (SystemStats::getNumCpus());
+            Image image (createTestPattern (800, 600));
+            const double numMegapixels = image.getWidth() * image.getHeight() / 1.0e6;
+
+            logMessage ("Convolving an 800x600 ARGB image, single-threaded / with "
+                          + String (SystemStats::getNumCpus()) + " threads:");
+
+            for (int size = 5; size <= 25; size += 10)
+            {
+                ImageConvolutionKernel separable (size), general (size);
+                separable.createGaussianBlur (size / 6.0f);
+                general.createGaussianBlur (size / 6.0f);
+                general.setKernelValue (0, 0, 0.01f);
+
+                logMessage ("  " + String (size) + "x" + String (size) + " kernel: "
+                              + String (numMegapixels / timeOperation (KernelOperation (general, image, nullptr), 2), 1)
+                              + " Mpixels/sec as a 2-D kernel, "
+                              + String (numMegapixels / timeOperation (KernelOperation (separable, image, nullptr), 2), 1)
+                              + " / " + String (numMegapixels / timeOperation (KernelOperation (separable, image, &pool), 2), 1)
+                              + " Mpixels/sec separated");
+            }
+
+            const float radii[] = { 2.0f, 8.0f, 32.0f };
+
+            for (int i = 0; i < numElementsInArray (radii); ++i)
+            {
+                ImageConvolutionKernel exact (2 * (int) std::ceil (radii[i] * 3.0f) + 1);
+                createExactGaussian (exact, radii[i]);
+
+                const Image source (createTestPattern (400, 300));
+                Image blurred (source.createCopy());
+                ImageConvolutionKernel::applyGaussianBlur (blurred, source, source.getBounds(), radii[i]);
+
+                Image reference (source.createCopy());
+                exact.applyToImage (reference, source, source.getBounds());
+
+                double rms = 0;
+                const int maxDiff = getMaxDifference (blurred, reference, &rms);
+
+                logMessage ("  gaussian blur, radius " + String (radii[i]) + ": "
+                              + String (numMegapixels / timeOperation (BlurOperation (radii[i], image, nullptr), 3), 1)
+                              + " / " + String (numMegapixels / timeOperation (BlurOperation (radii[i], image, &pool), 3), 1)
+                              + " Mpixels/sec, error compared to an exact gaussian: max "
+                              + String (maxDiff) + ", rms " + String (rms, 2));
+            }
+        }
+    }
+};
+
+static ImageConvolutionKernelTests imageConvolutionKernelTests;
+
+#endif
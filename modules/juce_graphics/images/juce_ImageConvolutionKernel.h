@@ -92,15 +92,49 @@ public:
     //==============================================================================
     /** Applies the kernel to an image.
 
+        If the kernel is separable (i.e. each of its rows is a multiple of the same row, as
+        is the case for a gaussian blur), this is done as a horizontal pass followed by a
+        vertical one, so it costs (size * 2) multiplies per pixel rather than (size * size).
+
         @param destImage        the image that will receive the resultant convoluted pixels.
         @param sourceImage      the source image to read from - this can be the same image as
                                 the destination, but if different, it must be exactly the same
                                 size and format.
         @param destinationArea  the region of the image to apply the filter to
+        @param threadPool       if this isn't null, the area is split into horizontal strips
+                                which are rendered in parallel by the pool's threads. The
+                                result is the same as when it's done on a single thread.
     */
     void applyToImage (Image& destImage,
                        const Image& sourceImage,
-                       const Rectangle<int>& destinationArea) const;
+                       const Rectangle<int>& destinationArea,
+                       ThreadPool* threadPool = nullptr) const;
+
+    //==============================================================================
+    /** Applies a gaussian blur to an image, without needing a kernel object.
+
+        For small radii, this uses an exact gaussian, applied as a horizontal and then a
+        vertical pass. For larger ones, it approximates the gaussian with three successive
+        box blurs, which take the same time whatever the radius is, so this is much faster
+        than creating a big kernel with createGaussianBlur() and applying that.
+
+        Pixels beyond the edges of the source image are treated as being transparent.
+
+        @param destImage        the image that will receive the blurred pixels.
+        @param sourceImage      the source image to read from - this can be the same image as
+                                the destination, but if different, it must be exactly the same
+                                size and format.
+        @param destinationArea  the region of the image to blur
+        @param blurRadius       the standard deviation of the gaussian, in pixels - this has
+                                the same meaning as the parameter to createGaussianBlur()
+        @param threadPool       if this isn't null, the area is split into strips which are
+                                blurred in parallel by the pool's threads
+    */
+    static void applyGaussianBlur (Image& destImage,
+                                   const Image& sourceImage,
+                                   const Rectangle<int>& destinationArea,
+                                   float blurRadius,
+                                   ThreadPool* threadPool = nullptr);
 
 private:
     //==============================================================================
@@ -85,6 +85,37 @@
  #include "native/freetype/FreeTypeAmalgam.h"
 #endif
 
+#ifndef JUCE_USE_SSE_INTRINSICS
+ #define JUCE_USE_SSE_INTRINSICS 1
+#endif
+
+#if ! JUCE_INTEL
+ #undef JUCE_USE_SSE_INTRINSICS
+#endif
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#endif
+
+// The AVX2 code is only called after checking the CPU, so it just needs a compiler that can build
+// it without the whole project being compiled for AVX2.
+#ifndef JUCE_USE_AVX2_INTRINSICS
+ #if JUCE_USE_SSE_INTRINSICS && ((JUCE_GCC && (defined (__clang__) || (__GNUC__ * 100 + __GNUC_MINOR__) >= 409)) \
+                                  || (JUCE_MSVC && _MSC_VER >= 1800))
+  #define JUCE_USE_AVX2_INTRINSICS 1
+ #endif
+#endif
+
+#if JUCE_USE_AVX2_INTRINSICS
+ #include <immintrin.h>
+
+ #if JUCE_GCC
+  #define JUCE_AVX2_FUNCTION  __attribute__ ((target ("avx2")))
+ #else
+  #define JUCE_AVX2_FUNCTION
+ #endif
+#endif
+
 #undef SIZEOF
 
 #if (JUCE_MAC || JUCE_IOS) && USE_COREGRAPHICS_RENDERING && JUCE_USE_COREIMAGE_LOADER
@@ -112,6 +143,7 @@ namespace juce
 #include "contexts/juce_GraphicsContext.cpp"
 #include "contexts/juce_LowLevelGraphicsPostScriptRenderer.cpp"
 #include "contexts/juce_LowLevelGraphicsSoftwareRenderer.cpp"
+#include "native/juce_RenderingHelpers.cpp"
 #include "images/juce_Image.cpp"
 #include "images/juce_ImageCache.cpp"
 #include "images/juce_ImageConvolutionKernel.cpp"
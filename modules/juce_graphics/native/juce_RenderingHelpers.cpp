@@ -0,0 +1,954 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library - "Jules' Utility Class Extensions"
+   Copyright 2004-11 by Raw Material Software Ltd.
+
+  ------------------------------------------------------------------------------
+
+   JUCE can be redistributed and/or modified under the terms of the GNU General
+   Public License (Version 2), as published by the Free Software Foundation.
+   A copy of the license is included in the JUCE distribution, or can be found
+   online at www.gnu.org/licenses.
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+  ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.rawmaterialsoftware.com/juce for more information.
+
+  ==============================================================================
+*/
+
+namespace RenderingHelpers
+{
+
+namespace PixelSpanHelpers
+{
+    enum { noSIMD = 0, sse2 = 1, avx2 = 2 };
+
+    static int simdLevel = -1;
+
+    static int getSIMDLevel() noexcept
+    {
+        if (simdLevel < 0)
+        {
+            simdLevel = noSIMD;
+
+           #if JUCE_USE_SSE_INTRINSICS
+            if (SystemStats::hasSSE2())
+                simdLevel = sse2;
+           #endif
+
+           #if JUCE_USE_AVX2_INTRINSICS
+            if (SystemStats::hasAVX2())
+                simdLevel = avx2;
+           #endif
+        }
+
+        return simdLevel;
+    }
+
+   #if JUCE_USE_SSE_INTRINSICS
+    //==============================================================================
+    /*  These do the same sums as PixelARGB::blend() and friends, on whole registers. The
+        multiplies never overflow a 16-bit lane, so each 32-bit pixel can be treated as a pair
+        of 16-bit components, and the final additions are done as 32-bit adds so that any
+        carries between the components also match the scalar code.
+    */
+    forcedinline __m128i blendARGB (__m128i dest, __m128i src, __m128i inverseAlpha) noexcept
+    {
+        const __m128i mask = _mm_set1_epi32 (0x00ff00ff);
+        const __m128i rb = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_and_si128 (dest, mask), inverseAlpha), 8);
+        const __m128i ag = _mm_andnot_si128 (mask, _mm_mullo_epi16 (_mm_srli_epi16 (dest, 8), inverseAlpha));
+
+        return _mm_add_epi32 (_mm_add_epi32 (src, rb), ag);
+    }
+
+    forcedinline __m128i multiplyAlphaARGB (__m128i src, __m128i multiplier) noexcept
+    {
+        const __m128i mask = _mm_set1_epi32 (0x00ff00ff);
+
+        return _mm_or_si128 (_mm_andnot_si128 (mask, _mm_mullo_epi16 (_mm_srli_epi16 (src, 8), multiplier)),
+                             _mm_srli_epi16 (_mm_mullo_epi16 (_mm_and_si128 (src, mask), multiplier), 8));
+    }
+
+    forcedinline __m128i getInverseAlphasARGB (__m128i src) noexcept
+    {
+        const __m128i alpha = _mm_sub_epi32 (_mm_set1_epi32 (0x100), _mm_srli_epi32 (src, 24));
+        return _mm_or_si128 (alpha, _mm_slli_epi32 (alpha, 16));
+    }
+
+    // For formats with independent 8-bit channels: dest = src + ((dest * inverseAlpha) >> 8)
+    forcedinline __m128i blendBytes (__m128i dest, __m128i src, __m128i inverseAlphaLo, __m128i inverseAlphaHi) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lo = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (dest, zero), inverseAlphaLo), 8);
+        const __m128i hi = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (dest, zero), inverseAlphaHi), 8);
+
+        return _mm_add_epi8 (_mm_packus_epi16 (lo, hi), src);
+    }
+
+    forcedinline __m128i loadSSE2 (const void* p) noexcept          { return _mm_loadu_si128 ((const __m128i*) p); }
+    forcedinline void storeSSE2 (void* p, __m128i v) noexcept       { _mm_storeu_si128 ((__m128i*) p, v); }
+
+    //==============================================================================
+    static void blendSSE2 (PixelARGB* dest, const PixelARGB& colour, int num) noexcept
+    {
+        const __m128i src = _mm_set1_epi32 ((int) colour.getARGB());
+        const __m128i inverseAlpha = _mm_set1_epi16 ((short) (0x100 - colour.getAlpha()));
+
+        for (; num >= 4; num -= 4, dest += 4)
+            storeSSE2 (dest, blendARGB (loadSSE2 (dest), src, inverseAlpha));
+
+        while (--num >= 0)
+            (dest++)->blend (colour);
+    }
+
+    static void blendSSE2 (PixelRGB* dest, const PixelARGB& colour, int num) noexcept
+    {
+        PixelRGB pattern [16];
+
+        for (int i = 0; i < numElementsInArray (pattern); ++i)
+            pattern[i].set (colour);
+
+        const uint8* const p = (const uint8*) pattern;
+        const __m128i src0 = loadSSE2 (p), src1 = loadSSE2 (p + 16), src2 = loadSSE2 (p + 32);
+        const __m128i inverseAlpha = _mm_set1_epi16 ((short) (0x100 - colour.getAlpha()));
+
+        for (; num >= 16; num -= 16, dest += 16)
+        {
+            uint8* const d = (uint8*) dest;
+            storeSSE2 (d,      blendBytes (loadSSE2 (d),      src0, inverseAlpha, inverseAlpha));
+            storeSSE2 (d + 16, blendBytes (loadSSE2 (d + 16), src1, inverseAlpha, inverseAlpha));
+            storeSSE2 (d + 32, blendBytes (loadSSE2 (d + 32), src2, inverseAlpha, inverseAlpha));
+        }
+
+        while (--num >= 0)
+            (dest++)->blend (colour);
+    }
+
+    static void blendSSE2 (PixelAlpha* dest, const PixelARGB& colour, int num) noexcept
+    {
+        const __m128i src = _mm_set1_epi8 ((char) colour.getAlpha());
+        const __m128i inverseAlpha = _mm_set1_epi16 ((short) (0x100 - colour.getAlpha()));
+
+        for (; num >= 16; num -= 16, dest += 16)
+            storeSSE2 (dest, blendBytes (loadSSE2 (dest), src, inverseAlpha, inverseAlpha));
+
+        while (--num >= 0)
+            (dest++)->blend (colour);
+    }
+
+    static void blendSSE2 (PixelARGB* dest, const PixelARGB* src, int num, const uint32 extraAlpha) noexcept
+    {
+        const __m128i multiplier = _mm_set1_epi16 ((short) (extraAlpha + 1));
+        const bool needsMultiplying = extraAlpha < 0xff;
+
+        for (; num >= 4; num -= 4, dest += 4, src += 4)
+        {
+            __m128i s = loadSSE2 (src);
+
+            if (needsMultiplying)
+                s = multiplyAlphaARGB (s, multiplier);
+
+            storeSSE2 (dest, blendARGB (loadSSE2 (dest), s, getInverseAlphasARGB (s)));
+        }
+
+        while (--num >= 0)
+            (dest++)->blend (*src++, extraAlpha);
+    }
+
+    static void blendSSE2 (PixelAlpha* dest, const PixelARGB* src, int num, const uint32 extraAlpha) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i multiplier = _mm_set1_epi16 ((short) (extraAlpha + 1));
+        const __m128i maxAlpha = _mm_set1_epi16 (0x100);
+
+        for (; num >= 8; num -= 8, dest += 8, src += 8)
+        {
+            __m128i s = _mm_packs_epi32 (_mm_srli_epi32 (loadSSE2 (src), 24),
+                                         _mm_srli_epi32 (loadSSE2 (src + 4), 24));
+
+            s = _mm_srli_epi16 (_mm_mullo_epi16 (s, multiplier), 8);
+
+            const __m128i d = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*) dest), zero);
+            const __m128i result = _mm_add_epi16 (_mm_srli_epi16 (_mm_mullo_epi16 (d, _mm_sub_epi16 (maxAlpha, s)), 8), s);
+
+            _mm_storel_epi64 ((__m128i*) dest, _mm_packus_epi16 (result, result));
+        }
+
+        while (--num >= 0)
+            (dest++)->blend (*src++, extraAlpha);
+    }
+
+    static void blendSSE2 (PixelAlpha* dest, const PixelAlpha* src, int num, const uint32 extraAlpha) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i multiplier = _mm_set1_epi16 ((short) (extraAlpha + 1));
+        const __m128i maxAlpha = _mm_set1_epi16 (0x100);
+
+        for (; num >= 16; num -= 16, dest += 16, src += 16)
+        {
+            const __m128i s = loadSSE2 (src);
+            const __m128i lo = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (s, zero), multiplier), 8);
+            const __m128i hi = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (s, zero), multiplier), 8);
+
+            storeSSE2 (dest, blendBytes (loadSSE2 (dest), _mm_packus_epi16 (lo, hi),
+                                         _mm_sub_epi16 (maxAlpha, lo), _mm_sub_epi16 (maxAlpha, hi)));
+        }
+
+        while (--num >= 0)
+            (dest++)->blend (*src++, extraAlpha);
+    }
+
+    static void fillSSE2 (PixelARGB* dest, const PixelARGB& colour, int num) noexcept
+    {
+        const __m128i src = _mm_set1_epi32 ((int) colour.getARGB());
+
+        for (; num >= 4; num -= 4, dest += 4)
+            storeSSE2 (dest, src);
+
+        while (--num >= 0)
+            (dest++)->set (colour);
+    }
+   #endif
+
+   #if JUCE_USE_AVX2_INTRINSICS
+    //==============================================================================
+    /*  The AVX2 versions of the functions above. These are compiled for AVX2 regardless of
+        the project's settings, and only get called if the CPU supports it. All the unpacking
+        and packing happens within each 128-bit half, so the pixels come back out in order.
+        Anything left over at the end of a span is handed on to the SSE2 version.
+    */
+    JUCE_AVX2_FUNCTION forcedinline __m256i blendARGB (__m256i dest, __m256i src, __m256i inverseAlpha) noexcept
+    {
+        const __m256i mask = _mm256_set1_epi32 (0x00ff00ff);
+        const __m256i rb = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_and_si256 (dest, mask), inverseAlpha), 8);
+        const __m256i ag = _mm256_andnot_si256 (mask, _mm256_mullo_epi16 (_mm256_srli_epi16 (dest, 8), inverseAlpha));
+
+        return _mm256_add_epi32 (_mm256_add_epi32 (src, rb), ag);
+    }
+
+    JUCE_AVX2_FUNCTION forcedinline __m256i multiplyAlphaARGB (__m256i src, __m256i multiplier) noexcept
+    {
+        const __m256i mask = _mm256_set1_epi32 (0x00ff00ff);
+
+        return _mm256_or_si256 (_mm256_andnot_si256 (mask, _mm256_mullo_epi16 (_mm256_srli_epi16 (src, 8), multiplier)),
+                                _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_and_si256 (src, mask), multiplier), 8));
+    }
+
+    JUCE_AVX2_FUNCTION forcedinline __m256i getInverseAlphasARGB (__m256i src) noexcept
+    {
+        const __m256i alpha = _mm256_sub_epi32 (_mm256_set1_epi32 (0x100), _mm256_srli_epi32 (src, 24));
+        return _mm256_or_si256 (alpha, _mm256_slli_epi32 (alpha, 16));
+    }
+
+    JUCE_AVX2_FUNCTION forcedinline __m256i blendBytes (__m256i dest, __m256i src, __m256i inverseAlphaLo, __m256i inverseAlphaHi) noexcept
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i lo = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_unpacklo_epi8 (dest, zero), inverseAlphaLo), 8);
+        const __m256i hi = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_unpackhi_epi8 (dest, zero), inverseAlphaHi), 8);
+
+        return _mm256_add_epi8 (_mm256_packus_epi16 (lo, hi), src);
+    }
+
+    JUCE_AVX2_FUNCTION forcedinline __m256i loadAVX2 (const void* p) noexcept       { return _mm256_loadu_si256 ((const __m256i*) p); }
+    JUCE_AVX2_FUNCTION forcedinline void storeAVX2 (void* p, __m256i v) noexcept    { _mm256_storeu_si256 ((__m256i*) p, v); }
+
+    //==============================================================================
+    JUCE_AVX2_FUNCTION static void blendAVX2 (PixelARGB* dest, const PixelARGB& colour, int num) noexcept
+    {
+        const __m256i src = _mm256_set1_epi32 ((int) colour.getARGB());
+        const __m256i inverseAlpha = _mm256_set1_epi16 ((short) (0x100 - colour.getAlpha()));
+
+        for (; num >= 8; num -= 8, dest += 8)
+            storeAVX2 (dest, blendARGB (loadAVX2 (dest), src, inverseAlpha));
+
+        _mm256_zeroupper();
+        blendSSE2 (dest, colour, num);
+    }
+
+    JUCE_AVX2_FUNCTION static void blendAVX2 (PixelRGB* dest, const PixelARGB& colour, int num) noexcept
+    {
+        PixelRGB pattern [32];
+
+        for (int i = 0; i < numElementsInArray (pattern); ++i)
+            pattern[i].set (colour);
+
+        const uint8* const p = (const uint8*) pattern;
+        const __m256i src0 = loadAVX2 (p), src1 = loadAVX2 (p + 32), src2 = loadAVX2 (p + 64);
+        const __m256i inverseAlpha = _mm256_set1_epi16 ((short) (0x100 - colour.getAlpha()));
+
+        for (; num >= 32; num -= 32, dest += 32)
+        {
+            uint8* const d = (uint8*) dest;
+            storeAVX2 (d,      blendBytes (loadAVX2 (d),      src0, inverseAlpha, inverseAlpha));
+            storeAVX2 (d + 32, blendBytes (loadAVX2 (d + 32), src1, inverseAlpha, inverseAlpha));
+            storeAVX2 (d + 64, blendBytes (loadAVX2 (d + 64), src2, inverseAlpha, inverseAlpha));
+        }
+
+        _mm256_zeroupper();
+        blendSSE2 (dest, colour, num);
+    }
+
+    JUCE_AVX2_FUNCTION static void blendAVX2 (PixelAlpha* dest, const PixelARGB& colour, int num) noexcept
+    {
+        const __m256i src = _mm256_set1_epi8 ((char) colour.getAlpha());
+        const __m256i inverseAlpha = _mm256_set1_epi16 ((short) (0x100 - colour.getAlpha()));
+
+        for (; num >= 32; num -= 32, dest += 32)
+            storeAVX2 (dest, blendBytes (loadAVX2 (dest), src, inverseAlpha, inverseAlpha));
+
+        _mm256_zeroupper();
+        blendSSE2 (dest, colour, num);
+    }
+
+    JUCE_AVX2_FUNCTION static void blendAVX2 (PixelARGB* dest, const PixelARGB* src, int num, const uint32 extraAlpha) noexcept
+    {
+        const __m256i multiplier = _mm256_set1_epi16 ((short) (extraAlpha + 1));
+        const bool needsMultiplying = extraAlpha < 0xff;
+
+        for (; num >= 8; num -= 8, dest += 8, src += 8)
+        {
+            __m256i s = loadAVX2 (src);
+
+            if (needsMultiplying)
+                s = multiplyAlphaARGB (s, multiplier);
+
+            storeAVX2 (dest, blendARGB (loadAVX2 (dest), s, getInverseAlphasARGB (s)));
+        }
+
+        _mm256_zeroupper();
+        blendSSE2 (dest, src, num, extraAlpha);
+    }
+
+    JUCE_AVX2_FUNCTION static void blendAVX2 (PixelAlpha* dest, const PixelAlpha* src, int num, const uint32 extraAlpha) noexcept
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i multiplier = _mm256_set1_epi16 ((short) (extraAlpha + 1));
+        const __m256i maxAlpha = _mm256_set1_epi16 (0x100);
+
+        for (; num >= 32; num -= 32, dest += 32, src += 32)
+        {
+            const __m256i s = loadAVX2 (src);
+            const __m256i lo = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_unpacklo_epi8 (s, zero), multiplier), 8);
+            const __m256i hi = _mm256_srli_epi16 (_mm256_mullo_epi16 (_mm256_unpackhi_epi8 (s, zero), multiplier), 8);
+
+            storeAVX2 (dest, blendBytes (loadAVX2 (dest), _mm256_packus_epi16 (lo, hi),
+                                         _mm256_sub_epi16 (maxAlpha, lo), _mm256_sub_epi16 (maxAlpha, hi)));
+        }
+
+        _mm256_zeroupper();
+        blendSSE2 (dest, src, num, extraAlpha);
+    }
+
+    JUCE_AVX2_FUNCTION static void fillAVX2 (PixelARGB* dest, const PixelARGB& colour, int num) noexcept
+    {
+        const __m256i src = _mm256_set1_epi32 ((int) colour.getARGB());
+
+        for (; num >= 8; num -= 8, dest += 8)
+            storeAVX2 (dest, src);
+
+        _mm256_zeroupper();
+        fillSSE2 (dest, colour, num);
+    }
+   #endif
+}
+
+#if JUCE_USE_SSE_INTRINSICS
+ #define JUCE_PERFORM_SSE2_SPAN_OP(function, args) \
+    if (PixelSpanHelpers::getSIMDLevel() >= PixelSpanHelpers::sse2) \
+    { \
+        PixelSpanHelpers::function args; \
+        return; \
+    }
+#else
+ #define JUCE_PERFORM_SSE2_SPAN_OP(function, args)
+#endif
+
+#if JUCE_USE_AVX2_INTRINSICS
+ #define JUCE_PERFORM_AVX2_SPAN_OP(function, args) \
+    if (PixelSpanHelpers::getSIMDLevel() >= PixelSpanHelpers::avx2) \
+    { \
+        PixelSpanHelpers::function args; \
+        return; \
+    }
+#else
+ #define JUCE_PERFORM_AVX2_SPAN_OP(function, args)
+#endif
+
+//==============================================================================
+void JUCE_CALLTYPE PixelSpans::blend (PixelARGB* dest, const PixelARGB& colour, int num) noexcept
+{
+    JUCE_PERFORM_AVX2_SPAN_OP (blendAVX2, (dest, colour, num))
+    JUCE_PERFORM_SSE2_SPAN_OP (blendSSE2, (dest, colour, num))
+
+    while (--num >= 0)
+        (dest++)->blend (colour);
+}
+
+void JUCE_CALLTYPE PixelSpans::blend (PixelRGB* dest, const PixelARGB& colour, int num) noexcept
+{
+    JUCE_PERFORM_AVX2_SPAN_OP (blendAVX2, (dest, colour, num))
+    JUCE_PERFORM_SSE2_SPAN_OP (blendSSE2, (dest, colour, num))
+
+    while (--num >= 0)
+        (dest++)->blend (colour);
+}
+
+void JUCE_CALLTYPE PixelSpans::blend (PixelAlpha* dest, const PixelARGB& colour, int num) noexcept
+{
+    JUCE_PERFORM_AVX2_SPAN_OP (blendAVX2, (dest, colour, num))
+    JUCE_PERFORM_SSE2_SPAN_OP (blendSSE2, (dest, colour, num))
+
+    while (--num >= 0)
+        (dest++)->blend (colour);
+}
+
+void JUCE_CALLTYPE PixelSpans::blend (PixelARGB* dest, const PixelARGB* src, int num, uint32 extraAlpha) noexcept
+{
+    jassert (extraAlpha <= 0xff);
+
+    JUCE_PERFORM_AVX2_SPAN_OP (blendAVX2, (dest, src, num, extraAlpha))
+    JUCE_PERFORM_SSE2_SPAN_OP (blendSSE2, (dest, src, num, extraAlpha))
+
+    while (--num >= 0)
+        (dest++)->blend (*src++, extraAlpha);
+}
+
+void JUCE_CALLTYPE PixelSpans::blend (PixelAlpha* dest, const PixelARGB* src, int num, uint32 extraAlpha) noexcept
+{
+    jassert (extraAlpha <= 0xff);
+
+    // (there's no AVX2 version of this one, as it'd need its results shuffling back into order)
+    JUCE_PERFORM_SSE2_SPAN_OP (blendSSE2, (dest, src, num, extraAlpha))
+
+    while (--num >= 0)
+        (dest++)->blend (*src++, extraAlpha);
+}
+
+void JUCE_CALLTYPE PixelSpans::blend (PixelAlpha* dest, const PixelAlpha* src, int num, uint32 extraAlpha) noexcept
+{
+    jassert (extraAlpha <= 0xff);
+
+    JUCE_PERFORM_AVX2_SPAN_OP (blendAVX2, (dest, src, num, extraAlpha))
+    JUCE_PERFORM_SSE2_SPAN_OP (blendSSE2, (dest, src, num, extraAlpha))
+
+    while (--num >= 0)
+        (dest++)->blend (*src++, extraAlpha);
+}
+
+void JUCE_CALLTYPE PixelSpans::fill (PixelARGB* dest, const PixelARGB& colour, int num) noexcept
+{
+    JUCE_PERFORM_AVX2_SPAN_OP (fillAVX2, (dest, colour, num))
+    JUCE_PERFORM_SSE2_SPAN_OP (fillSSE2, (dest, colour, num))
+
+    while (--num >= 0)
+        (dest++)->set (colour);
+}
+
+//==============================================================================
+static GlyphAtlas* glyphAtlasInstance = nullptr;
+
+GlyphAtlas::GlyphAtlas()  : shelfX (0), shelfY (0), shelfHeight (0) {}
+GlyphAtlas::~GlyphAtlas() { glyphAtlasInstance = nullptr; }
+
+GlyphAtlas& GlyphAtlas::getInstance()
+{
+    if (glyphAtlasInstance == nullptr)
+        glyphAtlasInstance = new GlyphAtlas();
+
+    return *glyphAtlasInstance;
+}
+
+Image GlyphAtlas::allocate (const int width, const int height, Rectangle<int>& area)
+{
+    jassert (width > 0 && height > 0);
+
+    if (width > maxAtlasGlyphSize || height > maxAtlasGlyphSize)
+    {
+        // (big glyphs would waste too much of a page, so they get an image of their own)
+        area.setBounds (0, 0, width, height);
+        return Image (Image::SingleChannel, width, height, true, SoftwareImageType());
+    }
+
+    const ScopedLock sl (lock);
+
+    if (shelfX + width > pageSize)
+    {
+        shelfX = 0;
+        shelfY += shelfHeight;
+        shelfHeight = 0;
+    }
+
+    if (page.isNull() || shelfY + height > pageSize)
+    {
+        page = Image (Image::SingleChannel, pageSize, pageSize, true, SoftwareImageType());
+        shelfX = shelfY = shelfHeight = 0;
+    }
+
+    area.setBounds (shelfX, shelfY, width, height);
+    shelfX += width;
+    shelfHeight = jmax (shelfHeight, height);
+
+    return page;
+}
+
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class PixelSpansTests  : public UnitTest
+{
+public:
+    PixelSpansTests() : UnitTest ("PixelSpans") {}
+
+    static PixelARGB createRandomColour (Random& r)
+    {
+        const int alpha = r.nextBool() ? r.nextInt (256) : (r.nextBool() ? 0 : 0xff);
+
+        return PixelARGB ((uint8) alpha, (uint8) r.nextInt (alpha + 1),
+                          (uint8) r.nextInt (alpha + 1), (uint8) r.nextInt (alpha + 1));
+    }
+
+    template <class PixelType>
+    struct TestBuffer
+    {
+        TestBuffer (Random& r)
+        {
+            for (int i = 0; i < numPixels; ++i)
+                result[i].set (createRandomColour (r));
+
+            memcpy (expected, result, sizeof (result));
+        }
+
+        bool matches() const    { return memcmp (expected, result, sizeof (result)) == 0; }
+
+        enum { numPixels = 140 };
+        PixelType result [numPixels], expected [numPixels];
+    };
+
+    void testBlending (Random& r)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            const int num = r.nextInt (128), offset = r.nextInt (8);
+            const PixelARGB colour (createRandomColour (r));
+            const uint32 extraAlpha = r.nextBool() ? 0xff : (uint32) r.nextInt (256);
+
+            {
+                TestBuffer<PixelARGB> b (r);
+                PixelSpans::blend (b.result + offset, colour, num);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].blend (colour);
+                expect (b.matches(), "ARGB colour");
+            }
+
+            {
+                TestBuffer<PixelRGB> b (r);
+                PixelSpans::blend (b.result + offset, colour, num);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].blend (colour);
+                expect (b.matches(), "RGB colour");
+            }
+
+            {
+                TestBuffer<PixelAlpha> b (r);
+                PixelSpans::blend (b.result + offset, colour, num);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].blend (colour);
+                expect (b.matches(), "alpha colour");
+            }
+
+            {
+                TestBuffer<PixelARGB> b (r), src (r);
+                PixelSpans::blend (b.result + offset, src.result + 3, num, extraAlpha);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].blend (src.result [3 + j], extraAlpha);
+                expect (b.matches(), "ARGB onto ARGB");
+            }
+
+            {
+                TestBuffer<PixelAlpha> b (r);
+                TestBuffer<PixelARGB> src (r);
+                PixelSpans::blend (b.result + offset, src.result + 3, num, extraAlpha);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].blend (src.result [3 + j], extraAlpha);
+                expect (b.matches(), "ARGB onto alpha");
+            }
+
+            {
+                TestBuffer<PixelAlpha> b (r), src (r);
+                PixelSpans::blend (b.result + offset, src.result + 3, num, extraAlpha);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].blend (src.result [3 + j], extraAlpha);
+                expect (b.matches(), "alpha onto alpha");
+            }
+
+            {
+                TestBuffer<PixelARGB> b (r);
+                PixelSpans::fill (b.result + offset, colour, num);
+                for (int j = 0; j < num; ++j) b.expected [offset + j].set (colour);
+                expect (b.matches(), "ARGB fill");
+            }
+        }
+    }
+
+    //==============================================================================
+    static String getLevelName (int level)
+    {
+        const char* const names[] = { "scalar", "SSE2", "AVX2" };
+        return names [level];
+    }
+
+    // Runs a filler over a large rectangle with each available instruction set, checking that
+    // they all give the same image, and logs the speeds.
+    template <class FillerType>
+    void testFiller (const String& name, const Image& image, const Image& startImage, FillerType& filler)
+    {
+        const EdgeTable et (image.getBounds());
+        const int numRepeats = 20;
+        Image firstResult;
+        String results;
+
+        for (int level = PixelSpanHelpers::noSIMD; level <= maxSIMDLevel; ++level)
+        {
+            PixelSpanHelpers::simdLevel = level;
+
+            copyPixels (image, startImage);
+            et.iterate (filler);
+
+            if (level == PixelSpanHelpers::noSIMD)
+                firstResult = image.createCopy();
+            else
+                expect (imagesAreIdentical (image, firstResult), name + ", " + getLevelName (level));
+
+            const int64 start = Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numRepeats; ++i)
+                et.iterate (filler);
+
+            const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            const double pixelsPerSecond = numRepeats * (double) image.getWidth() * image.getHeight() / jmax (1.0e-9, seconds);
+
+            results << "  " << getLevelName (level) << ": " << String (roundToInt (pixelsPerSecond / 1.0e6)).paddedLeft (' ', 5) << " Mpixels/sec";
+        }
+
+        logMessage (name.paddedRight (' ', 30) + results);
+    }
+
+    static void copyPixels (const Image& dest, const Image& src)
+    {
+        const Image::BitmapData d (dest, Image::BitmapData::writeOnly);
+        const Image::BitmapData s (src, Image::BitmapData::readOnly);
+
+        for (int y = 0; y < src.getHeight(); ++y)
+            memcpy (d.getLinePointer (y), s.getLinePointer (y), (size_t) (src.getWidth() * s.pixelStride));
+    }
+
+    static bool imagesAreIdentical (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+
+        for (int y = 0; y < a.getHeight(); ++y)
+            if (memcmp (da.getLinePointer (y), db.getLinePointer (y), (size_t) (a.getWidth() * da.pixelStride)) != 0)
+                return false;
+
+        return true;
+    }
+
+    static Image createRandomImage (Random& r, Image::PixelFormat format, int width, int height)
+    {
+        Image image (format, width, height, false);
+        const Image::BitmapData data (image, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                data.setPixelColour (x, y, Colour (createRandomColour (r).getUnpremultipliedARGB()));
+
+        return image;
+    }
+
+    void testPerformance (Random& r)
+    {
+        const int width = 1024, height = 512;
+
+        const Image argbStart  (createRandomImage (r, Image::ARGB, width, height));
+        const Image rgbStart   (createRandomImage (r, Image::RGB, width, height));
+        const Image alphaStart (createRandomImage (r, Image::SingleChannel, width, height));
+        const Image argbSource  (createRandomImage (r, Image::ARGB, width, height));
+        const Image alphaSource (createRandomImage (r, Image::SingleChannel, width, height));
+
+        const Image argb (Image::ARGB, width, height, false);
+        const Image rgb (Image::RGB, width, height, false);
+        const Image alpha (Image::SingleChannel, width, height, false);
+
+        const Image::BitmapData argbData (argb, Image::BitmapData::readWrite);
+        const Image::BitmapData rgbData (rgb, Image::BitmapData::readWrite);
+        const Image::BitmapData alphaData (alpha, Image::BitmapData::readWrite);
+        const Image::BitmapData argbSourceData (argbSource, Image::BitmapData::readOnly);
+        const Image::BitmapData alphaSourceData (alphaSource, Image::BitmapData::readOnly);
+
+        const PixelARGB colour (Colour (0x8040a0e0).getPixelARGB());
+
+        { EdgeTableFillers::SolidColour<PixelARGB> f (argbData, colour);         testFiller ("Solid colour, ARGB", argb, argbStart, f); }
+        { EdgeTableFillers::SolidColour<PixelARGB, true> f (argbData, colour);   testFiller ("Solid colour, ARGB, replace", argb, argbStart, f); }
+        { EdgeTableFillers::SolidColour<PixelRGB> f (rgbData, colour);           testFiller ("Solid colour, RGB", rgb, rgbStart, f); }
+        { EdgeTableFillers::SolidColour<PixelAlpha> f (alphaData, colour);       testFiller ("Solid colour, alpha", alpha, alphaStart, f); }
+
+        {
+            const ColourGradient gradient (Colour (0xc0ff8000), 10.0f, 10.0f, Colour (0x400040ff), width * 0.7f, height * 0.4f, false);
+            HeapBlock<PixelARGB> lookupTable;
+            const int numEntries = gradient.createLookupTable (AffineTransform::identity, lookupTable);
+
+            { EdgeTableFillers::Gradient<PixelARGB, GradientPixelIterators::Linear> f (argbData, gradient, AffineTransform::identity, lookupTable, numEntries);
+              testFiller ("Linear gradient, ARGB", argb, argbStart, f); }
+
+            { EdgeTableFillers::Gradient<PixelAlpha, GradientPixelIterators::Linear> f (alphaData, gradient, AffineTransform::identity, lookupTable, numEntries);
+              testFiller ("Linear gradient, alpha", alpha, alphaStart, f); }
+
+            { EdgeTableFillers::Gradient<PixelARGB, GradientPixelIterators::Radial> f (argbData, gradient, AffineTransform::identity, lookupTable, numEntries);
+              testFiller ("Radial gradient, ARGB", argb, argbStart, f); }
+        }
+
+        { EdgeTableFillers::ImageFill<PixelARGB, PixelARGB, false> f (argbData, argbSourceData, 255, 0, 0);    testFiller ("ARGB image onto ARGB", argb, argbStart, f); }
+        { EdgeTableFillers::ImageFill<PixelARGB, PixelARGB, false> f (argbData, argbSourceData, 150, 0, 0);    testFiller ("ARGB image onto ARGB, 60%", argb, argbStart, f); }
+        { EdgeTableFillers::ImageFill<PixelAlpha, PixelARGB, false> f (alphaData, argbSourceData, 255, 0, 0);  testFiller ("ARGB image onto alpha", alpha, alphaStart, f); }
+        { EdgeTableFillers::ImageFill<PixelAlpha, PixelAlpha, false> f (alphaData, alphaSourceData, 150, 0, 0); testFiller ("Alpha image onto alpha, 60%", alpha, alphaStart, f); }
+    }
+
+    void runTest()
+    {
+        const int originalLevel = PixelSpanHelpers::getSIMDLevel();
+        maxSIMDLevel = originalLevel;
+        Random r (1234);
+
+        for (int level = PixelSpanHelpers::noSIMD; level <= maxSIMDLevel; ++level)
+        {
+            beginTest ("Blending, " + getLevelName (level));
+            PixelSpanHelpers::simdLevel = level;
+            testBlending (r);
+        }
+
+        beginTest ("Fillers");
+        testPerformance (r);
+
+        PixelSpanHelpers::simdLevel = originalLevel;
+    }
+
+private:
+    int maxSIMDLevel;
+};
+
+static PixelSpansTests pixelSpansTests;
+
+//==============================================================================
+class GlyphCacheTests  : public UnitTest
+{
+public:
+    GlyphCacheTests() : UnitTest ("GlyphCache") {}
+
+    // All the outlines and advances are multiples of 1/16, so at a height of 16 every glyph lands
+    // on the same quarter-pixel offset as the text's start position, and should match its path exactly.
+    static Typeface::Ptr createTestTypeface()
+    {
+        CustomTypeface* const typeface = new CustomTypeface();
+
+        for (juce_wchar c = 'a'; c <= 'z'; ++c)
+        {
+            const float w = 0.25f + (c % 4) * 0.0625f;
+
+            Path p;
+            p.addRectangle (0.0625f, -0.75f, 0.125f, 0.75f);
+            p.addTriangle (0.0f, 0.0f, w, -0.5f - (c % 3) * 0.125f, w + 0.125f, 0.0f);
+            typeface->addGlyph (c, p, w + 0.1875f);
+        }
+
+        typeface->addGlyph (' ', Path(), 0.25f);
+
+        return typeface;
+    }
+
+    static bool imagesAreIdentical (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+
+        for (int y = 0; y < a.getHeight(); ++y)
+            if (memcmp (da.getLinePointer (y), db.getLinePointer (y), (size_t) (a.getWidth() * da.pixelStride)) != 0)
+                return false;
+
+        return true;
+    }
+
+    static int getMaxDifference (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+        int maxDiff = 0;
+
+        for (int y = 0; y < a.getHeight(); ++y)
+        {
+            const uint8* const la = da.getLinePointer (y);
+            const uint8* const lb = db.getLinePointer (y);
+
+            for (int i = 0; i < a.getWidth() * da.pixelStride; ++i)
+                maxDiff = jmax (maxDiff, std::abs (la[i] - lb[i]));
+        }
+
+        return maxDiff;
+    }
+
+    static void drawWords (Graphics& g, const Font& font, int seed, int width, int height)
+    {
+        Random r (seed);
+
+        for (int i = 0; i < 200; ++i)
+        {
+            g.setFont (font.withHeight (8.0f + r.nextInt (100) * 0.5f));
+            g.drawSingleLineText ("sphinx of black quartz judge my vow", r.nextInt (width) - 100, r.nextInt (height));
+        }
+    }
+
+    // Draws a run of glyphs straight through a GlyphCache, for comparing the speeds of different glyph types.
+    template <class CachedGlyphType>
+    static double drawGlyphRuns (const Image& image, const Font& font, const Array<int>& glyphNumbers,
+                                 const Array<Point<float> >& positions, const int numRepeats)
+    {
+        SoftwareRendererSavedState state (image, image.getBounds());
+        state.fillType.setColour (Colours::black);
+
+        GlyphCache<CachedGlyphType, SoftwareRendererSavedState>& cache
+            = GlyphCache<CachedGlyphType, SoftwareRendererSavedState>::getInstance();
+
+        cache.drawGlyphs (state, font, glyphNumbers.begin(), positions.begin(), glyphNumbers.size(), 0.0f, 0.0f);
+
+        const int64 start = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numRepeats; ++i)
+            cache.drawGlyphs (state, font, glyphNumbers.begin(), positions.begin(), glyphNumbers.size(), 0.0f, 0.0f);
+
+        const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        return numRepeats * glyphNumbers.size() / jmax (1.0e-9, seconds);
+    }
+
+    void runTest()
+    {
+        const Font font (Font (createTestTypeface()).withHeight (16.0f));
+
+        beginTest ("Glyph positions");
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                GlyphArrangement glyphs;
+                glyphs.addLineOfText (font, "the quick brown fox jumps over the lazy dog", 10.0f + i * 0.25f, 30.0f);
+
+                Image cached (Image::ARGB, 400, 50, true);
+                Image filled (Image::ARGB, 400, 50, true);
+
+                {
+                    Graphics g (cached);
+                    glyphs.draw (g);
+                }
+
+                {
+                    Graphics g (filled);
+                    Path p;
+                    glyphs.createPath (p);
+                   #if JUCE_MAC || JUCE_IOS
+                    p.applyTransform (AffineTransform::translation (0.0f, -0.5f));
+                   #endif
+                    g.fillPath (p);
+                }
+
+                expect (imagesAreIdentical (cached, filled));
+            }
+        }
+
+        beginTest ("Evicting glyphs");
+        {
+            // (this uses so many different sizes that the cache has to keep replacing its glyphs)
+            Image first (Image::ARGB, 600, 400, true);
+            Image second (Image::ARGB, 600, 400, true);
+
+            {
+                Graphics g (first);
+                g.setColour (Colours::darkblue);
+                drawWords (g, font, 1, first.getWidth(), first.getHeight());
+            }
+
+            for (int i = 2; i < 5; ++i)
+            {
+                Graphics g (second);
+                drawWords (g, font, i, second.getWidth(), second.getHeight());
+            }
+
+            second.clear (second.getBounds());
+
+            {
+                Graphics g (second);
+                g.setColour (Colours::darkblue);
+                drawWords (g, font, 1, second.getWidth(), second.getHeight());
+            }
+
+            expect (imagesAreIdentical (first, second));
+        }
+
+        beginTest ("Other fill types");
+        {
+            Image solid (Image::ARGB, 600, 400, true);
+            Image gradient (Image::ARGB, 600, 400, true);
+            const Colour colour (0xc0204080);
+
+            {
+                Graphics g (solid);
+                g.setColour (colour);
+                drawWords (g, font, 5, solid.getWidth(), solid.getHeight());
+            }
+
+            {
+                Graphics g (gradient);
+                g.setGradientFill (ColourGradient (colour, 0.0f, 0.0f, colour, 600.0f, 400.0f, false));
+                drawWords (g, font, 5, gradient.getWidth(), gradient.getHeight());
+            }
+
+            expect (getMaxDifference (solid, gradient) <= 2);
+        }
+
+        beginTest ("Performance");
+        {
+            // Lays out the text of a big table, one short word per cell.
+            const int numColumns = 12, numRows = 60;
+            const Font tableFont (font.withHeight (13.0f));
+            Image image (Image::ARGB, 1200, 900, true);
+            Array<int> glyphNumbers, wordGlyphs;
+            Array<float> wordOffsets;
+            Array<Point<float> > positions;
+
+            tableFont.getGlyphPositions ("cellvalue", wordGlyphs, wordOffsets);
+
+            for (int row = 0; row < numRows; ++row)
+            {
+                for (int column = 0; column < numColumns; ++column)
+                {
+                    for (int i = 0; i < wordGlyphs.size(); ++i)
+                    {
+                        glyphNumbers.add (wordGlyphs.getUnchecked (i));
+                        positions.add (Point<float> (column * 100.0f + 3.3f + wordOffsets.getUnchecked (i), row * 15.0f + 12.0f));
+                    }
+                }
+            }
+
+            const double edgeTableRate = drawGlyphRuns<CachedGlyphEdgeTable<SoftwareRendererSavedState> > (image, tableFont, glyphNumbers, positions, 20);
+            const double bitmapRate    = drawGlyphRuns<CachedGlyphBitmap<SoftwareRendererSavedState> >    (image, tableFont, glyphNumbers, positions, 20);
+
+            logMessage ("Drawing " + String (glyphNumbers.size()) + " glyphs of table text:");
+            logMessage ("  as edge-tables: " + String (edgeTableRate / 1.0e6, 2) + " Mglyphs/sec");
+            logMessage ("  from the atlas: " + String (bitmapRate / 1.0e6, 2) + " Mglyphs/sec");
+        }
+    }
+};
+
+static GlyphCacheTests glyphCacheTests;
+
+#endif
+
+}
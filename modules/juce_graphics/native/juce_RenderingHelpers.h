@@ -160,7 +160,72 @@ private:
 };
 
 //==============================================================================
-/** Holds a cache of recently-used glyph objects of some type. */
+/** Identifies a particular rendering of a glyph, for use as the key in a GlyphCache. */
+struct GlyphKey
+{
+    GlyphKey() noexcept
+        : typeface (nullptr), height (0), horizontalScale (0), glyph (0), subpixelPosition (0)
+    {}
+
+    GlyphKey (Typeface* const t, const float h, const float hScale, const int g, const int subpixel) noexcept
+        : typeface (t), height (h), horizontalScale (hScale), glyph (g), subpixelPosition (subpixel)
+    {}
+
+    bool operator== (const GlyphKey& other) const noexcept
+    {
+        return glyph == other.glyph
+                && typeface == other.typeface
+                && height == other.height
+                && horizontalScale == other.horizontalScale
+                && subpixelPosition == other.subpixelPosition;
+    }
+
+    /** Returns which of a number of equally-spaced horizontal offsets within a pixel is
+        nearest to the given position.
+    */
+    static int getSubpixelPosition (const float x, const int numPositions) noexcept
+    {
+        if (numPositions <= 1)
+            return 0;
+
+        const int n = (int) std::floor (x * numPositions + 0.5f);
+        return n - numPositions * (int) std::floor (n / (float) numPositions);
+    }
+
+    struct HashFunctions
+    {
+        static uint32 generateHash (const GlyphKey& key) noexcept
+        {
+            uint64 n = (uint64) (pointer_sized_int) key.typeface;
+            n = n * 31 + floatBits (key.height);
+            n = n * 31 + floatBits (key.horizontalScale);
+            n = n * 31 + (uint32) key.glyph;
+            n = n * 31 + (uint32) key.subpixelPosition;
+            return DefaultHashFunctions::generateHash ((int64) n);
+        }
+
+    private:
+        static uint32 floatBits (const float f) noexcept
+        {
+            union { float asFloat; uint32 asInt; } u;
+            u.asFloat = f;
+            return u.asInt;
+        }
+    };
+
+    Typeface* typeface;
+    float height, horizontalScale;
+    int glyph, subpixelPosition;
+};
+
+//==============================================================================
+/** Holds a cache of recently-used glyph objects of some type.
+
+    The glyphs are found with a hash table keyed on their typeface, size, glyph number and
+    (for glyph types that render at a fixed offset within a pixel) sub-pixel position, so
+    the cost of a lookup doesn't grow with the number of glyphs in the cache. Drawing a whole
+    run of glyphs with drawGlyphs() takes the cache's lock just once.
+*/
 template <class CachedGlyphType, class RenderTargetType>
 class GlyphCache  : private DeletedAtShutdown
 {
@@ -188,75 +253,128 @@ public:
     //==============================================================================
     void drawGlyph (RenderTargetType& target, const Font& font, const int glyphNumber, float x, float y)
     {
-        ++accessCounter;
-        CachedGlyphType* glyph = nullptr;
+        const Point<float> position (x, y);
+        drawGlyphs (target, font, &glyphNumber, &position, 1, 0.0f, 0.0f);
+    }
+
+    /** Draws a run of glyphs that all use the same font, each one at its position plus (dx, dy). */
+    void drawGlyphs (RenderTargetType& target, const Font& font, const int* const glyphNumbers,
+                     const Point<float>* const positions, const int numGlyphs, const float dx, const float dy)
+    {
+        Typeface* const typeface = font.getTypeface();
 
-        const ScopedReadLock srl (lock);
+        if (typeface == nullptr || numGlyphs <= 0)
+            return;
+
+        const int numSubpixelPositions = CachedGlyphType::getNumSubpixelPositions (*typeface);
+        const float height = font.getHeight();
+        const float horizontalScale = font.getHorizontalScale();
+        const int accessCount = ++accessCounter;
+        int i = 0;
 
-        for (int i = glyphs.size(); --i >= 0;)
         {
-            CachedGlyphType* const g = glyphs.getUnchecked (i);
+            const ScopedReadLock srl (lock);
 
-            if (g->glyph == glyphNumber && g->font == font)
+            for (; i < numGlyphs; ++i)
             {
-                glyph = g;
-                ++hits;
-                break;
+                const float x = positions[i].x + dx;
+                const GlyphKey key (typeface, height, horizontalScale, glyphNumbers[i],
+                                    GlyphKey::getSubpixelPosition (x, numSubpixelPositions));
+
+                const int* const slot = slotIndexes.getValuePointer (key);
+
+                if (slot == nullptr)
+                    break;
+
+                CachedGlyphType* const glyph = glyphs.getUnchecked (*slot);
+                glyph->lastAccessCount = accessCount;
+                glyph->draw (target, x, positions[i].y + dy);
             }
         }
 
-        if (glyph == nullptr)
+        hits += i;
+
+        if (i < numGlyphs)
         {
-            ++misses;
+            // (the read lock has to be released before taking the write lock, because two threads
+            // that both tried to upgrade their read locks at the same time would deadlock)
             const ScopedWriteLock swl (lock);
 
-            if (hits.value + misses.value > glyphs.size() * 16)
+            for (; i < numGlyphs; ++i)
             {
-                if (misses.value * 2 > hits.value)
-                    addNewGlyphSlots (32);
+                const float x = positions[i].x + dx;
+                const GlyphKey key (typeface, height, horizontalScale, glyphNumbers[i],
+                                    GlyphKey::getSubpixelPosition (x, numSubpixelPositions));
 
-                hits.set (0);
-                misses.set (0);
-                glyph = glyphs.getLast();
-            }
-            else
-            {
-                glyph = findLeastRecentlyUsedGlyph();
+                CachedGlyphType* const glyph = findOrCreateGlyph (key);
+                glyph->lastAccessCount = accessCount;
+                glyph->draw (target, x, positions[i].y + dy);
             }
-
-            jassert (glyph != nullptr);
-            glyph->generate (font, glyphNumber);
         }
-
-        glyph->lastAccessCount = accessCounter.value;
-        glyph->draw (target, x, y);
     }
 
 private:
     friend class OwnedArray <CachedGlyphType>;
     OwnedArray <CachedGlyphType> glyphs;
+    FlatHashMap <GlyphKey, int, GlyphKey::HashFunctions> slotIndexes;
     Atomic<int> accessCounter, hits, misses;
     ReadWriteLock lock;
 
+    // (must be called with the write lock held)
+    CachedGlyphType* findOrCreateGlyph (const GlyphKey& key)
+    {
+        if (const int* const slot = slotIndexes.getValuePointer (key))
+        {
+            ++hits;
+            return glyphs.getUnchecked (*slot);
+        }
+
+        ++misses;
+        int slot;
+
+        if (hits.value + misses.value > glyphs.size() * 16)
+        {
+            if (misses.value * 2 > hits.value)
+                addNewGlyphSlots (32);
+
+            hits.set (0);
+            misses.set (0);
+            slot = glyphs.size() - 1;
+        }
+        else
+        {
+            slot = findLeastRecentlyUsedGlyph();
+        }
+
+        CachedGlyphType* const glyph = glyphs.getUnchecked (slot);
+
+        if (glyph->key.typeface != nullptr)
+            slotIndexes.remove (glyph->key);
+
+        glyph->generate (key);
+        slotIndexes.set (key, slot);
+        return glyph;
+    }
+
     void addNewGlyphSlots (int num)
     {
         while (--num >= 0)
             glyphs.add (new CachedGlyphType());
     }
 
-    CachedGlyphType* findLeastRecentlyUsedGlyph() const noexcept
+    int findLeastRecentlyUsedGlyph() const noexcept
     {
-        CachedGlyphType* oldest = glyphs.getLast();
-        int oldestCounter = oldest->lastAccessCount;
+        int oldest = glyphs.size() - 1;
+        int oldestCounter = glyphs.getUnchecked (oldest)->lastAccessCount;
 
         for (int i = glyphs.size() - 1; --i >= 0;)
         {
-            CachedGlyphType* const glyph = glyphs.getUnchecked(i);
+            const CachedGlyphType* const glyph = glyphs.getUnchecked(i);
 
             if (glyph->lastAccessCount <= oldestCounter)
             {
                 oldestCounter = glyph->lastAccessCount;
-                oldest = glyph;
+                oldest = i;
             }
         }
 
@@ -278,7 +396,10 @@ template <class RendererType>
 class CachedGlyphEdgeTable
 {
 public:
-    CachedGlyphEdgeTable() : glyph (0), lastAccessCount (0) {}
+    CachedGlyphEdgeTable() : lastAccessCount (0) {}
+
+    // (an edge-table can be drawn at any fractional position, so one version of each glyph will do)
+    static int getNumSubpixelPositions (const Typeface&) noexcept    { return 1; }
 
     void draw (RendererType& state, float x, const float y) const
     {
@@ -289,32 +410,150 @@ public:
             state.fillEdgeTable (*edgeTable, x, roundToInt (y));
     }
 
-    void generate (const Font& newFont, const int glyphNumber)
+    void generate (const GlyphKey& newKey)
     {
-        font = newFont;
-        Typeface* const typeface = newFont.getTypeface();
+        key = newKey;
+        typeface = newKey.typeface;
         snapToIntegerCoordinate = typeface->isHinted();
-        glyph = glyphNumber;
 
-        const float fontHeight = font.getHeight();
-        edgeTable = typeface->getEdgeTableForGlyph (glyphNumber,
-                                                    AffineTransform::scale (fontHeight * font.getHorizontalScale(), fontHeight)
+        edgeTable = typeface->getEdgeTableForGlyph (key.glyph,
+                                                    AffineTransform::scale (key.height * key.horizontalScale, key.height)
                                                                   #if JUCE_MAC || JUCE_IOS
                                                                     .translated (0.0f, -0.5f)
                                                                   #endif
                                                     );
     }
 
-    Font font;
-    int glyph, lastAccessCount;
+    GlyphKey key;
+    int lastAccessCount;
     bool snapToIntegerCoordinate;
 
 private:
+    Typeface::Ptr typeface;
     ScopedPointer <EdgeTable> edgeTable;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedGlyphEdgeTable)
 };
 
+//==============================================================================
+/** Packs small single-channel images into a set of larger shared images.
+
+    Areas are handed out from shelves running across each page, and space is never re-used,
+    so whatever is drawn into an area stays valid for as long as its image is kept. When a
+    page is full, a new one is started, and the old one is deleted once nothing refers to
+    it any more.
+*/
+class JUCE_API  GlyphAtlas  : private DeletedAtShutdown
+{
+public:
+    GlyphAtlas();
+    ~GlyphAtlas();
+
+    static GlyphAtlas& getInstance();
+
+    /** Finds a cleared area of the given size, and returns the image that it's in. */
+    Image allocate (int width, int height, Rectangle<int>& area);
+
+private:
+    CriticalSection lock;
+    Image page;
+    int shelfX, shelfY, shelfHeight;
+
+    enum { pageSize = 512, maxAtlasGlyphSize = 128 };
+
+    JUCE_DECLARE_NON_COPYABLE (GlyphAtlas)
+};
+
+//==============================================================================
+/** Caches a glyph as an anti-aliased alpha mask, stored in one of the GlyphAtlas's
+    shared images.
+
+    Unhinted glyphs are rendered at a few different offsets within a pixel, and each
+    one is drawn using the version that's closest to its real position.
+*/
+template <class RendererType>
+class CachedGlyphBitmap
+{
+public:
+    CachedGlyphBitmap() : lastAccessCount (0), numSubpixelPositions (1) {}
+
+    static int getNumSubpixelPositions (const Typeface& t) noexcept   { return t.isHinted() ? 1 : 4; }
+
+    void draw (RendererType& state, const float x, const float y) const
+    {
+        if (image.isValid())
+            state.fillAlphaMask (image, area,
+                                 (int) std::floor (x - key.subpixelPosition / (float) numSubpixelPositions + 0.5f) + origin.x,
+                                 roundToInt (y) + origin.y);
+    }
+
+    void generate (const GlyphKey& newKey)
+    {
+        key = newKey;
+        typeface = newKey.typeface;
+        numSubpixelPositions = getNumSubpixelPositions (*typeface);
+        image = Image();
+
+        const ScopedPointer<EdgeTable> et (typeface->getEdgeTableForGlyph (key.glyph,
+                                                AffineTransform::scale (key.height * key.horizontalScale, key.height)
+                                                               .translated (key.subpixelPosition / (float) numSubpixelPositions,
+                                                                          #if JUCE_MAC || JUCE_IOS
+                                                                            -0.5f
+                                                                          #else
+                                                                            0.0f
+                                                                          #endif
+                                                                            )));
+
+        if (et != nullptr && ! et->isEmpty())
+        {
+            const Rectangle<int> bounds (et->getMaximumBounds());
+            image = GlyphAtlas::getInstance().allocate (bounds.getWidth(), bounds.getHeight(), area);
+            origin = bounds.getPosition();
+
+            Image::BitmapData data (image, area.getX(), area.getY(), area.getWidth(), area.getHeight(), Image::BitmapData::writeOnly);
+            MaskWriter writer (data, origin);
+            et->iterate (writer);
+        }
+    }
+
+    GlyphKey key;
+    int lastAccessCount;
+
+private:
+    Typeface::Ptr typeface;
+    Image image;
+    Rectangle<int> area;
+    Point<int> origin;
+    int numSubpixelPositions;
+
+    // Copies the edge-table's levels straight into the mask.
+    struct MaskWriter
+    {
+        MaskWriter (Image::BitmapData& d, const Point<int>& o) noexcept : data (d), origin (o), line (nullptr) {}
+
+        forcedinline void setEdgeTableYPos (const int y) noexcept                        { line = data.getLinePointer (y - origin.y); }
+        forcedinline void handleEdgeTablePixel (const int x, const int alpha) noexcept     { *getPixel (x) = (uint8) alpha; }
+        forcedinline void handleEdgeTablePixelFull (const int x) noexcept                 { *getPixel (x) = 255; }
+        forcedinline void handleEdgeTableLineFull (const int x, const int width) noexcept { handleEdgeTableLine (x, width, 255); }
+
+        void handleEdgeTableLine (const int x, const int width, const int alpha) noexcept
+        {
+            for (int i = 0; i < width; ++i)
+                *getPixel (x + i) = (uint8) alpha;
+        }
+
+        forcedinline uint8* getPixel (const int x) const noexcept    { return line + (x - origin.x) * data.pixelStride; }
+
+        Image::BitmapData& data;
+        const Point<int> origin;
+        uint8* line;
+
+        JUCE_DECLARE_NON_COPYABLE (MaskWriter)
+    };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedGlyphBitmap)
+};
+
 //==============================================================================
 /** Calculates the alpha values and positions for rendering the edges of a
     non-pixel-aligned rectangle.
@@ -572,6 +811,40 @@ namespace GradientPixelIterators
     do { dest->op; dest = addBytesToPointer (dest, destStride); } while (--width > 0); \
 }
 
+//==============================================================================
+/** Blends runs of adjacent pixels, using SSE2 or AVX2 if the CPU supports them.
+
+    The results are exactly the same as calling blend() on each pixel in turn, as long as
+    the colours are premultiplied. The edge-table fillers use these for their horizontal runs.
+*/
+struct JUCE_API  PixelSpans
+{
+    /** Blends a colour onto each of a run of pixels. */
+    static void JUCE_CALLTYPE blend (PixelARGB* dest, const PixelARGB& colour, int num) noexcept;
+    /** Blends a colour onto each of a run of pixels. */
+    static void JUCE_CALLTYPE blend (PixelRGB* dest, const PixelARGB& colour, int num) noexcept;
+    /** Blends a colour onto each of a run of pixels. */
+    static void JUCE_CALLTYPE blend (PixelAlpha* dest, const PixelARGB& colour, int num) noexcept;
+
+    /** Blends a run of pixels onto another one, in the same way as dest[i].blend (src[i], extraAlpha). */
+    static void JUCE_CALLTYPE blend (PixelARGB* dest, const PixelARGB* src, int num, uint32 extraAlpha) noexcept;
+    /** Blends a run of pixels onto another one, in the same way as dest[i].blend (src[i], extraAlpha). */
+    static void JUCE_CALLTYPE blend (PixelAlpha* dest, const PixelARGB* src, int num, uint32 extraAlpha) noexcept;
+    /** Blends a run of pixels onto another one, in the same way as dest[i].blend (src[i], extraAlpha). */
+    static void JUCE_CALLTYPE blend (PixelAlpha* dest, const PixelAlpha* src, int num, uint32 extraAlpha) noexcept;
+
+    /** Blends a run of pixels onto another one, in the same way as dest[i].blend (src[i], extraAlpha). */
+    template <class DestPixelType, class SrcPixelType>
+    static void blend (DestPixelType* dest, const SrcPixelType* src, int num, uint32 extraAlpha) noexcept
+    {
+        while (--num >= 0)
+            (dest++)->blend (*src++, extraAlpha);
+    }
+
+    /** Sets each of a run of pixels to a colour. */
+    static void JUCE_CALLTYPE fill (PixelARGB* dest, const PixelARGB& colour, int num) noexcept;
+};
+
 //==============================================================================
 /** Contains classes for filling edge tables with various fill types. */
 namespace EdgeTableFillers
@@ -653,7 +926,10 @@ namespace EdgeTableFillers
 
         inline void blendLine (PixelType* dest, const PixelARGB& colour, int width) const noexcept
         {
-            JUCE_PERFORM_PIXEL_OP_LOOP (blend (colour))
+            if (destData.pixelStride == sizeof (*dest))
+                PixelSpans::blend (dest, colour, width);
+            else
+                JUCE_PERFORM_PIXEL_OP_LOOP (blend (colour))
         }
 
         forcedinline void replaceLine (PixelRGB* dest, const PixelARGB& colour, int width) const noexcept
@@ -711,12 +987,98 @@ namespace EdgeTableFillers
 
         forcedinline void replaceLine (PixelARGB* dest, const PixelARGB& colour, int width) const noexcept
         {
-            JUCE_PERFORM_PIXEL_OP_LOOP (set (colour))
+            if (destData.pixelStride == sizeof (*dest))
+                PixelSpans::fill (dest, colour, width);
+            else
+                JUCE_PERFORM_PIXEL_OP_LOOP (set (colour))
         }
 
         JUCE_DECLARE_NON_COPYABLE (SolidColour)
     };
 
+    //==============================================================================
+    /** Fills an edge-table with a solid colour, using the levels in a single-channel image as a mask. */
+    template <class PixelType>
+    class AlphaMaskedSolidColour
+    {
+    public:
+        AlphaMaskedSolidColour (const Image::BitmapData& dest, const Image::BitmapData& mask,
+                                const int maskX, const int maskY, const PixelARGB& colour) noexcept
+            : destData (dest), maskData (mask), maskOriginX (maskX), maskOriginY (maskY), sourceColour (colour)
+        {
+        }
+
+        forcedinline void setEdgeTableYPos (const int y) noexcept
+        {
+            linePixels = (PixelType*) destData.getLinePointer (y);
+            maskLine = maskData.getLinePointer (y - maskOriginY);
+        }
+
+        forcedinline void handleEdgeTablePixel (const int x, const int alphaLevel) const noexcept
+        {
+            blendPixel (getPixel (x), (*getMaskLevel (x) * (uint32) (alphaLevel + 1)) >> 8);
+        }
+
+        forcedinline void handleEdgeTablePixelFull (const int x) const noexcept
+        {
+            blendPixel (getPixel (x), *getMaskLevel (x));
+        }
+
+        void handleEdgeTableLine (const int x, int width, const int alphaLevel) const noexcept
+        {
+            PixelType* dest = getPixel (x);
+            const uint8* mask = getMaskLevel (x);
+
+            while (--width >= 0)
+            {
+                blendPixel (dest, (*mask * (uint32) (alphaLevel + 1)) >> 8);
+                dest = addBytesToPointer (dest, destData.pixelStride);
+                mask += maskData.pixelStride;
+            }
+        }
+
+        void handleEdgeTableLineFull (const int x, int width) const noexcept
+        {
+            PixelType* dest = getPixel (x);
+            const uint8* mask = getMaskLevel (x);
+
+            while (--width >= 0)
+            {
+                blendPixel (dest, *mask);
+                dest = addBytesToPointer (dest, destData.pixelStride);
+                mask += maskData.pixelStride;
+            }
+        }
+
+    private:
+        const Image::BitmapData& destData;
+        const Image::BitmapData& maskData;
+        const int maskOriginX, maskOriginY;
+        PixelType* linePixels;
+        const uint8* maskLine;
+        PixelARGB sourceColour;
+
+        forcedinline PixelType* getPixel (const int x) const noexcept
+        {
+            return addBytesToPointer (linePixels, x * destData.pixelStride);
+        }
+
+        forcedinline const uint8* getMaskLevel (const int x) const noexcept
+        {
+            return maskLine + (x - maskOriginX) * maskData.pixelStride;
+        }
+
+        forcedinline void blendPixel (PixelType* const dest, const uint32 level) const noexcept
+        {
+            if (level >= 0xff)
+                dest->blend (sourceColour);
+            else if (level > 0)
+                dest->blend (sourceColour, level);
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (AlphaMaskedSolidColour)
+    };
+
     //==============================================================================
     /** Fills an edge-table with a gradient. */
     template <class PixelType, class GradientType>
@@ -750,7 +1112,9 @@ namespace EdgeTableFillers
         {
             PixelType* dest = getPixel (x);
 
-            if (alphaLevel < 0xff)
+            if (destData.pixelStride == sizeof (*dest))
+                blendLine (dest, x, width, (uint32) jmin (0xff, alphaLevel));
+            else if (alphaLevel < 0xff)
                 JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++), (uint32) alphaLevel))
             else
                 JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++)))
@@ -759,13 +1123,35 @@ namespace EdgeTableFillers
         void handleEdgeTableLineFull (int x, int width) const noexcept
         {
             PixelType* dest = getPixel (x);
-            JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++)))
+
+            if (destData.pixelStride == sizeof (*dest))
+                blendLine (dest, x, width, 0xff);
+            else
+                JUCE_PERFORM_PIXEL_OP_LOOP (blend (GradientType::getPixel (x++)))
         }
 
     private:
         const Image::BitmapData& destData;
         PixelType* linePixels;
 
+        // The colours are looked up in batches, so that they can be blended as a span.
+        void blendLine (PixelType* dest, int x, int width, const uint32 alphaLevel) const noexcept
+        {
+            PixelARGB colours [64];
+
+            while (width > 0)
+            {
+                const int num = jmin (width, (int) numElementsInArray (colours));
+
+                for (int i = 0; i < num; ++i)
+                    colours[i] = GradientType::getPixel (x++);
+
+                PixelSpans::blend (dest, colours, num, alphaLevel);
+                dest += num;
+                width -= num;
+            }
+        }
+
         forcedinline PixelType* getPixel (const int x) const noexcept
         {
             return addBytesToPointer (linePixels, x * destData.pixelStride);
@@ -826,7 +1212,10 @@ namespace EdgeTableFillers
 
             if (alphaLevel < 0xfe)
             {
-                JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (repeatPattern ? (x++ % srcData.width) : x++), (uint32) alphaLevel))
+                if (repeatPattern)
+                    JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (x++ % srcData.width), (uint32) alphaLevel))
+                else
+                    blendRow (dest, getSrcPixel (x), width, (uint32) alphaLevel);
             }
             else
             {
@@ -846,7 +1235,10 @@ namespace EdgeTableFillers
 
             if (extraAlpha < 0xfe)
             {
-                JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (repeatPattern ? (x++ % srcData.width) : x++), (uint32) extraAlpha))
+                if (repeatPattern)
+                    JUCE_PERFORM_PIXEL_OP_LOOP (blend (*getSrcPixel (x++ % srcData.width), (uint32) extraAlpha))
+                else
+                    blendRow (dest, getSrcPixel (x), width, (uint32) extraAlpha);
             }
             else
             {
@@ -892,6 +1284,10 @@ namespace EdgeTableFillers
             {
                 memcpy (dest, src, sizeof (PixelRGB) * (size_t) width);
             }
+            else if (srcData.pixelStride == sizeof (*src) && destData.pixelStride == sizeof (*dest))
+            {
+                PixelSpans::blend (dest, src, width, 0xff);
+            }
             else
             {
                 const int destStride = destData.pixelStride;
@@ -906,6 +1302,26 @@ namespace EdgeTableFillers
             }
         }
 
+        forcedinline void blendRow (DestPixelType* dest, SrcPixelType const* src, int width, const uint32 alpha) const noexcept
+        {
+            if (srcData.pixelStride == sizeof (*src) && destData.pixelStride == sizeof (*dest))
+            {
+                PixelSpans::blend (dest, src, width, alpha);
+            }
+            else
+            {
+                const int destStride = destData.pixelStride;
+                const int srcStride = srcData.pixelStride;
+
+                do
+                {
+                    dest->blend (*src, alpha);
+                    dest = addBytesToPointer (dest, destStride);
+                    src = addBytesToPointer (src, srcStride);
+                } while (--width > 0);
+            }
+        }
+
         JUCE_DECLARE_NON_COPYABLE (ImageFill)
     };
 
@@ -1511,6 +1927,14 @@ namespace EdgeTableFillers
         }
     }
 
+    template <class Iterator, class DestPixelType>
+    void renderAlphaMaskedFill (Iterator& iter, const Image::BitmapData& destData, const Image::BitmapData& maskData,
+                                const int maskX, const int maskY, const PixelARGB& fillColour, DestPixelType*)
+    {
+        EdgeTableFillers::AlphaMaskedSolidColour <DestPixelType> r (destData, maskData, maskX, maskY, fillColour);
+        iter.iterate (r);
+    }
+
     template <class Iterator, class DestPixelType>
     void renderGradient (Iterator& iter, const Image::BitmapData& destData, const ColourGradient& g, const AffineTransform& transform,
                          const PixelARGB* const lookupTable, const int numLookupEntries, const bool isIdentity, DestPixelType*)
@@ -1564,6 +1988,7 @@ namespace ClipRegions
         virtual void fillRectWithColour (Image::BitmapData& destData, const Rectangle<int>&, const PixelARGB& colour, bool replaceContents) const = 0;
         virtual void fillRectWithColour (Image::BitmapData& destData, const Rectangle<float>&, const PixelARGB& colour) const = 0;
         virtual void fillAllWithColour (Image::BitmapData& destData, const PixelARGB& colour, bool replaceContents) const = 0;
+        virtual void fillAlphaMaskWithColour (Image::BitmapData& destData, const Rectangle<int>& area, const Image::BitmapData& maskData, int maskX, int maskY, const PixelARGB& colour) const = 0;
         virtual void fillAllWithGradient (Image::BitmapData& destData, ColourGradient&, const AffineTransform&, bool isIdentity) const = 0;
         virtual void renderImageTransformed (const Image::BitmapData& destData, const Image::BitmapData& srcData, const int alpha, const AffineTransform&, bool betterQuality, bool tiledFill) const = 0;
         virtual void renderImageUntransformed (const Image::BitmapData& destData, const Image::BitmapData& srcData, const int alpha, int x, int y, bool tiledFill) const = 0;
@@ -1715,6 +2140,19 @@ namespace ClipRegions
             }
         }
 
+        void fillAlphaMaskWithColour (Image::BitmapData& destData, const Rectangle<int>& area, const Image::BitmapData& maskData, int maskX, int maskY, const PixelARGB& colour) const
+        {
+            EdgeTable et (area);
+            et.clipToEdgeTable (edgeTable);
+
+            switch (destData.pixelFormat)
+            {
+                case Image::ARGB:   EdgeTableFillers::renderAlphaMaskedFill (et, destData, maskData, maskX, maskY, colour, (PixelARGB*) 0); break;
+                case Image::RGB:    EdgeTableFillers::renderAlphaMaskedFill (et, destData, maskData, maskX, maskY, colour, (PixelRGB*) 0); break;
+                default:            EdgeTableFillers::renderAlphaMaskedFill (et, destData, maskData, maskX, maskY, colour, (PixelAlpha*) 0); break;
+            }
+        }
+
         void fillAllWithGradient (Image::BitmapData& destData, ColourGradient& gradient, const AffineTransform& transform, bool isIdentity) const
         {
             HeapBlock <PixelARGB> lookupTable;
@@ -1847,6 +2285,18 @@ namespace ClipRegions
             }
         }
 
+        void fillAlphaMaskWithColour (Image::BitmapData& destData, const Rectangle<int>& area, const Image::BitmapData& maskData, int maskX, int maskY, const PixelARGB& colour) const
+        {
+            SubRectangleIterator iter (clip, area);
+
+            switch (destData.pixelFormat)
+            {
+                case Image::ARGB:   EdgeTableFillers::renderAlphaMaskedFill (iter, destData, maskData, maskX, maskY, colour, (PixelARGB*) 0); break;
+                case Image::RGB:    EdgeTableFillers::renderAlphaMaskedFill (iter, destData, maskData, maskX, maskY, colour, (PixelRGB*) 0); break;
+                default:            EdgeTableFillers::renderAlphaMaskedFill (iter, destData, maskData, maskX, maskY, colour, (PixelAlpha*) 0); break;
+            }
+        }
+
         void fillAllWithGradient (Image::BitmapData& destData, ColourGradient& gradient, const AffineTransform& transform, bool isIdentity) const
         {
             HeapBlock <PixelARGB> lookupTable;
@@ -2034,7 +2484,7 @@ public:
         : image (im), clip (new ClipRegions::RectangleListRegion (clipBounds)),
           transform (0, 0),
           interpolationQuality (Graphics::mediumResamplingQuality),
-          transparencyLayerAlpha (1.0f)
+          transparencyLayerAlpha (1.0f), isDrawingToBand (false)
     {
     }
 
@@ -2042,7 +2492,7 @@ public:
         : image (im), clip (new ClipRegions::RectangleListRegion (clipList)),
           transform (x, y),
           interpolationQuality (Graphics::mediumResamplingQuality),
-          transparencyLayerAlpha (1.0f)
+          transparencyLayerAlpha (1.0f), isDrawingToBand (false)
     {
     }
 
@@ -2050,10 +2500,21 @@ public:
         : image (other.image), clip (other.clip), transform (other.transform),
           font (other.font), fillType (other.fillType),
           interpolationQuality (other.interpolationQuality),
-          transparencyLayerAlpha (other.transparencyLayerAlpha)
+          transparencyLayerAlpha (other.transparencyLayerAlpha),
+          band (other.band), isDrawingToBand (other.isDrawingToBand)
     {
     }
 
+    // Stops this state from touching any pixels outside the given area of its image, without
+    // changing the clip region. Because every shape is still built against the same clip, several
+    // states with different bands can render the same drawing operations into the same image in
+    // parallel, and the result is exactly what a single unrestricted state would produce.
+    void restrictDrawingToBand (const Rectangle<int>& area)
+    {
+        band = area;
+        isDrawingToBand = true;
+    }
+
     bool clipToRectangle (const Rectangle<int>& r)
     {
         if (clip != nullptr)
@@ -2198,6 +2659,7 @@ public:
 
             s->cloneClipIfMultiplyReferenced();
             s->clip->translate (-layerBounds.getPosition());
+            s->band -= layerBounds.getPosition();
         }
 
         return s;
@@ -2210,6 +2672,10 @@ public:
             const Rectangle<int> layerBounds (clip->getClipBounds());
 
             const ScopedPointer<LowLevelGraphicsContext> g (image.createLowLevelContext());
+
+            if (isDrawingToBand)
+                g->clipToRectangle (band);
+
             g->setOpacity (finishedLayerState.transparencyLayerAlpha);
             g->drawImage (finishedLayerState.image, AffineTransform::translation ((float) layerBounds.getX(),
                                                                                   (float) layerBounds.getY()));
@@ -2222,11 +2688,11 @@ public:
         if (fillType.isColour())
         {
             Image::BitmapData destData (image, Image::BitmapData::readWrite);
-            clip->fillRectWithColour (destData, r, fillType.colour.getPixelARGB(), replaceContents);
+            clip->fillRectWithColour (destData, clippedToBand (r), fillType.colour.getPixelARGB(), replaceContents);
         }
         else
         {
-            const Rectangle<int> clipped (clip->getClipBounds().getIntersection (r));
+            const Rectangle<int> clipped (clippedToBand (clip->getClipBounds().getIntersection (r)));
 
             if (! clipped.isEmpty())
                 fillShape (new ClipRegions::RectangleListRegion (clipped), false);
@@ -2238,11 +2704,11 @@ public:
         if (fillType.isColour())
         {
             Image::BitmapData destData (image, Image::BitmapData::readWrite);
-            clip->fillRectWithColour (destData, r, fillType.colour.getPixelARGB());
+            clip->fillRectWithColour (destData, clippedToBand (r), fillType.colour.getPixelARGB());
         }
         else
         {
-            const Rectangle<float> clipped (clip->getClipBounds().toFloat().getIntersection (r));
+            const Rectangle<float> clipped (clippedToBand (clip->getClipBounds().toFloat().getIntersection (r)));
 
             if (! clipped.isEmpty())
                 fillShape (new ClipRegions::EdgeTableRegion (clipped), false);
@@ -2286,7 +2752,7 @@ public:
     void fillPath (const Path& path, const AffineTransform& t)
     {
         if (clip != nullptr)
-            fillShape (new ClipRegions::EdgeTableRegion (clip->getClipBounds(), path, transform.getTransformWith (t)), false);
+            fillShape (new ClipRegions::EdgeTableRegion (clippedToBand (clip->getClipBounds()), path, transform.getTransformWith (t)), false);
     }
 
     void fillEdgeTable (const EdgeTable& edgeTable, const float x, const int y)
@@ -2302,6 +2768,40 @@ public:
         }
     }
 
+    // Fills the current shape using an area of a single-channel image as a mask, with the
+    // top-left of that area at the given position.
+    void fillAlphaMask (const Image& mask, const Rectangle<int>& maskArea, const int x, const int y)
+    {
+        jassert (transform.isOnlyTranslated);
+
+        if (clip != nullptr)
+        {
+            const Rectangle<int> destArea (maskArea.withPosition (x + transform.xOffset, y + transform.yOffset));
+
+            if (fillType.isColour())
+            {
+                const Rectangle<int> area (clippedToBand (clip->getClipBounds().getIntersection (destArea)));
+
+                if (! area.isEmpty())
+                {
+                    Image::BitmapData destData (image, Image::BitmapData::readWrite);
+                    const Image::BitmapData maskData (mask, maskArea.getX(), maskArea.getY(), maskArea.getWidth(), maskArea.getHeight());
+
+                    clip->fillAlphaMaskWithColour (destData, area, maskData, destArea.getX(), destArea.getY(),
+                                                   fillType.colour.getPixelARGB());
+                }
+            }
+            else
+            {
+                ClipRegions::Base::Ptr shape (new ClipRegions::EdgeTableRegion (destArea));
+                shape = shape->clipToImageAlpha (mask, AffineTransform::translation ((float) (destArea.getX() - maskArea.getX()),
+                                                                                     (float) (destArea.getY() - maskArea.getY())), false);
+                if (shape != nullptr)
+                    fillShape (shape, false);
+            }
+        }
+    }
+
     void drawGlyph (const Font& f, int glyphNumber, const AffineTransform& t)
     {
         if (clip != nullptr)
@@ -2317,7 +2817,7 @@ public:
     {
         jassert (clip != nullptr);
 
-        shapeToFill = clip->applyClipTo (shapeToFill);
+        shapeToFill = clippedToBand (clip->applyClipTo (shapeToFill));
 
         if (shapeToFill != nullptr)
         {
@@ -2383,7 +2883,7 @@ public:
                 else
                 {
                     Rectangle<int> area (tx, ty, sourceImage.getWidth(), sourceImage.getHeight());
-                    area = area.getIntersection (image.getBounds());
+                    area = clippedToBand (area.getIntersection (image.getBounds()));
 
                     if (! area.isEmpty())
                     {
@@ -2410,7 +2910,7 @@ public:
                 p.addRectangle (sourceImage.getBounds());
 
                 ClipRegions::Base::Ptr c (clip->clone());
-                c = c->clipToPath (p, t);
+                c = clippedToBand (c->clipToPath (p, t));
 
                 if (c != nullptr)
                     c->renderImageTransformed (destData, srcData, alpha, t, betterQuality, false);
@@ -2428,6 +2928,8 @@ public:
 
 private:
     float transparencyLayerAlpha;
+    Rectangle<int> band;
+    bool isDrawingToBand;
 
     void cloneClipIfMultiplyReferenced()
     {
@@ -2435,6 +2937,22 @@ private:
             clip = clip->clone();
     }
 
+    Rectangle<int> clippedToBand (const Rectangle<int>& r) const
+    {
+        return isDrawingToBand ? r.getIntersection (band) : r;
+    }
+
+    Rectangle<float> clippedToBand (const Rectangle<float>& r) const
+    {
+        // (only trims the rectangle when it has to, so that its edges aren't needlessly re-rounded)
+        return (isDrawingToBand && ! band.toFloat().contains (r)) ? r.getIntersection (band.toFloat()) : r;
+    }
+
+    ClipRegions::Base::Ptr clippedToBand (const ClipRegions::Base::Ptr& region) const
+    {
+        return (isDrawingToBand && region != nullptr) ? region->clipToRectangle (band) : region;
+    }
+
     SoftwareRendererSavedState& operator= (const SoftwareRendererSavedState&);
 };
 
@@ -30,6 +30,7 @@
     jassert (MessageManager::getInstance()->currentThreadHasLockedMessageManager() || getPeer() == nullptr);
 
 Component* Component::currentlyFocusedComponent = nullptr;
+static bool paintStatisticsEnabled = false;
 
 
 //==============================================================================
@@ -363,6 +364,60 @@ struct Component::ComponentHelpers
 
         return Desktop::getInstance().getDisplays().getMainDisplay().userArea;
     }
+
+    //==============================================================================
+    static Component::PaintStatistics* getPaintStatistics (Component& comp)
+    {
+        if (! paintStatisticsEnabled)
+            return nullptr;
+
+        if (comp.paintStatistics == nullptr)
+            comp.paintStatistics = new Component::PaintStatistics();
+
+        return comp.paintStatistics;
+    }
+
+    static void countRepaintRequest (Component& comp)
+    {
+        if (Component::PaintStatistics* const stats = getPaintStatistics (comp))
+            ++(stats->numRepaintRequests);
+    }
+
+    static void callPaint (Component& comp, Graphics& g, const bool isOverChildren)
+    {
+        if (Component::PaintStatistics* const stats = getPaintStatistics (comp))
+        {
+            const int64 startTime = Time::getHighResolutionTicks();
+
+            if (isOverChildren)
+            {
+                comp.paintOverChildren (g);
+            }
+            else
+            {
+                comp.paint (g);
+                ++(stats->numPaintCalls);
+            }
+
+            stats->totalPaintSeconds += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTime);
+        }
+        else
+        {
+            if (isOverChildren)
+                comp.paintOverChildren (g);
+            else
+                comp.paint (g);
+        }
+    }
+
+    // A layer that's only being translated can just be redrawn from its image at the new position.
+    static void repaintForTransformChange (Component& comp, const bool isOnlyMovingLayer)
+    {
+        if (isOnlyMovingLayer)
+            comp.repaintComposition();
+        else
+            comp.repaint();
+    }
 };
 
 //==============================================================================
@@ -444,16 +499,18 @@ void Component::setVisible (bool shouldBeVisible)
         const WeakReference<Component> safePointer (this);
         flags.visibleFlag = shouldBeVisible;
 
-        if (shouldBeVisible)
-            repaint();
-        else
+        if (! shouldBeVisible)
             repaintParent();
+        else if (isPaintedAsLayer())
+            repaintComposition();
+        else
+            repaint();
 
         sendFakeMouseMove();
 
         if (! shouldBeVisible)
         {
-            if (cachedImage != nullptr)
+            if (cachedImage != nullptr && ! isPaintedAsLayer())
                 cachedImage->releaseResources();
 
             if (currentlyFocusedComponent == this || isParentOf (currentlyFocusedComponent))
@@ -702,6 +759,7 @@ public:
             validArea.clear();
         }
 
+        if (! validArea.containsRectangle (bounds))
         {
             Graphics imG (image);
             LowLevelGraphicsContext& lg = imG.getInternalContext();
@@ -765,9 +823,53 @@ void Component::setBufferedToImage (const bool shouldBeBuffered)
     else
     {
         cachedImage = nullptr;
+        flags.paintedAsLayerFlag = false;
     }
 }
 
+void Component::setPaintedAsLayer (const bool shouldBeLayer)
+{
+    if (shouldBeLayer != isPaintedAsLayer())
+    {
+        setBufferedToImage (shouldBeLayer);
+        flags.paintedAsLayerFlag = shouldBeLayer;
+    }
+}
+
+bool Component::isPaintedAsLayer() const noexcept
+{
+    return flags.paintedAsLayerFlag && cachedImage != nullptr;
+}
+
+//==============================================================================
+Component::PaintStatistics::PaintStatistics() noexcept
+    : numRepaintRequests (0), numPaintCalls (0), numCachedImageDraws (0), totalPaintSeconds (0)
+{
+}
+
+void Component::setPaintStatisticsEnabled (const bool shouldBeEnabled) noexcept
+{
+    paintStatisticsEnabled = shouldBeEnabled;
+}
+
+bool Component::arePaintStatisticsEnabled() noexcept
+{
+    return paintStatisticsEnabled;
+}
+
+Component::PaintStatistics Component::getPaintStatistics() const
+{
+    return paintStatistics != nullptr ? *paintStatistics : PaintStatistics();
+}
+
+void Component::resetPaintStatistics()
+{
+    paintStatistics = nullptr;
+
+    for (int i = childComponentList.size(); --i >= 0;)
+        childComponentList.getUnchecked(i)->resetPaintStatistics();
+}
+
 //==============================================================================
 void Component::reorderChildInternal (const int sourceIndex, const int destIndex)
 {
@@ -1042,7 +1144,7 @@ void Component::setBounds (const int x, const int y, int w, int h)
             else if (! flags.hasHeavyweightPeerFlag)
                 repaintParent();
         }
-        else if (cachedImage != nullptr)
+        else if (cachedImage != nullptr && (wasResized || ! isPaintedAsLayer()))
         {
             cachedImage->invalidateAll();
         }
@@ -1219,29 +1321,32 @@ void Component::setTransform (const AffineTransform& newTransform)
     // and there will be all sorts of maths errors when converting coordinates.
     jassert (! newTransform.isSingularity());
 
+    const bool isOnlyMovingLayer = isPaintedAsLayer() && newTransform.isOnlyTranslation()
+                                     && (affineTransform == nullptr || affineTransform->isOnlyTranslation());
+
     if (newTransform.isIdentity())
     {
         if (affineTransform != nullptr)
         {
-            repaint();
+            ComponentHelpers::repaintForTransformChange (*this, isOnlyMovingLayer);
             affineTransform = nullptr;
-            repaint();
+            ComponentHelpers::repaintForTransformChange (*this, isOnlyMovingLayer);
 
             sendMovedResizedMessages (false, false);
         }
     }
     else if (affineTransform == nullptr)
     {
-        repaint();
+        ComponentHelpers::repaintForTransformChange (*this, isOnlyMovingLayer);
         affineTransform = new AffineTransform (newTransform);
-        repaint();
+        ComponentHelpers::repaintForTransformChange (*this, isOnlyMovingLayer);
         sendMovedResizedMessages (false, false);
     }
     else if (*affineTransform != newTransform)
     {
-        repaint();
+        ComponentHelpers::repaintForTransformChange (*this, isOnlyMovingLayer);
         *affineTransform = newTransform;
-        repaint();
+        ComponentHelpers::repaintForTransformChange (*this, isOnlyMovingLayer);
         sendMovedResizedMessages (false, false);
     }
 }
@@ -1731,6 +1836,10 @@ void Component::setAlpha (const float newAlpha)
             if (ComponentPeer* const peer = getPeer())
                 peer->setAlpha (newAlpha);
         }
+        else if (isPaintedAsLayer())
+        {
+            repaintComposition();
+        }
         else
         {
             repaint();
@@ -1746,16 +1855,19 @@ float Component::getAlpha() const
 //==============================================================================
 void Component::repaint()
 {
+    ComponentHelpers::countRepaintRequest (*this);
     internalRepaintUnchecked (getLocalBounds(), true);
 }
 
 void Component::repaint (const int x, const int y, const int w, const int h)
 {
+    ComponentHelpers::countRepaintRequest (*this);
     internalRepaint (Rectangle<int> (x, y, w, h));
 }
 
 void Component::repaint (const Rectangle<int>& area)
 {
+    ComponentHelpers::countRepaintRequest (*this);
     internalRepaint (area);
 }
 
@@ -1765,6 +1877,21 @@ void Component::repaintParent()
         parentComponent->internalRepaint (ComponentHelpers::convertToParentSpace (*this, getLocalBounds()));
 }
 
+// Marks the area that this component covers as needing to be redrawn, but leaves its cached image alone.
+void Component::repaintComposition()
+{
+    if (flags.hasHeavyweightPeerFlag)
+    {
+        if (flags.visibleFlag)
+            if (ComponentPeer* const peer = getPeer())
+                peer->repaint (getLocalBounds());
+    }
+    else
+    {
+        repaintParent();
+    }
+}
+
 void Component::internalRepaint (const Rectangle<int>& area)
 {
     const Rectangle<int> r (area.getIntersection (getLocalBounds()));
@@ -1775,16 +1902,18 @@ void Component::internalRepaint (const Rectangle<int>& area)
 
 void Component::internalRepaintUnchecked (const Rectangle<int>& area, const bool isEntireComponent)
 {
-    if (flags.visibleFlag)
+    // A layer keeps its image while it's invisible, so that needs invalidating even if
+    // nothing else has to be redrawn.
+    if (cachedImage != nullptr && (flags.visibleFlag || isPaintedAsLayer()))
     {
-        if (cachedImage != nullptr)
-        {
-            if (isEntireComponent)
-                cachedImage->invalidateAll();
-            else
-                cachedImage->invalidate (area);
-        }
+        if (isEntireComponent)
+            cachedImage->invalidateAll();
+        else
+            cachedImage->invalidate (area);
+    }
 
+    if (flags.visibleFlag)
+    {
         if (flags.hasHeavyweightPeerFlag)
         {
             // if component methods are being called from threads other than the message
@@ -1821,9 +1950,24 @@ void Component::paintWithinParentContext (Graphics& g)
     g.setOrigin (getX(), getY());
 
     if (cachedImage != nullptr)
-        cachedImage->paint (g);
+    {
+        if (PaintStatistics* const stats = ComponentHelpers::getPaintStatistics (*this))
+        {
+            const int numPaintCalls = stats->numPaintCalls;
+            cachedImage->paint (g);
+
+            if (stats->numPaintCalls == numPaintCalls)
+                ++(stats->numCachedImageDraws);
+        }
+        else
+        {
+            cachedImage->paint (g);
+        }
+    }
     else
+    {
         paintEntireComponent (g, false);
+    }
 }
 
 void Component::paintComponentAndChildren (Graphics& g)
@@ -1832,14 +1976,14 @@ void Component::paintComponentAndChildren (Graphics& g)
 
     if (flags.dontClipGraphicsFlag)
     {
-        paint (g);
+        ComponentHelpers::callPaint (*this, g, false);
     }
     else
     {
         g.saveState();
 
         if (ComponentHelpers::clipObscuredRegions (*this, g, clipBounds, Point<int>()) || ! g.isClipEmpty())
-            paint (g);
+            ComponentHelpers::callPaint (*this, g, false);
 
         g.restoreState();
     }
@@ -1893,7 +2037,7 @@ void Component::paintComponentAndChildren (Graphics& g)
     }
 
     g.saveState();
-    paintOverChildren (g);
+    ComponentHelpers::callPaint (*this, g, true);
     g.restoreState();
 }
 
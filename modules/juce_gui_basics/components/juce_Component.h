@@ -1002,6 +1002,73 @@ public:
     */
     void setBufferedToImage (bool shouldBeBuffered);
 
+    /** Makes the component into a retained layer, which keeps a cached image of itself.
+
+        A layer is buffered in the same way as with setBufferedToImage(), but its image is
+        kept when the component is moved, hidden or shown, has its alpha changed, or is given
+        a transform that's only a translation. Those changes just mark the area that it covers
+        in its parent as needing to be redrawn, and the parent then draws the cached image at
+        its new position without calling this component's paint() method.
+
+        The image is only redrawn after repaint() is called on this component or one of its
+        children, or when the component is resized. Because the image is also kept while the
+        component is invisible, this is best used for things like panels which get animated
+        around or faded in and out.
+
+        Calling setBufferedToImage (false) will also turn this off.
+
+        @see setBufferedToImage, isPaintedAsLayer
+    */
+    void setPaintedAsLayer (bool shouldBeLayer);
+
+    /** Returns true if setPaintedAsLayer() has been used to make this component a layer. */
+    bool isPaintedAsLayer() const noexcept;
+
+    //==============================================================================
+    /** Holds the counts and timings gathered for a component while paint statistics are enabled.
+        @see setPaintStatisticsEnabled, getPaintStatistics
+    */
+    struct PaintStatistics
+    {
+        PaintStatistics() noexcept;
+
+        /** The number of times repaint() has been called for this component, including the
+            calls that are made internally, e.g. when it's resized or made visible. */
+        int numRepaintRequests;
+
+        /** The number of times the component's paint() method has been called. */
+        int numPaintCalls;
+
+        /** The number of times the component was drawn from its cached image (see
+            setBufferedToImage() and setPaintedAsLayer()) without calling its paint() method. */
+        int numCachedImageDraws;
+
+        /** The total time spent in the component's paint() and paintOverChildren() methods.
+            This doesn't include any time spent painting its children. */
+        double totalPaintSeconds;
+    };
+
+    /** Turns the gathering of paint statistics on or off for all components.
+
+        This is turned off by default. While it's on, every paint() call gets timed, so
+        it's only really intended for profiling and debugging.
+        @see getPaintStatistics
+    */
+    static void setPaintStatisticsEnabled (bool shouldBeEnabled) noexcept;
+
+    /** Returns true if paint statistics are being gathered.
+        @see setPaintStatisticsEnabled
+    */
+    static bool arePaintStatisticsEnabled() noexcept;
+
+    /** Returns the paint statistics that have been gathered for this component.
+        @see setPaintStatisticsEnabled, resetPaintStatistics
+    */
+    PaintStatistics getPaintStatistics() const;
+
+    /** Clears the paint statistics of this component and all of its children. */
+    void resetPaintStatistics();
+
     /** Generates a snapshot of part of this component.
 
         This will return a new Image, the size of the rectangle specified,
@@ -2242,6 +2309,7 @@ private:
     MouseCursor cursor;
     ImageEffectFilter* effect;
     ScopedPointer <CachedComponentImage> cachedImage;
+    ScopedPointer <PaintStatistics> paintStatistics;
 
     class MouseListenerList;
     friend class MouseListenerList;
@@ -2273,6 +2341,7 @@ private:
         bool childCompFocusedFlag       : 1;
         bool dontClipGraphicsFlag       : 1;
         bool mouseDownWasBlocked        : 1;
+        bool paintedAsLayerFlag         : 1;
       #if JUCE_DEBUG
         bool isInsidePaintCall          : 1;
       #endif
@@ -2312,6 +2381,7 @@ private:
     void paintWithinParentContext (Graphics&);
     void sendMovedResizedMessages (bool wasMoved, bool wasResized);
     void repaintParent();
+    void repaintComposition();
     void sendFakeMouseMove() const;
     void takeKeyboardFocus (const FocusChangeType);
     void grabFocusInternal (const FocusChangeType, bool canTryParent);